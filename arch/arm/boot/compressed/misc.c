@@ -185,16 +185,41 @@ static inline __ptr_t memcpy(__ptr_t __dest, __const __ptr_t __src,
 	return __dest;
 }
 
-/*
- * gzip delarations
- */
-#define OF(args)  args
 #define STATIC static
 
 typedef unsigned char  uch;
 typedef unsigned short ush;
 typedef unsigned long  ulg;
 
+static void error(char *m);
+
+static void putstr(const char *);
+
+extern char input_data[];
+extern char input_data_end[];
+
+static uch *output_data;
+static ulg output_ptr;
+
+extern int end;
+static ulg free_mem_ptr;
+static ulg free_mem_end_ptr;
+
+#ifdef CONFIG_KERNEL_LZO
+
+/*
+ * The LZO decompressor writes straight to the output, so it needs neither
+ * a window nor an input buffer. The image ends with its uncompressed size,
+ * appended by the build as a little endian word.
+ */
+#include "../../../../lib/decompress_unlzo.c"
+
+#else
+
+/*
+ * gzip delarations
+ */
+#define OF(args)  args
 #define WSIZE 0x8000		/* Window size must be at least 32k, */
 				/* and a power of two */
 
@@ -235,23 +260,9 @@ static unsigned outcnt;		/* bytes in output buffer */
 
 static int  fill_inbuf(void);
 static void flush_window(void);
-static void error(char *m);
-
-extern char input_data[];
-extern char input_data_end[];
 
-static uch *output_data;
-static ulg output_ptr;
 static ulg bytes_out;
 
-static void error(char *m);
-
-static void putstr(const char *);
-
-extern int end;
-static ulg free_mem_ptr;
-static ulg free_mem_end_ptr;
-
 #ifdef STANDALONE_DEBUG
 #define NO_INFLATE_MALLOC
 #endif
@@ -299,6 +310,8 @@ void flush_window(void)
 	putstr(".");
 }
 
+#endif /* CONFIG_KERNEL_LZO */
+
 #ifndef arch_error
 #define arch_error(x)
 #endif
@@ -327,9 +340,15 @@ decompress_kernel(ulg output_start, ulg free_mem_ptr_p, ulg free_mem_ptr_end_p,
 
 	arch_decomp_setup();
 
-	makecrc();
 	putstr("Uncompressing Linux...");
+#ifdef CONFIG_KERNEL_LZO
+	unlzo((uch *)input_data, input_data_end - input_data, NULL, NULL,
+	      output_data, NULL, error);
+	output_ptr = get_unaligned_le32(input_data_end - 4);
+#else
+	makecrc();
 	gunzip();
+#endif
 	putstr(" done, booting the kernel.\n");
 	return output_ptr;
 }
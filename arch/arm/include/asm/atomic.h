@@ -236,5 +236,6 @@ static inline int atomic_add_unless(atomic_t *v, int a, int u)
 #define smp_mb__after_atomic_inc()	smp_mb()
 
 #include <asm-generic/atomic-long.h>
+#include <asm-generic/atomic64.h>
 #endif
 #endif
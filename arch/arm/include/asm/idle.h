@@ -0,0 +1,25 @@
+/*
+ *  arch/arm/include/asm/idle.h
+ *
+ *  Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef ASMARM_IDLE_H
+#define ASMARM_IDLE_H
+
+#include <linux/notifier.h>
+
+/*
+ * Called from the idle thread when it starts and stops idling, around
+ * whatever pm_idle is installed (cpuidle replaces it).
+ */
+#define IDLE_START	1
+#define IDLE_END	2
+
+extern void idle_notifier_register(struct notifier_block *n);
+extern void idle_notifier_unregister(struct notifier_block *n);
+
+#endif
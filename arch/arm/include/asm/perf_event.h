@@ -0,0 +1,29 @@
+/*
+ *  arch/arm/include/asm/perf_event.h
+ *
+ *  Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ARM_PERF_EVENT_H__
+#define __ARM_PERF_EVENT_H__
+
+/*
+ * The PMU interrupt is a regular interrupt and not an NMI, so the counter
+ * overflow handler calls perf_event_do_pending() itself and there is
+ * nothing to kick here.
+ */
+static inline void
+set_perf_event_pending(void)
+{
+}
+
+/*
+ * The counters are numbered from 1 in the cp15 accesses, so use the same
+ * numbering for the index exported to user space.
+ */
+#define PERF_EVENT_INDEX_OFFSET	1
+
+#endif /* __ARM_PERF_EVENT_H__ */
@@ -241,60 +241,35 @@ static int s5p6450_armclk_set_rate(struct clk *clk, unsigned long rate)
 
 	if (iter >= ctable.clock_table_size)
 		iter = ctable.clock_table_size - 1;
-	
 
+	/*
+	 * The ARM, HCLK and PCLK dividers of the level are written to
+	 * CLK_DIV0 at once, so no mix of the old and the new ratios is ever
+	 * used, and the transition costs one write per register.
+	 */
 	local_irq_save(flags);
+	clk_div0_tmp = __raw_readl(ARM_CLK_DIV) & ~(ARM_DIV_MASK |
+			S5P_CLKDIV0_HCLK166_MASK | S5P_CLKDIV0_PCLK83_MASK);
+	clk_div0_tmp |= ctable.clock_table[iter][1] |
+			ctable.clock_table[iter][2] |
+			ctable.clock_table[iter][3];
+
+	clk_div3_tmp = __raw_readl(S5P_CLK_DIV3) & ~(S5P_CLKDIV3_MALI_MASK);
+	clk_div3_tmp |= ctable.clock_table[iter][4];
+
 	if (cur_rate > round_tmp) {
 		/* Frequency Down */
-		clk_div0_tmp = __raw_readl(ARM_CLK_DIV) & ~(ARM_DIV_MASK);
-		clk_div0_tmp |= ctable.clock_table[iter][1];
 		__raw_writel(clk_div0_tmp, ARM_CLK_DIV);
-
-		clk_div0_tmp = __raw_readl(ARM_CLK_DIV) &
-				~(S5P_CLKDIV0_HCLK166_MASK);
-		clk_div0_tmp |= ctable.clock_table[iter][2];
-		__raw_writel(clk_div0_tmp, ARM_CLK_DIV);  //prob
-		
-
-#if 1
-			clk_div0_tmp = __raw_readl(ARM_CLK_DIV) &
-						~(S5P_CLKDIV0_PCLK83_MASK);
-			clk_div0_tmp |= ctable.clock_table[iter][3];
-			__raw_writel(clk_div0_tmp, ARM_CLK_DIV);  //prob
-#endif			
-			clk_div0_tmp = __raw_readl(S5P_CLK_DIV3) &
-						~(S5P_CLKDIV3_MALI_MASK);
-			clk_div0_tmp |= ctable.clock_table[iter][4];
-			__raw_writel(clk_div0_tmp, S5P_CLK_DIV3);  //prob
-
+		__raw_writel(clk_div3_tmp, S5P_CLK_DIV3);
 	} else {
 		/* Frequency Up */
-		clk_div0_tmp = __raw_readl(ARM_CLK_DIV) &
-				~(S5P_CLKDIV0_HCLK166_MASK);
-		clk_div0_tmp |= ctable.clock_table[iter][2];
-		__raw_writel(clk_div0_tmp, ARM_CLK_DIV);
-
-#if 1		
-			clk_div0_tmp = __raw_readl(ARM_CLK_DIV) &
-						~(S5P_CLKDIV0_PCLK83_MASK);
-			clk_div0_tmp |= ctable.clock_table[iter][3];
-			__raw_writel(clk_div0_tmp, ARM_CLK_DIV);  //prob
-			clk_div0_tmp = __raw_readl(S5P_CLK_DIV3) &
-						~(S5P_CLKDIV3_MALI_MASK);
-			clk_div0_tmp |= ctable.clock_table[iter][4];
-			__raw_writel(clk_div0_tmp, S5P_CLK_DIV3);  //prob
-
-
-#endif			
-
-		clk_div0_tmp = __raw_readl(ARM_CLK_DIV) & ~(ARM_DIV_MASK);
-		clk_div0_tmp |= ctable.clock_table[iter][1];
+		__raw_writel(clk_div3_tmp, S5P_CLK_DIV3);
 		__raw_writel(clk_div0_tmp, ARM_CLK_DIV);
-		}
+	}
 	local_irq_restore(flags);
 
 	clk->rate = ctable.clock_table[iter][0];
-	printk("ARM clk freq    -----   %u\n",clk->rate);
+	pr_debug("ARM clk freq    -----   %u\n",clk->rate);
 	return 0;
 }
 
@@ -0,0 +1,321 @@
+/*
+ *  arch/arm/mach-s5p6450/cpuidle.c
+ *
+ *  Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * CPU idle driver for the S5P6450.
+ *
+ * The SoC offers two idle states which resume on an ordinary interrupt: a
+ * plain WFI, in which only the ARM1176 core stops its own clock, and the
+ * SYSCON IDLE mode, in which the clock controller also gates the ARM clock
+ * domain. IDLE is what the default idle loop (s5p6450_idle) enters every
+ * time, so this driver saves no power over it; what it adds is the cheaper
+ * to leave WFI for short idles and the statistics below.
+ *
+ * There is nothing deeper to offer: the ARM domain cannot be power gated on
+ * its own, and STOP and SLEEP stop the PWM timers driving the clockevent and
+ * only wake up on external or RTC interrupts, so they are left to suspend.
+ *
+ * The exit latencies are not taken from a datasheet but measured at boot:
+ * each state is entered with the clockevent armed, and the time from its
+ * programmed expiry to the core running again is the cost of leaving it.
+ *
+ * Per-state residency statistics are shown in debugfs/s5p6450_idle; writing
+ * to the file clears them.
+ */
+
+#include <linux/cpuidle.h>
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/hrtimer.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/tick.h>
+
+#include <asm/proc-fns.h>
+
+#include <mach/map.h>
+#include <mach/regs-clock.h>
+
+#define S5P6450_IDLE_STATES	2
+
+/* < 10us, < 100us, < 1ms, < 10ms, < 100ms, < 1s, >= 1s */
+#define S5P6450_IDLE_BUCKETS	7
+
+#define S5P6450_IDLE_CAL_LOOPS	16
+#define S5P6450_IDLE_CAL_TRIES	(4 * S5P6450_IDLE_CAL_LOOPS)
+#define S5P6450_IDLE_CAL_US	200	/* timer armed this far ahead */
+
+struct s5p6450_idle_stats {
+	unsigned long	count;
+	unsigned long	short_count;	/* left before target_residency */
+	u32		max_us;
+	u64		total_us;
+	unsigned long	bucket[S5P6450_IDLE_BUCKETS];
+};
+
+static struct cpuidle_driver s5p6450_idle_driver = {
+	.name	= "s5p6450_idle",
+	.owner	= THIS_MODULE,
+};
+
+static DEFINE_PER_CPU(struct cpuidle_device, s5p6450_idle_dev);
+
+/* The S5P6450 has a single core, so the statistics are not per cpu */
+static struct s5p6450_idle_stats idle_stats[S5P6450_IDLE_STATES];
+
+/*
+ * PWR_CFG is rewritten on every entry rather than once at registration
+ * because the suspend code programs it for SLEEP.
+ */
+static void s5p6450_idle_wfi(u32 mode)
+{
+	u32 val;
+
+	val = __raw_readl(S5P_PWR_CFG);
+	val &= ~S5P6450_PWRCFG_CFG_WFI_MASK;
+	val |= mode;
+	__raw_writel(val, S5P_PWR_CFG);
+
+	cpu_do_idle();
+}
+
+static void s5p6450_idle_account(struct cpuidle_state *state, u32 us)
+{
+	struct s5p6450_idle_stats *st = cpuidle_get_statedata(state);
+	u32 limit = 10;
+	int b;
+
+	for (b = 0; b < S5P6450_IDLE_BUCKETS - 1 && us >= limit; b++)
+		limit *= 10;
+
+	st->count++;
+	st->total_us += us;
+	if (us > st->max_us)
+		st->max_us = us;
+	if (us < state->target_residency)
+		st->short_count++;
+	st->bucket[b]++;
+}
+
+static int s5p6450_enter_state(struct cpuidle_device *dev,
+			       struct cpuidle_state *state, u32 mode)
+{
+	ktime_t before, after;
+	u32 us;
+
+	before = ktime_get();
+	s5p6450_idle_wfi(mode);
+	after = ktime_get();
+
+	local_irq_enable();
+
+	us = ktime_us_delta(after, before);
+	s5p6450_idle_account(state, us);
+
+	return us;
+}
+
+static int s5p6450_enter_wfi(struct cpuidle_device *dev,
+			     struct cpuidle_state *state)
+{
+	return s5p6450_enter_state(dev, state,
+				   S5P6450_PWRCFG_CFG_WFI_IGNORE);
+}
+
+static int s5p6450_enter_idle(struct cpuidle_device *dev,
+			      struct cpuidle_state *state)
+{
+	return s5p6450_enter_state(dev, state, S5P6450_PWRCFG_CFG_WFI_IDLE);
+}
+
+static enum hrtimer_restart __init s5p6450_idle_cal_wake(struct hrtimer *t)
+{
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Returns the average time, rounded up to the next microsecond, from the
+ * expiry the clockevent was programmed for to the core running again after
+ * the WFI of @mode. The hrtimer makes sure an expiry is near; without high
+ * resolution timers it is the next tick. Wake ups by other interrupts come
+ * back before that expiry and are not counted.
+ */
+static unsigned int __init s5p6450_idle_calibrate(u32 mode)
+{
+	struct clock_event_device *evt = tick_get_device(0)->evtdev;
+	struct hrtimer timer;
+	ktime_t expires, now;
+	u64 total_ns = 0;
+	int i, n = 0;
+
+	hrtimer_init_on_stack(&timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	timer.function = s5p6450_idle_cal_wake;
+
+	for (i = 0; i < S5P6450_IDLE_CAL_TRIES &&
+		    n < S5P6450_IDLE_CAL_LOOPS; i++) {
+		local_irq_disable();
+		hrtimer_start(&timer, ktime_add_us(ktime_get(),
+						   S5P6450_IDLE_CAL_US),
+			      HRTIMER_MODE_ABS);
+
+		/* cannot change before the interrupt is handled */
+		expires = evt->next_event;
+		s5p6450_idle_wfi(mode);
+		now = ktime_get();
+
+		local_irq_enable();
+		hrtimer_cancel(&timer);
+
+		if (ktime_to_ns(now) < ktime_to_ns(expires))
+			continue;
+
+		total_ns += ktime_to_ns(ktime_sub(now, expires));
+		n++;
+	}
+
+	destroy_hrtimer_on_stack(&timer);
+
+	if (!n) {
+		printk(KERN_WARNING "s5p6450_idle: could not calibrate\n");
+		return 1;
+	}
+
+	return max_t(unsigned int, 1,
+		     div64_u64(total_ns + n * 1000 - 1, n * 1000));
+}
+
+static void __init s5p6450_idle_setup_state(struct cpuidle_state *state,
+					    const char *name, const char *desc,
+					    u32 mode, struct s5p6450_idle_stats *st,
+					    int (*enter)(struct cpuidle_device *,
+							 struct cpuidle_state *))
+{
+	strcpy(state->name, name);
+	strcpy(state->desc, desc);
+	state->exit_latency = s5p6450_idle_calibrate(mode);
+	/*
+	 * Entering and leaving run at full power, so the state only pays off
+	 * once it has been resident for longer than it took to get through.
+	 */
+	state->target_residency = 2 * state->exit_latency;
+	state->flags = CPUIDLE_FLAG_TIME_VALID;
+	state->enter = enter;
+	cpuidle_set_statedata(state, st);
+
+	printk(KERN_INFO "s5p6450_idle: %s exit latency %uus\n",
+	       name, state->exit_latency);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int s5p6450_idle_show(struct seq_file *s, void *unused)
+{
+	struct cpuidle_device *dev = &per_cpu(s5p6450_idle_dev, 0);
+	struct s5p6450_idle_stats st;
+	unsigned long flags;
+	int i, b;
+
+	seq_printf(s, "%-6s %7s %7s %10s %10s %7s %9s %10s"
+		   "  <10us <100us   <1ms  <10ms <100ms    <1s   >=1s\n",
+		   "state", "lat_us", "tgt_us", "count", "total_ms", "avg_us",
+		   "max_us", "short");
+
+	for (i = 0; i < dev->state_count; i++) {
+		struct cpuidle_state *state = &dev->states[i];
+
+		local_irq_save(flags);
+		st = idle_stats[i];
+		local_irq_restore(flags);
+
+		seq_printf(s, "%-6s %7u %7u %10lu %10llu %7llu %9u %10lu",
+			   state->name, state->exit_latency,
+			   state->target_residency, st.count,
+			   (unsigned long long)div64_u64(st.total_us, 1000),
+			   st.count ? (unsigned long long)
+				div64_u64(st.total_us, st.count) : 0ULL,
+			   st.max_us, st.short_count);
+		for (b = 0; b < S5P6450_IDLE_BUCKETS; b++)
+			seq_printf(s, " %6lu", st.bucket[b]);
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+
+static int s5p6450_idle_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s5p6450_idle_show, NULL);
+}
+
+static ssize_t s5p6450_idle_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	memset(idle_stats, 0, sizeof(idle_stats));
+	local_irq_restore(flags);
+
+	return count;
+}
+
+static const struct file_operations s5p6450_idle_fops = {
+	.owner		= THIS_MODULE,
+	.open		= s5p6450_idle_open,
+	.read		= seq_read,
+	.write		= s5p6450_idle_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init s5p6450_idle_debugfs_init(void)
+{
+	debugfs_create_file("s5p6450_idle", S_IRUGO | S_IWUSR, NULL, NULL,
+			    &s5p6450_idle_fops);
+}
+#else
+static inline void s5p6450_idle_debugfs_init(void) { }
+#endif
+
+static int __init s5p6450_idle_init(void)
+{
+	struct cpuidle_device *dev;
+	int ret;
+
+	ret = cpuidle_register_driver(&s5p6450_idle_driver);
+	if (ret)
+		return ret;
+
+	dev = &per_cpu(s5p6450_idle_dev, 0);
+
+	s5p6450_idle_setup_state(&dev->states[0], "WFI",
+				 "ARM wait for interrupt",
+				 S5P6450_PWRCFG_CFG_WFI_IGNORE, &idle_stats[0],
+				 s5p6450_enter_wfi);
+	s5p6450_idle_setup_state(&dev->states[1], "IDLE",
+				 "ARM clock domain gated",
+				 S5P6450_PWRCFG_CFG_WFI_IDLE, &idle_stats[1],
+				 s5p6450_enter_idle);
+	dev->state_count = S5P6450_IDLE_STATES;
+
+	ret = cpuidle_register_device(dev);
+	if (ret) {
+		printk(KERN_ERR "s5p6450_idle: failed to register device\n");
+		cpuidle_unregister_driver(&s5p6450_idle_driver);
+		return ret;
+	}
+
+	s5p6450_idle_debugfs_init();
+
+	return 0;
+}
+
+device_initcall(s5p6450_idle_init);
@@ -134,6 +134,21 @@ static struct s5p_dma_map __initdata s5pv210_dma_mappings[] = {
 		.channels		= MAP0(S3C_DMA_M2M),
 		.hw_addr.from	= 0,
 	},
+	[DMACH_3D_M2M1] = {
+		.name			= "3D-M2M1",
+		.channels		= MAP0(S3C_DMA_M2M),
+		.hw_addr.from	= 0,
+	},
+	[DMACH_3D_M2M2] = {
+		.name			= "3D-M2M2",
+		.channels		= MAP0(S3C_DMA_M2M),
+		.hw_addr.from	= 0,
+	},
+	[DMACH_3D_M2M3] = {
+		.name			= "3D-M2M3",
+		.channels		= MAP0(S3C_DMA_M2M),
+		.hw_addr.from	= 0,
+	},
 	[DMACH_I2S_V40_IN] = {
 		.name			= "i2s-v40-in",
 		.channels		= MAP0(S3C_DMA0_I2S0_RX),
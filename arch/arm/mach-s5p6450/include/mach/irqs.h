@@ -80,6 +80,7 @@
 
 #define IRQ_EINT_GROUPS		S5P_IRQ_VIC1(21)
 #define IRQ_HOST	        S5P_IRQ_VIC1(22)
+#define IRQ_PMUIRQ		S5P_IRQ_VIC1(23)
 
 
 #define IRQ_HSMMC0		S5P_IRQ_VIC1(24)
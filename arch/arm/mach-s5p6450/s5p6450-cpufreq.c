@@ -18,6 +18,9 @@
 #include <linux/io.h>
 #include <linux/regulator/consumer.h>
 #include <linux/gpio.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <asm/system.h>
 
 #include <plat/pll.h>
@@ -34,25 +37,57 @@ static struct clk *mpu_clk;
 
 static struct regulator *arm_regulator;
 static struct regulator *internal_regulator;
-static enum perf_level bootup_level;
 
 #if defined(CONFIG_S5P64XX_LTC3714)             
 extern int set_power(unsigned int freq);
 extern void ltc3714_init(void);
 #endif
 
-struct s5p6450_cpufreq_freqs s5p6450_freqs;
-
 /* Based on MAX8698C 
  * RAMP time : 1
  **/
 #define PMIC_RAMP_UP	10
-static unsigned long previous_arm_volt;
 
-/* If you don't need to wait exact ramp up delay
- * you can use fixed delay time
- **/
-//#define USE_FIXED_RAMP_UP_DELAY
+/* DRAM refresh counter, 7.8usec at the high and the low HCLK */
+#define S5P6450_DMC_REFRESH		(S3C_VA_MEM + 0x30)
+#define S5P6450_DMC_REFRESH_HCLK_HIGH	0x50E
+#define S5P6450_DMC_REFRESH_HCLK_LOW	0x287
+
+/* a lower voltage is only applied once the level has been kept this long */
+#define S5P6450_VOLT_DOWN_DELAY		msecs_to_jiffies(50)
+
+/*
+ * Everything a transition needs is worked out once per level at init, so
+ * that s5p6450_target() only has to look it up. The clock dividers of the
+ * level are in ctable.clock_table.
+ */
+struct s5p6450_opp {
+	unsigned int	freq;		/* kHz */
+	unsigned long	arm_volt;	/* uV */
+	unsigned long	int_volt;	/* uV */
+	u32		dmc_refresh;
+};
+
+#define S5P6450_MAX_OPPS	4
+
+static struct s5p6450_opp s5p6450_opps[S5P6450_MAX_OPPS];
+static unsigned int s5p6450_nr_opps;
+
+/* lowest ARM voltage of all levels, where a ramp of unknown origin starts */
+static unsigned long s5p6450_min_arm_volt;
+static unsigned long s5p6450_max_arm_volt;
+
+/*
+ * cur_opp is the level the clock is at, volt_opp the one the voltage is
+ * set for, or NULL when it is not known. volt_opp is never below cur_opp.
+ */
+static DEFINE_MUTEX(s5p6450_dvfs_lock);
+static struct s5p6450_opp *cur_opp;
+static struct s5p6450_opp *volt_opp;
+
+static struct workqueue_struct *s5p6450_volt_wq;
+static void s5p6450_volt_down(struct work_struct *work);
+static DECLARE_DELAYED_WORK(s5p6450_volt_work, s5p6450_volt_down);
 
 /* frequency table*/
 #if 0
@@ -163,31 +198,6 @@ static u32 clkdiv_val[3][5] = {
 	{3, 3, 1, 4, 1, },
 };
 #endif
-static struct s5p6450_domain_freq s5p6450_clk_info[] = {
-	{
-		.apll_out 	= 800000,
-		.armclk 	= 800000,
-		.hclk_high 	= 166000,
-		.pclk_high 	= 83000,
-		.hclk_low 	= 133000,
-		.pclk_low 	= 66000,
-	}, {
-		.apll_out 	= 667000,
-		.armclk 	= 333000,
-		.hclk_high 	= 166000,
-		.pclk_high 	= 83000,
-		.hclk_low 	= 133000,
-		.pclk_low 	= 66000,
-	}, {
-		.apll_out 	= 533000,
-		.armclk 	= 533000,
-		.hclk_high 	= 133000,
-		.pclk_high 	= 66000,
-		.hclk_low 	= 133000,
-		.pclk_low 	= 66000,
-	}, 
-};
-
 int s5p6450_verify_speed(struct cpufreq_policy *policy)
 {
 
@@ -209,118 +219,158 @@ unsigned int s5p6450_getspeed(unsigned int cpu)
 	return rate;
 }
 
+/* with the dvfs lock held */
+static int s5p6450_set_voltage(struct s5p6450_opp *opp)
+{
+	int ret = 0;
+
+#if defined(CONFIG_S5P64XX_LTC3714)
+	ret = set_power(opp->freq);
+#elif (defined(CONFIG_S5P6450_S5M8752) || defined(CONFIG_S5P6450_S5M8751))
+	ret = regulator_set_voltage(arm_regulator, opp->arm_volt,
+				    opp->arm_volt);
+#if defined(CONFIG_S5P6450_S5M8752)
+	if (!ret && internal_regulator)
+		ret = regulator_set_voltage(internal_regulator, opp->int_volt,
+					    opp->int_volt);
+#endif
+#endif
+	if (ret) {
+		if (printk_ratelimit())
+			printk(KERN_ERR "%s: can't set %lu uV for %u kHz\n",
+			       __func__, opp->arm_volt, opp->freq);
+		volt_opp = NULL;
+		return ret;
+	}
+
+	volt_opp = opp;
+	return 0;
+}
+
+/*
+ * Lowering the voltage is left until the new level has been kept for a
+ * while: the CPU is already running at the lower clock, and a governor
+ * that goes back up in the meantime saves both regulator writes.
+ */
+static void s5p6450_volt_down(struct work_struct *work)
+{
+	mutex_lock(&s5p6450_dvfs_lock);
+	if (cur_opp && (!volt_opp || volt_opp->arm_volt > cur_opp->arm_volt ||
+			volt_opp->int_volt > cur_opp->int_volt))
+		s5p6450_set_voltage(cur_opp);
+	mutex_unlock(&s5p6450_dvfs_lock);
+}
+
 static int s5p6450_target(struct cpufreq_policy *policy,
 		       unsigned int target_freq,
 		       unsigned int relation)
 {
+	struct cpufreq_freqs freqs;
+	struct s5p6450_opp *opp;
+	unsigned int index;
+	ktime_t start, ramp_start;
+	long ramp_us = 0;
+	s64 latency;
 	int ret = 0;
-	unsigned long arm_clk;
-	unsigned int index, arm_volt, int_volt;
-	unsigned int bus_speed_changing = 0;
-	unsigned int i;
 
-	s5p6450_freqs.freqs.old = s5p6450_getspeed(0);
 	if (cpufreq_frequency_table_target(policy, ctable.freq_table,
-		target_freq, relation, &index)) {
-		ret = -EINVAL;
-		goto out;
-	}
+		target_freq, relation, &index))
+		return -EINVAL;
 
-	arm_clk = ctable.freq_table[index].frequency;
+	opp = &s5p6450_opps[index];
 
-	for(i = 0;i<sizeof(s5p6450_dvs_confs);i++){
-		if(arm_clk == s5p6450_dvs_confs[i].lvl){
-			 index = i;
-			 break;
-		}
-	}
+	mutex_lock(&s5p6450_dvfs_lock);
 
-	s5p6450_freqs.freqs.new = arm_clk;
-	s5p6450_freqs.freqs.cpu = 0;
+	if (opp == cur_opp)
+		goto out;
 
-#if (defined(CONFIG_S5P6450_S5M8752) || defined(CONFIG_S5P6450_S5M8751))
-	if (s5p6450_freqs.freqs.new == s5p6450_freqs.freqs.old){
-		if(s5p6450_dvs_confs[index].arm_volt != regulator_get_voltage(arm_regulator)){
-			printk(KERN_INFO "adjusting ARM_VDD and  INT_VDD\n");
-			regulator_set_voltage(arm_regulator, s5p6450_dvs_confs[index].arm_volt,s5p6450_dvs_confs[index].arm_volt);
-#if defined(CONFIG_S5P6450_S5M8752)
-			regulator_set_voltage(internal_regulator, s5p6450_dvs_confs[index].int_volt,s5p6450_dvs_confs[index].int_volt);
-#endif
+	freqs.old = cur_opp->freq;
+	freqs.new = opp->freq;
+	freqs.cpu = 0;
+
+	/* the regulator write and the ramp are part of the transition */
+	start = ktime_get();
+	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+
+	/*
+	 * Going up, the voltage must be up before the clock is. It may still
+	 * be from a higher level whose voltage was not lowered yet. If it
+	 * cannot be raised the transition is abandoned: it ends where it
+	 * started, and only loops_per_jiffy is left scaled up, which makes
+	 * delays longer until the next transition.
+	 */
+	if (freqs.new > freqs.old &&
+	    (!volt_opp || volt_opp->arm_volt < opp->arm_volt ||
+	     volt_opp->int_volt < opp->int_volt)) {
+		unsigned long from = volt_opp ? volt_opp->arm_volt :
+					s5p6450_min_arm_volt;
+
+		ramp_start = ktime_get();
+		ret = s5p6450_set_voltage(opp);
+		if (ret) {
+			freqs.new = freqs.old;
+			cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
+			goto out;
 		}
-		return 0;
+		/*
+		 * Based on 10mV/usec ramp up speed; the regulator write itself
+		 * takes part of it. A voltage which is not known may be as low
+		 * as that of the slowest level.
+		 */
+		if (opp->arm_volt > from)
+			ramp_us = (opp->arm_volt - from) / 1000 / PMIC_RAMP_UP -
+				ktime_us_delta(ktime_get(), ramp_start);
+		if (ramp_us > 0)
+			udelay(ramp_us);
 	}
-#endif
 
-#if (defined(CONFIG_S5P6450_S5M8752) || defined(CONFIG_S5P6450_S5M8751))
-	arm_volt = s5p6450_dvs_confs[index].arm_volt;
-#endif
+	if (freqs.new > freqs.old) {
+		ret = clk_set_rate(mpu_clk, opp->freq * KHZ_T);
 
-#if defined(CONFIG_S5P6450_S5M8752)
-	int_volt = s5p6450_dvs_confs[index].int_volt;
-#endif 
-
-	/* Check if there need to change System bus clock */
-	if (s5p6450_freqs.new.hclk_high != s5p6450_freqs.old.hclk_high)
-	        bus_speed_changing = 1;
-
-	/* iNew clock inforamtion update */
-	memcpy(&s5p6450_freqs.new, &s5p6450_clk_info[index],
-					sizeof(struct s5p6450_domain_freq));
-	cpufreq_notify_transition(&s5p6450_freqs.freqs, CPUFREQ_PRECHANGE);
-
-	if (s5p6450_freqs.freqs.new > s5p6450_freqs.freqs.old) {
-		/*voltage up */		
-#if defined(CONFIG_S5P64XX_LTC3714)             
-                set_power(s5p6450_freqs.freqs.new);
-                ret = clk_set_rate(mpu_clk, s5p6450_freqs.freqs.new * KHZ_T);
-                if (ret != 0)
-                        pr_info("frequency scaling error\n");
-#endif
-
-#if (defined(CONFIG_S5P6450_S5M8752) || defined(CONFIG_S5P6450_S5M8751))
-		regulator_set_voltage(arm_regulator, arm_volt, arm_volt);
-#if defined(CONFIG_S5P6450_S5M8752)
-		regulator_set_voltage(internal_regulator, int_volt,	int_volt);
-#endif
-//		s5p6450_set_dvi_for_dvfs(index);
-                ret = clk_set_rate(mpu_clk, s5p6450_freqs.freqs.new * KHZ_T);
-#endif
-		if(bus_speed_changing)
-			__raw_writel(0X50E, S3C_VA_MEM + 0x30);
+		if (opp->dmc_refresh != cur_opp->dmc_refresh)
+			__raw_writel(opp->dmc_refresh, S5P6450_DMC_REFRESH);
 	} else {
-		/* Voltage down */
-		if(bus_speed_changing)
-			__raw_writel(0X287, S3C_VA_MEM + 0x30);
-#if defined(CONFIG_S5P64XX_LTC3714)             
-                 ret = clk_set_rate(mpu_clk, s5p6450_freqs.freqs.new * KHZ_T);
-                if (ret != 0)
-                        pr_info("frequency scaling error\n");
-                set_power(s5p6450_freqs.freqs.new);
-#endif
+		if (opp->dmc_refresh != cur_opp->dmc_refresh)
+			__raw_writel(opp->dmc_refresh, S5P6450_DMC_REFRESH);
 
-#if (defined(CONFIG_S5P6450_S5M8752) || defined(CONFIG_S5P6450_S5M8751))
-                ret = clk_set_rate(mpu_clk, s5p6450_freqs.freqs.new * KHZ_T);
-		regulator_set_voltage(arm_regulator, arm_volt,arm_volt);
-#endif
-#if defined(CONFIG_S5P6450_S5M8752)
-		regulator_set_voltage(internal_regulator, int_volt,	int_volt);
-#endif
+		ret = clk_set_rate(mpu_clk, opp->freq * KHZ_T);
+
+		queue_delayed_work(s5p6450_volt_wq, &s5p6450_volt_work,
+				   S5P6450_VOLT_DOWN_DELAY);
 	}
 
-	printk(KERN_INFO "Tfreq: %u\tOfreq: %u\tPolfreqs: %u   Volt: %u\n",target_freq,s5p6450_freqs.freqs.old,s5p6450_freqs.freqs.new,arm_volt);
-	cpufreq_notify_transition(&s5p6450_freqs.freqs, CPUFREQ_POSTCHANGE);
+	if (ret)
+		pr_info("frequency scaling error\n");
 
-	memcpy(&s5p6450_freqs.old, &s5p6450_freqs.new, sizeof(struct s5p6450_domain_freq));
-	printk(KERN_INFO "Perf changed[L%d]\n", index);
+	cur_opp = opp;
+	pr_debug("Tfreq: %u\tOfreq: %u\tPolfreqs: %u   Volt: %lu\n",
+		 target_freq, freqs.old, freqs.new,
+		 volt_opp ? volt_opp->arm_volt : 0);
 
-#if (defined(CONFIG_S5P6450_S5M8752) || defined(CONFIG_S5P6450_S5M8751))
-	previous_arm_volt = s5p6450_dvs_confs[index].arm_volt;
-#endif
+	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
+	/* governors size their sampling on the slowest transition seen */
+	latency = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (latency > policy->cpuinfo.transition_latency)
+		policy->cpuinfo.transition_latency = latency;
 out:
+	mutex_unlock(&s5p6450_dvfs_lock);
 	return ret;
 }
 
+static struct s5p6450_opp *s5p6450_find_opp(unsigned int freq)
+{
+	unsigned int i;
+
+	for (i = 0; i < s5p6450_nr_opps; i++) {
+		if (s5p6450_opps[i].freq == freq)
+			return &s5p6450_opps[i];
+	}
+
+	/* not a level of ours: the fastest needs the highest voltage */
+	return &s5p6450_opps[0];
+}
+
 static int s5p6450_cpufreq_suspend(struct cpufreq_policy *policy,
 			pm_message_t pmsg)
 {
@@ -330,17 +380,67 @@ return ret;
 
 static int s5p6450_cpufreq_resume(struct cpufreq_policy *policy)
 {
-	int ret = 0;
-	/* Clock inforamtion update with wakeup value */
-	memcpy(&s5p6450_freqs.old, &s5p6450_clk_info[bootup_level],
-			sizeof(struct s5p6450_domain_freq));
-	previous_arm_volt = s5p6450_dvs_confs[bootup_level].arm_volt;
-	return ret;
+	/*
+	 * The clock may have been changed by the wakeup code and the voltage
+	 * by the PMIC; the next transition sets the voltage again.
+	 */
+	cur_opp = s5p6450_find_opp(s5p6450_getspeed(0));
+	volt_opp = NULL;
+	return 0;
+}
+
+/*
+ * The voltage of each level comes from the lowest s5p6450_dvs_confs entry
+ * at or above its frequency, the DRAM refresh counter from its HCLK divider.
+ */
+static int __init s5p6450_init_opps(void)
+{
+	struct cpufreq_frequency_table *table = ctable.freq_table;
+	struct s5p6450_opp *opp;
+	unsigned long rate;
+	unsigned int i, j;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		if (i >= S5P6450_MAX_OPPS)
+			return -EINVAL;
+
+		opp = &s5p6450_opps[i];
+		opp->freq = table[i].frequency;
+
+		opp->arm_volt = s5p6450_dvs_confs[0].arm_volt;
+		opp->int_volt = s5p6450_dvs_confs[0].int_volt;
+		for (j = 0; j < ARRAY_SIZE(s5p6450_dvs_confs); j++) {
+			if (s5p6450_dvs_confs[j].lvl < opp->freq)
+				break;
+			opp->arm_volt = s5p6450_dvs_confs[j].arm_volt;
+			opp->int_volt = s5p6450_dvs_confs[j].int_volt;
+		}
+		if (!i || opp->arm_volt < s5p6450_min_arm_volt)
+			s5p6450_min_arm_volt = opp->arm_volt;
+		if (opp->arm_volt > s5p6450_max_arm_volt)
+			s5p6450_max_arm_volt = opp->arm_volt;
+
+		rate = clk_round_rate(mpu_clk, opp->freq * KHZ_T);
+		opp->dmc_refresh = S5P6450_DMC_REFRESH_HCLK_HIGH;
+		for (j = 0; j < ctable.clock_table_size; j++) {
+			if (ctable.clock_table[j][0] != rate)
+				continue;
+			if (ctable.clock_table[j][2] != ctable.clock_table[0][2])
+				opp->dmc_refresh = S5P6450_DMC_REFRESH_HCLK_LOW;
+			break;
+		}
+	}
+	s5p6450_nr_opps = i;
+
+	return 0;
 }
 
 static int __init s5p6450_cpu_init(struct cpufreq_policy *policy)
 {
-	u32 reg, rate;
+	ktime_t start;
+	long latency_us;
+	u32 reg;
+	int ret;
 
 #ifdef CLK_OUT_PROBING
 	reg = __raw_readl(S5P_CLK_OUT);
@@ -373,29 +473,35 @@ static int __init s5p6450_cpu_init(struct cpufreq_policy *policy)
 
 	cpufreq_frequency_table_get_attr(ctable.freq_table, policy->cpu);
 
-	policy->cpuinfo.transition_latency = 40000;
-
-	rate = clk_get_rate(mpu_clk);
-
-	switch (rate) {
-	case 800000000:	
-		bootup_level = L0;
-		break;
-	case 667200000:
-		bootup_level = L1;
-		break;
-	default:
-		printk(KERN_ERR "[%s] cannot find matching clock"
-				"[%s] rate [%d]\n"
-				, __FUNCTION__, MPU_CLK, rate);
-		bootup_level = L0;
-		break;
+	ret = s5p6450_init_opps();
+	if (ret) {
+		printk(KERN_ERR "[%s] too many levels\n", __FUNCTION__);
+		return ret;
 	}
-	memcpy(&s5p6450_freqs.old, &s5p6450_clk_info[bootup_level],
-			sizeof(struct s5p6450_domain_freq));
-	
-	previous_arm_volt = s5p6450_dvs_confs[bootup_level].arm_volt;
-	
+
+	cur_opp = s5p6450_find_opp(policy->cur);
+	volt_opp = NULL;
+
+	/*
+	 * The slowest transition goes from the lowest voltage to the highest:
+	 * a regulator write, the full ramp and a clock change. The writes are
+	 * timed by setting the current level again; if the voltage can't be
+	 * set, the one left by the bootloader is set again at the first change.
+	 */
+	mutex_lock(&s5p6450_dvfs_lock);
+	start = ktime_get();
+	s5p6450_set_voltage(cur_opp);
+	if (cur_opp->freq == policy->cur)
+		clk_set_rate(mpu_clk, cur_opp->freq * KHZ_T);
+	latency_us = ktime_us_delta(ktime_get(), start) +
+		(s5p6450_max_arm_volt - s5p6450_min_arm_volt) / 1000 /
+		PMIC_RAMP_UP;
+	mutex_unlock(&s5p6450_dvfs_lock);
+
+	policy->cpuinfo.transition_latency = latency_us * NSEC_PER_USEC;
+	printk(KERN_INFO "s5p6450-cpufreq: transition latency %ldus\n",
+	       latency_us);
+
 	return cpufreq_frequency_table_cpuinfo(policy, ctable.freq_table);
 }
 
@@ -412,6 +518,8 @@ static struct cpufreq_driver s5p6450_driver = {
 
 static int __init s5p6450_cpufreq_init(void)
 {
+	int ret;
+
 #if 1
 	if(ctable.apll_rate == IS_ARM_667){
                 ctable.freq_table = s5p6450_freq_table_667;
@@ -421,7 +529,16 @@ static int __init s5p6450_cpufreq_init(void)
                 ctable.freq_table = s5p6450_freq_table_800;
 	}
 #endif
-	return cpufreq_register_driver(&s5p6450_driver);
+	/* frozen over suspend, when the PMIC can't be reached */
+	s5p6450_volt_wq = create_freezeable_workqueue("s5p6450_volt");
+	if (!s5p6450_volt_wq)
+		return -ENOMEM;
+
+	ret = cpufreq_register_driver(&s5p6450_driver);
+	if (ret)
+		destroy_workqueue(s5p6450_volt_wq);
+
+	return ret;
 }
 
 late_initcall(s5p6450_cpufreq_init);
@@ -150,6 +150,11 @@ struct s5p_dma_buf {
 	void			*id;		/* client's id */
 	dma_addr_t		mcptr;		/* physical pointer to a set of micro codes */
 	unsigned long		*mcptr_cpu;	/* virtual pointer to a set of micro codes */
+	unsigned int		mcsize;		/* size of the micro code buffer */
+	unsigned int		flags;		/* S5P_DMABUF_xxx */
+	unsigned int		period;		/* cyclic: bytes per period */
+	unsigned int		periods;	/* cyclic: periods in the ring */
+	unsigned int		period_pos;	/* cyclic: period being transferred */
 };
 
 /* [1] is this updated for both recv/send modes? */
@@ -160,6 +165,16 @@ struct s5p_dma_stats {
 	unsigned long		timeout_shortest;
 	unsigned long		timeout_avg;
 	unsigned long		timeout_failed;
+
+	/* reload latency, irq entry to DMAGO, in ns */
+	unsigned long		reloads;
+	unsigned long		reload_last;
+	unsigned long		reload_longest;
+	unsigned long long	reload_total;
+
+	/* cyclic transfers */
+	unsigned long		periods;
+	unsigned long		restarts;
 };
 
 struct s3c2410_dma_map;
@@ -23,9 +23,14 @@
 #include <linux/slab.h>
 #include <linux/errno.h>
 #include <linux/delay.h>
+#include <linux/scatterlist.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/system.h>
 #include <asm/irq.h>
+#include <asm/div64.h>
 #include <mach/hardware.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
@@ -69,11 +74,20 @@ s3c_dma_controller_t 		s3c_dma_cntlrs[S3C_DMA_CONTROLLERS];
 #endif
 
 #define SIZE_OF_MICRO_CODES		512
+/* worst case of one setup_DMA_channel() block, including SEV/LPFE/END */
+#define SIZE_OF_MICRO_CODES_PER_XFER	96
+/* DMALPEND/DMALPFE only encode an 8 bit backward jump */
+#define PL330_MAX_BWJUMP		255
 #define PL330_NON_SECURE_DMA		1
 #define PL330_SECURE_DMA		0
 
 #define BUF_MAGIC 			(0xcafebabe)
 
+/* s5p_dma_buf flags */
+#define S5P_DMABUF_PREBUILT		(1<<0)	/* program built at enqueue */
+#define S5P_DMABUF_CYCLIC		(1<<1)	/* ring of buf->periods */
+#define S5P_DMABUF_LOOPED		(1<<2)	/* ring closed by DMALPFE */
+
 #define dmawarn(fmt...) 		printk(KERN_DEBUG fmt)
 
 #define dma_regaddr(dcon, reg) 		((dcon)->regs + (reg))
@@ -164,6 +178,28 @@ static void s3c_dma_stats_timeout(struct s5p_dma_stats *stats, int val)
 	stats->timeout_avg += val;
 }
 
+/* s3c_dma_stats_reload
+ *
+ * account the time from entering the irq handler to the channel being
+ * given its next program
+ */
+static void s3c_dma_stats_reload(struct s5p_dma_stats *stats, ktime_t entry)
+{
+	unsigned long ns;
+
+	if (stats == NULL)
+		return;
+
+	ns = (unsigned long)ktime_to_ns(ktime_sub(ktime_get(), entry));
+
+	stats->reloads++;
+	stats->reload_last = ns;
+	stats->reload_total += ns;
+
+	if (ns > stats->reload_longest)
+		stats->reload_longest = ns;
+}
+
 void s3c_enable_dmac(unsigned int dcon_num)
 {
 	s3c_dma_controller_t *dma_controller = &s3c_dma_cntlrs[dcon_num];
@@ -233,9 +269,68 @@ static int s3c_dma_waitforload(struct s3c2410_dma_chan *chan, int line)
 
 static inline void s3c_dma_freebuf(struct s5p_dma_buf *buf);
 
+/* s3c_dma_fill_param
+ *
+ * fill in the PL330 program parameters for one transfer of 'size' bytes
+ * at 'data', according to the channel's configuration
+ */
+static int s3c_dma_fill_param(struct s3c2410_dma_chan *chan,
+			      pl330_DMA_parameters_t *dma_param,
+			      dma_addr_t data, int size)
+{
+	memset(dma_param, 0, sizeof(pl330_DMA_parameters_t));
+
+	dma_param->mPeriNum = chan->config_flags;
+	dma_param->mDirection = chan->source;
+
+	switch (dma_param->mDirection) {
+	case S3C2410_DMASRC_MEM:
+		/* src: Memory: Mem-to-Peri (Write into FIFO) */
+		dma_param->mSrcAddr = data;
+		dma_param->mDstAddr = chan->dev_addr;
+		break;
+
+	case S3C2410_DMASRC_HW:
+		/* src: peripheral: Peri-to-Mem (Read from FIFO) */
+		dma_param->mSrcAddr = chan->dev_addr;
+		dma_param->mDstAddr = data;
+		break;
+
+	case S3C_DMA_MEM2MEM:
+		/* source & destination: Mem-to-Mem  */
+		dma_param->mSrcAddr = chan->dev_addr;
+		dma_param->mDstAddr = data;
+		break;
+
+	case S3C_DMA_MEM2MEM_SET:
+		/* source & destination: Mem-to-Mem  */
+		dma_param->mDirection = S3C_DMA_MEM2MEM;
+		dma_param->mSrcAddr = chan->dev_addr;
+		dma_param->mDstAddr = data;
+		break;
+
+	case S3C_DMA_PER2PER:
+	default:
+		printk(KERN_ERR "Peripheral-to-Peripheral DMA NOT YET implemented !! \n");
+		return -EINVAL;
+	}
+
+	dma_param->mTrSize = size;
+
+	dma_param->mLoop = 0;
+	dma_param->mControl = *(pl330_DMA_control_t *) &chan->dcon;
+
+	return 0;
+}
+
 /* s3c_dma_loadbuffer
  *
  * load a buffer, and update the channel state
+ *
+ * Buffers queued with s3c2410_dma_enqueue() behind this one are merged
+ * into its program for as long as there is room in the micro code
+ * buffer. Buffers from s3c2410_dma_enqueue_sg/cyclic() already carry
+ * their complete program and are loaded as they are.
  */
 static inline int s3c_dma_loadbuffer(struct s3c2410_dma_chan *chan,
 		       struct s5p_dma_buf *buf)
@@ -247,63 +342,31 @@ static inline int s3c_dma_loadbuffer(struct s3c2410_dma_chan *chan,
 	struct s5p_dma_buf *last2buf;
 	int bwJump = 0;
 
-	memset(&dma_param, 0, sizeof(pl330_DMA_parameters_t));
-	pr_debug("s3c_chan_loadbuffer: loading buffer %p (0x%08lx,0x%06x)\n",
-		 buf, (unsigned long) buf->data, buf->size);
-
 	if (buf == NULL) {
 		dmawarn("buffer is NULL\n");
 		return -EINVAL;
 	}
 
+	pr_debug("s3c_chan_loadbuffer: loading buffer %p (0x%08lx,0x%06x)\n",
+		 buf, (unsigned long) buf->data, buf->size);
+
 	pr_debug("%s: DMA CCR - %08x\n", __func__, chan->dcon);
 	pr_debug("%s: DMA Loop count - %08x\n", __func__,
 		(buf->size / chan->xfer_unit));
 
+	if (buf->flags & S5P_DMABUF_PREBUILT) {
+		chan->next = buf->next;
+		dma_param.mIrqEnable = 1;
+		goto loaded;
+	}
+
 	firstbuf = buf;
 	last1buf = buf;
 	last2buf = buf;
 
 	do {
-		dma_param.mPeriNum = chan->config_flags;
-		dma_param.mDirection = chan->source;
-
-		switch (dma_param.mDirection) {
-		case S3C2410_DMASRC_MEM:
-			/* src: Memory: Mem-to-Peri (Write into FIFO) */
-			dma_param.mSrcAddr = buf->data;
-			dma_param.mDstAddr = chan->dev_addr;
-			break;
-
-		case S3C2410_DMASRC_HW:
-			/* src: peripheral: Peri-to-Mem (Read from FIFO) */
-			dma_param.mSrcAddr = chan->dev_addr;
-			dma_param.mDstAddr = buf->data;
-			break;
-
-		case S3C_DMA_MEM2MEM:
-			/* source & destination: Mem-to-Mem  */
-			dma_param.mSrcAddr = chan->dev_addr;
-			dma_param.mDstAddr = buf->data;
-			break;
-
-		case S3C_DMA_MEM2MEM_SET:
-			/* source & destination: Mem-to-Mem  */
-			dma_param.mDirection = S3C_DMA_MEM2MEM;
-			dma_param.mSrcAddr = chan->dev_addr;
-			dma_param.mDstAddr = buf->data;
-			break;
-
-		case S3C_DMA_PER2PER:
-		default:
-			printk(KERN_ERR "Peripheral-to-Peripheral DMA NOT YET implemented !! \n");
+		if (s3c_dma_fill_param(chan, &dma_param, buf->data, buf->size))
 			return -EINVAL;
-		}
-
-		dma_param.mTrSize = buf->size;
-
-		dma_param.mLoop = 0;
-		dma_param.mControl = *(pl330_DMA_control_t *) &chan->dcon;
 
 		last2buf = last1buf;
 		last1buf = buf;
@@ -311,8 +374,13 @@ static inline int s3c_dma_loadbuffer(struct s3c2410_dma_chan *chan,
 		chan->next = buf->next;
 		buf = chan->next;
 
-		if (buf == NULL) {
-			firstbuf->next = NULL;
+		/* stop merging at a prebuilt buffer, or when the next
+		 * block might not fit behind this one */
+		if (buf == NULL || (buf->flags & S5P_DMABUF_PREBUILT) ||
+		    bwJump + 2 * SIZE_OF_MICRO_CODES_PER_XFER > firstbuf->mcsize) {
+			firstbuf->next = buf;
+			if (buf == NULL)
+				chan->end = firstbuf;
 			dma_param.mLastReq = 1;
 			dma_param.mIrqEnable = 1;
 		} else {
@@ -327,11 +395,12 @@ static inline int s3c_dma_loadbuffer(struct s3c2410_dma_chan *chan,
 		if (last2buf != firstbuf)
 			s3c_dma_freebuf(last2buf);
 
-	} while (buf != NULL);
+	} while (!dma_param.mLastReq);
 
 	if (last1buf != firstbuf)
 		s3c_dma_freebuf(last1buf);
 
+loaded:
 	if (dma_param.mIrqEnable) {
 		tmp = dma_rdreg(chan->dma_con, S3C_DMAC_INTEN);
 		tmp |= (1 << chan->number);
@@ -358,6 +427,26 @@ static inline int s3c_dma_loadbuffer(struct s3c2410_dma_chan *chan,
 	return 0;
 }
 
+/* s3c_dma_go
+ *
+ * issue DMAGO for the program at mcptr
+ */
+static inline void s3c_dma_go(struct s3c2410_dma_chan *chan, dma_addr_t mcptr)
+{
+#ifndef SECURE_M2M_DMA_MODE_SET
+	start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
+			chan->number, mcptr, PL330_NON_SECURE_DMA);
+#else	/* SECURE_M2M_DMA_MODE */
+	if (chan->dma_con->number == 0) {
+		start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
+			chan->number, mcptr, PL330_SECURE_DMA);
+	} else {
+		start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
+			chan->number, mcptr, PL330_NON_SECURE_DMA);
+	}
+#endif
+}
+
 /* s3c_dma_call_op
  *
  * small routine to call the o routine with the given op if it has been
@@ -431,18 +520,7 @@ static int s3c_dma_start(struct s3c2410_dma_chan *chan)
 		chan->irq_enabled = 1;
 	}
 
-#ifndef SECURE_M2M_DMA_MODE_SET
-	start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
-			chan->number, chan->curr->mcptr, PL330_NON_SECURE_DMA);
-#else	/* SECURE_M2M_DMA_MODE */
-	if (chan->dma_con->number == 0) {
-		start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
-			chan->number, chan->curr->mcptr, PL330_SECURE_DMA);
-	} else {
-		start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
-			chan->number, chan->curr->mcptr, PL330_NON_SECURE_DMA);
-	}
-#endif
+	s3c_dma_go(chan, chan->curr->mcptr);
 
 	/* Start the DMA operation on Peripheral */
 	s3c_dma_call_op(chan, S3C2410_DMAOP_START);
@@ -453,36 +531,21 @@ static int s3c_dma_start(struct s3c2410_dma_chan *chan)
 	return 0;
 }
 
-/* s3c2410_dma_enqueue
- *
- * queue an given buffer for dma transfer.
- *
- * id         the device driver's id information for this buffer
- * data       the physical address of the buffer data
- * size       the size of the buffer in bytes
- *
- * If the channel is not running, then the flag S3C2410_DMAF_AUTOSTART
- * is checked, and if set, the channel is started. If this flag isn't set,
- * then an error will be returned.
+/* s3c_dma_allocbuf
  *
- * It is possible to queue more than one DMA buffer onto a channel at
- * once, and the code will deal with the re-loading of the next buffer
- * when necessary.
+ * allocate a buffer descriptor along with 'mcsize' bytes of coherent
+ * memory for its micro code
  */
-int s3c2410_dma_enqueue(unsigned int channel, void *id,
-			dma_addr_t data, int size)
+static struct s5p_dma_buf *s3c_dma_allocbuf(unsigned int channel, void *id,
+					    dma_addr_t data, int size,
+					    int mcsize)
 {
-	struct s3c2410_dma_chan *chan = lookup_dma_channel(channel);
 	struct s5p_dma_buf *buf;
-	unsigned long flags;
-
-	pr_debug("%s: id=%p, data=%08x, size=%d\n",
-		__func__, id, (unsigned int) data, size);
 
 	buf = kmem_cache_alloc(dma_kmem, GFP_ATOMIC);
 	if (buf == NULL) {
 		printk(KERN_ERR "dma <%d> no memory for buffer\n", channel);
-		return -ENOMEM;
+		return NULL;
 	}
 
 	pr_debug("%s: new buffer %p\n", __func__, buf);
@@ -492,18 +555,43 @@ int s3c2410_dma_enqueue(unsigned int channel, void *id,
 	buf->size = size;
 	buf->id = id;
 	buf->magic = BUF_MAGIC;
+	buf->flags = 0;
+	buf->period = 0;
+	buf->periods = 0;
+	buf->period_pos = 0;
 
-	local_irq_save(flags);
-
-	buf->mcptr_cpu = dma_alloc_coherent(NULL, SIZE_OF_MICRO_CODES,
+	buf->mcsize = mcsize;
+	buf->mcptr_cpu = dma_alloc_coherent(NULL, mcsize,
 					    &buf->mcptr, GFP_ATOMIC);
 
 	if (buf->mcptr_cpu == NULL) {
 		printk(KERN_ERR "%s: failed to allocate memory for micro codes\n",
 				__func__);
-		return -ENOMEM;
+		kmem_cache_free(dma_kmem, buf);
+		return NULL;
 	}
 
+	return buf;
+}
+
+static void s3c_dma_destroybuf(struct s5p_dma_buf *buf)
+{
+	dma_free_coherent(NULL, buf->mcsize, buf->mcptr_cpu, buf->mcptr);
+	kmem_cache_free(dma_kmem, buf);
+}
+
+/* s3c_dma_queuebuf
+ *
+ * add a buffer to the end of the channel's queue, loading or starting
+ * the channel as required
+ */
+static int s3c_dma_queuebuf(unsigned int channel, struct s3c2410_dma_chan *chan,
+			    struct s5p_dma_buf *buf)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+
 	if (chan->curr == NULL) {
 		/* we've got nothing loaded... */
 		pr_debug("%s: buffer %p queued onto empty channel\n",
@@ -555,8 +643,151 @@ int s3c2410_dma_enqueue(unsigned int channel, void *id,
 
 	return 0;
 }
+
+/* s3c2410_dma_enqueue
+ *
+ * queue an given buffer for dma transfer.
+ *
+ * id         the device driver's id information for this buffer
+ * data       the physical address of the buffer data
+ * size       the size of the buffer in bytes
+ *
+ * If the channel is not running, then the flag S3C2410_DMAF_AUTOSTART
+ * is checked, and if set, the channel is started. If this flag isn't set,
+ * then an error will be returned.
+ *
+ * It is possible to queue more than one DMA buffer onto a channel at
+ * once, and the code will deal with the re-loading of the next buffer
+ * when necessary.
+ */
+int s3c2410_dma_enqueue(unsigned int channel, void *id,
+			dma_addr_t data, int size)
+{
+	struct s3c2410_dma_chan *chan = lookup_dma_channel(channel);
+	struct s5p_dma_buf *buf;
+
+	pr_debug("%s: id=%p, data=%08x, size=%d\n",
+		__func__, id, (unsigned int) data, size);
+
+	if (chan == NULL)
+		return -EINVAL;
+
+	buf = s3c_dma_allocbuf(channel, id, data, size, SIZE_OF_MICRO_CODES);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	return s3c_dma_queuebuf(channel, chan, buf);
+}
 EXPORT_SYMBOL(s3c2410_dma_enqueue);
 
+/* s3c2410_dma_enqueue_sg
+ *
+ * queue a scatterlist for dma transfer. Every entry gets its own block
+ * in one program; only the last one raises the interrupt and ends the
+ * program, so the whole list runs without CPU reloads in between.
+ */
+int s3c2410_dma_enqueue_sg(unsigned int channel, void *id,
+			   struct scatterlist *sg, int nents)
+{
+	struct s3c2410_dma_chan *chan = lookup_dma_channel(channel);
+	pl330_DMA_parameters_t dma_param;
+	struct scatterlist *s;
+	struct s5p_dma_buf *buf;
+	int size = 0, mcode_size = 0;
+	int i;
+
+	if (chan == NULL || sg == NULL || nents <= 0)
+		return -EINVAL;
+
+	for_each_sg(sg, s, nents, i)
+		size += sg_dma_len(s);
+
+	pr_debug("%s: id=%p, nents=%d, size=%d\n", __func__, id, nents, size);
+
+	buf = s3c_dma_allocbuf(channel, id, sg_dma_address(sg), size,
+			       nents * SIZE_OF_MICRO_CODES_PER_XFER);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	for_each_sg(sg, s, nents, i) {
+		if (s3c_dma_fill_param(chan, &dma_param, sg_dma_address(s),
+				       sg_dma_len(s))) {
+			s3c_dma_destroybuf(buf);
+			return -EINVAL;
+		}
+
+		dma_param.mIrqEnable = (i == nents - 1);
+		dma_param.mLastReq = (i == nents - 1);
+
+		mcode_size += setup_DMA_channel((u8 *)buf->mcptr_cpu + mcode_size,
+						dma_param, chan->number);
+	}
+
+	buf->flags = S5P_DMABUF_PREBUILT;
+
+	return s3c_dma_queuebuf(channel, chan, buf);
+}
+EXPORT_SYMBOL(s3c2410_dma_enqueue_sg);
+
+/* s3c2410_dma_enqueue_cyclic
+ *
+ * queue a ring of periods. Each period ends with DMASEV so the client
+ * hears about it, but the channel carries on into the next period by
+ * itself. If the program is short enough for DMALPFE's backward jump the
+ * ring is closed in micro code and the CPU never restarts the channel;
+ * otherwise the program ends after the last period and the irq handler
+ * re-issues it.
+ */
+int s3c2410_dma_enqueue_cyclic(unsigned int channel, void *id,
+			       dma_addr_t data, int period, int periods)
+{
+	struct s3c2410_dma_chan *chan = lookup_dma_channel(channel);
+	pl330_DMA_parameters_t dma_param;
+	struct s5p_dma_buf *buf;
+	int mcode_size = 0;
+	int i;
+
+	if (chan == NULL || period <= 0 || periods <= 0)
+		return -EINVAL;
+
+	pr_debug("%s: id=%p, data=%08x, period=%d, periods=%d\n",
+		__func__, id, (unsigned int) data, period, periods);
+
+	buf = s3c_dma_allocbuf(channel, id, data, period * periods,
+			       periods * SIZE_OF_MICRO_CODES_PER_XFER);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < periods; i++) {
+		if (s3c_dma_fill_param(chan, &dma_param, data + i * period,
+				       period)) {
+			s3c_dma_destroybuf(buf);
+			return -EINVAL;
+		}
+
+		dma_param.mIrqEnable = 1;
+		dma_param.mLastReq = 0;
+
+		mcode_size += setup_DMA_channel((u8 *)buf->mcptr_cpu + mcode_size,
+						dma_param, chan->number);
+	}
+
+	buf->flags = S5P_DMABUF_PREBUILT | S5P_DMABUF_CYCLIC;
+	buf->period = period;
+	buf->periods = periods;
+
+	if (mcode_size <= PL330_MAX_BWJUMP) {
+		config_DMA_set_infinite_loop((u8 *)buf->mcptr_cpu + mcode_size,
+					     mcode_size);
+		buf->flags |= S5P_DMABUF_LOOPED;
+	} else {
+		config_DMA_mark_end((u8 *)buf->mcptr_cpu + mcode_size);
+	}
+
+	return s3c_dma_queuebuf(channel, chan, buf);
+}
+EXPORT_SYMBOL(s3c2410_dma_enqueue_cyclic);
+
 static inline void s3c_dma_freebuf(struct s5p_dma_buf *buf)
 {
 	int magicok = (buf->magic == BUF_MAGIC);
@@ -565,10 +796,8 @@ static inline void s3c_dma_freebuf(struct s5p_dma_buf *buf)
 
 	if (magicok) {
 		local_irq_enable();
-		dma_free_coherent(NULL, SIZE_OF_MICRO_CODES, buf->mcptr_cpu, buf->mcptr);
+		s3c_dma_destroybuf(buf);
 		local_irq_disable();
-
-		kmem_cache_free(dma_kmem, buf);
 	} else {
 		printk(KERN_INFO "s3c_dma_freebuf: buff %p with bad magic\n", buf);
 	}
@@ -608,11 +837,50 @@ static inline void s3c_dma_lastxfer(struct s3c2410_dma_chan *chan)
 
 #define dmadbg2(x...)
 
+/* s3c_dma_period_done
+ *
+ * a period of a cyclic buffer has completed. The buffer stays at the
+ * head of the queue; only a ring that is not closed in micro code needs
+ * the channel restarting once the program has run off its end.
+ */
+static void s3c_dma_period_done(struct s3c2410_dma_chan *chan,
+				struct s5p_dma_buf *buf, ktime_t entry)
+{
+	unsigned long status;
+
+	if (++buf->period_pos >= buf->periods)
+		buf->period_pos = 0;
+
+	buf->ptr = buf->data + buf->period_pos * buf->period;
+
+	if (chan->stats != NULL)
+		chan->stats->periods++;
+
+	if (chan->callback_fn != NULL)
+		(chan->callback_fn) (chan, buf->id, buf->period, S3C2410_RES_OK);
+
+	/* the callback may have stopped or flushed the channel */
+	if (chan->curr != buf || chan->state != S5P_DMA_RUNNING ||
+	    (buf->flags & S5P_DMABUF_LOOPED))
+		return;
+
+	status = dma_rdreg(chan->dma_con, S3C_DMAC_CS(chan->number)) & 0xf;
+	if (status != S3C_DMAC_CS_STOPPED)
+		return;
+
+	s3c_dma_go(chan, buf->mcptr);
+
+	if (chan->stats != NULL)
+		chan->stats->restarts++;
+	s3c_dma_stats_reload(chan->stats, entry);
+}
+
 static irqreturn_t s3c_dma_irq(int irq, void *devpw)
 {
 	unsigned int channel = 0, dcon_num, i;
 	unsigned long tmp;
 	s3c_dma_controller_t *dma_controller = (s3c_dma_controller_t *) devpw;
+	ktime_t entry = ktime_get();
 
 	struct s3c2410_dma_chan *chan = NULL;
 	struct s5p_dma_buf *buf;
@@ -638,6 +906,15 @@ static irqreturn_t s3c_dma_irq(int irq, void *devpw)
 
 			dbg_showchan(chan);
 
+			if (buf != NULL && (buf->flags & S5P_DMABUF_CYCLIC)) {
+				/* clear first, so an event raised while the
+				 * client runs is not lost */
+				s3c_clear_interrupts(chan->dma_con->number,
+						     chan->number);
+				s3c_dma_period_done(chan, buf, entry);
+				goto next_channel;
+			}
+
 			/* modify the channel state */
 			switch (chan->load_state) {
 			case S5P_DMALOAD_1RUNNING:
@@ -741,21 +1018,8 @@ static irqreturn_t s3c_dma_irq(int irq, void *devpw)
 
 				local_irq_save(flags);
 				s3c_dma_loadbuffer(chan, chan->next);
-#ifndef SECURE_M2M_DMA_MODE_SET
-				start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
-						  chan->number, chan->curr->mcptr,
-						  PL330_NON_SECURE_DMA);
-#else	/* SECURE_M2M_DMA_MODE */
-				if (chan->dma_con->number == 0) {
-					start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
-							  chan->number, chan->curr->mcptr,
-							  PL330_SECURE_DMA);
-				} else {
-					start_DMA_channel(dma_regaddr(chan->dma_con, S3C_DMAC_DBGSTATUS),
-							  chan->number, chan->curr->mcptr,
-							  PL330_NON_SECURE_DMA);
-				}
-#endif
+				s3c_dma_go(chan, chan->curr->mcptr);
+				s3c_dma_stats_reload(chan->stats, entry);
 				local_irq_restore(flags);
 
 			} else {
@@ -1320,6 +1584,57 @@ struct sysdev_class dma_sysclass = {
 	.resume = s3c_dma_resume,
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int s3c_dma_stats_show(struct seq_file *s, void *unused)
+{
+	struct s3c2410_dma_chan *cp;
+	struct s5p_dma_stats *st;
+	unsigned long long avg;
+	int channel;
+
+	seq_printf(s, "ch  loads    reloads  last_ns  max_ns   avg_ns   periods  restarts\n");
+
+	for (channel = 0; channel < dma_channels; channel++) {
+		cp = &s3c_dma_chans[channel];
+		st = cp->stats;
+
+		if (st == NULL || (st->loads == 0 && st->periods == 0))
+			continue;
+
+		avg = st->reload_total;
+		if (st->reloads)
+			do_div(avg, st->reloads);
+
+		seq_printf(s, "%-3d %-8lu %-8lu %-8lu %-8lu %-8llu %-8lu %lu\n",
+			   channel, st->loads, st->reloads, st->reload_last,
+			   st->reload_longest, avg, st->periods, st->restarts);
+	}
+
+	return 0;
+}
+
+static int s3c_dma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s3c_dma_stats_show, inode->i_private);
+}
+
+static const struct file_operations s3c_dma_stats_fops = {
+	.open		= s3c_dma_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init s3c_dma_debugfs_init(void)
+{
+	if (dma_channels)
+		debugfs_create_file("pl330-dma", S_IRUGO, NULL, NULL,
+				    &s3c_dma_stats_fops);
+	return 0;
+}
+late_initcall(s3c_dma_debugfs_init);
+#endif
+
 /* kmem cache implementation */
 static void s3c_dma_cache_ctor(void *p)
 {
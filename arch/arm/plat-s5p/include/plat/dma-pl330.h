@@ -118,5 +118,46 @@
 #define S3C_DMACONTROL_ES_SIZE_32	(2<<28)
 #define S3C_DMACONTROL_ES_SIZE_64	(3<<28)
 
+struct scatterlist;
+
+/* s3c2410_dma_enqueue_sg
+ *
+ * queue a whole (dma mapped) scatterlist as one transfer. The list is
+ * compiled into a single PL330 program, so the channel does not come
+ * back to the CPU between entries. The buffdone callback is called once,
+ * with the total size, when the last entry has been transferred.
+*/
+
+extern int s3c2410_dma_enqueue_sg(unsigned int channel, void *id,
+				  struct scatterlist *sg, int nents);
+
+/* s3c2410_dma_enqueue_cyclic
+ *
+ * queue a ring of 'periods' contiguous periods of 'period' bytes each,
+ * starting at 'data'. The buffdone callback is called (with the period
+ * size) each time a period completes and the ring runs until the channel
+ * is stopped or flushed.
+*/
+
+extern int s3c2410_dma_enqueue_cyclic(unsigned int channel, void *id,
+				      dma_addr_t data, int period,
+				      int periods);
+
+/* struct s5p_pl330_slave
+ *
+ * dmaengine slave description, passed through dma_chan->private by the
+ * client's filter function.
+ *
+ * channel	the s3c2410_dma virtual channel (enum dma_ch) of the peripheral
+ * fifo		physical address of the peripheral's data register
+ * width	access width of the data register in bytes (1, 2 or 4)
+*/
+
+struct s5p_pl330_slave {
+	unsigned int		channel;
+	unsigned long		fifo;
+	int			width;
+};
+
 #endif /* __ARM_MACH_DMA_PL330_H */
 
@@ -21,6 +21,12 @@
 #include <linux/wait.h>
 #include <linux/cdev.h>
 #include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <asm/uaccess.h>
 #include <linux/gadc.h>
 
 struct gadc_cdev *get_gadc_cdev( struct cdev *cdev )
@@ -79,6 +85,29 @@ void gadc_init_buffer( struct gadc_buffer *adc, unsigned long int samplerate )
 }
 EXPORT_SYMBOL( gadc_init_buffer );
 
+/* Store a sample in the ring. Called with adc->lock held, which only serializes us against */
+/* other producers and the ring being freed. The reader side does not take the lock. */
+static void gadc_ring_put( struct gadc_buffer *adc, struct gadc_sample *sample )
+{
+	struct gadc_ring	*ring=adc->ring;
+	unsigned long int	head=adc->ring_head;
+
+	if( head - ring->tail >= adc->ring_size )
+	{
+		/* Full. Drop the new sample, the reader owns the old ones. */
+		ring->overflows=++adc->ring_overflows;
+		adc->flags|=ADC_SAMPLE_OVERFLOW;
+		return;
+	}
+
+	memcpy( &(ring->samples[head & (adc->ring_size - 1)]), sample, sizeof( *sample ) );
+
+	/* Sample must be visible before the reader can see the new head. */
+	smp_wmb( );
+	adc->ring_head=head + 1;
+	ring->head=adc->ring_head;
+}
+
 void gadc_add_sample( struct gadc_buffer *adc, unsigned long int value )
 {
 	unsigned long int	flags;
@@ -88,6 +117,9 @@ void gadc_add_sample( struct gadc_buffer *adc, unsigned long int value )
 	do_gettimeofday( &(adc->buffer[adc->curr_idx].timestamp) );
 	adc->buffer[adc->curr_idx].value=value;
 
+	if( adc->ring != NULL )
+		gadc_ring_put( adc, &(adc->buffer[adc->curr_idx]) );
+
 	adc->curr_idx=(adc->curr_idx + 1) % ADC_BUFFER_SIZE;
 	if( adc->curr_idx == adc->last_read_idx )
 	{
@@ -243,3 +275,195 @@ void gadc_poll_wait( struct file *file, struct gadc_buffer *adc, poll_table *wai
 	poll_wait( file, &(adc->poll_queue), wait );
 }
 EXPORT_SYMBOL( gadc_poll_wait );
+
+int gadc_alloc_ring( struct gadc_buffer *adc, unsigned long int nr_samples )
+{
+	struct gadc_ring	*ring;
+	unsigned long int	bytes;
+	unsigned long int	flags;
+
+	if( (nr_samples == 0) || (nr_samples > (1UL << 20)) )
+		return -EINVAL;
+
+	nr_samples=roundup_pow_of_two( nr_samples );
+	bytes=PAGE_ALIGN( sizeof( *ring ) + nr_samples * sizeof( struct gadc_sample ) );
+
+	/* vmalloc_user zeroes the pages, so head, tail and overflows start out at 0. */
+	ring=(struct gadc_ring *) vmalloc_user( bytes );
+	if( ring == NULL )
+		return -ENOMEM;
+	ring->size=nr_samples;
+
+	spin_lock_irqsave( &(adc->lock), flags );
+	if( adc->ring != NULL )
+	{
+		spin_unlock_irqrestore( &(adc->lock), flags );
+		vfree( ring );
+		return -EBUSY;
+	}
+	adc->ring=ring;
+	adc->ring_head=0;
+	adc->ring_size=nr_samples;
+	adc->ring_bytes=bytes;
+	adc->ring_overflows=0;
+	adc->watermark=1;
+	spin_unlock_irqrestore( &(adc->lock), flags );
+	return 0;
+}
+EXPORT_SYMBOL( gadc_alloc_ring );
+
+void gadc_free_ring( struct gadc_buffer *adc )
+{
+	struct gadc_ring	*ring;
+	unsigned long int	flags;
+
+	spin_lock_irqsave( &(adc->lock), flags );
+	ring=adc->ring;
+	adc->ring=NULL;
+	adc->ring_size=0;
+	adc->ring_bytes=0;
+	spin_unlock_irqrestore( &(adc->lock), flags );
+
+	/* Existing mappings keep their own reference to the pages. */
+	vfree( ring );
+	return;
+}
+EXPORT_SYMBOL( gadc_free_ring );
+
+int gadc_mmap_ring( struct gadc_buffer *adc, struct vm_area_struct *vma )
+{
+	if( adc->ring == NULL )
+		return -ENODEV;
+
+	if( (vma->vm_pgoff != 0) || ((vma->vm_end - vma->vm_start) > adc->ring_bytes) )
+		return -EINVAL;
+
+	return remap_vmalloc_range( vma, adc->ring, 0 );
+}
+EXPORT_SYMBOL( gadc_mmap_ring );
+
+unsigned long int gadc_get_ring_count( struct gadc_buffer *adc )
+{
+	struct gadc_ring	*ring=adc->ring;
+	unsigned long int	count;
+
+	if( ring == NULL )
+		return 0;
+
+	count=ACCESS_ONCE( adc->ring_head ) - ring->tail;
+	return (count > adc->ring_size) ? adc->ring_size : count;
+}
+EXPORT_SYMBOL( gadc_get_ring_count );
+
+/* Copy as many samples as fit in buf in at most two copies, one for each side of the wrap. */
+ssize_t gadc_read_ring( struct gadc_buffer *adc, char __user *buf, size_t count )
+{
+	struct gadc_ring	*ring=adc->ring;
+	unsigned long int	head;
+	unsigned long int	tail;
+	unsigned long int	mask;
+	unsigned long int	nr_samples;
+	unsigned long int	first;
+
+	if( ring == NULL )
+		return -ENODEV;
+
+	mask=adc->ring_size - 1;
+	head=ACCESS_ONCE( adc->ring_head );
+	tail=ring->tail;
+
+	/* A reader that corrupted its tail loses the oldest samples rather than reading garbage. */
+	if( head - tail > adc->ring_size )
+		tail=head - adc->ring_size;
+
+	/* Read the samples only after we've seen the head that covers them. */
+	smp_rmb( );
+
+	nr_samples=head - tail;
+	if( nr_samples > count / sizeof( struct gadc_sample ) )
+		nr_samples=count / sizeof( struct gadc_sample );
+	if( nr_samples == 0 )
+		return 0;
+
+	first=adc->ring_size - (tail & mask);
+	if( first > nr_samples )
+		first=nr_samples;
+
+	if( copy_to_user( buf, &(ring->samples[tail & mask]), first * sizeof( struct gadc_sample ) ) )
+		return -EFAULT;
+	if( (nr_samples > first) &&
+	    copy_to_user( buf + first * sizeof( struct gadc_sample ), &(ring->samples[0]),
+			  (nr_samples - first) * sizeof( struct gadc_sample ) ) )
+		return -EFAULT;
+
+	/* Done with the slots before handing them back to the producer. */
+	smp_mb( );
+	ring->tail=tail + nr_samples;
+
+	return nr_samples * sizeof( struct gadc_sample );
+}
+EXPORT_SYMBOL( gadc_read_ring );
+
+int gadc_wait_ring_fill( struct gadc_buffer *adc )
+{
+	return wait_event_interruptible( (adc->poll_queue), (gadc_get_ring_count( adc ) >= adc->watermark) );
+}
+EXPORT_SYMBOL( gadc_wait_ring_fill );
+
+static enum hrtimer_restart gadc_sampler_tick( struct hrtimer *timer )
+{
+	struct gadc_buffer	*adc=container_of( timer, struct gadc_buffer, timer );
+	unsigned long int	flags;
+	unsigned long int	missed;
+
+	/* The platform stores the result with gadc_add_sample once the conversion is done. */
+	adc->start_conversion( adc->conversion_channel );
+
+	/* Batch wakeups, waking the reader for every sample at kHz rates costs more than the */
+	/* sampling itself. */
+	if( (adc->ring == NULL) || (gadc_get_ring_count( adc ) >= adc->watermark) )
+		wake_up_interruptible( &(adc->poll_queue) );
+
+	/* Ticks we were too late for are samples that never got taken. Count them as overflows. */
+	missed=hrtimer_forward_now( timer, adc->period );
+	if( missed > 1 )
+	{
+		spin_lock_irqsave( &(adc->lock), flags );
+		adc->ring_overflows+=missed - 1;
+		if( adc->ring != NULL )
+			adc->ring->overflows=adc->ring_overflows;
+		adc->flags|=ADC_SAMPLE_OVERFLOW;
+		spin_unlock_irqrestore( &(adc->lock), flags );
+	}
+
+	return HRTIMER_RESTART;
+}
+
+int gadc_start_sampler( struct gadc_buffer *adc, struct gadc_platform_channel *channel,
+			void (*start_conversion)( struct gadc_platform_channel *channel ) )
+{
+	unsigned long int	sample_rate=gadc_get_samplerate( adc );
+
+	/* Samplerates are in mHz. */
+	if( sample_rate == 0 )
+		return -EINVAL;
+
+	adc->start_conversion=start_conversion;
+	adc->conversion_channel=channel;
+	adc->period=ns_to_ktime( div_u64( 1000000000000ULL, sample_rate ) );
+
+	hrtimer_init( &(adc->timer), CLOCK_MONOTONIC, HRTIMER_MODE_REL );
+	adc->timer.function=gadc_sampler_tick;
+	hrtimer_start( &(adc->timer), adc->period, HRTIMER_MODE_REL );
+	return 0;
+}
+EXPORT_SYMBOL( gadc_start_sampler );
+
+void gadc_stop_sampler( struct gadc_buffer *adc )
+{
+	/* Waits for a running tick to finish. */
+	if( adc->start_conversion != NULL )
+		hrtimer_cancel( &(adc->timer) );
+	return;
+}
+EXPORT_SYMBOL( gadc_stop_sampler );
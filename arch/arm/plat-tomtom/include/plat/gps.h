@@ -16,6 +16,7 @@
 #include <linux/device.h>
 #include <linux/mutex.h>
 #include <linux/notifier.h>
+#include <linux/spinlock.h>
 #include <linux/time.h>
 #include <linux/regulator/consumer.h>
 
@@ -26,6 +27,50 @@ typedef enum {
 
 struct gps_device;
 
+/*
+ * Timestamped GPS interrupts or time pulses. Every event gets a sequence
+ * number, so a reader of the ring can tell which events it missed; events
+ * the hardware missed (for periodic sources) are flagged GPS_EVENT_MISSED.
+ */
+#define GPS_EVENT_RING_SIZE	32	/* power of two, fits a sysfs page */
+
+#define GPS_EVENT_MISSED	0x01	/* pulse(s) missing before this one */
+
+struct gps_event {
+	u32	sequence;
+	u32	flags;
+	s64	monotonic_ns;	/* CLOCK_MONOTONIC */
+	s64	raw_ns;		/* CLOCK_MONOTONIC_RAW, not slewed by NTP */
+	struct timespec	real;	/* CLOCK_REALTIME, for PPS */
+};
+
+/* interval statistics over the raw clock; jitter is only tracked for
+   periodic sources, relative to a smoothed period estimate */
+struct gps_event_stats {
+	s64			nominal_ns;	/* 0 if not periodic */
+	s64			period_ns;
+	s64			last_raw_ns;
+	s64			min_interval_ns;
+	s64			max_interval_ns;
+	u64			sum_abs_jitter_ns;
+	s64			max_abs_jitter_ns;
+	u32			intervals;
+	u32			missed;
+};
+
+struct gps_event_ring {
+	spinlock_t		lock;
+	u32			sequence;
+	struct gps_event	events[GPS_EVENT_RING_SIZE];
+	struct gps_event_stats	stats;
+};
+
+extern void gps_event_ring_init(struct gps_event_ring *ring, s64 nominal_ns);
+extern void gps_event_record(struct gps_event_ring *ring, struct gps_event *ev);
+extern ssize_t gps_event_ring_show(struct gps_event_ring *ring, char *buf);
+extern ssize_t gps_event_stats_show(struct gps_event_ring *ring, char *buf);
+extern void gps_event_stats_reset(struct gps_event_ring *ring);
+
 struct gps_ops {
 	void (*get_timestamp)(struct gps_device *, struct timeval *);
 };
@@ -51,6 +96,9 @@ struct gps_device {
 
 	rwlock_t tv_lock;
 
+	/* interrupts of the receiver, see gps_device_event() */
+	struct gps_event_ring events;
+
 	struct device dev;
 };
 
@@ -63,6 +111,8 @@ extern struct gps_device *gps_device_register(const char *name,
 
 extern void gps_device_unregister(struct gps_device *gpsd);
 
+extern void gps_device_event(struct gps_device *gpsd, struct gps_event *ev);
+
 #define to_gps_device(obj) container_of(obj, struct gps_device, dev)
 
 struct generic_gps_info {
@@ -0,0 +1,34 @@
+/* include/asm-arm/plat-tomtom/tt_mixer.h
+ *
+ * Kernel mixer for prompt streams on top of the main playback stream.
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __INCLUDE_ASM_ARM_PLAT_TOMTOM_TT_MIXER_H
+#define __INCLUDE_ASM_ARM_PLAT_TOMTOM_TT_MIXER_H
+
+#include <sound/pcm.h>
+
+struct snd_card;
+
+/*
+ * Hooks for the DMA platform driver of the card. The first playback PCM
+ * passed to tt_mixer_new() becomes the carrier: while it runs, the streams
+ * of the mixer PCM are resampled to its rate and added to each period just
+ * before the DMA reaches it, ducking the carrier while a prompt plays.
+ */
+extern int tt_mixer_new(struct snd_card *card, struct snd_pcm *carrier);
+extern void tt_mixer_carrier_start(struct snd_pcm_substream *substream);
+extern void tt_mixer_carrier_stop(struct snd_pcm_substream *substream);
+
+/* mix into the period of the carrier starting at frame 'offset'; called
+   from the period interrupt, without any stream lock held */
+extern void tt_mixer_refill(struct snd_pcm_substream *substream,
+			    snd_pcm_uframes_t offset);
+
+#endif /* __INCLUDE_ASM_ARM_PLAT_TOMTOM_TT_MIXER_H */
@@ -1,4 +1,6 @@
 
+#include <linux/async.h>
+
 /**
  * struct bus_type_private - structure to hold the private to the driver core portions of the bus_type structure.
  *
@@ -33,6 +35,11 @@ struct driver_private {
 	struct klist_node knode_bus;
 	struct module_kobject *mkobj;
 	struct device_driver *driver;
+#ifdef CONFIG_DRIVER_ASYNC_PROBE
+	struct list_head async_node;
+	async_cookie_t async_cookie;	/* of the last async probe */
+	int async_pending;		/* probes matched, not yet scheduled */
+#endif
 };
 #define to_driver(obj) container_of(obj, struct driver_private, kobj)
 
@@ -117,6 +124,22 @@ extern void bus_remove_driver(struct device_driver *drv);
 
 extern void driver_detach(struct device_driver *drv);
 extern int driver_probe_device(struct device_driver *drv, struct device *dev);
+
+#ifdef CONFIG_DRIVER_ASYNC_PROBE
+extern bool driver_attach_async(struct device_driver *drv);
+extern bool device_attach_async(struct device *dev);
+extern void driver_async_probe_flush(struct device_driver *drv);
+#else
+static inline bool driver_attach_async(struct device_driver *drv)
+{
+	return false;
+}
+static inline bool device_attach_async(struct device *dev)
+{
+	return false;
+}
+static inline void driver_async_probe_flush(struct device_driver *drv) { }
+#endif
 static inline int driver_match_device(struct device_driver *drv,
 				      struct device *dev)
 {
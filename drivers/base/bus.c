@@ -510,7 +510,7 @@ void bus_probe_device(struct device *dev)
 	struct bus_type *bus = dev->bus;
 	int ret;
 
-	if (bus && bus->p->drivers_autoprobe) {
+	if (bus && bus->p->drivers_autoprobe && !device_attach_async(dev)) {
 		ret = device_attach(dev);
 		WARN_ON(ret < 0);
 	}
@@ -670,7 +670,7 @@ int bus_add_driver(struct device_driver *drv)
 	if (error)
 		goto out_unregister;
 
-	if (drv->bus->p->drivers_autoprobe) {
+	if (drv->bus->p->drivers_autoprobe && !driver_attach_async(drv)) {
 		error = driver_attach(drv);
 		if (error)
 			goto out_unregister;
@@ -729,6 +729,7 @@ void bus_remove_driver(struct device_driver *drv)
 	driver_remove_attrs(drv->bus, drv);
 	driver_remove_file(drv, &driver_attr_uevent);
 	klist_remove(&drv->p->knode_bus);
+	driver_async_probe_flush(drv);
 	pr_debug("bus: '%s': remove driver %s\n", drv->bus->name, drv->name);
 	driver_detach(drv);
 	module_remove_driver(drv);
@@ -24,6 +24,10 @@
 #include <linux/wait.h>
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
+#include <linux/boot_timeline.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/moduleparam.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -104,12 +108,15 @@ static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
+	int slot;
 
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
 		 drv->bus->name, __func__, drv->name, dev_name(dev));
 	WARN_ON(!list_empty(&dev->devres_head));
 
+	slot = boot_timeline_probe(dev, drv);
+
 	dev->driver = drv;
 	if (driver_sysfs_add(dev)) {
 		printk(KERN_ERR "%s: driver_sysfs_add(%s) failed\n",
@@ -128,6 +135,7 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	}
 
 	driver_bound(dev);
+	boot_timeline_end(slot, 0);
 	ret = 1;
 	pr_debug("bus: '%s': %s: bound device %s to driver %s\n",
 		 drv->bus->name, __func__, dev_name(dev), drv->name);
@@ -144,6 +152,7 @@ probe_failed:
 		       "%s: probe of %s failed with error %d\n",
 		       drv->name, dev_name(dev), ret);
 	}
+	boot_timeline_end(slot, ret);
 	/*
 	 * Ignore errors returned by ->probe so that the next driver can try
 	 * its luck.
@@ -302,6 +311,230 @@ int driver_attach(struct device_driver *drv)
 }
 EXPORT_SYMBOL_GPL(driver_attach);
 
+#ifdef CONFIG_DRIVER_ASYNC_PROBE
+/*
+ * Drivers which set async_probe are attached from kernel/async.c threads,
+ * both when they are registered and when a matching device is added later,
+ * so that their probes overlap with each other and with the remaining
+ * initcalls. Everything async is finished before init starts, before the
+ * root filesystem is mounted and before a module load returns.
+ *
+ * async_probe_after names drivers whose async probes must be done first.
+ * As async threads can only wait for work scheduled before their own, a
+ * dependency scheduled later is not waited for; drivers probed
+ * synchronously before are done anyway.
+ */
+static int driver_async_probe_enabled = 1;
+core_param(driver_async_probe, driver_async_probe_enabled, bool, 0644);
+
+/* drivers that had an async probe scheduled or about to be */
+static LIST_HEAD(async_probe_drivers);
+static DEFINE_MUTEX(async_probe_lock);
+static DECLARE_WAIT_QUEUE_HEAD(async_probe_waitqueue);
+
+struct async_attach {
+	struct device		*dev;
+	struct device_driver	*drv;
+};
+
+static void driver_async_probe_wait(struct device_driver *drv,
+				    async_cookie_t cookie)
+{
+	const char * const *name;
+	struct driver_private *priv;
+	async_cookie_t dep;
+
+	for (name = drv->async_probe_after; name && *name; name++) {
+		dep = 0;
+		mutex_lock(&async_probe_lock);
+		list_for_each_entry(priv, &async_probe_drivers, async_node)
+			if (!strcmp(priv->driver->name, *name))
+				dep = priv->async_cookie;
+		mutex_unlock(&async_probe_lock);
+
+		if (!dep)
+			continue;
+		if (dep < cookie)
+			async_synchronize_cookie(dep + 1);
+		else
+			printk(KERN_WARNING "%s: async probe of %s scheduled "
+			       "later, not waiting for it\n", drv->name, *name);
+	}
+}
+
+/*
+ * Announce an async probe of @drv before it has a cookie, so that
+ * driver_async_probe_flush() waits for it to be scheduled.
+ */
+static void driver_async_get(struct device_driver *drv)
+{
+	struct driver_private *priv = drv->p;
+
+	mutex_lock(&async_probe_lock);
+	if (!priv->async_cookie && !priv->async_pending)
+		list_add_tail(&priv->async_node, &async_probe_drivers);
+	priv->async_pending++;
+	mutex_unlock(&async_probe_lock);
+}
+
+/* @cookie is 0 if the probe announced with driver_async_get() was dropped */
+static void driver_async_put(struct device_driver *drv, async_cookie_t cookie)
+{
+	struct driver_private *priv = drv->p;
+
+	mutex_lock(&async_probe_lock);
+	if (cookie > priv->async_cookie)
+		priv->async_cookie = cookie;
+	if (!--priv->async_pending) {
+		if (!priv->async_cookie)
+			list_del(&priv->async_node);
+		wake_up_all(&async_probe_waitqueue);
+	}
+	mutex_unlock(&async_probe_lock);
+}
+
+static void driver_async_schedule(struct device_driver *drv,
+				  async_func_ptr *func, void *data)
+{
+	/*
+	 * Before async threads are up func runs right away, so it must not be
+	 * called with async_probe_lock held.
+	 */
+	driver_async_put(drv, async_schedule(func, data));
+}
+
+static void async_driver_attach(void *data, async_cookie_t cookie)
+{
+	struct device_driver *drv = data;
+
+	driver_async_probe_wait(drv, cookie);
+	driver_attach(drv);
+}
+
+/**
+ * driver_attach_async - bind a newly registered driver from an async thread.
+ * @drv: driver.
+ *
+ * Returns true if the attach was scheduled, false if the caller has to
+ * attach @drv itself.
+ */
+bool driver_attach_async(struct device_driver *drv)
+{
+	if (!drv->async_probe || !driver_async_probe_enabled)
+		return false;
+
+	driver_async_get(drv);
+	driver_async_schedule(drv, async_driver_attach, drv);
+	return true;
+}
+
+static void async_device_attach(void *data, async_cookie_t cookie)
+{
+	struct async_attach *aa = data;
+	struct device *dev = aa->dev;
+
+	driver_async_probe_wait(aa->drv, cookie);
+
+	if (dev->parent)	/* Needed for USB */
+		down(&dev->parent->sem);
+	down(&dev->sem);
+	if (!dev->driver)
+		driver_probe_device(aa->drv, dev);
+	up(&dev->sem);
+	if (dev->parent)
+		up(&dev->parent->sem);
+
+	put_device(dev);
+	kfree(aa);
+}
+
+/*
+ * The klist iterator keeps bus_remove_driver() from getting past
+ * klist_remove() while we are here, so once the probe is announced the
+ * driver cannot go away before it is done.
+ */
+static int __device_match_driver(struct device_driver *drv, void *data)
+{
+	struct async_attach *aa = data;
+
+	if (!driver_match_device(drv, aa->dev))
+		return 0;
+
+	aa->drv = drv;
+	if (drv->async_probe)
+		driver_async_get(drv);
+	return 1;
+}
+
+/**
+ * device_attach_async - probe a newly added device from an async thread.
+ * @dev: device.
+ *
+ * If the first driver matching @dev asks for async probing, the probe is
+ * scheduled and true is returned. Otherwise the caller has to attach @dev
+ * itself.
+ */
+bool device_attach_async(struct device *dev)
+{
+	struct async_attach match = { .dev = dev }, *aa;
+
+	if (!driver_async_probe_enabled || dev->driver)
+		return false;
+
+	bus_for_each_drv(dev->bus, NULL, &match, __device_match_driver);
+	if (!match.drv || !match.drv->async_probe)
+		return false;
+
+	aa = kmemdup(&match, sizeof(match), GFP_KERNEL);
+	if (!aa) {
+		driver_async_put(match.drv, 0);
+		return false;
+	}
+
+	get_device(dev);
+	driver_async_schedule(aa->drv, async_device_attach, aa);
+	return true;
+}
+
+/**
+ * driver_async_probe_flush - wait for the async probes of a driver.
+ * @drv: driver going away.
+ */
+static bool driver_async_scheduled(struct driver_private *priv)
+{
+	bool scheduled;
+
+	mutex_lock(&async_probe_lock);
+	scheduled = !priv->async_pending;
+	mutex_unlock(&async_probe_lock);
+
+	return scheduled;
+}
+
+void driver_async_probe_flush(struct device_driver *drv)
+{
+	struct driver_private *priv = drv->p;
+	async_cookie_t cookie;
+
+	/* the driver is off the bus, so nothing new can be announced */
+	wait_event(async_probe_waitqueue, driver_async_scheduled(priv));
+
+	mutex_lock(&async_probe_lock);
+	cookie = priv->async_cookie;
+	mutex_unlock(&async_probe_lock);
+
+	if (!cookie)
+		return;
+
+	async_synchronize_cookie(cookie + 1);
+
+	mutex_lock(&async_probe_lock);
+	list_del(&priv->async_node);
+	priv->async_cookie = 0;
+	mutex_unlock(&async_probe_lock);
+}
+#endif /* CONFIG_DRIVER_ASYNC_PROBE */
+
 /*
  * __device_release_driver() must be called with @dev->sem held.
  * When called for a USB interface, @dev->parent->sem must be held as well.
@@ -524,6 +524,9 @@ int __init_or_module platform_driver_probe(struct platform_driver *drv,
 	/* make sure driver won't have bind/unbind attributes */
 	drv->driver.suppress_bind_attrs = true;
 
+	/* the probe must be done by the time the driver is registered */
+	drv->driver.async_probe = false;
+
 	/* temporary section violation during probe() */
 	drv->probe = probe;
 	retval = code = platform_driver_register(drv);
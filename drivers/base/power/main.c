@@ -21,6 +21,7 @@
 #include <linux/kallsyms.h>
 #include <linux/mutex.h>
 #include <linux/pm.h>
+#include <linux/pm_profile.h>
 #include <linux/pm_runtime.h>
 #include <linux/resume-trace.h>
 #include <linux/rwsem.h>
@@ -117,6 +118,7 @@ void device_pm_remove(struct device *dev)
 		 kobject_name(&dev->kobj));
 	mutex_lock(&dpm_list_mtx);
 	list_del_init(&dev->power.entry);
+	pm_profile_remove(dev);
 	mutex_unlock(&dpm_list_mtx);
 	pm_runtime_remove(dev);
 }
@@ -367,20 +369,25 @@ static int device_resume_noirq(struct device *dev, pm_message_t state)
 void dpm_resume_noirq(pm_message_t state)
 {
 	struct device *dev;
+	ktime_t start = pm_profile_time();
 
 	mutex_lock(&dpm_list_mtx);
 	transition_started = false;
 	list_for_each_entry(dev, &dpm_list, power.entry)
 		if (dev->power.status > DPM_OFF) {
+			ktime_t dev_start = pm_profile_time();
 			int error;
 
 			dev->power.status = DPM_OFF;
 			error = device_resume_noirq(dev, state);
+			pm_profile_device(dev, PM_PROFILE_RESUME_NOIRQ,
+					  dev_start);
 			if (error)
 				pm_dev_err(dev, state, " early", error);
 		}
 	mutex_unlock(&dpm_list_mtx);
 	resume_device_irqs();
+	pm_profile_phase(PM_PROFILE_RESUME_NOIRQ, start);
 }
 EXPORT_SYMBOL_GPL(dpm_resume_noirq);
 
@@ -484,6 +491,7 @@ static void dpm_drv_wdclr(struct device *dev)
 static void dpm_resume(pm_message_t state)
 {
 	struct list_head list;
+	ktime_t start = pm_profile_time();
 
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
@@ -492,12 +500,14 @@ static void dpm_resume(pm_message_t state)
 
 		get_device(dev);
 		if (dev->power.status >= DPM_OFF) {
+			ktime_t dev_start = pm_profile_time();
 			int error;
 
 			dev->power.status = DPM_RESUMING;
 			mutex_unlock(&dpm_list_mtx);
 
 			error = device_resume(dev, state);
+			pm_profile_device(dev, PM_PROFILE_RESUME, dev_start);
 
 			mutex_lock(&dpm_list_mtx);
 			if (error)
@@ -512,6 +522,7 @@ static void dpm_resume(pm_message_t state)
 	}
 	list_splice(&list, &dpm_list);
 	mutex_unlock(&dpm_list_mtx);
+	pm_profile_phase(PM_PROFILE_RESUME, start);
 }
 
 /**
@@ -551,6 +562,7 @@ static void device_complete(struct device *dev, pm_message_t state)
 static void dpm_complete(pm_message_t state)
 {
 	struct list_head list;
+	ktime_t start = pm_profile_time();
 
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
@@ -560,10 +572,13 @@ static void dpm_complete(pm_message_t state)
 
 		get_device(dev);
 		if (dev->power.status > DPM_ON) {
+			ktime_t dev_start = pm_profile_time();
+
 			dev->power.status = DPM_ON;
 			mutex_unlock(&dpm_list_mtx);
 
 			device_complete(dev, state);
+			pm_profile_device(dev, PM_PROFILE_COMPLETE, dev_start);
 			pm_runtime_put_noidle(dev);
 
 			mutex_lock(&dpm_list_mtx);
@@ -574,6 +589,7 @@ static void dpm_complete(pm_message_t state)
 	}
 	list_splice(&list, &dpm_list);
 	mutex_unlock(&dpm_list_mtx);
+	pm_profile_phase(PM_PROFILE_COMPLETE, start);
 }
 
 /**
@@ -647,12 +663,16 @@ static int device_suspend_noirq(struct device *dev, pm_message_t state)
 int dpm_suspend_noirq(pm_message_t state)
 {
 	struct device *dev;
+	ktime_t start = pm_profile_time();
 	int error = 0;
 
 	suspend_device_irqs();
 	mutex_lock(&dpm_list_mtx);
 	list_for_each_entry_reverse(dev, &dpm_list, power.entry) {
+		ktime_t dev_start = pm_profile_time();
+
 		error = device_suspend_noirq(dev, state);
+		pm_profile_device(dev, PM_PROFILE_SUSPEND_NOIRQ, dev_start);
 		if (error) {
 			pm_dev_err(dev, state, " late", error);
 			break;
@@ -660,6 +680,7 @@ int dpm_suspend_noirq(pm_message_t state)
 		dev->power.status = DPM_OFF_IRQ;
 	}
 	mutex_unlock(&dpm_list_mtx);
+	pm_profile_phase(PM_PROFILE_SUSPEND_NOIRQ, start);
 	if (error)
 		dpm_resume_noirq(resume_event(state));
 	return error;
@@ -722,18 +743,22 @@ static int device_suspend(struct device *dev, pm_message_t state)
 static int dpm_suspend(pm_message_t state)
 {
 	struct list_head list;
+	ktime_t start = pm_profile_time();
 	int error = 0;
 
 	INIT_LIST_HEAD(&list);
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_list)) {
 		struct device *dev = to_device(dpm_list.prev);
+		ktime_t dev_start;
 
 		get_device(dev);
 		mutex_unlock(&dpm_list_mtx);
 
 		dpm_drv_wdset(dev);
+		dev_start = pm_profile_time();
 		error = device_suspend(dev, state);
+		pm_profile_device(dev, PM_PROFILE_SUSPEND, dev_start);
 		dpm_drv_wdclr(dev);
 
 		mutex_lock(&dpm_list_mtx);
@@ -749,6 +774,7 @@ static int dpm_suspend(pm_message_t state)
 	}
 	list_splice(&list, dpm_list.prev);
 	mutex_unlock(&dpm_list_mtx);
+	pm_profile_phase(PM_PROFILE_SUSPEND, start);
 	return error;
 }
 
@@ -802,6 +828,7 @@ static int device_prepare(struct device *dev, pm_message_t state)
 static int dpm_prepare(pm_message_t state)
 {
 	struct list_head list;
+	ktime_t start = pm_profile_time();
 	int error = 0;
 
 	INIT_LIST_HEAD(&list);
@@ -809,6 +836,7 @@ static int dpm_prepare(pm_message_t state)
 	transition_started = true;
 	while (!list_empty(&dpm_list)) {
 		struct device *dev = to_device(dpm_list.next);
+		ktime_t dev_start;
 
 		get_device(dev);
 		dev->power.status = DPM_PREPARING;
@@ -820,7 +848,9 @@ static int dpm_prepare(pm_message_t state)
 			pm_runtime_put_noidle(dev);
 			error = -EBUSY;
 		} else {
+			dev_start = pm_profile_time();
 			error = device_prepare(dev, state);
+			pm_profile_device(dev, PM_PROFILE_PREPARE, dev_start);
 		}
 
 		mutex_lock(&dpm_list_mtx);
@@ -844,6 +874,7 @@ static int dpm_prepare(pm_message_t state)
 	}
 	list_splice(&list, &dpm_list);
 	mutex_unlock(&dpm_list_mtx);
+	pm_profile_phase(PM_PROFILE_PREPARE, start);
 	return error;
 }
 
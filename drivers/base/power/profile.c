@@ -0,0 +1,463 @@
+/*
+ * drivers/base/power/profile.c - Suspend/resume latency profiler.
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This file is released under the GPLv2
+ *
+ *
+ * Every phase of a suspend cycle and every device callback run by the driver
+ * core is timed. The durations of all cycles since boot are collected in
+ * decade histograms, per phase and per device, and the callbacks that took
+ * longer than a threshold are kept in a ring along with their cycle number.
+ *
+ * Everything is shown in debugfs/pm_profile; writing to any of the files
+ * clears the statistics.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/pm_profile.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "power.h"
+
+/* < 10us, < 100us, < 1ms, < 10ms, < 100ms, < 1s, >= 1s */
+#define PM_PROFILE_BUCKETS	7
+
+#define PM_PROFILE_RING		256
+
+enum {
+	PM_PROFILE_DIR_SUSPEND,
+	PM_PROFILE_DIR_RESUME,
+	PM_PROFILE_DIRS
+};
+
+struct pm_profile_hist {
+	unsigned long	count;
+	u32		last_us;
+	u32		max_us;
+	u64		total_us;
+	unsigned long	bucket[PM_PROFILE_BUCKETS];
+};
+
+struct pm_profile_dev {
+	unsigned long		cycle;	/* cycle of cycle_us[] */
+	u32			cycle_us[PM_PROFILE_DIRS];
+	bool			ran[PM_PROFILE_DIRS];
+	struct pm_profile_hist	hist[PM_PROFILE_DIRS];
+};
+
+struct pm_profile_rec {
+	unsigned long		cycle;
+	u32			us;
+	enum pm_profile_phase	phase;
+	char			name[20];
+};
+
+static const char *pm_profile_phases[PM_PROFILE_NR_PHASES] = {
+	[PM_PROFILE_SYNC]		= "sync",
+	[PM_PROFILE_FREEZE]		= "freeze",
+	[PM_PROFILE_PREPARE]		= "prepare",
+	[PM_PROFILE_SUSPEND]		= "suspend",
+	[PM_PROFILE_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[PM_PROFILE_RESUME_NOIRQ]	= "resume_noirq",
+	[PM_PROFILE_RESUME]		= "resume",
+	[PM_PROFILE_COMPLETE]		= "complete",
+	[PM_PROFILE_THAW]		= "thaw",
+};
+
+static const char *pm_profile_dirs[PM_PROFILE_DIRS] = {
+	[PM_PROFILE_DIR_SUSPEND]	= "suspend",
+	[PM_PROFILE_DIR_RESUME]		= "resume",
+};
+
+static DEFINE_SPINLOCK(pm_profile_lock);
+static int depth;
+static unsigned long cycle;		/* the current or last cycle */
+static unsigned long failed;
+static u32 phase_us[PM_PROFILE_NR_PHASES];
+static bool phase_ran[PM_PROFILE_NR_PHASES];
+static struct pm_profile_hist phase_hist[PM_PROFILE_NR_PHASES];
+static struct pm_profile_hist total_hist[PM_PROFILE_DIRS];
+static struct pm_profile_rec ring[PM_PROFILE_RING];
+static unsigned int ring_head, ring_count;
+static u32 ring_threshold_us = 1000;
+
+static inline int pm_profile_dir(enum pm_profile_phase phase)
+{
+	return phase < PM_PROFILE_RESUME_NOIRQ ?
+		PM_PROFILE_DIR_SUSPEND : PM_PROFILE_DIR_RESUME;
+}
+
+static void pm_profile_hist_add(struct pm_profile_hist *h, u32 us)
+{
+	u32 limit = 10;
+	int b;
+
+	for (b = 0; b < PM_PROFILE_BUCKETS - 1 && us >= limit; b++)
+		limit *= 10;
+
+	h->count++;
+	h->last_us = us;
+	h->total_us += us;
+	if (us > h->max_us)
+		h->max_us = us;
+	h->bucket[b]++;
+}
+
+/**
+ * pm_profile_begin - Start a suspend cycle, unless one is running.
+ */
+void pm_profile_begin(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	if (!depth++) {
+		cycle++;
+		memset(phase_us, 0, sizeof(phase_us));
+		memset(phase_ran, 0, sizeof(phase_ran));
+	}
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+/**
+ * pm_profile_end - Finish a suspend cycle.
+ * @error: The cycle failed.
+ *
+ * Add the durations of the phases and devices of the cycle to the histograms
+ * when the outermost cycle ends.
+ */
+void pm_profile_end(int error)
+{
+	struct device *dev;
+	struct pm_profile_dev *prof;
+	u32 total_us[PM_PROFILE_DIRS] = { 0, 0 };
+	bool ran[PM_PROFILE_DIRS] = { false, false };
+	unsigned long flags;
+	int phase, dir;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	if (!depth || --depth) {
+		spin_unlock_irqrestore(&pm_profile_lock, flags);
+		return;
+	}
+
+	if (error)
+		failed++;
+
+	for (phase = 0; phase < PM_PROFILE_NR_PHASES; phase++) {
+		if (!phase_ran[phase])
+			continue;
+		pm_profile_hist_add(&phase_hist[phase], phase_us[phase]);
+		dir = pm_profile_dir(phase);
+		total_us[dir] += phase_us[phase];
+		ran[dir] = true;
+	}
+
+	for (dir = 0; dir < PM_PROFILE_DIRS; dir++)
+		if (ran[dir])
+			pm_profile_hist_add(&total_hist[dir], total_us[dir]);
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+	device_pm_lock();
+	list_for_each_entry(dev, &dpm_list, power.entry) {
+		prof = dev->power.profile;
+		if (!prof)
+			continue;
+
+		spin_lock_irqsave(&pm_profile_lock, flags);
+		if (prof->cycle == cycle) {
+			for (dir = 0; dir < PM_PROFILE_DIRS; dir++) {
+				if (prof->ran[dir])
+					pm_profile_hist_add(&prof->hist[dir],
+							    prof->cycle_us[dir]);
+				prof->cycle_us[dir] = 0;
+				prof->ran[dir] = false;
+			}
+		}
+		spin_unlock_irqrestore(&pm_profile_lock, flags);
+	}
+	device_pm_unlock();
+}
+
+/**
+ * pm_profile_phase - Account a phase of the current cycle.
+ * @phase: Phase that ran.
+ * @start: pm_profile_time() when it started.
+ */
+void pm_profile_phase(enum pm_profile_phase phase, ktime_t start)
+{
+	u32 us = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	if (depth) {
+		phase_us[phase] += us;
+		phase_ran[phase] = true;
+	}
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+/**
+ * pm_profile_device - Account a device callback of the current cycle.
+ * @dev: Device whose callbacks were run.
+ * @phase: Phase the callbacks belong to.
+ * @start: pm_profile_time() before the callbacks.
+ */
+void pm_profile_device(struct device *dev, enum pm_profile_phase phase,
+		       ktime_t start)
+{
+	u32 us = ktime_us_delta(ktime_get(), start);
+	int dir = pm_profile_dir(phase);
+	struct pm_profile_dev *prof, *new = NULL;
+	struct pm_profile_rec *rec;
+	unsigned long flags;
+
+	if (!depth)
+		return;
+
+	/*
+	 * pm_profile_remove() may free the statistics as soon as the lock is
+	 * dropped, so only look at them with it held.
+	 */
+	if (!ACCESS_ONCE(dev->power.profile)) {
+		/* May be in a noirq phase */
+		new = kzalloc(sizeof(*new), GFP_ATOMIC);
+		if (!new)
+			return;
+	}
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	prof = dev->power.profile;
+	if (!prof) {
+		/*
+		 * Freed while we weren't looking, or the device is already off
+		 * dpm_list and nothing would free a new one.
+		 */
+		if (!new || list_empty(&dev->power.entry)) {
+			spin_unlock_irqrestore(&pm_profile_lock, flags);
+			kfree(new);
+			return;
+		}
+		prof = new;
+		new = NULL;
+		dev->power.profile = prof;
+	}
+
+	if (prof->cycle != cycle) {
+		memset(prof->cycle_us, 0, sizeof(prof->cycle_us));
+		memset(prof->ran, 0, sizeof(prof->ran));
+		prof->cycle = cycle;
+	}
+	prof->cycle_us[dir] += us;
+	prof->ran[dir] = true;
+
+	if (us >= ring_threshold_us) {
+		rec = &ring[ring_head];
+		ring_head = (ring_head + 1) % PM_PROFILE_RING;
+		if (ring_count < PM_PROFILE_RING)
+			ring_count++;
+
+		rec->cycle = cycle;
+		rec->us = us;
+		rec->phase = phase;
+		strlcpy(rec->name, dev_name(dev), sizeof(rec->name));
+	}
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+	kfree(new);
+}
+
+/**
+ * pm_profile_remove - Drop the statistics of a device being removed.
+ * @dev: Device to handle.
+ */
+void pm_profile_remove(struct device *dev)
+{
+	struct pm_profile_dev *prof;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	prof = dev->power.profile;
+	dev->power.profile = NULL;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+	kfree(prof);
+}
+
+static void pm_profile_hist_show(struct seq_file *s, const char *name,
+				 const char *dir, struct pm_profile_hist *h)
+{
+	int b;
+
+	seq_printf(s, "%-20s %-7s %7lu %8u %8llu %8u", name, dir, h->count,
+		   h->last_us,
+		   h->count ? div64_u64(h->total_us, h->count) : 0ULL,
+		   h->max_us);
+	for (b = 0; b < PM_PROFILE_BUCKETS; b++)
+		seq_printf(s, " %6lu", h->bucket[b]);
+	seq_putc(s, '\n');
+}
+
+static void pm_profile_header(struct seq_file *s, const char *what)
+{
+	seq_printf(s, "%-20s %-7s %7s %8s %8s %8s %6s %6s %6s %6s %6s %6s %6s\n",
+		   what, "", "count", "last us", "avg us", "max us", "<10us",
+		   "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s");
+}
+
+static int pm_profile_phases_show(struct seq_file *s, void *unused)
+{
+	struct pm_profile_hist hist;
+	unsigned long flags, cycles, fails;
+	int phase, dir;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	cycles = cycle;
+	fails = failed;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+	seq_printf(s, "cycles: %lu, failed: %lu\n\n", cycles, fails);
+	pm_profile_header(s, "phase");
+
+	for (phase = 0; phase < PM_PROFILE_NR_PHASES; phase++) {
+		spin_lock_irqsave(&pm_profile_lock, flags);
+		hist = phase_hist[phase];
+		spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+		pm_profile_hist_show(s, pm_profile_phases[phase],
+				     pm_profile_dirs[pm_profile_dir(phase)],
+				     &hist);
+	}
+
+	for (dir = 0; dir < PM_PROFILE_DIRS; dir++) {
+		spin_lock_irqsave(&pm_profile_lock, flags);
+		hist = total_hist[dir];
+		spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+		pm_profile_hist_show(s, "total", pm_profile_dirs[dir], &hist);
+	}
+
+	return 0;
+}
+
+static int pm_profile_devices_show(struct seq_file *s, void *unused)
+{
+	struct device *dev;
+	struct pm_profile_hist hist;
+	unsigned long flags;
+	int dir;
+
+	pm_profile_header(s, "device");
+
+	device_pm_lock();
+	list_for_each_entry(dev, &dpm_list, power.entry) {
+		for (dir = 0; dir < PM_PROFILE_DIRS; dir++) {
+			spin_lock_irqsave(&pm_profile_lock, flags);
+			if (dev->power.profile)
+				hist = dev->power.profile->hist[dir];
+			else
+				hist.count = 0;
+			spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+			if (hist.count)
+				pm_profile_hist_show(s, dev_name(dev),
+						     pm_profile_dirs[dir],
+						     &hist);
+		}
+	}
+	device_pm_unlock();
+
+	return 0;
+}
+
+static int pm_profile_ring_show(struct seq_file *s, void *unused)
+{
+	struct pm_profile_rec rec;
+	unsigned long flags;
+	unsigned int i, n;
+
+	seq_printf(s, "%-8s %-14s %8s %s\n", "cycle", "phase", "us", "device");
+
+	for (i = 0; ; i++) {
+		spin_lock_irqsave(&pm_profile_lock, flags);
+		n = ring_count;
+		if (i < n)
+			rec = ring[(ring_head + PM_PROFILE_RING - n + i) %
+				   PM_PROFILE_RING];
+		spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+		if (i >= n)
+			break;
+
+		seq_printf(s, "%-8lu %-14s %8u %s\n", rec.cycle,
+			   pm_profile_phases[rec.phase], rec.us, rec.name);
+	}
+
+	return 0;
+}
+
+static int pm_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, inode->i_private, NULL);
+}
+
+static ssize_t pm_profile_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct device *dev;
+	unsigned long flags;
+
+	device_pm_lock();
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	failed = 0;
+	memset(phase_hist, 0, sizeof(phase_hist));
+	memset(total_hist, 0, sizeof(total_hist));
+	ring_count = 0;
+	list_for_each_entry(dev, &dpm_list, power.entry)
+		if (dev->power.profile)
+			memset(dev->power.profile->hist, 0,
+			       sizeof(dev->power.profile->hist));
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+	device_pm_unlock();
+
+	return count;
+}
+
+static const struct file_operations pm_profile_fops = {
+	.owner		= THIS_MODULE,
+	.open		= pm_profile_open,
+	.read		= seq_read,
+	.write		= pm_profile_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init pm_profile_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("pm_profile", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("phases", S_IRUGO | S_IWUSR, dir,
+			    pm_profile_phases_show, &pm_profile_fops);
+	debugfs_create_file("devices", S_IRUGO | S_IWUSR, dir,
+			    pm_profile_devices_show, &pm_profile_fops);
+	debugfs_create_file("ring", S_IRUGO | S_IWUSR, dir,
+			    pm_profile_ring_show, &pm_profile_fops);
+	debugfs_create_u32("ring_threshold_us", S_IRUGO | S_IWUSR, dir,
+			   &ring_threshold_us);
+
+	return 0;
+}
+
+late_initcall(pm_profile_init);
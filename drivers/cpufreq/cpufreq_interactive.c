@@ -0,0 +1,461 @@
+/*
+ *  drivers/cpufreq/cpufreq_interactive.c
+ *
+ *  Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The interactive governor samples the load of a CPU over a short period
+ * after it leaves idle, instead of on a fixed grid as ondemand does, and
+ * jumps straight to the maximum speed when the load is high. Lowering the
+ * speed is held back for min_sample_time, so a short pause in an
+ * interaction does not cost a ramp up afterwards.
+ *
+ * Sampling is started and stopped from the idle notifier, so a CPU that
+ * stays idle at the minimum speed is not woken up by the governor. Unlike a
+ * pm_idle hook, the notifier keeps working when cpuidle installs its own
+ * pm_idle.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/kernel_stat.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
+#include <asm/idle.h>
+#include <asm/system.h>
+
+#define DEF_GO_MAXSPEED_LOAD		(85)
+#define DEF_MIN_SAMPLE_TIME		(80000)
+#define DEF_TIMER_RATE			(20000)
+#define MIN_TIMER_RATE			(5000)
+#define TRANSITION_LATENCY_LIMIT	(10 * 1000 * 1000)
+
+struct cpufreq_interactive_cpuinfo {
+	struct timer_list cpu_timer;
+	int timer_idlecancel;
+	u64 sample_wall;		/* start of the sample, in us */
+	u64 sample_idle;
+	u64 change_wall;		/* last target_freq change */
+	u64 change_idle;
+	struct cpufreq_policy *policy;
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int target_freq;
+	int governor_enabled;
+	struct work_struct freq_work;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
+
+static unsigned int interactive_enable;	/* number of CPUs using it */
+static DEFINE_MUTEX(interactive_mutex);
+
+/* serializes the driver ->target calls of the worker and of GOV_LIMITS */
+static DEFINE_MUTEX(set_speed_lock);
+
+static struct workqueue_struct *kinteractive_wq;
+
+static struct interactive_tuners {
+	unsigned int go_maxspeed_load;
+	unsigned int min_sample_time;
+	unsigned int timer_rate;
+} interactive_tuners_ins = {
+	.go_maxspeed_load = DEF_GO_MAXSPEED_LOAD,
+	.min_sample_time = DEF_MIN_SAMPLE_TIME,
+	.timer_rate = DEF_TIMER_RATE,
+};
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+static
+#endif
+struct cpufreq_governor cpufreq_gov_interactive = {
+	.name			= "interactive",
+	.governor		= cpufreq_governor_interactive,
+	.max_transition_latency	= TRANSITION_LATENCY_LIMIT,
+	.owner			= THIS_MODULE,
+};
+
+static u64 get_cpu_idle_time_jiffy(unsigned int cpu, u64 *wall)
+{
+	cputime64_t cur_wall_time;
+	cputime64_t busy_time;
+
+	cur_wall_time = jiffies64_to_cputime64(get_jiffies_64());
+	busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
+			kstat_cpu(cpu).cpustat.system);
+
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
+
+	*wall = jiffies_to_usecs(cur_wall_time);
+
+	return jiffies_to_usecs(cputime64_sub(cur_wall_time, busy_time));
+}
+
+static u64 get_cpu_idle_time(unsigned int cpu, u64 *wall)
+{
+	u64 idle_time = get_cpu_idle_time_us(cpu, wall);
+
+	if (idle_time == -1ULL)
+		return get_cpu_idle_time_jiffy(cpu, wall);
+
+	return idle_time;
+}
+
+static unsigned int interactive_load(s64 wall, s64 idle)
+{
+	if (wall <= 0 || idle >= wall)
+		return 0;
+	if (idle < 0)
+		idle = 0;
+
+	return div64_u64(100 * (wall - idle), wall);
+}
+
+static void interactive_timer_start(struct cpufreq_interactive_cpuinfo *pcpu,
+				    unsigned int cpu)
+{
+	pcpu->sample_idle = get_cpu_idle_time(cpu, &pcpu->sample_wall);
+	pcpu->timer_idlecancel = 0;
+	mod_timer_pinned(&pcpu->cpu_timer, jiffies +
+			 usecs_to_jiffies(interactive_tuners_ins.timer_rate));
+}
+
+static void cpufreq_interactive_timer(unsigned long data)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, data);
+	struct cpufreq_policy *policy;
+	unsigned int load, load_since_change, new_freq, index;
+	u64 wall, idle;
+
+	smp_rmb();
+	if (!pcpu->governor_enabled)
+		return;
+
+	policy = pcpu->policy;
+	idle = get_cpu_idle_time(data, &wall);
+
+	load = interactive_load(wall - pcpu->sample_wall,
+				idle - pcpu->sample_idle);
+	load_since_change = interactive_load(wall - pcpu->change_wall,
+					     idle - pcpu->change_idle);
+
+	/*
+	 * A single short sample right after a change says little about the
+	 * load to come; the load since the change is a better guess when it
+	 * is the higher of the two.
+	 */
+	if (load_since_change > load)
+		load = load_since_change;
+
+	if (load >= interactive_tuners_ins.go_maxspeed_load)
+		new_freq = policy->max;
+	else
+		new_freq = policy->max * load / 100;
+
+	if (cpufreq_frequency_table_target(policy, pcpu->freq_table, new_freq,
+					   CPUFREQ_RELATION_H, &index))
+		goto rearm;
+
+	new_freq = pcpu->freq_table[index].frequency;
+
+	/* hold a speed for min_sample_time before lowering it */
+	if (new_freq < pcpu->target_freq &&
+	    (s64)(wall - pcpu->change_wall) <
+	    interactive_tuners_ins.min_sample_time)
+		goto rearm;
+
+	if (new_freq != pcpu->target_freq) {
+		pcpu->target_freq = new_freq;
+		pcpu->change_wall = wall;
+		pcpu->change_idle = idle;
+		queue_work(kinteractive_wq, &pcpu->freq_work);
+	}
+
+rearm:
+	/* at the maximum, going idle starts sampling again */
+	if (pcpu->target_freq == policy->max)
+		return;
+
+	/*
+	 * At the minimum there is nothing to lower: an idle CPU is left
+	 * alone, and a busy one is sampled until it goes idle.
+	 */
+	if (pcpu->target_freq == policy->min && idle_cpu(data))
+		return;
+
+	interactive_timer_start(pcpu, data);
+	if (pcpu->target_freq == policy->min)
+		pcpu->timer_idlecancel = 1;
+}
+
+static void cpufreq_interactive_idle_start(void)
+{
+	unsigned int cpu = smp_processor_id();
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	if (pcpu->target_freq != pcpu->policy->min) {
+		/* keep sampling so that the speed comes down while idle */
+		if (!timer_pending(&pcpu->cpu_timer))
+			interactive_timer_start(pcpu, cpu);
+	} else if (pcpu->timer_idlecancel) {
+		/* the CPU went idle before the load had to be checked */
+		del_timer(&pcpu->cpu_timer);
+	}
+}
+
+static void cpufreq_interactive_idle_end(void)
+{
+	unsigned int cpu = smp_processor_id();
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	/* left idle: check the load after one short period */
+	if (!timer_pending(&pcpu->cpu_timer))
+		interactive_timer_start(pcpu, cpu);
+}
+
+static int cpufreq_interactive_idle_notifier(struct notifier_block *nb,
+					     unsigned long val, void *data)
+{
+	switch (val) {
+	case IDLE_START:
+		cpufreq_interactive_idle_start();
+		break;
+	case IDLE_END:
+		cpufreq_interactive_idle_end();
+		break;
+	}
+
+	return 0;
+}
+
+static struct notifier_block cpufreq_interactive_idle_nb = {
+	.notifier_call = cpufreq_interactive_idle_notifier,
+};
+
+static void cpufreq_interactive_freq_change(struct work_struct *work)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		container_of(work, struct cpufreq_interactive_cpuinfo,
+			     freq_work);
+
+	mutex_lock(&set_speed_lock);
+	if (pcpu->governor_enabled &&
+	    pcpu->target_freq != pcpu->policy->cur)
+		__cpufreq_driver_target(pcpu->policy, pcpu->target_freq,
+					CPUFREQ_RELATION_H);
+	mutex_unlock(&set_speed_lock);
+}
+
+/************************** sysfs interface ************************/
+
+#define show_one(file_name, object)					\
+static ssize_t show_##file_name						\
+(struct kobject *kobj, struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%u\n", interactive_tuners_ins.object);	\
+}
+show_one(go_maxspeed_load, go_maxspeed_load);
+show_one(min_sample_time, min_sample_time);
+show_one(timer_rate, timer_rate);
+
+static ssize_t store_go_maxspeed_load(struct kobject *a, struct attribute *b,
+				      const char *buf, size_t count)
+{
+	unsigned int input;
+
+	if (sscanf(buf, "%u", &input) != 1 || input < 1 || input > 100)
+		return -EINVAL;
+
+	interactive_tuners_ins.go_maxspeed_load = input;
+	return count;
+}
+
+static ssize_t store_min_sample_time(struct kobject *a, struct attribute *b,
+				     const char *buf, size_t count)
+{
+	unsigned int input;
+
+	if (sscanf(buf, "%u", &input) != 1)
+		return -EINVAL;
+
+	interactive_tuners_ins.min_sample_time = input;
+	return count;
+}
+
+static ssize_t store_timer_rate(struct kobject *a, struct attribute *b,
+				const char *buf, size_t count)
+{
+	unsigned int input;
+
+	if (sscanf(buf, "%u", &input) != 1)
+		return -EINVAL;
+
+	interactive_tuners_ins.timer_rate = max(input, (unsigned int)MIN_TIMER_RATE);
+	return count;
+}
+
+#define define_one_rw(_name) \
+static struct global_attr _name = \
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+define_one_rw(go_maxspeed_load);
+define_one_rw(min_sample_time);
+define_one_rw(timer_rate);
+
+static struct attribute *interactive_attributes[] = {
+	&go_maxspeed_load.attr,
+	&min_sample_time.attr,
+	&timer_rate.attr,
+	NULL
+};
+
+static struct attribute_group interactive_attr_group = {
+	.attrs = interactive_attributes,
+	.name = "interactive",
+};
+
+/************************** sysfs end ************************/
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned int j, was_enabled;
+	int rc;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if ((!cpu_online(policy->cpu)) || (!policy->cur))
+			return -EINVAL;
+
+		mutex_lock(&interactive_mutex);
+
+		was_enabled = interactive_enable;
+		if (!was_enabled) {
+			rc = sysfs_create_group(cpufreq_global_kobject,
+						&interactive_attr_group);
+			if (rc) {
+				mutex_unlock(&interactive_mutex);
+				return rc;
+			}
+		}
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->policy = policy;
+			pcpu->freq_table = cpufreq_frequency_get_table(j);
+			pcpu->target_freq = policy->cur;
+			pcpu->change_idle = get_cpu_idle_time(j,
+							&pcpu->change_wall);
+			smp_wmb();
+			pcpu->governor_enabled = 1;
+			interactive_enable++;
+		}
+
+		/* sampling starts at the next idle entry or exit */
+		mutex_unlock(&interactive_mutex);
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&interactive_mutex);
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->governor_enabled = 0;
+			smp_wmb();
+			del_timer_sync(&pcpu->cpu_timer);
+			cancel_work_sync(&pcpu->freq_work);
+			interactive_enable--;
+		}
+
+		if (!interactive_enable)
+			sysfs_remove_group(cpufreq_global_kobject,
+					   &interactive_attr_group);
+
+		mutex_unlock(&interactive_mutex);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&set_speed_lock);
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+				policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+				policy->min, CPUFREQ_RELATION_L);
+		for_each_cpu(j, policy->cpus)
+			per_cpu(cpuinfo, j).target_freq = policy->cur;
+		mutex_unlock(&set_speed_lock);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_gov_interactive_init(void)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned int i;
+	int err;
+
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		init_timer(&pcpu->cpu_timer);
+		pcpu->cpu_timer.function = cpufreq_interactive_timer;
+		pcpu->cpu_timer.data = i;
+		INIT_WORK(&pcpu->freq_work, cpufreq_interactive_freq_change);
+	}
+
+	/* speeding up is on the path of the user's input, don't queue it */
+	kinteractive_wq = create_rt_workqueue("kinteractive");
+	if (!kinteractive_wq) {
+		printk(KERN_ERR "Creation of kinteractive failed\n");
+		return -EFAULT;
+	}
+	idle_notifier_register(&cpufreq_interactive_idle_nb);
+	err = cpufreq_register_governor(&cpufreq_gov_interactive);
+	if (err) {
+		idle_notifier_unregister(&cpufreq_interactive_idle_nb);
+		destroy_workqueue(kinteractive_wq);
+	}
+
+	return err;
+}
+
+static void __exit cpufreq_gov_interactive_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	idle_notifier_unregister(&cpufreq_interactive_idle_nb);
+	destroy_workqueue(kinteractive_wq);
+}
+
+MODULE_DESCRIPTION("'cpufreq_interactive' - A cpufreq governor for "
+	"latency sensitive workloads");
+MODULE_LICENSE("GPL");
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+fs_initcall(cpufreq_gov_interactive_init);
+#else
+module_init(cpufreq_gov_interactive_init);
+#endif
+module_exit(cpufreq_gov_interactive_exit);
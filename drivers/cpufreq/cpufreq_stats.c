@@ -15,6 +15,8 @@
 #include <linux/sysfs.h>
 #include <linux/cpufreq.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/percpu.h>
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
@@ -38,6 +40,12 @@ struct cpufreq_stats {
 	unsigned int last_index;
 	cputime64_t *time_in_state;
 	unsigned int *freq_table;
+	/* from CPUFREQ_PRECHANGE to CPUFREQ_POSTCHANGE, in ns */
+	ktime_t trans_start;
+	unsigned int trans_latency_count;
+	u64 trans_latency_total;
+	u64 trans_latency_last;
+	u64 trans_latency_max;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
@@ -92,6 +100,25 @@ static ssize_t show_time_in_state(struct cpufreq_policy *policy, char *buf)
 	return len;
 }
 
+static ssize_t show_trans_latency(struct cpufreq_policy *policy, char *buf)
+{
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	u64 last, avg, max;
+
+	if (!stat)
+		return 0;
+	spin_lock(&cpufreq_stats_lock);
+	last = stat->trans_latency_last;
+	avg = stat->trans_latency_count ?
+		div64_u64(stat->trans_latency_total,
+			  stat->trans_latency_count) : 0;
+	max = stat->trans_latency_max;
+	spin_unlock(&cpufreq_stats_lock);
+	return sprintf(buf, "last %llu\navg %llu\nmax %llu\n",
+		       (unsigned long long)last, (unsigned long long)avg,
+		       (unsigned long long)max);
+}
+
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 {
@@ -141,10 +168,12 @@ CPUFREQ_STATDEVICE_ATTR(trans_table, 0444, show_trans_table);
 
 CPUFREQ_STATDEVICE_ATTR(total_trans, 0444, show_total_trans);
 CPUFREQ_STATDEVICE_ATTR(time_in_state, 0444, show_time_in_state);
+CPUFREQ_STATDEVICE_ATTR(trans_latency, 0444, show_trans_latency);
 
 static struct attribute *default_attrs[] = {
 	&_attr_total_trans.attr,
 	&_attr_time_in_state.attr,
+	&_attr_trans_latency.attr,
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	&_attr_trans_table.attr,
 #endif
@@ -276,14 +305,33 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
+	u64 latency;
 
-	if (val != CPUFREQ_POSTCHANGE)
+	if (val != CPUFREQ_PRECHANGE && val != CPUFREQ_POSTCHANGE)
 		return 0;
 
 	stat = per_cpu(cpufreq_stats_table, freq->cpu);
 	if (!stat)
 		return 0;
 
+	spin_lock(&cpufreq_stats_lock);
+	if (val == CPUFREQ_PRECHANGE) {
+		stat->trans_start = ktime_get();
+		spin_unlock(&cpufreq_stats_lock);
+		return 0;
+	}
+	if (stat->trans_start.tv64) {
+		latency = ktime_to_ns(ktime_sub(ktime_get(),
+						stat->trans_start));
+		stat->trans_start.tv64 = 0;
+		stat->trans_latency_count++;
+		stat->trans_latency_total += latency;
+		stat->trans_latency_last = latency;
+		if (latency > stat->trans_latency_max)
+			stat->trans_latency_max = latency;
+	}
+	spin_unlock(&cpufreq_stats_lock);
+
 	old_index = stat->last_index;
 	new_index = freq_table_get_index(stat, freq->new);
 
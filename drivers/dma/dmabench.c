@@ -0,0 +1,195 @@
+/*
+ * DMA Engine memcpy benchmark
+ *
+ * Times memcpy offloaded to a DMA Engine channel against a CPU memcpy
+ * for power-of-two buffer sizes from min_size to max_size. The offloaded
+ * copy includes the cost of mapping the buffers, as a real client pays
+ * for it too, and every size is verified once.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/delay.h>
+#include <linux/dmaengine.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+static unsigned int min_size = 64;
+module_param(min_size, uint, S_IRUGO);
+MODULE_PARM_DESC(min_size, "Smallest copy size in bytes (default: 64)");
+
+static unsigned int max_size = 1 << 20;
+module_param(max_size, uint, S_IRUGO);
+MODULE_PARM_DESC(max_size, "Largest copy size in bytes (default: 1MiB)");
+
+static unsigned int iterations = 100;
+module_param(iterations, uint, S_IRUGO);
+MODULE_PARM_DESC(iterations, "Copies per size and method (default: 100)");
+
+static char test_channel[20];
+module_param_string(channel, test_channel, sizeof(test_channel), S_IRUGO);
+MODULE_PARM_DESC(channel, "Bus ID of the channel to test (default: any)");
+
+static char test_device[20];
+module_param_string(device, test_device, sizeof(test_device), S_IRUGO);
+MODULE_PARM_DESC(device, "Bus ID of the DMA Engine to test (default: any)");
+
+static struct dma_chan *bench_chan;
+static struct task_struct *bench_task;
+
+static bool dmabench_filter(struct dma_chan *chan, void *param)
+{
+	if (test_channel[0] != '\0' &&
+	    strcmp(dma_chan_name(chan), test_channel) != 0)
+		return false;
+	if (test_device[0] != '\0' &&
+	    strcmp(dev_name(chan->device->dev), test_device) != 0)
+		return false;
+	return true;
+}
+
+/* bytes per microsecond is MB/s */
+static unsigned long dmabench_rate(unsigned int size, s64 ns)
+{
+	u64 bytes = (u64)size * iterations * 1000;
+
+	if (ns <= 0)
+		return 0;
+
+	return (unsigned long)div64_u64(bytes, ns);
+}
+
+static s64 dmabench_dma(struct dma_chan *chan, u8 *dst, u8 *src,
+			unsigned int size, unsigned int *failures)
+{
+	dma_cookie_t cookie;
+	ktime_t start;
+	unsigned int i;
+
+	start = ktime_get();
+
+	for (i = 0; i < iterations; i++) {
+		cookie = dma_async_memcpy_buf_to_buf(chan, dst, src, size);
+		if (dma_submit_error(cookie)) {
+			(*failures)++;
+			msleep(1);
+			continue;
+		}
+
+		if (dma_sync_wait(chan, cookie) != DMA_SUCCESS)
+			(*failures)++;
+	}
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static s64 dmabench_cpu(u8 *dst, u8 *src, unsigned int size)
+{
+	ktime_t start;
+	unsigned int i;
+
+	start = ktime_get();
+
+	for (i = 0; i < iterations; i++)
+		memcpy(dst, src, size);
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static int dmabench_func(void *data)
+{
+	struct dma_chan *chan = data;
+	unsigned int size, i, failures;
+	s64 dma_ns, cpu_ns;
+	u8 *src, *dst;
+
+	src = kmalloc(max_size, GFP_KERNEL);
+	dst = kmalloc(max_size, GFP_KERNEL);
+	if (src == NULL || dst == NULL) {
+		pr_warning("dmabench: no memory for %u byte buffers\n",
+			   max_size);
+		goto out;
+	}
+
+	for (i = 0; i < max_size; i++)
+		src[i] = i ^ (i >> 8);
+
+	pr_info("dmabench: %s, %u iterations per size\n",
+		dma_chan_name(chan), iterations);
+	pr_info("dmabench: %10s %12s %12s %10s %10s %8s\n", "size",
+		"dma ns/op", "cpu ns/op", "dma MB/s", "cpu MB/s", "errors");
+
+	for (size = min_size; size && size <= max_size; size <<= 1) {
+		if (kthread_should_stop())
+			break;
+
+		failures = 0;
+
+		memset(dst, 0, size);
+		dma_ns = dmabench_dma(chan, dst, src, size, &failures);
+		if (memcmp(dst, src, size))
+			failures++;
+
+		cpu_ns = dmabench_cpu(dst, src, size);
+
+		pr_info("dmabench: %10u %12lld %12lld %10lu %10lu %8u\n", size,
+			div_s64(dma_ns, iterations), div_s64(cpu_ns, iterations),
+			dmabench_rate(size, dma_ns), dmabench_rate(size, cpu_ns),
+			failures);
+	}
+
+out:
+	kfree(src);
+	kfree(dst);
+
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static int __init dmabench_init(void)
+{
+	dma_cap_mask_t mask;
+
+	if (!iterations || !min_size || min_size > max_size)
+		return -EINVAL;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+	bench_chan = dma_request_channel(mask, dmabench_filter, NULL);
+	if (bench_chan == NULL) {
+		pr_warning("dmabench: no memcpy channel available\n");
+		return -ENODEV;
+	}
+
+	bench_task = kthread_run(dmabench_func, bench_chan, "dmabench");
+	if (IS_ERR(bench_task)) {
+		dma_release_channel(bench_chan);
+		return PTR_ERR(bench_task);
+	}
+
+	return 0;
+}
+/* when compiled-in wait for drivers to load first */
+late_initcall(dmabench_init);
+
+static void __exit dmabench_exit(void)
+{
+	kthread_stop(bench_task);
+	dma_release_channel(bench_chan);
+}
+module_exit(dmabench_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("DMA Engine memcpy benchmark");
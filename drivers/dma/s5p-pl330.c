@@ -0,0 +1,669 @@
+/*
+ * dmaengine driver for the Samsung S5P PL330 DMA controller
+ *
+ * The controller is owned by the s3c2410_dma layer in
+ * arch/arm/plat-s5p/dma-pl330.c. This driver puts the dmaengine API on
+ * top of it, so generic clients (async_tx, net DMA, dmatest) can offload
+ * copies and fills. Each dmaengine channel claims one virtual channel of
+ * that layer when it is allocated: one of the DMACH_3D_M2M channels for
+ * memcpy/memset, or the channel named in struct s5p_pl330_slave for
+ * slave transfers. Every descriptor is queued with
+ * s3c2410_dma_enqueue_sg(), so its PL330 program is built at issue time
+ * and is not affected by the next descriptor reconfiguring the channel.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/init.h>
+#include <linux/interrupt.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include <mach/dma.h>
+
+#define S5P_PL330_NR_CHANS	4
+#define S5P_PL330_NR_DESCS	64
+
+/* keeps the loop counters of one PL330 program block in range */
+#define S5P_PL330_MAX_CHUNK	(1 << 21)
+
+struct s5p_pl330_desc {
+	struct dma_async_tx_descriptor	txd;
+	struct list_head		node;
+
+	enum dma_transaction_type	type;
+	dma_addr_t			dst;
+	dma_addr_t			src;	/* memcpy source */
+	size_t				len;
+	unsigned int			xfer_unit;
+
+	/* memset: the fill value, read by the PL330 from a fixed address */
+	u32				*pattern;
+	dma_addr_t			pattern_phys;
+
+	/* slave */
+	struct scatterlist		*sg;
+	unsigned int			sg_len;
+	enum dma_data_direction		direction;
+
+	/* chunks queued with the pl330 layer and not yet completed */
+	unsigned int			chunks;
+};
+
+struct s5p_pl330_chan {
+	struct dma_chan			chan;
+	struct s3c2410_dma_client	client;
+	char				name[16];
+
+	unsigned int			m2m;	/* virtual channel for memcpy */
+	unsigned int			vch;	/* virtual channel in use */
+	struct s5p_pl330_slave		*slave;
+
+	spinlock_t			lock;
+	dma_cookie_t			completed;
+	struct list_head		free;
+	struct list_head		queued;	/* submitted, not issued */
+	struct list_head		active;	/* given to the pl330 layer */
+	struct list_head		done;
+	struct tasklet_struct		tasklet;
+
+	struct s5p_pl330_desc		*descs;
+	u32				*patterns;
+	dma_addr_t			patterns_phys;
+};
+
+struct s5p_pl330_dev {
+	struct dma_device		dma;
+	struct s5p_pl330_chan		chan[S5P_PL330_NR_CHANS];
+};
+
+static inline struct s5p_pl330_chan *to_s5p_chan(struct dma_chan *chan)
+{
+	return container_of(chan, struct s5p_pl330_chan, chan);
+}
+
+static inline struct s5p_pl330_desc *to_s5p_desc(struct dma_async_tx_descriptor *txd)
+{
+	return container_of(txd, struct s5p_pl330_desc, txd);
+}
+
+static inline struct device *chan2dev(struct dma_chan *chan)
+{
+	return &chan->dev->device;
+}
+
+static inline struct device *chan2parent(struct dma_chan *chan)
+{
+	return chan->dev->device.parent;
+}
+
+/*----------------------------------------------------------------------*/
+
+static struct s5p_pl330_desc *s5p_pl330_desc_get(struct s5p_pl330_chan *pch)
+{
+	struct s5p_pl330_desc *desc, *ret = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pch->lock, flags);
+	list_for_each_entry(desc, &pch->free, node) {
+		if (async_tx_test_ack(&desc->txd)) {
+			list_del(&desc->node);
+			ret = desc;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&pch->lock, flags);
+
+	if (ret == NULL)
+		dev_dbg(chan2dev(&pch->chan), "no free descriptors\n");
+
+	return ret;
+}
+
+static dma_cookie_t s5p_pl330_tx_submit(struct dma_async_tx_descriptor *tx)
+{
+	struct s5p_pl330_desc *desc = to_s5p_desc(tx);
+	struct s5p_pl330_chan *pch = to_s5p_chan(tx->chan);
+	dma_cookie_t cookie;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pch->lock, flags);
+
+	cookie = pch->chan.cookie;
+	if (++cookie < 0)
+		cookie = 1;
+	pch->chan.cookie = cookie;
+	desc->txd.cookie = cookie;
+
+	list_add_tail(&desc->node, &pch->queued);
+
+	spin_unlock_irqrestore(&pch->lock, flags);
+
+	return cookie;
+}
+
+/* s5p_pl330_buffdone
+ *
+ * s3c2410_dma completion callback, called from the pl330 irq handler or,
+ * with S3C2410_RES_ABORT, from a channel flush
+ */
+static void s5p_pl330_buffdone(struct s3c2410_dma_chan *lchan, void *id,
+			       int size, enum s3c2410_dma_buffresult result)
+{
+	struct s5p_pl330_desc *desc = id;
+	struct s5p_pl330_chan *pch = to_s5p_chan(desc->txd.chan);
+
+	spin_lock(&pch->lock);
+	if (--desc->chunks == 0) {
+		list_move_tail(&desc->node, &pch->done);
+		tasklet_schedule(&pch->tasklet);
+	}
+	spin_unlock(&pch->lock);
+}
+
+/* s5p_pl330_start
+ *
+ * hand a descriptor to the pl330 layer. Called with pch->lock held.
+ */
+static void s5p_pl330_start(struct s5p_pl330_chan *pch,
+			    struct s5p_pl330_desc *desc)
+{
+	struct scatterlist sg;
+	unsigned int i, nchunks;
+	size_t off, len;
+	int ret = 0;
+
+	switch (desc->type) {
+	case DMA_SLAVE:
+		desc->chunks = 1;
+		s3c2410_dma_devconfig(pch->vch,
+				      desc->direction == DMA_TO_DEVICE ?
+				      S3C2410_DMASRC_MEM : S3C2410_DMASRC_HW,
+				      pch->slave->fifo);
+		s3c2410_dma_config(pch->vch, pch->slave->width);
+		ret = s3c2410_dma_enqueue_sg(pch->vch, desc, desc->sg,
+					     desc->sg_len);
+		if (ret)
+			desc->chunks = 0;
+		break;
+
+	case DMA_MEMCPY:
+	case DMA_MEMSET:
+		nchunks = DIV_ROUND_UP(desc->len, S5P_PL330_MAX_CHUNK);
+		desc->chunks = nchunks;
+
+		for (i = 0, off = 0; i < nchunks; i++, off += len) {
+			len = min_t(size_t, desc->len - off, S5P_PL330_MAX_CHUNK);
+
+			if (desc->type == DMA_MEMCPY)
+				s3c2410_dma_devconfig(pch->vch, S3C_DMA_MEM2MEM,
+						      desc->src + off);
+			else
+				s3c2410_dma_devconfig(pch->vch, S3C_DMA_MEM2MEM_SET,
+						      desc->pattern_phys);
+			s3c2410_dma_config(pch->vch, desc->xfer_unit);
+
+			sg_init_table(&sg, 1);
+			sg_dma_address(&sg) = desc->dst + off;
+			sg_dma_len(&sg) = len;
+
+			ret = s3c2410_dma_enqueue_sg(pch->vch, desc, &sg, 1);
+			if (ret) {
+				desc->chunks -= nchunks - i;
+				break;
+			}
+		}
+		break;
+
+	default:
+		BUG();
+	}
+
+	if (ret)
+		dev_err(chan2dev(&pch->chan),
+			"failed to queue descriptor %d: %d\n",
+			desc->txd.cookie, ret);
+
+	/* nothing (more) in flight: complete it from the tasklet */
+	if (desc->chunks == 0) {
+		list_move_tail(&desc->node, &pch->done);
+		tasklet_schedule(&pch->tasklet);
+	}
+}
+
+static void s5p_pl330_issue_pending(struct dma_chan *chan)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	struct s5p_pl330_desc *desc, *_desc;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pch->lock, flags);
+	list_for_each_entry_safe(desc, _desc, &pch->queued, node) {
+		list_move_tail(&desc->node, &pch->active);
+		s5p_pl330_start(pch, desc);
+	}
+	spin_unlock_irqrestore(&pch->lock, flags);
+}
+
+static void s5p_pl330_unmap(struct s5p_pl330_chan *pch,
+			    struct s5p_pl330_desc *desc)
+{
+	struct device *parent = chan2parent(&pch->chan);
+	enum dma_ctrl_flags flags = desc->txd.flags;
+
+	if (desc->type == DMA_SLAVE)
+		return;
+
+	if (!(flags & DMA_COMPL_SKIP_DEST_UNMAP)) {
+		if (flags & DMA_COMPL_DEST_UNMAP_SINGLE)
+			dma_unmap_single(parent, desc->dst, desc->len,
+					 DMA_FROM_DEVICE);
+		else
+			dma_unmap_page(parent, desc->dst, desc->len,
+				       DMA_FROM_DEVICE);
+	}
+
+	if (desc->type == DMA_MEMCPY && !(flags & DMA_COMPL_SKIP_SRC_UNMAP)) {
+		if (flags & DMA_COMPL_SRC_UNMAP_SINGLE)
+			dma_unmap_single(parent, desc->src, desc->len,
+					 DMA_TO_DEVICE);
+		else
+			dma_unmap_page(parent, desc->src, desc->len,
+				       DMA_TO_DEVICE);
+	}
+}
+
+static void s5p_pl330_tasklet(unsigned long data)
+{
+	struct s5p_pl330_chan *pch = (struct s5p_pl330_chan *)data;
+	struct s5p_pl330_desc *desc;
+	dma_async_tx_callback callback;
+	void *param;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pch->lock, flags);
+	while (!list_empty(&pch->done)) {
+		desc = list_first_entry(&pch->done, struct s5p_pl330_desc, node);
+		list_del(&desc->node);
+		pch->completed = desc->txd.cookie;
+		spin_unlock_irqrestore(&pch->lock, flags);
+
+		callback = desc->txd.callback;
+		param = desc->txd.callback_param;
+
+		s5p_pl330_unmap(pch, desc);
+
+		kfree(desc->sg);
+		desc->sg = NULL;
+
+		if (callback)
+			callback(param);
+
+		spin_lock_irqsave(&pch->lock, flags);
+		list_add_tail(&desc->node, &pch->free);
+	}
+	spin_unlock_irqrestore(&pch->lock, flags);
+}
+
+/*----------------------------------------------------------------------*/
+
+static struct dma_async_tx_descriptor *
+s5p_pl330_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dest,
+			  dma_addr_t src, size_t len, unsigned long flags)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	struct s5p_pl330_desc *desc;
+
+	if (unlikely(!len || (len & 3) || pch->slave)) {
+		dev_dbg(chan2dev(chan), "prep_dma_memcpy: bad length %zu\n",
+			len);
+		return NULL;
+	}
+
+	desc = s5p_pl330_desc_get(pch);
+	if (desc == NULL)
+		return NULL;
+
+	desc->type = DMA_MEMCPY;
+	desc->dst = dest;
+	desc->src = src;
+	desc->len = len;
+	desc->xfer_unit = ((dest | src | len) & 7) ? 4 : 8;
+
+	desc->txd.flags = flags;
+	desc->txd.cookie = -EBUSY;
+
+	return &desc->txd;
+}
+
+static struct dma_async_tx_descriptor *
+s5p_pl330_prep_dma_memset(struct dma_chan *chan, dma_addr_t dest,
+			  int value, size_t len, unsigned long flags)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	struct s5p_pl330_desc *desc;
+
+	if (unlikely(!len || (len & 3) || pch->slave)) {
+		dev_dbg(chan2dev(chan), "prep_dma_memset: bad length %zu\n",
+			len);
+		return NULL;
+	}
+
+	desc = s5p_pl330_desc_get(pch);
+	if (desc == NULL)
+		return NULL;
+
+	desc->type = DMA_MEMSET;
+	desc->dst = dest;
+	desc->len = len;
+	desc->xfer_unit = 4;
+	*desc->pattern = (value & 0xff) * 0x01010101;
+
+	desc->txd.flags = flags;
+	desc->txd.cookie = -EBUSY;
+
+	return &desc->txd;
+}
+
+static struct dma_async_tx_descriptor *
+s5p_pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
+			unsigned int sg_len, enum dma_data_direction direction,
+			unsigned long flags)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	struct s5p_pl330_desc *desc;
+	struct scatterlist *sg, *s;
+	unsigned int i;
+
+	if (unlikely(!pch->slave || !sg_len))
+		return NULL;
+
+	if (direction != DMA_TO_DEVICE && direction != DMA_FROM_DEVICE)
+		return NULL;
+
+	desc = s5p_pl330_desc_get(pch);
+	if (desc == NULL)
+		return NULL;
+
+	/* the program is built at issue time; keep our own copy of the list */
+	desc->sg = kmalloc(sg_len * sizeof(*desc->sg), GFP_ATOMIC);
+	if (desc->sg == NULL) {
+		unsigned long lflags;
+
+		spin_lock_irqsave(&pch->lock, lflags);
+		list_add(&desc->node, &pch->free);
+		spin_unlock_irqrestore(&pch->lock, lflags);
+		return NULL;
+	}
+
+	sg_init_table(desc->sg, sg_len);
+	sg = desc->sg;
+	desc->len = 0;
+	for_each_sg(sgl, s, sg_len, i) {
+		sg_dma_address(sg) = sg_dma_address(s);
+		sg_dma_len(sg) = sg_dma_len(s);
+		desc->len += sg_dma_len(s);
+		sg = sg_next(sg);
+	}
+
+	desc->type = DMA_SLAVE;
+	desc->sg_len = sg_len;
+	desc->direction = direction;
+
+	desc->txd.flags = flags;
+	desc->txd.cookie = -EBUSY;
+
+	return &desc->txd;
+}
+
+static void s5p_pl330_terminate_all(struct dma_chan *chan)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	struct s5p_pl330_desc *desc, *_desc;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	/* the flush completes everything in flight with RES_ABORT, which
+	 * takes pch->lock, so it must run without it */
+	s3c2410_dma_ctrl(pch->vch, S3C2410_DMAOP_STOP);
+	s3c2410_dma_ctrl(pch->vch, S3C2410_DMAOP_FLUSH);
+
+	spin_lock_irqsave(&pch->lock, flags);
+	list_splice_init(&pch->queued, &list);
+	list_splice_init(&pch->active, &list);
+	list_splice_init(&pch->done, &list);
+	pch->completed = pch->chan.cookie;
+	spin_unlock_irqrestore(&pch->lock, flags);
+
+	list_for_each_entry_safe(desc, _desc, &list, node) {
+		s5p_pl330_unmap(pch, desc);
+		kfree(desc->sg);
+		desc->sg = NULL;
+	}
+
+	spin_lock_irqsave(&pch->lock, flags);
+	list_splice(&list, &pch->free);
+	spin_unlock_irqrestore(&pch->lock, flags);
+}
+
+static enum dma_status
+s5p_pl330_is_tx_complete(struct dma_chan *chan, dma_cookie_t cookie,
+			 dma_cookie_t *done, dma_cookie_t *used)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	dma_cookie_t last_used;
+	dma_cookie_t last_complete;
+
+	last_complete = pch->completed;
+	last_used = chan->cookie;
+
+	if (done)
+		*done = last_complete;
+	if (used)
+		*used = last_used;
+
+	return dma_async_is_complete(cookie, last_complete, last_used);
+}
+
+/*----------------------------------------------------------------------*/
+
+static int s5p_pl330_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	struct device *parent = chan2parent(chan);
+	struct s5p_pl330_desc *desc;
+	int i, ret;
+
+	pch->slave = chan->private;
+	pch->vch = pch->slave ? pch->slave->channel : pch->m2m;
+
+	ret = s3c2410_dma_request(pch->vch, &pch->client, NULL);
+	if (ret < 0) {
+		dev_dbg(chan2dev(chan), "no pl330 channel for %u\n", pch->vch);
+		return ret;
+	}
+
+	s3c2410_dma_set_buffdone_fn(pch->vch, s5p_pl330_buffdone);
+	s3c2410_dma_setflags(pch->vch, S3C2410_DMAF_AUTOSTART);
+
+	pch->descs = kcalloc(S5P_PL330_NR_DESCS, sizeof(*pch->descs),
+			     GFP_KERNEL);
+	if (pch->descs == NULL)
+		goto err_descs;
+
+	pch->patterns = dma_alloc_coherent(parent,
+					   S5P_PL330_NR_DESCS * sizeof(u32),
+					   &pch->patterns_phys, GFP_KERNEL);
+	if (pch->patterns == NULL)
+		goto err_patterns;
+
+	for (i = 0; i < S5P_PL330_NR_DESCS; i++) {
+		desc = &pch->descs[i];
+
+		dma_async_tx_descriptor_init(&desc->txd, chan);
+		desc->txd.tx_submit = s5p_pl330_tx_submit;
+		desc->txd.flags = DMA_CTRL_ACK;
+		desc->pattern = &pch->patterns[i];
+		desc->pattern_phys = pch->patterns_phys + i * sizeof(u32);
+
+		list_add_tail(&desc->node, &pch->free);
+	}
+
+	pch->completed = chan->cookie = 1;
+
+	dev_dbg(chan2dev(chan), "using pl330 channel %u\n", pch->vch);
+
+	return S5P_PL330_NR_DESCS;
+
+err_patterns:
+	kfree(pch->descs);
+	pch->descs = NULL;
+err_descs:
+	s3c2410_dma_free(pch->vch, &pch->client);
+	return -ENOMEM;
+}
+
+static void s5p_pl330_free_chan_resources(struct dma_chan *chan)
+{
+	struct s5p_pl330_chan *pch = to_s5p_chan(chan);
+	struct device *parent = chan2parent(chan);
+
+	s5p_pl330_terminate_all(chan);
+	tasklet_kill(&pch->tasklet);
+
+	s3c2410_dma_free(pch->vch, &pch->client);
+
+	INIT_LIST_HEAD(&pch->free);
+	dma_free_coherent(parent, S5P_PL330_NR_DESCS * sizeof(u32),
+			  pch->patterns, pch->patterns_phys);
+	kfree(pch->descs);
+	pch->descs = NULL;
+	pch->slave = NULL;
+}
+
+/*----------------------------------------------------------------------*/
+
+static int __init s5p_pl330_probe(struct platform_device *pdev)
+{
+	struct s5p_pl330_dev *pdd;
+	struct s5p_pl330_chan *pch;
+	int i, ret;
+
+	pdd = kzalloc(sizeof(*pdd), GFP_KERNEL);
+	if (pdd == NULL)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&pdd->dma.channels);
+
+	for (i = 0; i < S5P_PL330_NR_CHANS; i++) {
+		pch = &pdd->chan[i];
+
+		pch->chan.device = &pdd->dma;
+		pch->m2m = DMACH_3D_M2M0 + i;
+		snprintf(pch->name, sizeof(pch->name), "pl330-dmaengine%d", i);
+		pch->client.name = pch->name;
+
+		spin_lock_init(&pch->lock);
+		INIT_LIST_HEAD(&pch->free);
+		INIT_LIST_HEAD(&pch->queued);
+		INIT_LIST_HEAD(&pch->active);
+		INIT_LIST_HEAD(&pch->done);
+		tasklet_init(&pch->tasklet, s5p_pl330_tasklet,
+			     (unsigned long)pch);
+
+		list_add_tail(&pch->chan.device_node, &pdd->dma.channels);
+	}
+
+	dma_cap_set(DMA_MEMCPY, pdd->dma.cap_mask);
+	dma_cap_set(DMA_MEMSET, pdd->dma.cap_mask);
+	dma_cap_set(DMA_SLAVE, pdd->dma.cap_mask);
+
+	/* the program's remainder loop moves whole words */
+	pdd->dma.copy_align = 2;
+	pdd->dma.fill_align = 2;
+
+	pdd->dma.dev = &pdev->dev;
+	pdd->dma.device_alloc_chan_resources = s5p_pl330_alloc_chan_resources;
+	pdd->dma.device_free_chan_resources = s5p_pl330_free_chan_resources;
+	pdd->dma.device_prep_dma_memcpy = s5p_pl330_prep_dma_memcpy;
+	pdd->dma.device_prep_dma_memset = s5p_pl330_prep_dma_memset;
+	pdd->dma.device_prep_slave_sg = s5p_pl330_prep_slave_sg;
+	pdd->dma.device_terminate_all = s5p_pl330_terminate_all;
+	pdd->dma.device_is_tx_complete = s5p_pl330_is_tx_complete;
+	pdd->dma.device_issue_pending = s5p_pl330_issue_pending;
+
+	platform_set_drvdata(pdev, pdd);
+
+	ret = dma_async_device_register(&pdd->dma);
+	if (ret) {
+		kfree(pdd);
+		return ret;
+	}
+
+	dev_info(&pdev->dev, "PL330 dmaengine: %d channels (memcpy, memset, slave)\n",
+		 S5P_PL330_NR_CHANS);
+
+	return 0;
+}
+
+static int __exit s5p_pl330_remove(struct platform_device *pdev)
+{
+	struct s5p_pl330_dev *pdd = platform_get_drvdata(pdev);
+	int i;
+
+	dma_async_device_unregister(&pdd->dma);
+
+	for (i = 0; i < S5P_PL330_NR_CHANS; i++)
+		tasklet_kill(&pdd->chan[i].tasklet);
+
+	kfree(pdd);
+
+	return 0;
+}
+
+static struct platform_driver s5p_pl330_driver = {
+	.remove		= __exit_p(s5p_pl330_remove),
+	.driver = {
+		.name	= "s5p-pl330-dmaengine",
+	},
+};
+
+static struct platform_device *s5p_pl330_device;
+
+static int __init s5p_pl330_init(void)
+{
+	int ret;
+
+	/* the hardware is described to the s3c2410_dma layer by the
+	 * machine code; this device only anchors the dma_device */
+	s5p_pl330_device = platform_device_register_simple("s5p-pl330-dmaengine",
+							   -1, NULL, 0);
+	if (IS_ERR(s5p_pl330_device))
+		return PTR_ERR(s5p_pl330_device);
+
+	s5p_pl330_device->dev.coherent_dma_mask = DMA_BIT_MASK(32);
+
+	ret = platform_driver_probe(&s5p_pl330_driver, s5p_pl330_probe);
+	if (ret)
+		platform_device_unregister(s5p_pl330_device);
+
+	return ret;
+}
+subsys_initcall(s5p_pl330_init);
+
+static void __exit s5p_pl330_exit(void)
+{
+	platform_driver_unregister(&s5p_pl330_driver);
+	platform_device_unregister(s5p_pl330_device);
+}
+module_exit(s5p_pl330_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Samsung S5P PL330 dmaengine driver");
+MODULE_ALIAS("platform:s5p-pl330-dmaengine");
@@ -644,6 +644,8 @@ static struct i2c_driver cyttsp_i2c_driver = {
 	.driver = {
 		.name	= CYTTSP_DEVNAME,
 		.owner	= THIS_MODULE,
+		/* resetting and querying the controller takes over 100ms */
+		.async_probe = true,
 	},
 };
 
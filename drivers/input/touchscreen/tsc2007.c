@@ -671,6 +671,7 @@ static int __devinit tsc2007_probe(struct i2c_client *client,
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	ts->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN +
 					TSC2007_SUSPEND_LEVEL;
+	ts->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	ts->early_suspend.suspend = tsc2007_early_suspend;
 	ts->early_suspend.resume = tsc2007_late_resume;
 	register_early_suspend(&ts->early_suspend);
@@ -17,6 +17,8 @@
 #ifdef __KERNEL__
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
 #include <linux/i2c.h>
 #include <linux/fb.h>
 #include <linux/videodev2.h>
@@ -303,6 +305,27 @@ struct fimc_limit {
 	u32 real_h_rot;
 };
 
+/* capture to fimd window, bypassing userspace */
+struct fimc_pipeline {
+	spinlock_t		lock;
+	int			win;		/* fimd window or -1 */
+	int			active;
+	dma_addr_t		addr[FIMC_PHYBUFS];
+	ktime_t			done[FIMC_PHYBUFS];	/* end of capture */
+	ktime_t			last_done;
+	s64			period_ns;	/* capture frame period */
+
+	/* statistics, cleared by writing to debugfs */
+	unsigned long		frames;
+	unsigned long		shown;
+	unsigned long		dropped;
+	s64			lat_last_ns;
+	s64			lat_min_ns;
+	s64			lat_max_ns;
+	s64			lat_total_ns;
+	struct dentry		*debugfs;
+};
+
 /* fimc controller abstration */
 struct fimc_control {
 	int				id;		/* controller id */
@@ -330,6 +353,7 @@ struct fimc_control {
 	struct fimc_outinfo		*out;		/* output dev info */
 	struct fimc_fbinfo		fb;		/* fimd info */
 	struct fimc_scaler		sc;		/* scaler info */
+	struct fimc_pipeline		pipe;		/* capture to fimd */
 
 	enum fimc_status		status;
 	enum fimc_log			log;
@@ -407,6 +431,9 @@ extern struct fimc_limit fimc50_limits[FIMC_DEVICES];
 extern int s3cfb_direct_ioctl(int id, unsigned int cmd, unsigned long arg);
 extern int s3cfb_open_fifo(int id, int ch, int (*do_priv)(void *), void *param);
 extern int s3cfb_close_fifo(int id, int (*do_priv)(void *), void *param);
+extern int s3cfb_overlay_attach(int id, void (*latched)(void *priv, dma_addr_t addr, ktime_t vsync), void *priv);
+extern int s3cfb_overlay_queue(int id, dma_addr_t addr);
+extern void s3cfb_overlay_detach(int id);
 
 /* general */
 extern void s3c_csis_start(int lanes, int settle, int align, int width, int height, int pixel_format);
@@ -447,6 +474,13 @@ extern int fimc_s_parm(struct file *file, void *fh, struct v4l2_streamparm *a);
 
 void fimc_hwset_stop_processing(struct fimc_control *ctrl);
 
+/* capture to fimd pipeline */
+extern void fimc_pipeline_init(struct fimc_control *ctrl);
+extern void fimc_pipeline_exit(struct fimc_control *ctrl);
+extern int fimc_pipeline_start(struct fimc_control *ctrl);
+extern void fimc_pipeline_stop(struct fimc_control *ctrl);
+extern void fimc_pipeline_frame(struct fimc_control *ctrl, int idx);
+
 /* output device */
 extern void fimc_outdev_set_src_addr(struct fimc_control *ctrl, dma_addr_t *base);
 extern int fimc_outdev_set_ctx_param(struct fimc_control *ctrl, struct fimc_ctx *ctx);
@@ -932,6 +932,10 @@ int fimc_g_ctrl_capture(void *fh, struct v4l2_control *c)
 		ctrl->cap->flip = c->id;
 		break;
 
+	case V4L2_CID_CAPTURE_TO_FB:
+		c->value = ctrl->pipe.win;
+		break;
+
 	default:
 		/* get ctrl supported by subdev */
 		/* WriteBack doesn't have subdev_call */
@@ -991,6 +995,13 @@ int fimc_s_ctrl_capture(void *fh, struct v4l2_control *c)
 		fimc_hwset_stop_processing(ctrl);
 		break;
 
+	case V4L2_CID_CAPTURE_TO_FB:
+		if (ctrl->status == FIMC_STREAMON)
+			ret = -EBUSY;
+		else
+			ctrl->pipe.win = c->value < 0 ? -1 : c->value;
+		break;
+
 	default:
 		/* try on subdev */
 		/* WriteBack doesn't have subdev_call */
@@ -1099,10 +1110,15 @@ int fimc_streamon_capture(void *fh)
 {
 	struct fimc_control *ctrl = fh;
 	struct fimc_capinfo *cap = ctrl->cap;
-	int rot, i;
+	int rot, i, ret;
 
 	fimc_dbg("%s\n", __func__);
 
+	/* captured frames go straight to a fimd window */
+	ret = fimc_pipeline_start(ctrl);
+	if (ret)
+		return ret;
+
 	/* enable camera power if needed */
 	/*
 	if (ctrl->cam->cam_power)
@@ -1175,6 +1191,7 @@ int fimc_streamoff_capture(void *fh)
 
 	ctrl->status = FIMC_READY_OFF;
 	fimc_stop_capture(ctrl);
+	fimc_pipeline_stop(ctrl);
 
 #ifdef PINGPONG_2ADDR_MODE
 	for (i = 0; i < FIMC_PINGPONG; i++)
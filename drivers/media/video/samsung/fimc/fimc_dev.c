@@ -385,14 +385,17 @@ static inline void fimc_irq_cap(struct fimc_control *ctrl)
 	pp = ((fimc_hwget_frame_count(ctrl) + 2) % 4);
 	if (cap->fmt.field == V4L2_FIELD_INTERLACED_TB) {
 		/* odd value of pp means one frame is made with top/bottom */
-		if (pp & 0x1) {
-			cap->irq = 1;
-			wake_up(&ctrl->wq);
-		}
-	} else {
-		cap->irq = 1;
-		wake_up(&ctrl->wq);
+		if (!(pp & 0x1))
+			return;
+
+		pp &= ~0x1;
 	}
+
+	if (ctrl->pipe.active)
+		fimc_pipeline_frame(ctrl, pp);
+
+	cap->irq = 1;
+	wake_up(&ctrl->wq);
 }
 
 static irqreturn_t fimc_irq(int irq, void *dev_id)
@@ -452,6 +455,7 @@ struct fimc_control *fimc_register_controller(struct platform_device *pdev)
 	mutex_init(&ctrl->lock);
 	mutex_init(&ctrl->v4l2_lock);
 	init_waitqueue_head(&ctrl->wq);
+	fimc_pipeline_init(ctrl);
 
 	/* get resource for io memory */
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -495,6 +499,7 @@ static int fimc_unregister_controller(struct platform_device *pdev)
 	ctrl = get_fimc_ctrl(id);
 
 	free_irq(ctrl->irq, ctrl);
+	fimc_pipeline_exit(ctrl);
 	mutex_destroy(&ctrl->lock);
 	mutex_destroy(&ctrl->v4l2_lock);
 	kfree(&ctrl->wq);
@@ -957,6 +962,10 @@ static int fimc_release(struct file *filp)
 	}
 
 	if (ctrl->cap) {
+		/* the display must not scan out the freed buffers */
+		fimc_pipeline_stop(ctrl);
+		ctrl->pipe.win = -1;
+
 		ctrl->mem.curr = ctrl->mem.base;
 		kfree(filp->private_data);
 		filp->private_data = NULL;
@@ -0,0 +1,280 @@
+/* linux/drivers/media/video/samsung/fimc/fimc_pipeline.c
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * Capture to display pipeline for Samsung Camera Interface (FIMC) driver
+ *
+ * With V4L2_CID_CAPTURE_TO_FB set to a fimd window, every frame the capture
+ * device completes is handed to s3cfb from the capture interrupt and shown
+ * at the next frame interrupt of the display, without passing through
+ * userspace. Scaling and rotation are done by the fimc output stage as for
+ * any capture, so the capture format must match the window.
+ *
+ * The latency from sensor to glass is accounted in debugfs as
+ * fimc<id>-overlay; writing to the file clears the statistics.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/videodev2.h>
+
+#include "fimc.h"
+
+/*
+ * called by s3cfb from its frame interrupt once a buffer is latched. The
+ * sensor started sending the frame about one capture period before the
+ * capture completed, so that period is added to the time spent waiting
+ * for the display.
+*/
+static void fimc_pipeline_latched(void *priv, dma_addr_t addr, ktime_t vsync)
+{
+	struct fimc_control *ctrl = priv;
+	struct fimc_pipeline *pipe = &ctrl->pipe;
+	s64 lat;
+	int i;
+
+	spin_lock(&pipe->lock);
+
+	for (i = 0; i < FIMC_PHYBUFS; i++) {
+		if (pipe->addr[i] == addr)
+			break;
+	}
+
+	if (i < FIMC_PHYBUFS && pipe->done[i].tv64) {
+		lat = ktime_to_ns(ktime_sub(vsync, pipe->done[i])) +
+			pipe->period_ns;
+
+		pipe->shown++;
+		pipe->lat_last_ns = lat;
+		pipe->lat_total_ns += lat;
+		if (!pipe->lat_min_ns || lat < pipe->lat_min_ns)
+			pipe->lat_min_ns = lat;
+		if (lat > pipe->lat_max_ns)
+			pipe->lat_max_ns = lat;
+	}
+
+	spin_unlock(&pipe->lock);
+}
+
+/* hand a completed capture buffer to the display, from the fimc interrupt */
+void fimc_pipeline_frame(struct fimc_control *ctrl, int idx)
+{
+	struct fimc_pipeline *pipe = &ctrl->pipe;
+	ktime_t now = ktime_get();
+	dma_addr_t addr;
+	int win;
+
+	spin_lock(&pipe->lock);
+
+	if (!pipe->active) {
+		spin_unlock(&pipe->lock);
+		return;
+	}
+
+	if (pipe->last_done.tv64)
+		pipe->period_ns = ktime_to_ns(ktime_sub(now, pipe->last_done));
+
+	pipe->last_done = now;
+	pipe->done[idx] = now;
+	pipe->frames++;
+	addr = pipe->addr[idx];
+	win = pipe->win;
+
+	spin_unlock(&pipe->lock);
+
+	/* the display did not take the previous frame in time */
+	if (s3cfb_overlay_queue(win, addr) == 1) {
+		spin_lock(&pipe->lock);
+		pipe->dropped++;
+		spin_unlock(&pipe->lock);
+	}
+}
+
+/*
+ * attach the capture buffers to the fimd window at stream on. All four
+ * hardware buffers are needed, so that fimc never writes the buffer being
+ * scanned out as long as the display keeps up.
+*/
+int fimc_pipeline_start(struct fimc_control *ctrl)
+{
+	struct fimc_capinfo *cap = ctrl->cap;
+	struct fimc_pipeline *pipe = &ctrl->pipe;
+	struct fb_var_screeninfo var;
+	unsigned long flags;
+	int bpp, ret, i;
+
+	if (pipe->win < 0)
+		return 0;
+
+	switch (cap->fmt.pixelformat) {
+	case V4L2_PIX_FMT_RGB565:
+		bpp = 16;
+		break;
+
+	case V4L2_PIX_FMT_RGB32:
+		bpp = 32;
+		break;
+
+	default:
+		fimc_err("%s: fimd can't show the capture format\n", __func__);
+		return -EINVAL;
+	}
+
+	if (cap->nr_bufs != FIMC_PHYBUFS) {
+		fimc_err("%s: %d buffers are needed\n", __func__, FIMC_PHYBUFS);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&pipe->lock, flags);
+	for (i = 0; i < FIMC_PHYBUFS; i++) {
+		pipe->addr[i] = cap->bufs[i].base[FIMC_ADDR_Y];
+		pipe->done[i] = ktime_set(0, 0);
+	}
+	pipe->last_done = ktime_set(0, 0);
+	pipe->period_ns = 0;
+	spin_unlock_irqrestore(&pipe->lock, flags);
+
+	ret = s3cfb_overlay_attach(pipe->win, fimc_pipeline_latched, ctrl);
+	if (ret) {
+		fimc_err("%s: can't attach to fb%d\n", __func__, pipe->win);
+		return ret;
+	}
+
+	s3cfb_direct_ioctl(pipe->win, FBIOGET_VSCREENINFO,
+			   (unsigned long)&var);
+
+	if (var.xres != cap->fmt.width || var.yres != cap->fmt.height ||
+	    var.xres_virtual != var.xres || var.bits_per_pixel != bpp) {
+		fimc_err("%s: capture %dx%d doesn't match fb%d %dx%d-%d\n",
+			 __func__, cap->fmt.width, cap->fmt.height, pipe->win,
+			 var.xres, var.yres, var.bits_per_pixel);
+		s3cfb_overlay_detach(pipe->win);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&pipe->lock, flags);
+	pipe->active = 1;
+	spin_unlock_irqrestore(&pipe->lock, flags);
+
+	fimc_info1("%s: capture to fb%d\n", __func__, pipe->win);
+
+	return 0;
+}
+
+/* give the window back, the capture must be stopped */
+void fimc_pipeline_stop(struct fimc_control *ctrl)
+{
+	struct fimc_pipeline *pipe = &ctrl->pipe;
+	unsigned long flags;
+
+	if (!pipe->active)
+		return;
+
+	spin_lock_irqsave(&pipe->lock, flags);
+	pipe->active = 0;
+	spin_unlock_irqrestore(&pipe->lock, flags);
+
+	s3cfb_overlay_detach(pipe->win);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int fimc_pipeline_show(struct seq_file *s, void *unused)
+{
+	struct fimc_control *ctrl = s->private;
+	struct fimc_pipeline *pipe = &ctrl->pipe;
+	struct fimc_pipeline stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pipe->lock, flags);
+	stats = *pipe;
+	spin_unlock_irqrestore(&pipe->lock, flags);
+
+	seq_printf(s, "window:  %d%s\n", stats.win,
+		   stats.active ? " (streaming)" : "");
+	seq_printf(s, "frames:  %lu captured, %lu shown, %lu dropped\n",
+		   stats.frames, stats.shown, stats.dropped);
+	seq_printf(s, "period:  %lld us\n", div_s64(stats.period_ns, 1000));
+	seq_printf(s, "latency: last %lld us, min %lld us, avg %lld us, "
+		   "max %lld us\n",
+		   div_s64(stats.lat_last_ns, 1000),
+		   div_s64(stats.lat_min_ns, 1000),
+		   stats.shown ? (s64)div64_u64(stats.lat_total_ns,
+					(u64)stats.shown * 1000) : 0LL,
+		   div_s64(stats.lat_max_ns, 1000));
+
+	return 0;
+}
+
+static int fimc_pipeline_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fimc_pipeline_show, inode->i_private);
+}
+
+static ssize_t fimc_pipeline_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct fimc_control *ctrl = s->private;
+	struct fimc_pipeline *pipe = &ctrl->pipe;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pipe->lock, flags);
+	pipe->frames = 0;
+	pipe->shown = 0;
+	pipe->dropped = 0;
+	pipe->lat_last_ns = 0;
+	pipe->lat_min_ns = 0;
+	pipe->lat_max_ns = 0;
+	pipe->lat_total_ns = 0;
+	spin_unlock_irqrestore(&pipe->lock, flags);
+
+	return count;
+}
+
+static const struct file_operations fimc_pipeline_fops = {
+	.owner		= THIS_MODULE,
+	.open		= fimc_pipeline_open,
+	.read		= seq_read,
+	.write		= fimc_pipeline_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+void fimc_pipeline_init(struct fimc_control *ctrl)
+{
+	struct fimc_pipeline *pipe = &ctrl->pipe;
+#ifdef CONFIG_DEBUG_FS
+	char name[32];
+#endif
+
+	memset(pipe, 0, sizeof(*pipe));
+	spin_lock_init(&pipe->lock);
+	pipe->win = -1;
+
+#ifdef CONFIG_DEBUG_FS
+	snprintf(name, sizeof(name), "fimc%d-overlay", ctrl->id);
+	pipe->debugfs = debugfs_create_file(name, S_IRUGO | S_IWUSR, NULL,
+					    ctrl, &fimc_pipeline_fops);
+#endif
+}
+
+void fimc_pipeline_exit(struct fimc_control *ctrl)
+{
+	fimc_pipeline_stop(ctrl);
+
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove(ctrl->pipe.debugfs);
+#endif
+	ctrl->pipe.debugfs = NULL;
+}
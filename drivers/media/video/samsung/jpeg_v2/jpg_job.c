@@ -0,0 +1,642 @@
+/* linux/drivers/media/video/samsung/jpeg_v2/jpg_job.c
+ *
+ * Copyright (c) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * Job queue for the Jpeg decoder
+ *
+ * Every open file gets its own set of DMA buffers and may have up to
+ * JPG_MAX_JOBS decode jobs in flight. The jobs of all files run one at a
+ * time, in submission order, from a single worker, so a client can parse
+ * and fill the next stream while the hardware decodes the previous one.
+ * The bus address of each buffer is handed out so decoded images can be
+ * passed on to G2D or FIMC without a copy; a job can also decode straight
+ * into the memory of a registered framebuffer.
+ *
+ * The stream is copied out of the input buffer when the job is queued. The
+ * input buffer stays mapped in user space, and the decoder must not see a
+ * frame header other than the one checked against the output buffer.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/dma-mapping.h>
+#include <linux/fb.h>
+#include <linux/kernel.h>
+#include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#include "jpg_mem.h"
+#include "jpg_misc.h"
+#include "jpg_opr.h"
+#include "jpg_job.h"
+
+/* markers the header parser cares about */
+#define JPG_MARKER_SOI		0xD8
+#define JPG_MARKER_SOF0		0xC0	/* baseline */
+#define JPG_MARKER_SOF1		0xC1	/* extended sequential */
+#define JPG_MARKER_SOF2		0xC2	/* progressive, not supported */
+#define JPG_MARKER_SOS		0xDA
+
+struct jpg_job_buf {
+	struct jpg_job_queue	*q;
+	void			*virt;
+	dma_addr_t		phys;
+	UINT32			size;
+	int			users;	/* queued jobs */
+	int			maps;	/* user mappings */
+};
+
+struct jpg_job_queue {
+	struct kref		ref;	/* the file and every mapping */
+	struct mutex		lock;	/* buffers */
+	struct jpg_job_buf	bufs[JPG_MAX_JOB_BUFS];
+
+	/* under jpg_job_lock */
+	struct list_head	done;
+	int			jobs;	/* queued, running or done */
+	UINT32			next_id;
+
+	wait_queue_head_t	wait;
+};
+
+struct jpg_job_entry {
+	struct list_head	list;
+	struct jpg_job_queue	*q;
+	void			*stream;	/* copy only we can reach */
+	dma_addr_t		stream_phys;
+	UINT32			stream_size;
+	UINT32			out_phys;
+	UINT32			out_size;	/* room at out_phys */
+	jpg_job			job;
+};
+
+static struct device		*jpg_job_dev;
+static struct workqueue_struct	*jpg_job_wq;
+static LIST_HEAD(jpg_job_pending);
+static DEFINE_SPINLOCK(jpg_job_lock);
+static struct jpg_job_queue	*jpg_job_running;
+
+static void jpg_job_run_pending(struct work_struct *work);
+static DECLARE_WORK(jpg_job_work, jpg_job_run_pending);
+
+static void jpg_job_put_buf(struct jpg_job_queue *q, UINT32 index)
+{
+	if (index < JPG_MAX_JOB_BUFS)
+		q->bufs[index].users--;
+}
+
+static void jpg_job_free_entry(struct jpg_job_entry *e)
+{
+	if (e->stream)
+		dma_free_writecombine(jpg_job_dev, e->stream_size, e->stream,
+				      e->stream_phys);
+	kfree(e);
+}
+
+static int jpg_job_check_stream(const UINT8 *p, UINT32 size,
+				out_mode_t format, UINT32 room);
+
+static void jpg_job_run(struct jpg_job_entry *e)
+{
+	sspc100_jpg_ctx		ctx;
+	jpg_return_status	ret;
+	ktime_t			start;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.jpg_data_addr = e->stream_phys;
+	ctx.img_data_addr = e->out_phys;
+
+	/* the legacy ioctls program the hardware under the same mutex */
+	lock_jpg_mutex();
+
+	/* the last look at the header before the decoder writes what it
+	   says, see jpg_job_queue_job() */
+	if (jpg_job_check_stream(e->stream, e->job.in_size,
+				 e->job.dec.out_format, e->out_size)) {
+		unlock_jpg_mutex();
+		e->job.status = -EINVAL;
+		return;
+	}
+
+	start = ktime_get();
+	ret = decode_jpg(&ctx, &e->job.dec);
+	e->job.time_us = ktime_to_us(ktime_sub(ktime_get(), start));
+	unlock_jpg_mutex();
+
+	e->job.status = (ret == JPG_SUCCESS) ? 0 : -EIO;
+}
+
+static void jpg_job_run_pending(struct work_struct *work)
+{
+	struct jpg_job_entry	*e;
+	struct jpg_job_queue	*q;
+
+	for (;;) {
+		spin_lock_irq(&jpg_job_lock);
+		if (list_empty(&jpg_job_pending)) {
+			spin_unlock_irq(&jpg_job_lock);
+			break;
+		}
+		e = list_first_entry(&jpg_job_pending, struct jpg_job_entry,
+				     list);
+		list_del(&e->list);
+		q = e->q;
+		jpg_job_running = q;
+		spin_unlock_irq(&jpg_job_lock);
+
+		jpg_job_run(e);
+
+		dma_free_writecombine(jpg_job_dev, e->stream_size, e->stream,
+				      e->stream_phys);
+		e->stream = NULL;
+
+		mutex_lock(&q->lock);
+		jpg_job_put_buf(q, e->job.out_buf);
+		mutex_unlock(&q->lock);
+
+		/* wake up under the lock: once jpg_job_queue_destroy() sees
+		   the queue idle, we do not touch it any more */
+		spin_lock_irq(&jpg_job_lock);
+		list_add_tail(&e->list, &q->done);
+		jpg_job_running = NULL;
+		wake_up(&q->wait);
+		spin_unlock_irq(&jpg_job_lock);
+	}
+}
+
+/* width and height from the frame header, which must precede the scan */
+static int jpg_job_parse_header(const UINT8 *p, UINT32 size,
+				UINT32 *width, UINT32 *height)
+{
+	UINT32	i = 2, len;
+	UINT8	marker;
+
+	if (size < 4 || p[0] != 0xFF || p[1] != JPG_MARKER_SOI)
+		return -EINVAL;
+
+	while (i + 4 <= size) {
+		if (p[i] != 0xFF)
+			return -EINVAL;
+
+		marker = p[i + 1];
+		if (marker == 0xFF) {	/* fill byte */
+			i++;
+			continue;
+		}
+
+		len = (p[i + 2] << 8) | p[i + 3];
+		if (len < 2 || i + 2 + len > size)
+			return -EINVAL;
+
+		switch (marker) {
+		case JPG_MARKER_SOF0:
+		case JPG_MARKER_SOF1:
+			if (len < 7)
+				return -EINVAL;
+			*height = (p[i + 5] << 8) | p[i + 6];
+			*width = (p[i + 7] << 8) | p[i + 8];
+			return 0;
+
+		case JPG_MARKER_SOF2:
+		case JPG_MARKER_SOS:
+			return -EINVAL;
+		}
+
+		i += 2 + len;
+	}
+
+	return -EINVAL;
+}
+
+/* does the image the stream describes fit in room bytes? */
+static int jpg_job_check_stream(const UINT8 *p, UINT32 size,
+				out_mode_t format, UINT32 room)
+{
+	UINT32	width, height;
+	int	ret;
+
+	ret = jpg_job_parse_header(p, size, &width, &height);
+	if (ret)
+		return ret;
+
+	if (width == 0 || width > MAX_JPG_WIDTH ||
+	    height == 0 || height > MAX_JPG_HEIGHT)
+		return -EINVAL;
+
+	if (get_yuv_size(format, width, height) > room)
+		return -ENOSPC;
+
+	return 0;
+}
+
+/* is [phys, phys + size) inside the memory of a registered framebuffer? */
+static int jpg_job_check_fb(UINT32 phys, UINT32 size)
+{
+#ifdef CONFIG_FB
+	struct fb_info	*info;
+	int		i;
+
+	for (i = 0; i < FB_MAX; i++) {
+		info = registered_fb[i];
+		if (info == NULL || info->fix.smem_len < size)
+			continue;
+
+		if (phys >= info->fix.smem_start &&
+		    phys - info->fix.smem_start <= info->fix.smem_len - size)
+			return 0;
+	}
+#endif
+	return -EINVAL;
+}
+
+int jpg_job_alloc_buf(struct jpg_job_queue *q, jpg_buf_req *req)
+{
+	struct jpg_job_buf	*buf;
+	UINT32			size = PAGE_ALIGN(req->size);
+	int			i;
+
+	if (size == 0 || size > JPG_JOB_BUF_MAX_SIZE)
+		return -EINVAL;
+
+	mutex_lock(&q->lock);
+
+	for (i = 0; i < JPG_MAX_JOB_BUFS; i++)
+		if (q->bufs[i].virt == NULL)
+			break;
+
+	if (i == JPG_MAX_JOB_BUFS) {
+		mutex_unlock(&q->lock);
+		return -ENOSPC;
+	}
+
+	buf = &q->bufs[i];
+	buf->virt = dma_alloc_writecombine(jpg_job_dev, size, &buf->phys,
+					   GFP_KERNEL);
+	if (buf->virt == NULL) {
+		mutex_unlock(&q->lock);
+		jpg_err("no memory for a %u byte job buffer\n", size);
+		return -ENOMEM;
+	}
+	buf->size = size;
+
+	req->size = size;
+	req->index = i;
+	req->offset = JPG_JOB_BUF_OFFSET(i);
+	req->phys = buf->phys;
+
+	mutex_unlock(&q->lock);
+
+	return 0;
+}
+
+int jpg_job_free_buf(struct jpg_job_queue *q, UINT32 index)
+{
+	struct jpg_job_buf	*buf;
+	int			ret = 0;
+
+	if (index >= JPG_MAX_JOB_BUFS)
+		return -EINVAL;
+
+	mutex_lock(&q->lock);
+
+	buf = &q->bufs[index];
+	if (buf->virt == NULL) {
+		ret = -EINVAL;
+	} else if (buf->users || buf->maps) {
+		ret = -EBUSY;
+	} else {
+		dma_free_writecombine(jpg_job_dev, buf->size, buf->virt,
+				      buf->phys);
+		buf->virt = NULL;
+	}
+
+	mutex_unlock(&q->lock);
+
+	return ret;
+}
+
+int jpg_job_queue_job(struct jpg_job_queue *q, jpg_job *job)
+{
+	struct jpg_job_entry	*e;
+	struct jpg_job_buf	*in, *out = NULL;
+	UINT32			out_phys, out_size;
+	int			ret;
+
+	if (job->in_buf >= JPG_MAX_JOB_BUFS || job->in_buf == job->out_buf)
+		return -EINVAL;
+
+	if (job->dec.out_format != YCBCR_422 &&
+	    job->dec.out_format != YCBCR_420)
+		return -EINVAL;
+
+	e = kzalloc(sizeof(*e), GFP_KERNEL);
+	if (e == NULL)
+		return -ENOMEM;
+
+	mutex_lock(&q->lock);
+
+	in = &q->bufs[job->in_buf];
+	if (in->virt == NULL || job->in_size == 0 ||
+	    job->in_size > in->size) {
+		ret = -EINVAL;
+		goto err;
+	}
+
+	if (job->out_buf == JPG_JOB_BUF_PHYS) {
+		ret = jpg_job_check_fb(job->out_phys, job->out_size);
+		if (ret)
+			goto err;
+		out_phys = job->out_phys;
+		out_size = job->out_size;
+	} else {
+		if (job->out_buf >= JPG_MAX_JOB_BUFS ||
+		    q->bufs[job->out_buf].virt == NULL) {
+			ret = -EINVAL;
+			goto err;
+		}
+		out = &q->bufs[job->out_buf];
+		out_phys = out->phys;
+		out_size = out->size;
+	}
+
+	/* user space can still write the input buffer, so the decoder gets
+	   a copy and the header is checked in that */
+	e->stream_size = PAGE_ALIGN(job->in_size);
+	e->stream = dma_alloc_writecombine(jpg_job_dev, e->stream_size,
+					   &e->stream_phys, GFP_KERNEL);
+	if (e->stream == NULL) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	memcpy(e->stream, in->virt, job->in_size);
+
+	/* the decoder writes as much as the stream says, check that it fits
+	   before letting it loose on the memory */
+	ret = jpg_job_check_stream(e->stream, job->in_size,
+				   job->dec.out_format, out_size);
+	if (ret)
+		goto err;
+
+	spin_lock_irq(&jpg_job_lock);
+	if (q->jobs >= JPG_MAX_JOBS) {
+		spin_unlock_irq(&jpg_job_lock);
+		ret = -EAGAIN;
+		goto err;
+	}
+
+	job->id = q->next_id++;
+	job->status = 0;
+	job->time_us = 0;
+
+	e->q = q;
+	e->out_phys = out_phys;
+	e->out_size = out_size;
+	e->job = *job;
+
+	if (out)
+		out->users++;
+
+	list_add_tail(&e->list, &jpg_job_pending);
+	q->jobs++;
+	spin_unlock_irq(&jpg_job_lock);
+
+	mutex_unlock(&q->lock);
+
+	queue_work(jpg_job_wq, &jpg_job_work);
+
+	return 0;
+
+err:
+	mutex_unlock(&q->lock);
+	jpg_job_free_entry(e);
+	return ret;
+}
+
+static int jpg_job_done(struct jpg_job_queue *q)
+{
+	int done;
+
+	spin_lock_irq(&jpg_job_lock);
+	done = !list_empty(&q->done);
+	spin_unlock_irq(&jpg_job_lock);
+
+	return done;
+}
+
+int jpg_job_dequeue_job(struct jpg_job_queue *q, jpg_job *job, int nonblock)
+{
+	struct jpg_job_entry	*e;
+	int			ret;
+
+	for (;;) {
+		spin_lock_irq(&jpg_job_lock);
+		if (!list_empty(&q->done))
+			break;
+		spin_unlock_irq(&jpg_job_lock);
+
+		if (nonblock)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(q->wait, jpg_job_done(q));
+		if (ret)
+			return ret;
+	}
+
+	e = list_first_entry(&q->done, struct jpg_job_entry, list);
+	list_del(&e->list);
+	q->jobs--;
+	spin_unlock_irq(&jpg_job_lock);
+
+	*job = e->job;
+	kfree(e);
+
+	return 0;
+}
+
+unsigned int jpg_job_poll(struct jpg_job_queue *q, struct file *file,
+			  poll_table *wait)
+{
+	unsigned int mask = 0;
+
+	poll_wait(file, &q->wait, wait);
+
+	spin_lock_irq(&jpg_job_lock);
+	if (!list_empty(&q->done))
+		mask |= POLLIN | POLLRDNORM;
+	if (q->jobs < JPG_MAX_JOBS)
+		mask |= POLLOUT | POLLWRNORM;
+	spin_unlock_irq(&jpg_job_lock);
+
+	return mask;
+}
+
+static void jpg_job_queue_release(struct kref *ref)
+{
+	struct jpg_job_queue	*q = container_of(ref, struct jpg_job_queue,
+						  ref);
+	struct jpg_job_buf	*buf;
+	int			i;
+
+	for (i = 0; i < JPG_MAX_JOB_BUFS; i++) {
+		buf = &q->bufs[i];
+		if (buf->virt)
+			dma_free_writecombine(jpg_job_dev, buf->size,
+					      buf->virt, buf->phys);
+	}
+
+	kfree(q);
+}
+
+static void jpg_job_vm_open(struct vm_area_struct *vma)
+{
+	struct jpg_job_buf	*buf = vma->vm_private_data;
+	struct jpg_job_queue	*q = buf->q;
+
+	mutex_lock(&q->lock);
+	buf->maps++;
+	mutex_unlock(&q->lock);
+
+	kref_get(&q->ref);
+}
+
+static void jpg_job_vm_close(struct vm_area_struct *vma)
+{
+	struct jpg_job_buf	*buf = vma->vm_private_data;
+	struct jpg_job_queue	*q = buf->q;
+
+	mutex_lock(&q->lock);
+	buf->maps--;
+	mutex_unlock(&q->lock);
+
+	kref_put(&q->ref, jpg_job_queue_release);
+}
+
+static struct vm_operations_struct jpg_job_vm_ops = {
+	.open	= jpg_job_vm_open,
+	.close	= jpg_job_vm_close,
+};
+
+int jpg_job_mmap(struct jpg_job_queue *q, struct vm_area_struct *vma)
+{
+	unsigned long		offset = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long		size = vma->vm_end - vma->vm_start;
+	struct jpg_job_buf	*buf;
+	UINT32			index;
+	int			ret;
+
+	index = (offset - JPG_JOB_BUF_OFFSET(0)) / JPG_JOB_BUF_MAX_SIZE;
+	if (index >= JPG_MAX_JOB_BUFS || offset != JPG_JOB_BUF_OFFSET(index))
+		return -EINVAL;
+
+	mutex_lock(&q->lock);
+
+	buf = &q->bufs[index];
+	if (buf->virt == NULL || size > buf->size) {
+		mutex_unlock(&q->lock);
+		return -EINVAL;
+	}
+
+	vma->vm_pgoff = 0;
+	ret = dma_mmap_writecombine(jpg_job_dev, vma, buf->virt, buf->phys,
+				    size);
+	if (ret) {
+		mutex_unlock(&q->lock);
+		return ret;
+	}
+
+	vma->vm_private_data = buf;
+	vma->vm_ops = &jpg_job_vm_ops;
+	buf->maps++;
+
+	mutex_unlock(&q->lock);
+
+	kref_get(&q->ref);
+
+	return 0;
+}
+
+struct jpg_job_queue *jpg_job_queue_create(void)
+{
+	struct jpg_job_queue	*q;
+	int			i;
+
+	q = kzalloc(sizeof(*q), GFP_KERNEL);
+	if (q == NULL)
+		return NULL;
+
+	for (i = 0; i < JPG_MAX_JOB_BUFS; i++)
+		q->bufs[i].q = q;
+
+	kref_init(&q->ref);
+	mutex_init(&q->lock);
+	INIT_LIST_HEAD(&q->done);
+	init_waitqueue_head(&q->wait);
+
+	return q;
+}
+
+static int jpg_job_idle(struct jpg_job_queue *q)
+{
+	int idle;
+
+	spin_lock_irq(&jpg_job_lock);
+	idle = (jpg_job_running != q);
+	spin_unlock_irq(&jpg_job_lock);
+
+	return idle;
+}
+
+void jpg_job_queue_destroy(struct jpg_job_queue *q)
+{
+	struct jpg_job_entry	*e, *tmp;
+	LIST_HEAD(dropped);
+
+	/* jobs that did not start yet are dropped, a running one is
+	   waited for */
+	spin_lock_irq(&jpg_job_lock);
+	list_for_each_entry_safe(e, tmp, &jpg_job_pending, list)
+		if (e->q == q)
+			list_move_tail(&e->list, &dropped);
+	list_splice_init(&q->done, &dropped);
+	spin_unlock_irq(&jpg_job_lock);
+
+	wait_event(q->wait, jpg_job_idle(q));
+
+	/* the running job may have completed onto the done list meanwhile */
+	list_splice_init(&q->done, &dropped);
+
+	list_for_each_entry_safe(e, tmp, &dropped, list) {
+		list_del(&e->list);
+		jpg_job_free_entry(e);
+	}
+
+	kref_put(&q->ref, jpg_job_queue_release);
+}
+
+int jpg_job_init(struct device *dev)
+{
+	jpg_job_dev = dev;
+
+	jpg_job_wq = create_singlethread_workqueue("jpeg");
+	if (jpg_job_wq == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void jpg_job_exit(void)
+{
+	if (jpg_job_wq)
+		destroy_workqueue(jpg_job_wq);
+	jpg_job_wq = NULL;
+}
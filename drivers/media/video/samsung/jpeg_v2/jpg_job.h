@@ -0,0 +1,38 @@
+/* linux/drivers/media/video/samsung/jpeg_v2/jpg_job.h
+ *
+ * Copyright (c) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * Definition for the Jpeg decoder job queue
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __JPG_JOB_H__
+#define __JPG_JOB_H__
+
+#include <linux/fs.h>
+#include <linux/poll.h>
+
+#include "jpg_misc.h"
+#include "jpg_opr.h"
+
+struct device;
+struct jpg_job_queue;
+
+int jpg_job_init(struct device *dev);
+void jpg_job_exit(void);
+
+struct jpg_job_queue *jpg_job_queue_create(void);
+void jpg_job_queue_destroy(struct jpg_job_queue *q);
+
+int jpg_job_alloc_buf(struct jpg_job_queue *q, jpg_buf_req *req);
+int jpg_job_free_buf(struct jpg_job_queue *q, UINT32 index);
+int jpg_job_queue_job(struct jpg_job_queue *q, jpg_job *job);
+int jpg_job_dequeue_job(struct jpg_job_queue *q, jpg_job *job, int nonblock);
+unsigned int jpg_job_poll(struct jpg_job_queue *q, struct file *file,
+			  poll_table *wait);
+int jpg_job_mmap(struct jpg_job_queue *q, struct vm_area_struct *vma);
+
+#endif
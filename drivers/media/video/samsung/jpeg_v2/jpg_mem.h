@@ -109,12 +109,15 @@
 
 #define	ENABLE_IRQ				(0xf<<3)
 
+struct jpg_job_queue;
+
 typedef struct __s5pc100_jpg_ctx {
 	volatile UINT32                  jpg_data_addr;
 	volatile UINT32                  img_data_addr;
 	volatile UINT32                  jpg_thumb_data_addr;
 	volatile UINT32                  img_thumb_data_addr;
 	int                          caller_process;
+	struct jpg_job_queue		*queue;
 } sspc100_jpg_ctx;
 
 void *phy_to_vir_addr(UINT32 phy_addr, int mem_size);
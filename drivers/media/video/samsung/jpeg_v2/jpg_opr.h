@@ -144,6 +144,35 @@ typedef struct {
 	jpg_enc_proc_param	*thumb_enc_param;
 } jpg_args;
 
+/* job queue interface, see jpg_job.c */
+#define JPG_MAX_JOB_BUFS	16	/* buffers per open file */
+#define JPG_MAX_JOBS		16	/* jobs per open file, queued or done */
+#define JPG_JOB_BUF_PHYS	0xFFFFFFFF	/* out_buf: decode to out_phys */
+
+/* mmap offset of job buffer n, beyond the reserved region */
+#define JPG_JOB_BUF_OFFSET(n)	(0x80000000 + ((n) << 24))
+#define JPG_JOB_BUF_MAX_SIZE	(1 << 24)
+
+typedef struct {
+	UINT32			size;	/* in: bytes */
+	UINT32			index;	/* out */
+	UINT32			offset;	/* out: for mmap */
+	UINT32			phys;	/* out: bus address for G2D, FIMC, ... */
+} jpg_buf_req;
+
+typedef struct {
+	UINT32			id;		/* out: assigned by the queue */
+	UINT32			user;		/* returned as passed in */
+	UINT32			in_buf;		/* buffer holding the stream */
+	UINT32			in_size;	/* bytes of stream in it */
+	UINT32			out_buf;	/* buffer or JPG_JOB_BUF_PHYS */
+	UINT32			out_phys;	/* framebuffer memory to decode to */
+	UINT32			out_size;	/* bytes available at out_phys */
+	jpg_dec_proc_param	dec;		/* in: out_format, out: the rest */
+	int			status;		/* out: 0 or -errno */
+	UINT32			time_us;	/* out: time the decoder took */
+} jpg_job;
+
 void reset_jpg(sspc100_jpg_ctx *jpg_ctx);
 jpg_return_status decode_jpg(sspc100_jpg_ctx *jpg_ctx, jpg_dec_proc_param *dec_param);
 jpg_return_status encode_jpg(sspc100_jpg_ctx *jpg_ctx, jpg_enc_proc_param *enc_param);
@@ -29,6 +29,7 @@
 #include <linux/init.h>
 #include <asm/io.h>
 #include <asm/page.h>
+#include <asm/uaccess.h>
 #include <mach/irqs.h>
 #include <linux/semaphore.h>
 #include <mach/map.h>
@@ -49,6 +50,7 @@
 #include "jpg_mem.h"
 #include "jpg_misc.h"
 #include "jpg_opr.h"
+#include "jpg_job.h"
 #include "regs-jpeg.h"
 
 static struct clk		*s3c_jpeg_clk;
@@ -122,11 +124,18 @@ static int s3c_jpeg_open(struct inode *inode, struct file *file)
 	jpg_reg_ctx = (sspc100_jpg_ctx *)mem_alloc(sizeof(sspc100_jpg_ctx));
 	memset(jpg_reg_ctx, 0x00, sizeof(sspc100_jpg_ctx));
 
+	jpg_reg_ctx->queue = jpg_job_queue_create();
+	if (jpg_reg_ctx->queue == NULL) {
+		kfree(jpg_reg_ctx);
+		return -ENOMEM;
+	}
+
 	ret = lock_jpg_mutex();
 
 	if (!ret) {
 		jpg_err("JPG Mutex Lock Fail\r\n");
 		unlock_jpg_mutex();
+		jpg_job_queue_destroy(jpg_reg_ctx->queue);
 		kfree(jpg_reg_ctx);
 		return FALSE;
 	}
@@ -135,6 +144,7 @@ static int s3c_jpeg_open(struct inode *inode, struct file *file)
 		jpg_err("Instance Number error-JPEG is running, \
 				instance number is %d\n", instanceNo);
 		unlock_jpg_mutex();
+		jpg_job_queue_destroy(jpg_reg_ctx->queue);
 		kfree(jpg_reg_ctx);
 		return FALSE;
 	}
@@ -163,6 +173,9 @@ static int s3c_jpeg_release(struct inode *inode, struct file *file)
 		return FALSE;
 	}
 
+	/* drops queued jobs and waits for a running one */
+	jpg_job_queue_destroy(jpg_reg_ctx->queue);
+
 	ret = lock_jpg_mutex();
 
 	if (!ret) {
@@ -198,6 +211,55 @@ static ssize_t s3c_jpeg_read(struct file *file, char *buf, size_t count, loff_t
 	return 0;
 }
 
+static int s3c_jpeg_job_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	sspc100_jpg_ctx		*jpg_reg_ctx = file->private_data;
+	struct jpg_job_queue	*q = jpg_reg_ctx->queue;
+	jpg_buf_req		req;
+	jpg_job			job;
+	UINT32			index;
+	int			ret;
+
+	switch (cmd) {
+	case IOCTL_JPG_ALLOC_BUF:
+		if (copy_from_user(&req, (void __user *)arg, sizeof(req)))
+			return -EFAULT;
+		ret = jpg_job_alloc_buf(q, &req);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user *)arg, &req, sizeof(req))) {
+			jpg_job_free_buf(q, req.index);
+			return -EFAULT;
+		}
+		return 0;
+
+	case IOCTL_JPG_FREE_BUF:
+		if (get_user(index, (UINT32 __user *)arg))
+			return -EFAULT;
+		return jpg_job_free_buf(q, index);
+
+	case IOCTL_JPG_QUEUE_JOB:
+		if (copy_from_user(&job, (void __user *)arg, sizeof(job)))
+			return -EFAULT;
+		ret = jpg_job_queue_job(q, &job);
+		if (ret)
+			return ret;
+		/* the job is queued anyway, its id is also in the result */
+		return put_user(job.id, &((jpg_job __user *)arg)->id);
+
+	case IOCTL_JPG_DEQUEUE_JOB:
+		ret = jpg_job_dequeue_job(q, &job,
+					  file->f_flags & O_NONBLOCK);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user *)arg, &job, sizeof(job)))
+			return -EFAULT;
+		return 0;
+	}
+
+	return -ENOTTY;
+}
+
 static int s3c_jpeg_ioctl(struct inode *inode, struct file *file, unsigned int cmd, unsigned long arg)
 {
 	static sspc100_jpg_ctx		*jpg_reg_ctx;
@@ -214,6 +276,10 @@ static int s3c_jpeg_ioctl(struct inode *inode, struct file *file, unsigned int c
 		return FALSE;
 	}
 
+	/* the job queue takes the mutex only while the hardware runs */
+	if (_IOC_TYPE(cmd) == JPEG_JOB_IOCTL_MAGIC)
+		return s3c_jpeg_job_ioctl(file, cmd, arg);
+
 	ret = lock_jpg_mutex();
 
 	if (!ret) {
@@ -320,18 +386,23 @@ static int s3c_jpeg_ioctl(struct inode *inode, struct file *file, unsigned int c
 
 static unsigned int s3c_jpeg_poll(struct file *file, poll_table *wait)
 {
-	unsigned int mask = 0;
+	sspc100_jpg_ctx	*jpg_reg_ctx = file->private_data;
 
 	jpg_dbg("enter poll \n");
-	poll_wait(file, &wait_queue_jpeg, wait);
-	mask = POLLOUT | POLLWRNORM;
-	return mask;
+
+	/* without jobs in flight this is POLLOUT, as it always was */
+	return jpg_job_poll(jpg_reg_ctx->queue, file, wait);
 }
 int s3c_jpeg_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	unsigned long size	= vma->vm_end - vma->vm_start;
 	unsigned long max_size;
 	unsigned long page_frame_no;
+	sspc100_jpg_ctx	*jpg_reg_ctx = filp->private_data;
+
+	/* job buffers live above the reserved region's offsets */
+	if ((vma->vm_pgoff << PAGE_SHIFT) >= JPG_JOB_BUF_OFFSET(0))
+		return jpg_job_mmap(jpg_reg_ctx->queue, vma);
 
 	page_frame_no = __phys_to_pfn(jpg_data_base_addr);
 
@@ -428,6 +499,12 @@ static int s3c_jpeg_probe(struct platform_device *pdev)
 
 	init_waitqueue_head(&wait_queue_jpeg);
 
+	ret = jpg_job_init(&pdev->dev);
+	if (ret) {
+		jpg_err("failed to create the job queue\n");
+		return ret;
+	}
+
 	jpg_dbg("JPG_Init\n");
 
 	// Mutex initialization
@@ -467,6 +544,7 @@ static int s3c_jpeg_remove(struct platform_device *dev)
 
 	free_irq(irq_no, dev);
 	misc_deregister(&s3c_jpeg_miscdev);
+	jpg_job_exit();
 	return 0;
 }
 
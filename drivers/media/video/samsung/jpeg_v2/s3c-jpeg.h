@@ -44,4 +44,18 @@
 #define IOCTL_SET_JPGMODE			0x00000006
 
 #endif
+
+/*
+ * Job queue: decode jobs queued on an open file run in order on the
+ * hardware while the caller prepares the next ones. Completed jobs are
+ * picked up with IOCTL_JPG_DEQUEUE_JOB, poll() reports POLLIN while there
+ * are any and POLLOUT while another job can be queued.
+ */
+#define JPEG_JOB_IOCTL_MAGIC			'J'
+
+#define IOCTL_JPG_ALLOC_BUF		_IOWR(JPEG_JOB_IOCTL_MAGIC, 0x20, jpg_buf_req)
+#define IOCTL_JPG_FREE_BUF		_IOW(JPEG_JOB_IOCTL_MAGIC, 0x21, UINT32)
+#define IOCTL_JPG_QUEUE_JOB		_IOWR(JPEG_JOB_IOCTL_MAGIC, 0x22, jpg_job)
+#define IOCTL_JPG_DEQUEUE_JOB		_IOR(JPEG_JOB_IOCTL_MAGIC, 0x23, jpg_job)
+
 #endif /*__JPEG_DRIVER_H__*/
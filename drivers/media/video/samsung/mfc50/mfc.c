@@ -62,6 +62,7 @@
 #include "mfc_memory.h"
 #include "mfc_buffer_manager.h"
 #include "mfc_intr.h"
+#include "mfc_sched.h"
 
 #define	Frame_Base_Power_CTR_ON			1			// 0 : Disable,		1: Enable
 #define	ENABLE_MONITORING_MFC_DD		0			// 0 : Disable,		1: Enable
@@ -147,6 +148,8 @@ static int mfc_open(struct inode *inode, struct file *file)
 		goto out_open;
 	}
 
+	mfc_sched_open(mfc_ctx);
+
 	/* Decoder only */
 	mfc_ctx->extraDPB = MFC_MAX_EXTRA_DPB;
 	mfc_ctx->FrameType = MFC_RET_FRAME_NOT_SET;
@@ -201,6 +204,9 @@ static int mfc_release(struct inode *inode, struct file *file)
 		goto out_release;
 	}
 
+	mfc_sched_release(mfc_ctx);
+
+	/* the buffers go to the pool, for the next instance to pick up */
 	mfc_release_all_buffer(mfc_ctx->mem_inst_no);
 	mfc_merge_fragment(mfc_ctx->mem_inst_no);
 
@@ -291,6 +297,14 @@ static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 			break;
 
 		case IOCTL_MFC_ENC_EXE:
+			/* wait for our turn on the codec, at most a frame per other instance */
+			ret = mfc_sched_get(mfc_ctx);
+			if (ret < 0)
+			{
+				in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+				break;
+			}
+
 			mutex_lock(&mfc_mutex);
 #if	ENABLE_MONITORING_MFC_DD
 			mfc_info("IOCTL_MFC_ENC_EXE\n");
@@ -302,6 +316,7 @@ static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 				in_param.ret_code = MFCINST_ERR_STATE_INVALID;
 				ret = -EINVAL;
 				mutex_unlock(&mfc_mutex);
+				mfc_sched_put(mfc_ctx, FALSE);
 				break;
 			}
 
@@ -311,12 +326,14 @@ static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 				in_param.ret_code = MFCINST_ERR_STATE_INVALID;
 				ret = -EINVAL;
 				mutex_unlock(&mfc_mutex);
+				mfc_sched_put(mfc_ctx, FALSE);
 				break;
 			}
 
 			in_param.ret_code = mfc_exe_encode(mfc_ctx, &(in_param.args));
 			ret = in_param.ret_code;
 			mutex_unlock(&mfc_mutex);
+			mfc_sched_put(mfc_ctx, (ret == MFCINST_RET_OK) ? TRUE : FALSE);
 			break;
 
 		case IOCTL_MFC_DEC_INIT:
@@ -354,6 +371,14 @@ static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 			break;
 
 		case IOCTL_MFC_DEC_EXE:
+			/* wait for our turn on the codec, at most a frame per other instance */
+			ret = mfc_sched_get(mfc_ctx);
+			if (ret < 0)
+			{
+				in_param.ret_code = MFCINST_ERR_STATE_INVALID;
+				break;
+			}
+
 			mutex_lock(&mfc_mutex);
 #if	ENABLE_MONITORING_MFC_DD
 			mfc_debug_L0("IOCTL_MFC_DEC_EXE\n");
@@ -364,6 +389,7 @@ static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 				in_param.ret_code = MFCINST_ERR_STATE_INVALID;
 				ret = -EINVAL;
 				mutex_unlock(&mfc_mutex);
+				mfc_sched_put(mfc_ctx, FALSE);
 				break;
 			}
 
@@ -373,12 +399,14 @@ static int mfc_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 				in_param.ret_code = MFCINST_ERR_STATE_INVALID;
 				ret = -EINVAL;
 				mutex_unlock(&mfc_mutex);
+				mfc_sched_put(mfc_ctx, FALSE);
 				break;
 			}
 
 			in_param.ret_code = mfc_exe_decode(mfc_ctx, &(in_param.args));
 			ret = in_param.ret_code;
 			mutex_unlock(&mfc_mutex);
+			mfc_sched_put(mfc_ctx, (ret == MFCINST_RET_OK) ? TRUE : FALSE);
 			break;
 
 		case IOCTL_MFC_GET_CONFIG:
@@ -648,6 +676,7 @@ static int mfc_probe(struct platform_device *pdev)
 #endif
 
 	mutex_init(&mfc_mutex);
+	mfc_sched_init();
 
 	/*
 	 * buffer memory secure 
@@ -727,6 +756,7 @@ static int mfc_remove(struct platform_device *pdev)
 	free_irq(IRQ_MFC, pdev);
 
 	mutex_destroy(&mfc_mutex);
+	mfc_sched_exit();
 
 	clk_put(mfc_clk);
 
@@ -43,6 +43,18 @@
 static struct list_head mfc_alloc_mem_head[MFC_MAX_PORT_NUM];
 static struct list_head mfc_free_mem_head[MFC_MAX_PORT_NUM];
 
+/*
+ * Buffers given back by an instance are parked in the pool of their port
+ * instead of going back into the free list. An instance opened later for
+ * the same codec and resolution asks for the same sizes again and gets the
+ * parked chunks back without carving up (and fragmenting) the free list.
+ * The pool is returned to the free list as soon as a request cannot be met
+ * otherwise, so it never costs memory an allocation needs.
+ */
+static struct list_head mfc_pool_mem_head[MFC_MAX_PORT_NUM];
+static unsigned int mfc_pool_size[MFC_MAX_PORT_NUM];
+static unsigned long mfc_pool_hits, mfc_pool_misses, mfc_pool_flushes;
+
 void mfc_print_mem_list(void)
 {
 	struct list_head *pos;
@@ -70,6 +82,13 @@ void mfc_print_mem_list(void)
 			mfc_info("[free_list] start_addr: 0x%08x size:%d\n",
 					free_node->start_addr , free_node->size);
 		}
+
+		list_for_each(pos, &mfc_pool_mem_head[port_no])
+		{
+			alloc_node = list_entry(pos, mfc_alloc_mem_t, list);
+			mfc_info("[pool_list] p_addr: 0x%08x size: %d\n",
+					alloc_node->p_addr, alloc_node->size);
+		}
 	}
 }
 
@@ -83,6 +102,9 @@ void mfc_merge_fragment(int inst_no)
 	{
 		list_for_each_safe(pos, n, &mfc_free_mem_head[port_no])
 		{
+			if (n == &mfc_free_mem_head[port_no])
+				break;
+
 			node1 = list_entry(pos, mfc_free_mem_t, list);
 			node2 = list_entry(n, mfc_free_mem_t, list);
 			if ((node1->start_addr + node1->size) == node2->start_addr)
@@ -112,7 +134,7 @@ static unsigned int mfc_get_free_mem(int alloc_size, int inst_no, int port_no)
 
 	if (list_empty(&mfc_free_mem_head[port_no]))
 	{
-		mfc_err("all memory is gone\n");
+		mfc_debug("all memory is gone\n");
 		return alloc_addr;
 	}
 
@@ -148,7 +170,7 @@ static unsigned int mfc_get_free_mem(int alloc_size, int inst_no, int port_no)
 	}
 	else
 	{
-		mfc_err("there is no suitable chunk....[case 1]\n");
+		mfc_debug("there is no suitable chunk....[case 1]\n");
 		return 0;
 	}
 
@@ -165,6 +187,8 @@ int mfc_init_buffer(void)
 	{
 		INIT_LIST_HEAD(&mfc_alloc_mem_head[port_no]);
 		INIT_LIST_HEAD(&mfc_free_mem_head[port_no]);
+		INIT_LIST_HEAD(&mfc_pool_mem_head[port_no]);
+		mfc_pool_size[port_no] = 0;
 
 		/* init free head node */
 		free_node =
@@ -207,7 +231,7 @@ MFC_ERROR_CODE mfc_release_buffer(unsigned char *u_addr)
 			alloc_node = list_entry(pos, mfc_alloc_mem_t, list);
 			if (alloc_node->u_addr == u_addr)
 			{
-				mfc_free_alloc_mem(alloc_node, port_no);
+				mfc_pool_alloc_mem(alloc_node, port_no);
 				found = TRUE;
 				break;
 			}
@@ -237,7 +261,7 @@ void mfc_release_all_buffer(int inst_no)
 			alloc_node = list_entry(pos, mfc_alloc_mem_t, list);
 			if (alloc_node->inst_no == inst_no)
 			{
-				mfc_free_alloc_mem(alloc_node, port_no);
+				mfc_pool_alloc_mem(alloc_node, port_no);
 			}
 		}
 	}
@@ -247,20 +271,20 @@ void mfc_release_all_buffer(int inst_no)
 #endif
 }
 
-void mfc_free_alloc_mem(mfc_alloc_mem_t *alloc_node, int port_no)
+static void mfc_insert_free_mem(unsigned int start_addr, unsigned int size, int port_no)
 {
 	struct list_head *pos;
 	mfc_free_mem_t *free_node;
 	mfc_free_mem_t *target_node;
 
 	free_node = (mfc_free_mem_t	*)kmalloc(sizeof(mfc_free_mem_t), GFP_KERNEL);
-	free_node->start_addr = alloc_node->p_addr;
-	free_node->size = alloc_node->size;
+	free_node->start_addr = start_addr;
+	free_node->size = size;
 
 	list_for_each(pos, &mfc_free_mem_head[port_no])
 	{
 		target_node = list_entry(pos, mfc_free_mem_t, list);
-		if (alloc_node->p_addr < target_node->start_addr)
+		if (start_addr < target_node->start_addr)
 			break;
 	}
 
@@ -268,11 +292,90 @@ void mfc_free_alloc_mem(mfc_alloc_mem_t *alloc_node, int port_no)
 		list_add_tail(&(free_node->list), &(mfc_free_mem_head[port_no]));
 	else
 		list_add_tail(&(free_node->list), pos);
+}
+
+void mfc_free_alloc_mem(mfc_alloc_mem_t *alloc_node, int port_no)
+{
+	mfc_insert_free_mem(alloc_node->p_addr, alloc_node->size, port_no);
 
 	list_del(&(alloc_node->list));
 	kfree(alloc_node);
 }
 
+/* park a chunk an instance is done with in the pool of its port */
+void mfc_pool_alloc_mem(mfc_alloc_mem_t *alloc_node, int port_no)
+{
+	list_del(&(alloc_node->list));
+
+	alloc_node->inst_no = -1;
+	alloc_node->u_addr = NULL;
+	list_add(&(alloc_node->list), &mfc_pool_mem_head[port_no]);
+	mfc_pool_size[port_no] += alloc_node->size;
+}
+
+/*
+ * take the best fitting pooled chunk of at least alloc_size and hand the
+ * tail the request does not need to the free list
+ */
+static mfc_alloc_mem_t *mfc_pool_get_mem(int alloc_size, int port_no)
+{
+	mfc_alloc_mem_t *pool_node, *match_node = NULL;
+
+	list_for_each_entry(pool_node, &mfc_pool_mem_head[port_no], list)
+	{
+		if (pool_node->size < alloc_size)
+			continue;
+
+		if ((match_node == NULL) || (pool_node->size < match_node->size))
+			match_node = pool_node;
+
+		if (match_node->size == alloc_size)
+			break;
+	}
+
+	if (match_node == NULL)
+		return NULL;
+
+	list_del(&(match_node->list));
+	mfc_pool_size[port_no] -= match_node->size;
+
+	if (match_node->size > alloc_size)
+	{
+		mfc_insert_free_mem(match_node->p_addr + alloc_size,
+				match_node->size - alloc_size, port_no);
+		match_node->size = alloc_size;
+		mfc_merge_fragment(-1);
+	}
+
+	return match_node;
+}
+
+/* give all pooled chunks of a port back to the free list */
+static void mfc_pool_flush(int port_no)
+{
+	mfc_alloc_mem_t *pool_node, *n;
+
+	if (list_empty(&mfc_pool_mem_head[port_no]))
+		return;
+
+	list_for_each_entry_safe(pool_node, n, &mfc_pool_mem_head[port_no], list)
+		mfc_free_alloc_mem(pool_node, port_no);
+
+	mfc_pool_size[port_no] = 0;
+	mfc_pool_flushes++;
+
+	mfc_merge_fragment(-1);
+}
+
+void mfc_get_pool_stats(mfc_pool_stats_t *stats)
+{
+	stats->port0_size = mfc_pool_size[0];
+	stats->port1_size = mfc_pool_size[1];
+	stats->hits = mfc_pool_hits;
+	stats->misses = mfc_pool_misses;
+	stats->flushes = mfc_pool_flushes;
+}
+
 MFC_ERROR_CODE mfc_get_phys_addr(mfc_inst_ctx *mfc_ctx, mfc_args *args)
 {
 	int ret, port_no;
@@ -317,6 +420,15 @@ MFC_ERROR_CODE mfc_allocate_buffer(mfc_inst_ctx *mfc_ctx, mfc_args *args, int po
 
 	in_param = (mfc_mem_alloc_arg_t *)args;
 
+	/* a chunk a previous instance left in the pool is as good as new */
+	alloc_node = mfc_pool_get_mem((int)in_param->buff_size, port_no);
+	if (alloc_node != NULL)
+	{
+		mfc_pool_hits++;
+		goto set_addr;
+	}
+	mfc_pool_misses++;
+
 	alloc_node = (mfc_alloc_mem_t *)kmalloc(sizeof(mfc_alloc_mem_t), GFP_KERNEL);
 	if (!alloc_node)
 	{
@@ -328,6 +440,12 @@ MFC_ERROR_CODE mfc_allocate_buffer(mfc_inst_ctx *mfc_ctx, mfc_args *args, int po
 
 	/* if user request area, allocate from reserved area */
 	start_paddr = mfc_get_free_mem((int)in_param->buff_size, inst_no, port_no);
+	if (!start_paddr && !list_empty(&mfc_pool_mem_head[port_no]))
+	{
+		/* the pool holds the memory we need: give it back and retry */
+		mfc_pool_flush(port_no);
+		start_paddr = mfc_get_free_mem((int)in_param->buff_size, inst_no, port_no);
+	}
 	mfc_debug("start_paddr = 0x%X\n\r", start_paddr);
 
 	if (!start_paddr)
@@ -340,6 +458,9 @@ MFC_ERROR_CODE mfc_allocate_buffer(mfc_inst_ctx *mfc_ctx, mfc_args *args, int po
 	}
 
 	alloc_node->p_addr = start_paddr;
+	alloc_node->size = (int)in_param->buff_size;
+
+set_addr:
 	if (port_no)
 	{
 		alloc_node->v_addr = (unsigned char *)(mfc_get_port1_buff_vaddr() +
@@ -363,7 +484,6 @@ MFC_ERROR_CODE mfc_allocate_buffer(mfc_inst_ctx *mfc_ctx, mfc_args *args, int po
 			(unsigned int)alloc_node->v_addr,
 			alloc_node->p_addr);
 
-	alloc_node->size = (int)in_param->buff_size;
 	alloc_node->inst_no = inst_no;
 
 	list_add(&(alloc_node->list), &mfc_alloc_mem_head[port_no]);
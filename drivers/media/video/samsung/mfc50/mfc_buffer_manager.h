@@ -45,6 +45,15 @@ typedef struct {
 } mfc_free_mem_t;
 
 
+typedef struct {
+	unsigned int port0_size;   /* bytes parked in the port0 pool        */
+	unsigned int port1_size;   /* bytes parked in the port1 pool        */
+	unsigned long hits;        /* allocations served from the pool      */
+	unsigned long misses;      /* allocations served from the free list */
+	unsigned long flushes;     /* pool given back to make room          */
+} mfc_pool_stats_t;
+
+
 /*================================================================================*/
 /*  Function Prototype                                                            */
 /*================================================================================*/
@@ -53,6 +62,8 @@ int mfc_init_buffer(void);
 void mfc_merge_fragment(int inst_no);
 void mfc_release_all_buffer(int inst_no);
 void mfc_free_alloc_mem(mfc_alloc_mem_t *alloc_node, int port_no);
+void mfc_pool_alloc_mem(mfc_alloc_mem_t *alloc_node, int port_no);
+void mfc_get_pool_stats(mfc_pool_stats_t *stats);
 MFC_ERROR_CODE mfc_release_buffer(unsigned char *u_addr);
 MFC_ERROR_CODE mfc_get_phys_addr(mfc_inst_ctx *mfc_ctx, mfc_args *args);
 MFC_ERROR_CODE mfc_allocate_buffer(mfc_inst_ctx *mfc_ctx, mfc_args *args, int port_no);
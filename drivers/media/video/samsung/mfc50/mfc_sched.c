@@ -0,0 +1,318 @@
+/*
+ * drivers/media/video/samsung/mfc50/mfc_sched.c
+ *
+ * Frame scheduler for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * Instances share the codec one frame at a time, in round-robin order of
+ * their instance slots, and the time each frame waits for and occupies the
+ * codec is accounted per instance. The statistics are shown in debugfs as
+ * mfc-stats; writing to the file clears them.
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+
+#include "mfc_buffer_manager.h"
+#include "mfc_logmsg.h"
+#include "mfc_memory.h"
+#include "mfc_sched.h"
+
+/* fps and utilization are computed over windows of this length */
+#define MFC_STATS_WINDOW_NS	NSEC_PER_SEC
+
+typedef struct {
+	BOOL active;
+	SSBSIP_MFC_CODEC_TYPE codec_type;
+	unsigned int width;
+	unsigned int height;
+
+	ktime_t grant;          /* the turn was given           */
+
+	unsigned long frames;
+	u64 wait_ns;
+	u64 wait_max_ns;
+
+	/* current window, and the rates of the last complete one */
+	ktime_t win_start;
+	unsigned long win_frames;
+	u64 win_busy_ns;
+	unsigned int fps_x100;
+	unsigned int util_permille;
+} mfc_inst_stats;
+
+static struct {
+	spinlock_t lock;
+	wait_queue_head_t wait;
+
+	/*
+	 * Threads asking for a turn, per slot. Several threads may share an
+	 * instance, and each of them is served in a turn of its own.
+	 */
+	int waiting[MFC_MAX_INSTANCE_NUM];
+	int owner;              /* slot holding the codec or -1 */
+	int last;               /* slot served last             */
+
+	mfc_inst_stats stats[MFC_MAX_INSTANCE_NUM];
+#ifdef CONFIG_DEBUG_FS
+	struct dentry *debugfs;
+#endif
+} mfc_sched;
+
+/* next waiting slot after the one served last; lock held */
+static int mfc_sched_next(void)
+{
+	int i, slot;
+
+	for (i = 1; i <= MFC_MAX_INSTANCE_NUM; i++)
+	{
+		slot = (mfc_sched.last + i) % MFC_MAX_INSTANCE_NUM;
+		if (mfc_sched.waiting[slot])
+			return slot;
+	}
+
+	return -1;
+}
+
+static BOOL mfc_sched_turn(int slot)
+{
+	BOOL turn = FALSE;
+
+	spin_lock(&mfc_sched.lock);
+	if ((mfc_sched.owner < 0) && (mfc_sched_next() == slot))
+	{
+		mfc_sched.owner = slot;
+		mfc_sched.waiting[slot]--;
+		turn = TRUE;
+	}
+	spin_unlock(&mfc_sched.lock);
+
+	return turn;
+}
+
+int mfc_sched_get(mfc_inst_ctx *mfc_ctx)
+{
+	int slot = mfc_ctx->mem_inst_no;
+	mfc_inst_stats *stats = &mfc_sched.stats[slot];
+	ktime_t request, now;
+	u64 wait_ns;
+	int ret;
+
+	request = ktime_get();
+
+	spin_lock(&mfc_sched.lock);
+	mfc_sched.waiting[slot]++;
+	spin_unlock(&mfc_sched.lock);
+
+	ret = wait_event_interruptible(mfc_sched.wait, mfc_sched_turn(slot));
+	if (ret)
+	{
+		/* we may be the one the others are waiting for */
+		spin_lock(&mfc_sched.lock);
+		mfc_sched.waiting[slot]--;
+		spin_unlock(&mfc_sched.lock);
+		wake_up_all(&mfc_sched.wait);
+		return ret;
+	}
+
+	now = ktime_get();
+	wait_ns = ktime_to_ns(ktime_sub(now, request));
+
+	spin_lock(&mfc_sched.lock);
+	stats->grant = now;
+	stats->wait_ns += wait_ns;
+	if (wait_ns > stats->wait_max_ns)
+		stats->wait_max_ns = wait_ns;
+	spin_unlock(&mfc_sched.lock);
+
+	return 0;
+}
+
+void mfc_sched_put(mfc_inst_ctx *mfc_ctx, BOOL frame_done)
+{
+	int slot = mfc_ctx->mem_inst_no;
+	mfc_inst_stats *stats = &mfc_sched.stats[slot];
+	ktime_t now = ktime_get();
+	u64 busy_ns, win_ns;
+
+	busy_ns = ktime_to_ns(ktime_sub(now, stats->grant));
+
+	spin_lock(&mfc_sched.lock);
+
+	stats->codec_type = mfc_ctx->MfcCodecType;
+	stats->width = mfc_ctx->img_width;
+	stats->height = mfc_ctx->img_height;
+	stats->win_busy_ns += busy_ns;
+	if (frame_done)
+	{
+		stats->frames++;
+		stats->win_frames++;
+	}
+
+	win_ns = ktime_to_ns(ktime_sub(now, stats->win_start));
+	if (win_ns >= MFC_STATS_WINDOW_NS)
+	{
+		stats->fps_x100 = div64_u64((u64)stats->win_frames * 100 * NSEC_PER_SEC, win_ns);
+		stats->util_permille = div64_u64(stats->win_busy_ns * 1000, win_ns);
+		stats->win_start = now;
+		stats->win_frames = 0;
+		stats->win_busy_ns = 0;
+	}
+
+	mfc_sched.owner = -1;
+	mfc_sched.last = slot;
+
+	spin_unlock(&mfc_sched.lock);
+
+	wake_up_all(&mfc_sched.wait);
+}
+
+void mfc_sched_open(mfc_inst_ctx *mfc_ctx)
+{
+	mfc_inst_stats *stats = &mfc_sched.stats[mfc_ctx->mem_inst_no];
+
+	spin_lock(&mfc_sched.lock);
+	memset(stats, 0, sizeof(*stats));
+	stats->active = TRUE;
+	stats->codec_type = UNKNOWN_TYPE;
+	stats->win_start = ktime_get();
+	spin_unlock(&mfc_sched.lock);
+}
+
+void mfc_sched_release(mfc_inst_ctx *mfc_ctx)
+{
+	spin_lock(&mfc_sched.lock);
+	mfc_sched.stats[mfc_ctx->mem_inst_no].active = FALSE;
+	spin_unlock(&mfc_sched.lock);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static const char *mfc_codec_name(SSBSIP_MFC_CODEC_TYPE codec_type)
+{
+	static const char *names[] = {
+		[H264_DEC]    = "h264-dec",
+		[VC1_DEC]     = "vc1-dec",
+		[MPEG4_DEC]   = "mpeg4-dec",
+		[XVID_DEC]    = "xvid-dec",
+		[MPEG1_DEC]   = "mpeg1-dec",
+		[MPEG2_DEC]   = "mpeg2-dec",
+		[H263_DEC]    = "h263-dec",
+		[VC1RCV_DEC]  = "vc1rcv-dec",
+		[DIVX311_DEC] = "divx311-dec",
+		[DIVX412_DEC] = "divx412-dec",
+		[DIVX502_DEC] = "divx502-dec",
+		[DIVX503_DEC] = "divx503-dec",
+		[H264_ENC]    = "h264-enc",
+		[MPEG4_ENC]   = "mpeg4-enc",
+		[H263_ENC]    = "h263-enc",
+	};
+
+	if ((unsigned int)codec_type >= ARRAY_SIZE(names))
+		return "-";
+
+	return names[codec_type];
+}
+
+static int mfc_stats_show(struct seq_file *s, void *unused)
+{
+	mfc_inst_stats stats;
+	mfc_pool_stats_t pool;
+	int slot;
+
+	seq_printf(s, "inst codec        size       frames   fps     util  "
+			"wait avg/max (us)\n");
+
+	for (slot = 0; slot < MFC_MAX_INSTANCE_NUM; slot++)
+	{
+		spin_lock(&mfc_sched.lock);
+		stats = mfc_sched.stats[slot];
+		spin_unlock(&mfc_sched.lock);
+
+		if (!stats.active)
+			continue;
+
+		seq_printf(s, "%-4d %-12s %4ux%-4u  %-8lu %3u.%02u  %3u.%u%%  %llu/%llu\n",
+			slot, mfc_codec_name(stats.codec_type),
+			stats.width, stats.height, stats.frames,
+			stats.fps_x100 / 100, stats.fps_x100 % 100,
+			stats.util_permille / 10, stats.util_permille % 10,
+			stats.frames ? div64_u64(stats.wait_ns, (u64)stats.frames * 1000) : 0ULL,
+			div64_u64(stats.wait_max_ns, 1000));
+	}
+
+	mfc_get_pool_stats(&pool);
+	seq_printf(s, "\npool: port0 %u KB, port1 %u KB, hits %lu, misses %lu, "
+			"flushes %lu\n",
+			pool.port0_size >> 10, pool.port1_size >> 10,
+			pool.hits, pool.misses, pool.flushes);
+
+	return 0;
+}
+
+static int mfc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mfc_stats_show, NULL);
+}
+
+static ssize_t mfc_stats_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	mfc_inst_stats *stats;
+	int slot;
+
+	spin_lock(&mfc_sched.lock);
+	for (slot = 0; slot < MFC_MAX_INSTANCE_NUM; slot++)
+	{
+		stats = &mfc_sched.stats[slot];
+		stats->frames = 0;
+		stats->wait_ns = 0;
+		stats->wait_max_ns = 0;
+	}
+	spin_unlock(&mfc_sched.lock);
+
+	return count;
+}
+
+static const struct file_operations mfc_stats_fops = {
+	.owner      = THIS_MODULE,
+	.open       = mfc_stats_open,
+	.read       = seq_read,
+	.write      = mfc_stats_write,
+	.llseek     = seq_lseek,
+	.release    = single_release,
+};
+#endif
+
+void mfc_sched_init(void)
+{
+	spin_lock_init(&mfc_sched.lock);
+	init_waitqueue_head(&mfc_sched.wait);
+	memset(mfc_sched.waiting, 0, sizeof(mfc_sched.waiting));
+	mfc_sched.owner = -1;
+	mfc_sched.last = MFC_MAX_INSTANCE_NUM - 1;
+
+#ifdef CONFIG_DEBUG_FS
+	mfc_sched.debugfs = debugfs_create_file("mfc-stats", S_IRUGO | S_IWUSR,
+						NULL, NULL, &mfc_stats_fops);
+#endif
+}
+
+void mfc_sched_exit(void)
+{
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove(mfc_sched.debugfs);
+#endif
+}
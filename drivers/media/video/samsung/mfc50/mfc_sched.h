@@ -0,0 +1,33 @@
+/*
+ * drivers/media/video/samsung/mfc50/mfc_sched.h
+ *
+ * Header file for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _MFC_SCHED_H_
+#define _MFC_SCHED_H_
+
+#include "mfc_opr.h"
+
+void mfc_sched_init(void);
+void mfc_sched_exit(void);
+
+void mfc_sched_open(mfc_inst_ctx *mfc_ctx);
+void mfc_sched_release(mfc_inst_ctx *mfc_ctx);
+
+/*
+ * Frame level arbitration of the codec. Every DEC_EXE and ENC_EXE takes a
+ * turn with mfc_sched_get() and hands it on with mfc_sched_put(); waiting
+ * instances get their turns in round-robin order, so with N instances a
+ * frame waits for at most N - 1 frames of the others.
+ */
+int mfc_sched_get(mfc_inst_ctx *mfc_ctx);
+void mfc_sched_put(mfc_inst_ctx *mfc_ctx, BOOL frame_done);
+
+#endif /* _MFC_SCHED_H_ */
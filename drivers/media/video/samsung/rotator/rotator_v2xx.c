@@ -21,6 +21,12 @@
 #include <linux/io.h>
 #include <linux/platform_device.h>
 #include <linux/miscdevice.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include <linux/uaccess.h>
 #include <mach/hardware.h>
 #include <mach/map.h>
 #include <mach/pd.h>
@@ -30,6 +36,22 @@
 
 #include "rotator_v2xx.h"
 
+struct rot_job_entry {
+	struct list_head	list;
+	struct rot_ctx		*ctx;		/* NULL once the file is gone */
+	struct rot_job		job;
+	int			discard;	/* ROTATOR_EXEC, not dequeued */
+};
+
+/* per file state */
+struct rot_ctx {
+	struct list_head	done;		/* finished, to be dequeued */
+	int			nr_jobs;	/* queued, running and done */
+	int			outstanding;	/* queued and running */
+	int			chain_win;	/* fb window or -1 */
+	unsigned long		chain_shown;
+};
+
 struct rot_ctrl	s5p_rot;
 
 void rotator_set_src(struct rot_ctrl *ctrl, struct rot_param *params)
@@ -214,9 +236,90 @@ void rotator_disable_int(struct	rot_ctrl *ctrl)
 	writel(cfg, ctrl->regs + S5P_ROT_CONFIG);
 }
 
+static void rotator_run(struct rot_ctrl *ctrl, struct rot_param *params)
+{
+	/* set parameter to regs */
+	rotator_set_src(ctrl, params);
+	rotator_set_dst(ctrl, params);
+	rotator_set_fmt(ctrl, params);
+	rotator_set_degree_flip(ctrl, params);
+
+	rotator_start(ctrl);
+}
+
+static inline int rotator_fence_done(struct rot_ctrl *ctrl, u32 fence)
+{
+	return (s32)(ctrl->done_seqno - fence) >= 0;
+}
+
+/* start the oldest pending job if the rotator is free, job_lock held */
+static void rotator_kick(struct rot_ctrl *ctrl)
+{
+	struct rot_job_entry *entry;
+
+	if (ctrl->running || ctrl->status != ROT_IDLE ||
+	    list_empty(&ctrl->pending))
+		return;
+
+	entry = list_first_entry(&ctrl->pending, struct rot_job_entry, list);
+	list_del(&entry->list);
+
+	ctrl->running = entry;
+	ctrl->status = ROT_RUN;
+
+	rotator_run(ctrl, &entry->job.param);
+
+	/* the timer is idle here, tag it with the job it is armed for */
+	ctrl->timer.data = entry->job.fence;
+	mod_timer(&ctrl->timer, jiffies + ROTATOR_TIMEOUT);
+}
+
+/*
+ * retire the running job and signal its fence, job_lock held. If the
+ * result is to be shown, the window and address are returned so that the
+ * caller can queue it to s3cfb after dropping the lock.
+*/
+static void rotator_complete(struct rot_ctrl *ctrl, int result,
+			     int *win, dma_addr_t *addr)
+{
+	struct rot_job_entry *entry = ctrl->running;
+	struct rot_ctx *ctx = entry->ctx;
+
+	ctrl->running = NULL;
+	if (ctrl->status == ROT_RUN)
+		ctrl->status = ROT_IDLE;
+
+	ctrl->done_seqno = entry->job.fence;
+	entry->job.result = result;
+
+	*win = -1;
+
+	if (!ctx) {
+		kfree(entry);
+		return;
+	}
+
+	ctx->outstanding--;
+
+	if (entry->discard) {
+		ctx->nr_jobs--;
+		kfree(entry);
+		return;
+	}
+
+	if (!result && (entry->job.flags & ROT_JOB_CHAIN)) {
+		*win = ctx->chain_win;
+		*addr = entry->job.param.dst_base[0];
+	}
+
+	list_add_tail(&entry->list, &ctx->done);
+}
+
 irqreturn_t rotator_irq(int irq, void *dev_id)
 {
 	struct rot_ctrl	*ctrl =	&s5p_rot;
+	dma_addr_t addr = 0;
+	int win = -1;
 	u32 cfg;
 
 	cfg = readl(ctrl->regs + S5P_ROT_STATUS);
@@ -224,29 +327,203 @@ irqreturn_t rotator_irq(int irq, void *dev_id)
 
 	writel(cfg, ctrl->regs + S5P_ROT_STATUS);
 
-	ctrl->status = ROT_IDLE;
+	spin_lock(&ctrl->job_lock);
+
+	if (ctrl->running) {
+		del_timer(&ctrl->timer);
+		rotator_complete(ctrl, 0, &win, &addr);
+	} else if (ctrl->status == ROT_RUN) {
+		ctrl->status = ROT_IDLE;
+	}
+
+	rotator_kick(ctrl);
+
+	spin_unlock(&ctrl->job_lock);
+
+	/* hand the rotated frame to the display without a trip to userspace */
+	if (win >= 0)
+		s3cfb_overlay_queue(win, addr);
 
 	wake_up(&ctrl->wq);
 
 	return IRQ_HANDLED;
 }
 
+static void rotator_timeout(unsigned long data)
+{
+	struct rot_ctrl	*ctrl =	&s5p_rot;
+	u32 fence = (u32)data;
+	unsigned long flags;
+	dma_addr_t addr;
+	int win;
+
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+
+	/*
+	 * del_timer() in the interrupt handler does not wait for an expiry
+	 * that is already running, so by now the job this expiry was armed
+	 * for may have finished and the next one started. Ignore it then.
+	 */
+	if (ctrl->running && ctrl->running->job.fence == fence) {
+		printk(KERN_ERR	"%s: Interrupt timeout\n", __func__);
+		rotator_complete(ctrl, -ETIMEDOUT, &win, &addr);
+		rotator_kick(ctrl);
+	}
+
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
+	wake_up(&ctrl->wq);
+}
+
+/* called by s3cfb at the frame interrupt that shows a chained frame */
+static void rotator_chain_latched(void *priv, dma_addr_t addr, ktime_t vsync)
+{
+	struct rot_ctx *ctx = priv;
+
+	ctx->chain_shown++;
+}
+
+static int rotator_queue(struct rot_ctrl *ctrl, struct rot_ctx *ctx,
+			 struct rot_job *job, int discard, int nonblock)
+{
+	struct rot_job_entry *entry;
+	unsigned long flags;
+	int ret;
+
+	ret = rotator_check_vars(&job->param);
+	if (ret) {
+		printk(KERN_ERR	"%s: invalid parameters\n", __func__);
+		return -EINVAL;
+	}
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return -ENOMEM;
+
+	entry->ctx = ctx;
+	entry->job = *job;
+	entry->job.result = 0;
+	entry->discard = discard;
+
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+
+	while (ctx->nr_jobs >= ROT_MAX_JOBS) {
+		spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
+		if (nonblock) {
+			kfree(entry);
+			return -EAGAIN;
+		}
+
+		ret = wait_event_interruptible(ctrl->wq,
+				ctx->nr_jobs < ROT_MAX_JOBS);
+		if (ret) {
+			kfree(entry);
+			return ret;
+		}
+
+		spin_lock_irqsave(&ctrl->job_lock, flags);
+	}
+
+	entry->job.fence = ++ctrl->seqno;
+	job->fence = entry->job.fence;
+
+	list_add_tail(&entry->list, &ctrl->pending);
+	ctx->nr_jobs++;
+	ctx->outstanding++;
+
+	rotator_kick(ctrl);
+
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
+	return 0;
+}
+
+static int rotator_dequeue(struct rot_ctrl *ctrl, struct rot_ctx *ctx,
+			   struct rot_job *job, int nonblock)
+{
+	struct rot_job_entry *entry;
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+
+	while (list_empty(&ctx->done)) {
+		spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
+		if (nonblock)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(ctrl->wq,
+				!list_empty(&ctx->done));
+		if (ret)
+			return ret;
+
+		spin_lock_irqsave(&ctrl->job_lock, flags);
+	}
+
+	entry = list_first_entry(&ctx->done, struct rot_job_entry, list);
+	list_del(&entry->list);
+	ctx->nr_jobs--;
+
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
+	*job = entry->job;
+	kfree(entry);
+
+	/* there is room for another job */
+	wake_up(&ctrl->wq);
+
+	return 0;
+}
+
+static int rotator_set_chain(struct rot_ctrl *ctrl, struct rot_ctx *ctx,
+			     int win)
+{
+	unsigned long flags;
+	int old, ret = 0;
+
+	mutex_lock(&ctrl->lock);
+
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+	old = ctx->chain_win;
+	ctx->chain_win = -1;
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
+	if (old >= 0)
+		s3cfb_overlay_detach(old);
+
+	if (win >= 0) {
+		ret = s3cfb_overlay_attach(win, rotator_chain_latched, ctx);
+		if (!ret) {
+			spin_lock_irqsave(&ctrl->job_lock, flags);
+			ctx->chain_win = win;
+			spin_unlock_irqrestore(&ctrl->job_lock, flags);
+		}
+	}
+
+	mutex_unlock(&ctrl->lock);
+
+	return ret;
+}
+
 int rotator_open(struct	inode *inode, struct file *file)
 {
 	struct rot_ctrl	*ctrl =	&s5p_rot;
-	struct rot_param *params;
+	struct rot_ctx *ctx;
 	int ret;
 
 	/* allocating the rotator instance */
 	
-	params	= kmalloc(sizeof(struct rot_param), GFP_KERNEL);
-	if (params == NULL) {
+	ctx = kzalloc(sizeof(struct rot_ctx), GFP_KERNEL);
+	if (ctx == NULL) {
 		printk(KERN_ERR	"Instance memory allocation was	failed\n");
 		return -ENOMEM;
 	}
 
-	memset(params, 0, sizeof(struct	rot_param));
-	file->private_data = (struct rot_param *)params;
+	INIT_LIST_HEAD(&ctx->done);
+	ctx->chain_win = -1;
+	file->private_data = ctx;
 
 	atomic_inc(&ctrl->in_use);
 	printk("%s: %dth called.\n", __func__, atomic_read(&ctrl->in_use));
@@ -270,18 +547,49 @@ int rotator_open(struct	inode *inode, struct file *file)
 int rotator_release(struct inode *inode, struct	file *file)
 {
 	struct rot_ctrl	*ctrl =	&s5p_rot;
-	struct rot_param *params;
+	struct rot_job_entry *entry, *tmp;
+	struct rot_ctx *ctx;
+	unsigned long flags;
 	int ret;
 	
-	params	= (struct rot_param *)file->private_data;
-	if (params == NULL) {
+	ctx = (struct rot_ctx *)file->private_data;
+	if (ctx == NULL) {
 		printk(KERN_ERR	"Can't release rotator!!\n");
 		return -1;
 	}
-	kfree(params);
+
+	rotator_set_chain(ctrl, ctx, -1);
+
+	/* forget the jobs of this file, a running one finishes orphaned */
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+
+	list_for_each_entry_safe(entry, tmp, &ctrl->pending, list) {
+		if (entry->ctx == ctx) {
+			list_del(&entry->list);
+			kfree(entry);
+		}
+	}
+
+	if (ctrl->running && ctrl->running->ctx == ctx)
+		ctrl->running->ctx = NULL;
+
+	list_for_each_entry_safe(entry, tmp, &ctx->done, list) {
+		list_del(&entry->list);
+		kfree(entry);
+	}
+
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
+	if (ctx->chain_shown)
+		printk(KERN_DEBUG "%s: %lu chained frames shown\n", __func__,
+		       ctx->chain_shown);
+
+	kfree(ctx);
 
 	atomic_dec(&ctrl->in_use);
 	if (atomic_read(&ctrl->in_use) == 0) {
+		wait_event_timeout(ctrl->wq, !ctrl->running, ROTATOR_TIMEOUT);
+
 		rotator_disable_int(ctrl);
 		clk_disable(ctrl->clock);
 
@@ -295,71 +603,97 @@ int rotator_release(struct inode *inode, struct	file *file)
 	return 0;
 }
 
+/*
+ * ROTATOR_EXEC runs one frame and, unless the file is non-blocking, waits
+ * for it. ROTATOR_QUEUE adds a job behind the ones already submitted and
+ * returns its fence at once; finished jobs are collected in order with
+ * ROTATOR_DEQUEUE, and ROTATOR_WAIT_FENCE waits until a given job and all
+ * jobs before it have finished. Jobs flagged ROT_JOB_CHAIN are shown in
+ * the fb window set with ROTATOR_SET_CHAIN from the rotator interrupt.
+*/
 static int rotator_ioctl(struct	inode *inode, struct file *file,
 						u32 cmd, unsigned long arg)
 {
 	struct rot_ctrl	*ctrl =	&s5p_rot;
-	struct rot_param *params;
-	struct rot_param *parg;
-	int ret;
+	struct rot_ctx *ctx = (struct rot_ctx *)file->private_data;
+	int nonblock = file->f_flags & O_NONBLOCK;
+	struct rot_job job;
+	u32 fence;
+	int win, ret;
+
+	switch (cmd) {
+	case ROTATOR_EXEC:
+		memset(&job, 0, sizeof(job));
+		ret = copy_from_user(&job.param, (struct rot_param *)arg,
+				     sizeof(struct rot_param));
+		if (ret) {
+			printk(KERN_ERR	"%s: error : copy_from_user\n",
+			       __func__);
+			return -EINVAL;
+		}
 
-	if (rotator_get_status(ctrl) !=	S5P_ROT_STATREG_STATUS_IDLE) {
-		printk(KERN_ERR	"Rotator state : %x\n",
-						rotator_get_status(ctrl));
-		return -EBUSY;
-	}
+		ret = rotator_queue(ctrl, ctx, &job, 1, nonblock);
+		if (ret || nonblock)
+			return ret;
 
-	mutex_lock(&ctrl->lock);
+		wait_event(ctrl->wq, rotator_fence_done(ctrl, job.fence));
+		return 0;
 
-	params	 = (struct rot_param *)file->private_data;
-	parg	 = (struct rot_param *)arg;
+	case ROTATOR_QUEUE:
+		if (copy_from_user(&job, (struct rot_job *)arg, sizeof(job)))
+			return -EFAULT;
 
-	ret = copy_from_user(params, parg, sizeof(struct rot_param));
-	if (ret) {
-		printk(KERN_ERR	"%s: error : copy_from_user\n",	__func__);
-		mutex_unlock(&ctrl->lock);
-		return -EINVAL;
-	}
+		ret = rotator_queue(ctrl, ctx, &job, 0, nonblock);
+		if (ret)
+			return ret;
 
-	ret = rotator_check_vars(params);
-	if (ret) {
-		printk(KERN_ERR	"%s: invalid parameters\n", __func__);
-		mutex_unlock(&ctrl->lock);
-		return -EINVAL;
-	}
-	
-	/* set parameter to regs */
-	rotator_set_src(ctrl, params);
-	rotator_set_dst(ctrl, params);
-	rotator_set_fmt(ctrl, params);
-	rotator_set_degree_flip(ctrl, params);
+		return put_user(job.fence, &((struct rot_job *)arg)->fence);
 
-	rotator_start(ctrl);
-	ctrl->status = ROT_RUN;
+	case ROTATOR_DEQUEUE:
+		ret = rotator_dequeue(ctrl, ctx, &job, nonblock);
+		if (ret)
+			return ret;
 
-	if (!(file->f_flags & O_NONBLOCK)) {
-		ret = wait_event_timeout(ctrl->wq, (ctrl->status == ROT_IDLE),
-				ROTATOR_TIMEOUT);
-		if (ret	== 0) {
-			ctrl->status = ROT_IDLE;
-			printk(KERN_ERR	"%s: Interrupt timeout\n", __func__);
-		}
-	}
+		return copy_to_user((struct rot_job *)arg, &job, sizeof(job)) ?
+			-EFAULT : 0;
 
-	mutex_unlock(&ctrl->lock);
+	case ROTATOR_WAIT_FENCE:
+		if (get_user(fence, (u32 *)arg))
+			return -EFAULT;
 
-	return 0;
+		return wait_event_interruptible(ctrl->wq,
+				rotator_fence_done(ctrl, fence));
+
+	case ROTATOR_SET_CHAIN:
+		if (get_user(win, (int *)arg))
+			return -EFAULT;
+
+		return rotator_set_chain(ctrl, ctx, win);
+
+	default:
+		return -EINVAL;
+	}
 }
 
+/* readable when a job can be dequeued, writable when none is in flight */
 static u32 rotator_poll(struct file *file, poll_table *wait)
 {
 	struct rot_ctrl	*ctrl =	&s5p_rot;
+	struct rot_ctx *ctx = (struct rot_ctx *)file->private_data;
+	unsigned long flags;
 	u32 mask = 0;
 
 	poll_wait(file,	&ctrl->wq, wait);
 
-	if (rotator_get_status(ctrl) ==	S5P_ROT_STATREG_STATUS_IDLE)
-		mask = POLLOUT | POLLWRNORM;
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+
+	if (!list_empty(&ctx->done))
+		mask |= POLLIN | POLLRDNORM;
+
+	if (!ctx->outstanding)
+		mask |= POLLOUT | POLLWRNORM;
+
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
 
 	return mask;
 }
@@ -397,6 +731,10 @@ int rotator_probe(struct platform_device *pdev)
 	clk_enable(ctrl->clock);
 
 
+	spin_lock_init(&ctrl->job_lock);
+	INIT_LIST_HEAD(&ctrl->pending);
+	setup_timer(&ctrl->timer, rotator_timeout, 0);
+
 	/* IRQ handling	*/
 	ctrl->irq_num =	platform_get_irq(pdev, 0);
 	if (ctrl->irq_num <= 0)	{
@@ -454,6 +792,7 @@ static int rotator_remove(struct platform_device *pdev)
 
 	clk_disable(ctrl->clock);
 	free_irq(ctrl->irq_num,	NULL);
+	del_timer_sync(&ctrl->timer);
 
 	if (ctrl->regs != NULL)	{
 		printk(KERN_INFO "Rotator Driver, releasing resource\n");
@@ -477,21 +816,16 @@ static int rotator_remove(struct platform_device *pdev)
 static int rotator_suspend(struct platform_device *dev,	pm_message_t state)
 {
 	struct rot_ctrl	*ctrl =	&s5p_rot;
-	u32 i =	0;
+	unsigned long flags;
 	int ret;
-	
-	if (ctrl->status != ROT_IDLE) {
-		ctrl->status = ROT_READY_SLEEP;
 
-		while (i++ > 1000) {
-			if (ctrl->status == ROT_IDLE)
-				break;
+	/* let the running job finish, queued ones wait for resume */
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+	ctrl->status = ROT_READY_SLEEP;
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
 
-			printk(KERN_ERR	"Rotator is running.\n");
-		}
-	} else {
-		ctrl->status = ROT_READY_SLEEP;
-	}
+	if (!wait_event_timeout(ctrl->wq, !ctrl->running, ROTATOR_TIMEOUT))
+		printk(KERN_ERR	"Rotator is running.\n");
 
 	ctrl->status = ROT_SLEEP;
 	clk_disable(ctrl->clock);
@@ -508,6 +842,7 @@ static int rotator_suspend(struct platform_device *dev,	pm_message_t state)
 static int rotator_resume(struct platform_device *pdev)
 {
 	struct rot_ctrl	*ctrl =	&s5p_rot;
+	unsigned long flags;
 	int ret;
 
 	ret = s5pv210_pd_enable("rotator_pd");
@@ -517,10 +852,13 @@ static int rotator_resume(struct platform_device *pdev)
 	}
 	
 	clk_enable(ctrl->clock);
-	ctrl->status = ROT_IDLE;
-	
 	rotator_enable_int(ctrl);
 
+	spin_lock_irqsave(&ctrl->job_lock, flags);
+	ctrl->status = ROT_IDLE;
+	rotator_kick(ctrl);
+	spin_unlock_irqrestore(&ctrl->job_lock, flags);
+
 	return 0;
 }
 
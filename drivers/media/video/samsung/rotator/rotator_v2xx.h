@@ -22,6 +22,13 @@
 #define	ROT_CLK_NAME	"rot"
 
 #define	ROTATOR_EXEC	_IO(ROTATOR_IOCTL_MAGIC, 0)
+#define	ROTATOR_QUEUE	_IOWR(ROTATOR_IOCTL_MAGIC, 1, struct rot_job)
+#define	ROTATOR_DEQUEUE	_IOR(ROTATOR_IOCTL_MAGIC, 2, struct rot_job)
+#define	ROTATOR_WAIT_FENCE	_IOW(ROTATOR_IOCTL_MAGIC, 3, u32)
+#define	ROTATOR_SET_CHAIN	_IOW(ROTATOR_IOCTL_MAGIC, 4, int)
+
+/* jobs a file may have queued, running or waiting to be dequeued */
+#define	ROT_MAX_JOBS	8
 
 enum rot_status	{
 	ROT_IDLE,
@@ -30,6 +37,8 @@ enum rot_status	{
 	ROT_SLEEP,
 };
 
+struct rot_job_entry;
+
 struct rot_ctrl	{
 	char			name[16];
 	atomic_t		in_use;
@@ -40,6 +49,14 @@ struct rot_ctrl	{
 	struct mutex		lock;
 	wait_queue_head_t	wq;
 	enum rot_status		status;
+
+	/* job queue, shared by all files in submission order */
+	spinlock_t		job_lock;
+	struct list_head	pending;
+	struct rot_job_entry	*running;
+	struct timer_list	timer;		/* interrupt timeout */
+	u32			seqno;		/* fence of the last queued job */
+	u32			done_seqno;	/* fence of the last finished job */
 };
 
 enum rot_format	{
@@ -83,5 +100,21 @@ struct rot_param {
 	enum rot_degree	degree;		/* degree */
 	enum rot_flip flip;		/* flip	*/
 };
+
+/* ROT_JOB_CHAIN: show dst_base in the window set with ROTATOR_SET_CHAIN */
+#define	ROT_JOB_CHAIN	(1 << 0)
+
+struct rot_job {
+	struct rot_param	param;
+	u32			flags;
+	u32			user;		/* returned as is */
+	u32			fence;		/* out: signalled when finished */
+	int			result;		/* out: 0 or -ETIMEDOUT */
+};
+
+/* FIMD */
+extern int s3cfb_overlay_attach(int id, void (*latched)(void *priv, dma_addr_t addr, ktime_t vsync), void *priv);
+extern int s3cfb_overlay_queue(int id, dma_addr_t addr);
+extern void s3cfb_overlay_detach(int id);
 #endif /* _S5P_ROTATOR_V2XX_H_	*/
 
@@ -19,6 +19,7 @@
 #include <linux/file.h>
 #include <linux/mm.h>
 #include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/debugfs.h>
 #include <linux/android_pmem.h>
 #include <linux/mempolicy.h>
@@ -74,9 +75,9 @@ struct pmem_data {
 	struct list_head region_list;
 	/* a linked list of data so we can access them for debugging */
 	struct list_head list;
-#if PMEM_DEBUG
+	/* number of outstanding get_pmem_file references, an allocation with
+	 * references is never relocated */
 	int ref;
-#endif
 };
 
 struct pmem_bits {
@@ -89,6 +90,17 @@ struct pmem_region_node {
 	struct list_head list;
 };
 
+/* a contiguous run of entries in a best-fit managed region */
+struct pmem_extent {
+	/* linkage in free_by_start or alloc_by_start */
+	struct rb_node start_node;
+	/* linkage in free_by_size, only used while the extent is free */
+	struct rb_node size_node;
+	/* first entry and number of entries, in PMEM_MIN_ALLOC units */
+	unsigned long start;
+	unsigned long len;
+};
+
 #define PMEM_DEBUG_MSGS 0
 #if PMEM_DEBUG_MSGS
 #define DLOG(fmt,args...) \
@@ -118,6 +130,21 @@ struct pmem_info {
 	struct pmem_bits *bitmap;
 	/* indicates the region should not be managed with an allocator */
 	unsigned no_allocator;
+	/* indicates the region is managed with the best-fit extent allocator
+	 * instead of the bitmap, data->index is then the first entry of the
+	 * allocation and its length is kept in alloc_by_start */
+	unsigned best_fit;
+	/* in best-fit mode, allow unmapped allocations to be relocated */
+	unsigned compact;
+	/* free extents ordered by start and by (len, start), and allocated
+	 * extents ordered by start, protected by bitmap_sem */
+	struct rb_root free_by_start;
+	struct rb_root free_by_size;
+	struct rb_root alloc_by_start;
+	/* allocator statistics, protected by bitmap_sem */
+	unsigned long alloc_failures;
+	unsigned long compactions;
+	unsigned long relocated_pages;
 	/* indicates maps of this region should be cached, if a mix of
 	 * cached and uncached is desired, set this and open the device with
 	 * O_SYNC to get an uncached region */
@@ -232,6 +259,357 @@ static int is_master_owner(struct file *file)
 	return ret;
 }
 
+static void pmem_extent_insert_start(struct rb_root *root,
+				     struct pmem_extent *ext)
+{
+	struct rb_node **p = &root->rb_node, *parent = NULL;
+	struct pmem_extent *e;
+
+	while (*p) {
+		parent = *p;
+		e = rb_entry(parent, struct pmem_extent, start_node);
+		if (ext->start < e->start)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&ext->start_node, parent, p);
+	rb_insert_color(&ext->start_node, root);
+}
+
+static void pmem_extent_insert_size(struct rb_root *root,
+				    struct pmem_extent *ext)
+{
+	struct rb_node **p = &root->rb_node, *parent = NULL;
+	struct pmem_extent *e;
+
+	while (*p) {
+		parent = *p;
+		e = rb_entry(parent, struct pmem_extent, size_node);
+		if (ext->len < e->len ||
+		    (ext->len == e->len && ext->start < e->start))
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&ext->size_node, parent, p);
+	rb_insert_color(&ext->size_node, root);
+}
+
+static struct pmem_extent *pmem_extent_find(struct rb_root *root,
+					    unsigned long start)
+{
+	struct rb_node *n = root->rb_node;
+	struct pmem_extent *e;
+
+	while (n) {
+		e = rb_entry(n, struct pmem_extent, start_node);
+		if (start < e->start)
+			n = n->rb_left;
+		else if (start > e->start)
+			n = n->rb_right;
+		else
+			return e;
+	}
+	return NULL;
+}
+
+/* the free extent that ends exactly at start, if there is one */
+static struct pmem_extent *pmem_extent_free_before(int id,
+						   unsigned long start)
+{
+	struct rb_node *n = pmem[id].free_by_start.rb_node;
+	struct pmem_extent *e, *prev = NULL;
+
+	while (n) {
+		e = rb_entry(n, struct pmem_extent, start_node);
+		if (e->start < start) {
+			prev = e;
+			n = n->rb_right;
+		} else {
+			n = n->rb_left;
+		}
+	}
+	if (prev && prev->start + prev->len == start)
+		return prev;
+	return NULL;
+}
+
+/* the smallest free extent of at least len entries, lowest start first */
+static struct pmem_extent *pmem_extent_best_fit(int id, unsigned long len)
+{
+	struct rb_node *n = pmem[id].free_by_size.rb_node;
+	struct pmem_extent *e, *best = NULL;
+
+	while (n) {
+		e = rb_entry(n, struct pmem_extent, size_node);
+		if (e->len >= len) {
+			best = e;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+	return best;
+}
+
+/* return the range [start, start + len) to the free trees, merging it with
+ * its free neighbours. spare is an unlinked extent the caller no longer
+ * needs, it is either reused or freed so this path never allocates */
+static void pmem_bestfit_add_free(int id, unsigned long start,
+				  unsigned long len, struct pmem_extent *spare)
+{
+	struct pmem_extent *prev, *next;
+
+	prev = pmem_extent_free_before(id, start);
+	next = pmem_extent_find(&pmem[id].free_by_start, start + len);
+
+	if (prev) {
+		rb_erase(&prev->size_node, &pmem[id].free_by_size);
+		prev->len += len;
+		if (next) {
+			prev->len += next->len;
+			rb_erase(&next->start_node, &pmem[id].free_by_start);
+			rb_erase(&next->size_node, &pmem[id].free_by_size);
+			kfree(next);
+		}
+		pmem_extent_insert_size(&pmem[id].free_by_size, prev);
+		kfree(spare);
+	} else if (next) {
+		/* moving next's start down keeps the start ordering intact,
+		 * the range below it was allocated until now */
+		rb_erase(&next->size_node, &pmem[id].free_by_size);
+		next->start = start;
+		next->len += len;
+		pmem_extent_insert_size(&pmem[id].free_by_size, next);
+		kfree(spare);
+	} else {
+		spare->start = start;
+		spare->len = len;
+		pmem_extent_insert_start(&pmem[id].free_by_start, spare);
+		pmem_extent_insert_size(&pmem[id].free_by_size, spare);
+	}
+}
+
+static int pmem_bestfit_free(int id, int index)
+{
+	/* caller should hold the write lock on pmem_sem! */
+	struct pmem_extent *alloc;
+
+	alloc = pmem_extent_find(&pmem[id].alloc_by_start, index);
+	if (!alloc) {
+		printk(KERN_WARNING "pmem: freeing unknown allocation %d\n",
+		       index);
+		return -1;
+	}
+	rb_erase(&alloc->start_node, &pmem[id].alloc_by_start);
+	pmem_bestfit_add_free(id, alloc->start, alloc->len, alloc);
+	return 0;
+}
+
+static unsigned long pmem_bestfit_len(int id, int index)
+{
+	struct pmem_extent *alloc;
+	unsigned long len = 0;
+
+	down_read(&pmem[id].bitmap_sem);
+	alloc = pmem_extent_find(&pmem[id].alloc_by_start, index);
+	if (alloc)
+		len = alloc->len * PMEM_MIN_ALLOC;
+	up_read(&pmem[id].bitmap_sem);
+	return len;
+}
+
+/* take a free extent from the pool of no longer needed extents, or
+ * allocate a new one, and make it cover [start, start + len) */
+static void pmem_bestfit_add_gap(int id, struct rb_root *pool,
+				 unsigned long start, unsigned long len)
+{
+	struct rb_node *n = rb_first(pool);
+	struct pmem_extent *ext;
+
+	if (n) {
+		rb_erase(n, pool);
+		ext = rb_entry(n, struct pmem_extent, start_node);
+	} else {
+		ext = kmalloc(sizeof(struct pmem_extent), GFP_KERNEL);
+		if (!ext) {
+			printk(KERN_ERR "pmem: lost %lu free pages while "
+			       "compacting!\n", len);
+			return;
+		}
+	}
+	ext->start = start;
+	ext->len = len;
+	pmem_extent_insert_start(&pmem[id].free_by_start, ext);
+	pmem_extent_insert_size(&pmem[id].free_by_size, ext);
+}
+
+/* rebuild the free trees from the gaps between allocations. Compaction
+ * only moves an allocation to the start of the gap below it, so the number
+ * of gaps never grows and the old extents can be reused for the new ones */
+static void pmem_bestfit_rebuild_free(int id)
+{
+	struct rb_root pool = pmem[id].free_by_start;
+	struct pmem_extent *alloc;
+	struct rb_node *n;
+	unsigned long next = 0;
+
+	pmem[id].free_by_start = RB_ROOT;
+	pmem[id].free_by_size = RB_ROOT;
+
+	for (n = rb_first(&pmem[id].alloc_by_start); n; n = rb_next(n)) {
+		alloc = rb_entry(n, struct pmem_extent, start_node);
+		if (alloc->start > next)
+			pmem_bestfit_add_gap(id, &pool, next,
+					     alloc->start - next);
+		next = alloc->start + alloc->len;
+	}
+	if (next < pmem[id].num_entries)
+		pmem_bestfit_add_gap(id, &pool, next,
+				     pmem[id].num_entries - next);
+
+	while ((n = rb_first(&pool))) {
+		rb_erase(n, &pool);
+		kfree(rb_entry(n, struct pmem_extent, start_node));
+	}
+}
+
+/* write lock every file backed by the allocation at index if none of them
+ * is mapped or referenced from the kernel, the caller holds data_list_sem.
+ * Only trylocks are used, the caller holds bitmap_sem which nests inside
+ * pmem_data->sem. An allocation no file points at is left alone, its owner
+ * may not have stored the index yet. Returns 1 if the allocation may be
+ * moved */
+static int pmem_lock_movable(int id, unsigned long index)
+{
+	struct pmem_data *data, *failed = NULL;
+	int owners = 0;
+
+	list_for_each_entry(data, &pmem[id].data_list, list) {
+		if (data->index != index)
+			continue;
+		owners++;
+		if (!down_write_trylock(&data->sem)) {
+			failed = data;
+			break;
+		}
+		if (data->vma || data->ref ||
+		    (data->flags & (PMEM_FLAGS_MASTERMAP | PMEM_FLAGS_SUBMAP))) {
+			up_write(&data->sem);
+			failed = data;
+			break;
+		}
+	}
+	if (!failed)
+		return owners != 0;
+
+	list_for_each_entry(data, &pmem[id].data_list, list) {
+		if (data == failed)
+			break;
+		if (data->index == index)
+			up_write(&data->sem);
+	}
+	return 0;
+}
+
+static void pmem_unlock_moved(int id, unsigned long index,
+			      unsigned long new_index)
+{
+	struct pmem_data *data;
+
+	list_for_each_entry(data, &pmem[id].data_list, list) {
+		if (data->index != index)
+			continue;
+		data->index = new_index;
+		up_write(&data->sem);
+	}
+}
+
+static void pmem_bestfit_compact(int id)
+{
+	/* caller should hold the write lock on pmem_sem! */
+	struct pmem_extent *alloc;
+	struct rb_node *n;
+	unsigned long next = 0;
+	void *src, *dst;
+
+	if (down_trylock(&pmem[id].data_list_sem))
+		return;
+
+	DLOG("compacting %s\n", pmem[id].dev.name);
+	for (n = rb_first(&pmem[id].alloc_by_start); n; n = rb_next(n)) {
+		alloc = rb_entry(n, struct pmem_extent, start_node);
+		if (alloc->start > next && pmem_lock_movable(id, alloc->start)) {
+			src = pmem[id].vbase + PMEM_OFFSET(alloc->start);
+			dst = pmem[id].vbase + PMEM_OFFSET(next);
+			/* read what the devices wrote, and leave no lines of
+			 * either range behind for the next user of the memory;
+			 * dst is below src, so this covers both */
+			if (pmem[id].cached)
+				dmac_flush_range(src,
+					src + alloc->len * PMEM_MIN_ALLOC);
+			memmove(dst, src, alloc->len * PMEM_MIN_ALLOC);
+			if (pmem[id].cached)
+				dmac_flush_range(dst,
+					src + alloc->len * PMEM_MIN_ALLOC);
+			pmem_unlock_moved(id, alloc->start, next);
+			/* still above the previous allocation, so the tree
+			 * ordering is unchanged */
+			alloc->start = next;
+			pmem[id].relocated_pages += alloc->len;
+		}
+		next = alloc->start + alloc->len;
+	}
+	up(&pmem[id].data_list_sem);
+
+	pmem_bestfit_rebuild_free(id);
+	pmem[id].compactions++;
+}
+
+static int pmem_bestfit_allocate(int id, unsigned long len)
+{
+	/* caller should hold the write lock on pmem_sem! */
+	unsigned long pages = (len + PMEM_MIN_ALLOC - 1) / PMEM_MIN_ALLOC;
+	struct pmem_extent *free, *alloc;
+
+	if (pages == 0 || pages > pmem[id].num_entries)
+		return -1;
+
+	free = pmem_extent_best_fit(id, pages);
+	if (!free && pmem[id].compact) {
+		pmem_bestfit_compact(id);
+		free = pmem_extent_best_fit(id, pages);
+	}
+	if (!free) {
+		pmem[id].alloc_failures++;
+		printk("pmem: no space left to allocate!\n");
+		return -1;
+	}
+
+	if (free->len == pages) {
+		rb_erase(&free->start_node, &pmem[id].free_by_start);
+		rb_erase(&free->size_node, &pmem[id].free_by_size);
+		alloc = free;
+	} else {
+		alloc = kmalloc(sizeof(struct pmem_extent), GFP_KERNEL);
+		if (!alloc) {
+			pmem[id].alloc_failures++;
+			return -1;
+		}
+		alloc->start = free->start;
+		alloc->len = pages;
+		/* carve the allocation off the front of the free extent */
+		rb_erase(&free->size_node, &pmem[id].free_by_size);
+		free->start += pages;
+		free->len -= pages;
+		pmem_extent_insert_size(&pmem[id].free_by_size, free);
+	}
+	pmem_extent_insert_start(&pmem[id].alloc_by_start, alloc);
+	DLOG("best fit %lu pages at %lu\n", alloc->len, alloc->start);
+	return alloc->start;
+}
+
 static int pmem_free(int id, int index)
 {
 	/* caller should hold the write lock on pmem_sem! */
@@ -242,6 +620,8 @@ static int pmem_free(int id, int index)
 		pmem[id].allocated = 0;
 		return 0;
 	}
+	if (pmem[id].best_fit)
+		return pmem_bestfit_free(id, index);
 	/* clean up the bitmap, merging any buddies */
 	pmem[id].bitmap[curr].allocated = 0;
 	/* find a slots buddy Buddy# = Slot# ^ (1 << order)
@@ -349,9 +729,7 @@ static int pmem_open(struct inode *inode, struct file *file)
 	data->vma = NULL;
 	data->pid = 0;
 	data->master_file = NULL;
-#if PMEM_DEBUG
 	data->ref = 0;
-#endif
 	INIT_LIST_HEAD(&data->region_list);
 	init_rwsem(&data->sem);
 
@@ -393,6 +771,9 @@ static int pmem_allocate(int id, unsigned long len)
 		return len;
 	}
 
+	if (pmem[id].best_fit)
+		return pmem_bestfit_allocate(id, len);
+
 	if (order > PMEM_MAX_ORDER)
 		return -1;
 	DLOG("order %lx\n", order);
@@ -420,6 +801,7 @@ static int pmem_allocate(int id, unsigned long len)
 	 * return an error
 	 */
 	if (best_fit < 0) {
+		pmem[id].alloc_failures++;
 		printk("pmem: no space left to allocate!\n");
 		return -1;
 	}
@@ -470,6 +852,8 @@ static unsigned long pmem_len(int id, struct pmem_data *data)
 {
 	if (pmem[id].no_allocator)
 		return data->index;
+	else if (pmem[id].best_fit)
+		return pmem_bestfit_len(id, data->index);
 	else
 		return PMEM_LEN(id, data->index);
 }
@@ -606,10 +990,11 @@ static int pmem_mmap(struct file *file, struct vm_area_struct *vma)
 	}
 	/* if file->private_data == unalloced, alloc*/
 	if (data && data->index == -1) {
+		/* store the index before a compaction can look for it */
 		down_write(&pmem[id].bitmap_sem);
 		index = pmem_allocate(id, vma->vm_end - vma->vm_start);
-		up_write(&pmem[id].bitmap_sem);
 		data->index = index;
+		up_write(&pmem[id].bitmap_sem);
 	}
 	/* either no space was available or an error occured */
 	if (!has_allocation(file)) {
@@ -727,11 +1112,9 @@ int get_pmem_addr(struct file *file, unsigned long *start,
 	*len = pmem_len(id, data);
 	*vstart = (unsigned long)pmem_start_vaddr(id, data);
 	up_read(&data->sem);
-#if PMEM_DEBUG
 	down_write(&data->sem);
 	data->ref++;
 	up_write(&data->sem);
-#endif
 	return 0;
 }
 
@@ -767,16 +1150,16 @@ void put_pmem_file(struct file *file)
 		return;
 	id = get_id(file);
 	data = (struct pmem_data *)file->private_data;
-#if PMEM_DEBUG
 	down_write(&data->sem);
+#if PMEM_DEBUG
 	if (data->ref == 0) {
 		printk("pmem: pmem_put > pmem_get %s (pid %d)\n",
 		       pmem[id].dev.name, data->pid);
 		BUG();
 	}
+#endif
 	data->ref--;
 	up_write(&data->sem);
-#endif
 	fput(file);
 }
 
@@ -845,13 +1228,18 @@ static int pmem_connect(unsigned long connect, struct file *file)
 	}
 	src_data = (struct pmem_data *)src_file->private_data;
 
+	/* the bitmap sem keeps a best-fit compaction from moving the source
+	 * allocation while its index is copied */
+	down_read(&pmem[get_id(file)].bitmap_sem);
 	if (has_allocation(file) && (data->index != src_data->index)) {
+		up_read(&pmem[get_id(file)].bitmap_sem);
 		printk("pmem: file is already mapped but doesn't match this"
 		       " src_file!\n");
 		ret = -EINVAL;
 		goto err_bad_file;
 	}
 	data->index = src_data->index;
+	up_read(&pmem[get_id(file)].bitmap_sem);
 	data->flags |= PMEM_FLAGS_CONNECTED;
 	data->master_fd = connect;
 	data->master_file = src_file;
@@ -1141,7 +1529,11 @@ static long pmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			if (has_allocation(file))
 				return -EINVAL;
 			data = (struct pmem_data *)file->private_data;
+			down_write(&data->sem);
+			down_write(&pmem[id].bitmap_sem);
 			data->index = pmem_allocate(id, arg);
+			up_write(&pmem[id].bitmap_sem);
+			up_write(&data->sem);
 			break;
 		}
 	case PMEM_CONNECT:
@@ -1167,6 +1559,50 @@ static long pmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 }
 
 #if PMEM_DEBUG
+/* sum up the free space of a region, caller should hold the read lock on
+ * pmem_sem. Adjacent free buddies are counted as one extent since they are
+ * physically contiguous */
+static void pmem_free_stats(int id, unsigned long *total,
+			    unsigned long *largest, unsigned long *extents)
+{
+	struct pmem_extent *ext;
+	struct rb_node *n;
+	unsigned long run = 0;
+	int curr = 0;
+
+	*total = *largest = *extents = 0;
+	if (pmem[id].no_allocator) {
+		if (!pmem[id].allocated) {
+			*total = *largest = pmem[id].num_entries;
+			*extents = 1;
+		}
+		return;
+	}
+
+	if (pmem[id].best_fit) {
+		for (n = rb_first(&pmem[id].free_by_start); n; n = rb_next(n)) {
+			ext = rb_entry(n, struct pmem_extent, start_node);
+			*total += ext->len;
+			*largest = max(*largest, ext->len);
+			(*extents)++;
+		}
+		return;
+	}
+
+	while (curr < pmem[id].num_entries) {
+		if (PMEM_IS_FREE(id, curr)) {
+			if (!run)
+				(*extents)++;
+			run += 1 << PMEM_ORDER(id, curr);
+			*total += 1 << PMEM_ORDER(id, curr);
+			*largest = max(*largest, run);
+		} else {
+			run = 0;
+		}
+		curr = PMEM_NEXT_INDEX(id, curr);
+	}
+}
+
 static ssize_t debug_open(struct inode *inode, struct file *file)
 {
 	file->private_data = inode->i_private;
@@ -1182,6 +1618,7 @@ static ssize_t debug_read(struct file *file, char __user *buf, size_t count,
 	int id = (int)file->private_data;
 	const int debug_bufmax = 4096;
 	static char buffer[4096];
+	unsigned long free, largest, extents;
 	int n = 0;
 
 	DLOG("debug open\n");
@@ -1207,6 +1644,25 @@ static ssize_t debug_read(struct file *file, char __user *buf, size_t count,
 	}
 	up(&pmem[id].data_list_sem);
 
+	down_read(&pmem[id].bitmap_sem);
+	pmem_free_stats(id, &free, &largest, &extents);
+	/* external fragmentation: the share of free space that cannot be
+	 * handed out as a single allocation */
+	n += scnprintf(buffer + n, debug_bufmax - n,
+		       "allocator: %s\n"
+		       "free: %lu kB in %lu extents, largest %lu kB, "
+		       "fragmentation %lu%%\n"
+		       "failed allocations %lu, compactions %lu, "
+		       "relocated %lu kB\n",
+		       pmem[id].no_allocator ? "none" :
+		       pmem[id].best_fit ? "best-fit" : "buddy",
+		       free * (PMEM_MIN_ALLOC / 1024), extents,
+		       largest * (PMEM_MIN_ALLOC / 1024),
+		       free ? 100 - (largest * 100) / free : 0,
+		       pmem[id].alloc_failures, pmem[id].compactions,
+		       pmem[id].relocated_pages * (PMEM_MIN_ALLOC / 1024));
+	up_read(&pmem[id].bitmap_sem);
+
 	n++;
 	buffer[n] = 0;
 	return simple_read_from_buffer(buf, count, ppos, buffer, n);
@@ -1235,6 +1691,11 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 	id_count++;
 
 	pmem[id].no_allocator = pdata->no_allocator;
+	pmem[id].best_fit = pdata->best_fit;
+	pmem[id].compact = pdata->compact;
+	pmem[id].free_by_start = RB_ROOT;
+	pmem[id].free_by_size = RB_ROOT;
+	pmem[id].alloc_by_start = RB_ROOT;
 	pmem[id].cached = pdata->cached;
 	pmem[id].buffered = pdata->buffered;
 	pmem[id].base = pdata->start;
@@ -1256,6 +1717,20 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 	}
 	pmem[id].num_entries = pmem[id].size / PMEM_MIN_ALLOC;
 
+	if (pmem[id].best_fit && !pmem[id].no_allocator) {
+		struct pmem_extent *ext;
+
+		ext = kmalloc(sizeof(struct pmem_extent), GFP_KERNEL);
+		if (!ext)
+			goto err_no_mem_for_metadata;
+		ext->start = 0;
+		ext->len = pmem[id].num_entries;
+		pmem_extent_insert_start(&pmem[id].free_by_start, ext);
+		pmem_extent_insert_size(&pmem[id].free_by_size, ext);
+		pmem[id].bitmap = NULL;
+		goto setup_vbase;
+	}
+
 	pmem[id].bitmap = kmalloc(pmem[id].num_entries *
 				  sizeof(struct pmem_bits), GFP_KERNEL);
 	if (!pmem[id].bitmap)
@@ -1271,6 +1746,7 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 		}
 	}
 
+setup_vbase:
 	if (pmem[id].cached)
 		pmem[id].vbase = ioremap_cached(pmem[id].base,
 						pmem[id].size);
@@ -1295,6 +1771,9 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 #endif
 	return 0;
 error_cant_remap:
+	if (pmem[id].best_fit && !pmem[id].no_allocator)
+		kfree(rb_entry(rb_first(&pmem[id].free_by_start),
+			       struct pmem_extent, start_node));
 	kfree(pmem[id].bitmap);
 err_no_mem_for_metadata:
 	misc_deregister(&pmem[id].dev);
@@ -22,6 +22,9 @@
 #include <linux/cdev.h>
 #include <linux/gpio.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
 #include <asm/uaccess.h>
 
 static int micro_major = -1;
@@ -30,6 +33,11 @@ module_param(micro_major, int, 0600);
 
 MODULE_PARM_DESC(micro_major, "Major device number to use, automatically assigned if not specified");
 
+static unsigned int coalesce_us = 500;
+module_param(coalesce_us, uint, 0644);
+
+MODULE_PARM_DESC(coalesce_us, "Default window in us within which interrupts are merged into one event");
+
 static void micro_gpio_set_optional(int p, int v)
 {
 	if (p != -1)
@@ -129,6 +137,16 @@ static int micro_ioctl(struct inode *inode,
 			       (int __user *)arg);
 		break;
 
+	case IO_CAN_SET_COALESCE:
+		if ((int)arg < 0) {
+			ret = -EINVAL;
+			break;
+		}
+		spin_lock_irq(&micro->event_lock);
+		micro->coalesce_ns = (s64)arg * NSEC_PER_USEC;
+		spin_unlock_irq(&micro->event_lock);
+		break;
+
 	default:
 		printk(KERN_WARNING "CAN micro: Invalid ioctl command %u\n", cmd);
 		ret = -EINVAL;
@@ -137,14 +155,131 @@ static int micro_ioctl(struct inode *inode,
 	return ret;
 }
 
+#define MICRO_EVENT(micro, seq) (&(micro)->events[(seq) & (MICRO_EVENT_RING_SIZE - 1)])
+
+/*
+ * Queue an event for the interrupt. A burst of interrupts is merged into the
+ * newest event while it is still waiting for its first reader, so a busy bus
+ * does not overrun the queue and a reader wakes up once per burst.
+ */
 irqreturn_t micro_interrupt(int irq, void *dev)
 {
 	struct can_micro_dev *micro = dev;
+	struct micro_event *event;
+	s64 now = ktime_to_ns(ktime_get());
+	u32 head;
+
+	spin_lock(&micro->event_lock);
+
+	head = micro->event_head;
+	event = MICRO_EVENT(micro, head - 1);
+	if (head != micro->event_consumed && micro->coalesce_ns &&
+	    now - event->last <= micro->coalesce_ns) {
+		event->last = now;
+		if (event->count < 0xffff)
+			event->count++;
+		spin_unlock(&micro->event_lock);
+		return IRQ_HANDLED;
+	}
+
+	event = MICRO_EVENT(micro, head);
+	event->timestamp = now;
+	event->last = now;
+	event->sequence = head;
+	event->count = 1;
+	event->flags = 0;
+	/* vgpio pins may sit behind a bus, only sample the pin if we can */
+	if (!gpio_cansleep(micro->gpio_pin_can_resetin) &&
+	    !gpio_get_value(micro->gpio_pin_can_resetin))
+		event->flags |= MICRO_EVENT_RESET;
+	micro->event_head = head + 1;
+
+	spin_unlock(&micro->event_lock);
+
+	wake_up_interruptible(&micro->event_wait);
 	kill_fasync(&micro->fasync_listeners, SIGIO, POLL_IN);
 
 	return IRQ_HANDLED;
 }
 
+/* The read position of a file is the sequence of the next event it gets */
+static int micro_events_pending(struct can_micro_dev *micro, struct file *file)
+{
+	return (u32)file->f_pos != ACCESS_ONCE(micro->event_head);
+}
+
+static ssize_t micro_read(struct file *file, char __user *buf,
+                          size_t count, loff_t *ppos)
+{
+	struct can_micro_dev *micro = file->private_data;
+	struct micro_event batch[8];
+	unsigned long flags;
+	size_t done = 0;
+	int lost, n, ret;
+	u32 pos;
+
+	if (count < sizeof(struct micro_event))
+		return -EINVAL;
+
+	if (!micro_events_pending(micro, file)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(micro->event_wait,
+		                               micro_events_pending(micro, file));
+		if (ret)
+			return ret;
+	}
+
+	/* Copy out in batches, user memory may fault so not under the lock */
+	while (count - done >= sizeof(struct micro_event)) {
+		n = 0;
+		lost = 0;
+
+		spin_lock_irqsave(&micro->event_lock, flags);
+		pos = (u32)*ppos;
+		if (micro->event_head - pos > MICRO_EVENT_RING_SIZE) {
+			pos = micro->event_head - MICRO_EVENT_RING_SIZE;
+			lost = 1;
+		}
+		while (pos != micro->event_head && n < ARRAY_SIZE(batch) &&
+		       count - done >= (n + 1) * sizeof(struct micro_event)) {
+			batch[n] = *MICRO_EVENT(micro, pos);
+			if (lost) {
+				batch[n].flags |= MICRO_EVENT_LOST;
+				lost = 0;
+			}
+			n++;
+			pos++;
+		}
+		/* Handed out events are final, stop coalescing into them */
+		if ((s32)(pos - micro->event_consumed) > 0)
+			micro->event_consumed = pos;
+		spin_unlock_irqrestore(&micro->event_lock, flags);
+
+		if (n == 0)
+			break;
+
+		*ppos = pos;
+		if (copy_to_user(buf + done, batch, n * sizeof(struct micro_event)))
+			return done ? done : -EFAULT;
+		done += n * sizeof(struct micro_event);
+	}
+
+	return done;
+}
+
+static unsigned int micro_poll(struct file *file, poll_table *wait)
+{
+	struct can_micro_dev *micro = file->private_data;
+
+	poll_wait(file, &micro->event_wait, wait);
+
+	if (micro_events_pending(micro, file))
+		return POLLIN | POLLRDNORM;
+
+	return 0;
+}
+
 static int micro_fasync(int fd, struct file *file, int mode)
 {
 	struct can_micro_dev *micro = file->private_data;
@@ -168,9 +303,15 @@ static int micro_open(struct inode *inode, struct file *file)
 	}
 
 	file->private_data = micro;
+
+	/* Only events from now on */
+	spin_lock_irq(&micro->event_lock);
+	file->f_pos = micro->event_head;
+	spin_unlock_irq(&micro->event_lock);
+
 	micro_activate(micro);
 
-	return 0;
+	return nonseekable_open(inode, file);
 }
 
 static int micro_release(struct inode *inode, struct file *file)
@@ -188,6 +329,9 @@ static int micro_release(struct inode *inode, struct file *file)
 static struct file_operations micro_fops = {
 	.owner   = THIS_MODULE,
 	.ioctl   = micro_ioctl,
+	.read    = micro_read,
+	.poll    = micro_poll,
+	.llseek  = no_llseek,
 	.open    = micro_open,
 	.release = micro_release,
 	.fasync  = micro_fasync,
@@ -232,6 +376,12 @@ static int micro_probe(struct platform_device *pdev)
 	micro->count = 0;
 	micro->fasync_listeners = NULL;
 
+	spin_lock_init(&micro->event_lock);
+	micro->event_head = 0;
+	micro->event_consumed = 0;
+	micro->coalesce_ns = (s64)coalesce_us * NSEC_PER_USEC;
+	init_waitqueue_head(&micro->event_wait);
+
 	micro->irq = platform_get_irq_byname(pdev, "CAN IRQ");
 	if (micro->irq < 0) {
 		dev_warn(&pdev->dev, "Couldn't get CAN irq\n"); /* Not critical failure */
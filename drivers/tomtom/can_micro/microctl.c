@@ -11,6 +11,7 @@
  * 
  */
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -212,29 +213,36 @@ int sync_handler(char *cmd)
 
 int monitor_handler(char *cmd)
 {
-	int flags;
+	struct micro_event ev[16];
+	struct pollfd pfd = {
+		.fd = ctx.dev_fd,
+		.events = POLLIN,
+	};
+	ssize_t n;
+	int i;
 
-	void sigio_handler(int signum)
-	{
-		printf("Received SIGIO\n");
-	}
-	//signal(SIGIO, sigio_handler);
+	while (1) {
+		/* Report the pins when the bus is quiet */
+		i = poll(&pfd, 1, MONITOR_PERIOD * 1000);
+		if (i == -1)
+			err(EXIT_FAILURE, "Couldn't poll fd %d", ctx.dev_fd);
+		if (i == 0) {
+			printf("nRESET = %d, RESERV = %d\n", get_nreset(), get_reserve());
+			continue;
+		}
 
-	flags = fcntl(ctx.dev_fd, F_GETFL);
-	if (flags == -1)
-		err(EXIT_FAILURE, "Couldn't get fd %d flags", ctx.dev_fd);
-	if (fcntl(ctx.dev_fd, F_SETFL, flags | FASYNC) == -1)
-		err(EXIT_FAILURE, "Couldn't set fd %d flags", ctx.dev_fd);
+		n = read(ctx.dev_fd, ev, sizeof(ev));
+		if (n == -1)
+			err(EXIT_FAILURE, "Couldn't read events from fd %d", ctx.dev_fd);
 
-	while (1) {
-		sleep(MONITOR_PERIOD);
-		printf("nRESET = %d, RESERV = %d", get_nreset(), get_reserve());
+		for (i = 0; i < n / sizeof(ev[0]); i++)
+			printf("%u: %lld.%09lld +%lldns x%u%s%s\n", ev[i].sequence,
+			       ev[i].timestamp / 1000000000, ev[i].timestamp % 1000000000,
+			       ev[i].last - ev[i].timestamp, ev[i].count,
+			       ev[i].flags & MICRO_EVENT_RESET ? " reset" : "",
+			       ev[i].flags & MICRO_EVENT_LOST ? " (lost events)" : "");
 	}
 
-	if (fcntl(ctx.dev_fd, F_SETFL, flags) == -1)
-		err(EXIT_FAILURE, "Couldn't set fd %d flags", ctx.dev_fd);
-	//signal(SIGIO, SIG_DFL);
-
 	return 0;
 }
 
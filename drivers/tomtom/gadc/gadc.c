@@ -18,13 +18,22 @@
 #include <linux/timer.h>
 #include <linux/init.h>
 #include <linux/cdev.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
 #include <linux/gadc.h>
+#include <asm/uaccess.h>
+
+/* Size of the per channel sample ring, rounded up to a power of two. */
+static unsigned long int ring_samples=4096;
+module_param( ring_samples, ulong, S_IRUGO );
+MODULE_PARM_DESC( ring_samples, "Samples buffered per channel (default: 4096)" );
 
 static int gadc_open( struct inode *inode, struct file *file )
 {
 	struct gadc_cdev		*chardev=(struct gadc_cdev *) get_gadc_cdev( inode->i_cdev );
 	struct gadc_platform_interface	*pdata=(struct gadc_platform_interface *) chardev->private;
 	struct gadc_platform_channel	*channel=&(pdata->channels[(iminor( file->f_dentry->d_inode ) - chardev->minor)]);
+	int				ret;
 
 	if( pdata->is_running( channel ) )
 		return -EBUSY;
@@ -32,7 +41,18 @@ static int gadc_open( struct inode *inode, struct file *file )
 	/* Initialize data. */
 	gadc_init_buffer( channel->buffer, 1 );
 	gadc_set_samplerate( channel->buffer, 10000 );
+	ret=gadc_alloc_ring( channel->buffer, ring_samples );
+	if( ret )
+		return ret;
+
 	pdata->start_channel( channel );
+	ret=gadc_start_sampler( channel->buffer, channel, pdata->start_conversion );
+	if( ret )
+	{
+		pdata->stop_channel( channel );
+		gadc_free_ring( channel->buffer );
+		return ret;
+	}
 	file->private_data = chardev;
 	return 0;
 }
@@ -43,8 +63,10 @@ static int gadc_release(struct inode *inode, struct file *file )
 	struct gadc_platform_interface	*pdata=(struct gadc_platform_interface *) chardev->private;
 	struct gadc_platform_channel	*channel=&(pdata->channels[(iminor( file->f_dentry->d_inode ) - chardev->minor)]);
 
+	gadc_stop_sampler( channel->buffer );
 	pdata->stop_channel( channel );
 	gadc_clear_buffer( channel->buffer );
+	gadc_free_ring( channel->buffer );
 	file->private_data=NULL;
 	return 0;
 }
@@ -54,11 +76,10 @@ static unsigned gadc_poll(struct file *file, poll_table *wait)
 	struct gadc_cdev		*chardev=(struct gadc_cdev *) file->private_data;
 	struct gadc_platform_interface	*pdata=(struct gadc_platform_interface *) chardev->private;
 	struct gadc_platform_channel	*channel=&(pdata->channels[(iminor( file->f_dentry->d_inode ) - chardev->minor)]);
-	int				tmpval;
 	unsigned int			mask = 0;
 
 	gadc_poll_wait( file, channel->buffer, wait );
-	if ( gadc_get_samplecount( channel->buffer, &tmpval ) > 0 )
+	if ( gadc_get_ring_count( channel->buffer ) >= channel->buffer->watermark )
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
@@ -75,20 +96,19 @@ static int gadc_ioctl( struct inode *inode, struct file *file, unsigned int cmd,
 	switch( cmd )
 	{
 		case ADC_SET_SAMPLERATE:
-			/* We are limited by HZ and the ADC rate, so make sure the samplerate matches this. */
+			/* Conversions are started from an hrtimer, so we are only limited by the ADC rate. */
 			samplerate = (unsigned long int) arg;
-			if( samplerate > 1000 * HZ ) samplerate=1000 * HZ;
 			if( samplerate > 1000 * pdata->max_samplerate ) samplerate=1000 * pdata->max_samplerate;
 			if( samplerate == 0 )
 				return -EINVAL;
 
-			samplerate=1000 * HZ/((HZ * 1000 + (samplerate >> 1))/samplerate); 
 			gadc_set_samplerate( channel->buffer, samplerate );
 
-			/* Restart the ADC channel. Otherwise we have to wait for 1 tick. */
+			/* Restart the ADC channel. Otherwise we have to wait for 1 period. */
+			gadc_stop_sampler( channel->buffer );
 			pdata->stop_channel( channel );
 			pdata->start_channel( channel );
-			break;
+			return gadc_start_sampler( channel->buffer, channel, pdata->start_conversion );
 
 		case ADC_GET_SAMPLERATE:
 			*((unsigned long int *) arg)=gadc_get_samplerate( channel->buffer );
@@ -104,6 +124,23 @@ static int gadc_ioctl( struct inode *inode, struct file *file, unsigned int cmd,
 			copy_to_user( (void *) arg, &format, sizeof( format ) );
 			break;
 
+		case ADC_GET_RINGSIZE:
+			if( put_user( channel->buffer->ring_bytes, (unsigned long int __user *) arg ) )
+				return -EFAULT;
+			break;
+
+		case ADC_GET_OVERFLOWS:
+			if( put_user( channel->buffer->ring_overflows, (unsigned long int __user *) arg ) )
+				return -EFAULT;
+			break;
+
+		case ADC_SET_WATERMARK:
+			/* Number of samples that must be buffered before poll and blocking reads return. */
+			if( ((unsigned long int) arg == 0) || ((unsigned long int) arg > channel->buffer->ring_size) )
+				return -EINVAL;
+			channel->buffer->watermark=(unsigned long int) arg;
+			break;
+
 		default :
 			return -ENOTTY;
 	}
@@ -116,42 +153,32 @@ static ssize_t gadc_read( struct file *file, char __user *buf, size_t count, lof
 	struct gadc_cdev		*chardev=(struct gadc_cdev *) file->private_data;
 	struct gadc_platform_interface	*plat_interface=(struct gadc_platform_interface *) chardev->private;
 	struct gadc_platform_channel	*channel=&(plat_interface->channels[(iminor( file->f_dentry->d_inode ) - chardev->minor)]);
-	struct gadc_sample		sample;
-        int				samplecount;
-	int				maxbufsamples;
-	int				loop=0;
 
-	/* Determine the amount of samples that'll fit in the buffer. */
-	gadc_get_samplecount( channel->buffer, &samplecount );
+	if( count < sizeof( struct gadc_sample ) )
+		return -EINVAL;
 
 	/* If no samples are present block & wait. */
-	if( samplecount == 0 )
+	if( gadc_get_ring_count( channel->buffer ) == 0 )
 	{
 		if( !(file->f_flags & O_NONBLOCK) )
 		{
-			if( gadc_wait_buffer_fill( channel->buffer, &samplecount ) )
+			if( gadc_wait_ring_fill( channel->buffer ) )
 				return -ERESTARTSYS;
 		}
 		else return -EAGAIN;
 	}
 
-	/* Determine how many samples to read. */
-	maxbufsamples=count/sizeof( sample );
-	if( samplecount > maxbufsamples ) samplecount=maxbufsamples;
-
-	/* Copy sample by sample. Since we need to copy to user space, do this in two steps. */
-	for( loop=0; loop < samplecount; loop++ )
-	{
-		
-		if( !gadc_get_sample( channel->buffer, &sample ) )
-			break;
+	/* Hand out everything that fits in one go, not sample by sample. */
+	return gadc_read_ring( channel->buffer, buf, count );
+}
 
-		if( copy_to_user( &(((struct gadc_sample *) buf)[loop]), &sample, sizeof( sample ) ) )
-			return -EINVAL;
-	}
+static int gadc_mmap( struct file *file, struct vm_area_struct *vma )
+{
+	struct gadc_cdev		*chardev=(struct gadc_cdev *) file->private_data;
+	struct gadc_platform_interface	*pdata=(struct gadc_platform_interface *) chardev->private;
+	struct gadc_platform_channel	*channel=&(pdata->channels[(iminor( file->f_dentry->d_inode ) - chardev->minor)]);
 
-	/* Return the read bytes. */
-	return loop * sizeof( struct gadc_sample );
+	return gadc_mmap_ring( channel->buffer, vma );
 }
 
 struct file_operations gadc_fops=
@@ -159,6 +186,7 @@ struct file_operations gadc_fops=
 	.owner	=THIS_MODULE,
 	.read	=gadc_read,
 	.poll	=gadc_poll,
+	.mmap	=gadc_mmap,
 
 	.ioctl	=gadc_ioctl,
 	.open	=gadc_open,
@@ -184,6 +212,12 @@ static int gadc_probe( struct platform_device *dev )
 		return -ENODEV;
 	}
 
+	if( pdata->start_conversion == NULL )
+	{
+		printk( GADC_DRIVER_NAME": Missing start_conversion!\n" );
+		return -ENODEV;
+	}
+
 	chardev=(struct gadc_cdev *) kmalloc( sizeof( struct gadc_cdev ), GFP_KERNEL );
 	if( chardev == NULL )
 	{
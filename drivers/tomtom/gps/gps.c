@@ -18,11 +18,206 @@
 #include <linux/device.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <plat/gps.h>
 
 #define GPS_NAME	"gps" 
 #define GPS_PFX		GPS_NAME ": " 
 
+/**
+ * gps_event_ring_init	- reset an event ring and its statistics
+ * @ring:		- the ring
+ * @nominal_ns:	- period of the events if they are periodic (e.g. a 1PPS
+ *				  time pulse), up to 2s, or 0
+ */
+void gps_event_ring_init(struct gps_event_ring *ring, s64 nominal_ns)
+{
+	memset(ring, 0, sizeof(*ring));
+	spin_lock_init(&ring->lock);
+	ring->stats.nominal_ns = nominal_ns;
+	ring->stats.period_ns = nominal_ns;
+}
+EXPORT_SYMBOL(gps_event_ring_init);
+
+static void gps_event_update_stats(struct gps_event_stats *stats,
+		struct gps_event *ev)
+{
+	s64 interval = ev->raw_ns - stats->last_raw_ns;
+	s64 jitter;
+	s64 periods;
+
+	if (stats->nominal_ns) {
+		/* a gap this long is suspend or the receiver losing its fix,
+		   not jitter */
+		if (interval > 16 * stats->period_ns)
+			return;
+
+		periods = div_s64(interval + stats->period_ns / 2,
+				  (s32)stats->period_ns);
+		if (periods < 1)
+			periods = 1;
+		if (periods > 1) {
+			stats->missed += periods - 1;
+			ev->flags |= GPS_EVENT_MISSED;
+		}
+
+		/* the period estimate follows the drift of the local
+		   oscillator against GPS time */
+		jitter = interval - periods * stats->period_ns;
+		if (periods == 1)
+			stats->period_ns += div_s64(jitter, 16);
+
+		if (jitter < 0)
+			jitter = -jitter;
+		stats->sum_abs_jitter_ns += jitter;
+		if (jitter > stats->max_abs_jitter_ns)
+			stats->max_abs_jitter_ns = jitter;
+	}
+
+	if (!stats->intervals || interval < stats->min_interval_ns)
+		stats->min_interval_ns = interval;
+	if (interval > stats->max_interval_ns)
+		stats->max_interval_ns = interval;
+	stats->intervals++;
+}
+
+/**
+ * gps_event_record	- timestamp an event and queue it in a ring
+ * @ring:		- the ring
+ * @ev:			- filled in with the timestamps and sequence number
+ *
+ * Meant to be called first thing in the interrupt handler. The monotonic
+ * timestamps are immune to settimeofday(); the real time is taken in the
+ * same snapshot as the raw one, for the PPS API.
+ */
+void gps_event_record(struct gps_event_ring *ring, struct gps_event *ev)
+{
+	unsigned long flags;
+	struct timespec raw;
+	ktime_t mono;
+
+	mono = ktime_get();
+	getnstime_raw_and_real(&raw, &ev->real);
+
+	ev->monotonic_ns = ktime_to_ns(mono);
+	ev->raw_ns = timespec_to_ns(&raw);
+	ev->flags = 0;
+
+	spin_lock_irqsave(&ring->lock, flags);
+
+	if (ring->stats.last_raw_ns)
+		gps_event_update_stats(&ring->stats, ev);
+	ring->stats.last_raw_ns = ev->raw_ns;
+
+	ev->sequence = ring->sequence++;
+	ring->events[ev->sequence & (GPS_EVENT_RING_SIZE - 1)] = *ev;
+
+	spin_unlock_irqrestore(&ring->lock, flags);
+}
+EXPORT_SYMBOL(gps_event_record);
+
+/*
+ * One line per event, oldest first:
+ * <sequence> <monotonic ns> <raw ns> <real sec>.<real nsec> <flags>
+ */
+ssize_t gps_event_ring_show(struct gps_event_ring *ring, char *buf)
+{
+	struct gps_event ev;
+	unsigned long flags;
+	ssize_t len = 0;
+	u32 seq, end;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	end = ring->sequence;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	seq = (end > GPS_EVENT_RING_SIZE) ? end - GPS_EVENT_RING_SIZE : 0;
+
+	for (; seq != end; seq++) {
+		spin_lock_irqsave(&ring->lock, flags);
+		/* skip what got overwritten while printing */
+		if (ring->sequence - seq > GPS_EVENT_RING_SIZE) {
+			spin_unlock_irqrestore(&ring->lock, flags);
+			continue;
+		}
+		ev = ring->events[seq & (GPS_EVENT_RING_SIZE - 1)];
+		spin_unlock_irqrestore(&ring->lock, flags);
+
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%u %lld %lld %ld.%09ld %x\n", ev.sequence,
+				 ev.monotonic_ns, ev.raw_ns, ev.real.tv_sec,
+				 ev.real.tv_nsec, ev.flags);
+	}
+
+	return len;
+}
+EXPORT_SYMBOL(gps_event_ring_show);
+
+ssize_t gps_event_stats_show(struct gps_event_ring *ring, char *buf)
+{
+	struct gps_event_stats stats;
+	unsigned long flags;
+	u32 events;
+	u64 mean = 0;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	stats = ring->stats;
+	events = ring->sequence;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	if (stats.nominal_ns && stats.intervals)
+		mean = div_u64(stats.sum_abs_jitter_ns, stats.intervals);
+
+	return sprintf(buf, "events: %u\n"
+			    "intervals: %u\n"
+			    "missed: %u\n"
+			    "min_interval_ns: %lld\n"
+			    "max_interval_ns: %lld\n"
+			    "period_ns: %lld\n"
+			    "mean_abs_jitter_ns: %llu\n"
+			    "max_abs_jitter_ns: %lld\n",
+			    events, stats.intervals, stats.missed,
+			    stats.min_interval_ns, stats.max_interval_ns,
+			    stats.period_ns, mean, stats.max_abs_jitter_ns);
+}
+EXPORT_SYMBOL(gps_event_stats_show);
+
+void gps_event_stats_reset(struct gps_event_ring *ring)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	ring->stats.min_interval_ns = 0;
+	ring->stats.max_interval_ns = 0;
+	ring->stats.sum_abs_jitter_ns = 0;
+	ring->stats.max_abs_jitter_ns = 0;
+	ring->stats.intervals = 0;
+	ring->stats.missed = 0;
+	spin_unlock_irqrestore(&ring->lock, flags);
+}
+EXPORT_SYMBOL(gps_event_stats_reset);
+
+/**
+ * gps_device_event	- record an interrupt of the receiver
+ * @gpsd:		- the GPS device
+ * @ev:			- filled in with the event, see gps_event_record()
+ *
+ * Also keeps the timestamp returned by gps_get_timestamp() up to date.
+ */
+void gps_device_event(struct gps_device *gpsd, struct gps_event *ev)
+{
+	unsigned long flags;
+
+	gps_event_record(&gpsd->events, ev);
+
+	write_lock_irqsave(&gpsd->tv_lock, flags);
+	gpsd->props.tv.tv_sec = ev->real.tv_sec;
+	gpsd->props.tv.tv_usec = ev->real.tv_nsec / NSEC_PER_USEC;
+	write_unlock_irqrestore(&gpsd->tv_lock, flags);
+}
+EXPORT_SYMBOL(gps_device_event);
+
 void gps_get_timestamp(struct gps_device *gpsd, struct timeval *tv)
 {
 	mutex_lock(&gpsd->update_sem);
@@ -47,6 +242,26 @@ static ssize_t gps_show_timestamp(struct device *dev,
 	return sprintf(buf, "%8ld.%06ld\n", tv.tv_sec, tv.tv_usec);
 }
 
+static ssize_t gps_show_events(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return gps_event_ring_show(&to_gps_device(dev)->events, buf);
+}
+
+static ssize_t gps_show_jitter(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return gps_event_stats_show(&to_gps_device(dev)->events, buf);
+}
+
+/* any write resets the statistics */
+static ssize_t gps_store_jitter(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	gps_event_stats_reset(&to_gps_device(dev)->events);
+	return count;
+}
+
 static ssize_t gps_show_name(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -64,6 +279,8 @@ static void gps_device_release(struct device *dev)
 static struct device_attribute gps_device_attributes[] = {
 	__ATTR(name, 0444, gps_show_name, NULL),
 	__ATTR(timestamp, 0444, gps_show_timestamp, NULL),
+	__ATTR(events, 0444, gps_show_events, NULL),
+	__ATTR(jitter, 0644, gps_show_jitter, gps_store_jitter),
 	__ATTR_NULL,
 };
 
@@ -97,6 +314,7 @@ struct gps_device *gps_device_register(const char *name, struct device *parent,
 	mutex_init(&new_gpsd->ops_sem);
 
 	new_gpsd->tv_lock = RW_LOCK_UNLOCKED;
+	gps_event_ring_init(&new_gpsd->events, 0);
 
 	new_gpsd->dev.class		= gps_class;
 	new_gpsd->dev.parent	= parent;
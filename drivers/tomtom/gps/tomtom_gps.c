@@ -166,7 +166,7 @@ static struct gps_ops tomtom_gps_ops = {
 
 static irqreturn_t tomtom_gps_irq_handler(int irq, void *dev_id)
 {
-	unsigned long		flags;
+	struct gps_event	ev;
 	struct gps_device	*gpsd = NULL;
 
 	BUG_ON(!dev_id);
@@ -174,9 +174,7 @@ static irqreturn_t tomtom_gps_irq_handler(int irq, void *dev_id)
 	gpsd = platform_get_drvdata((struct platform_device *)dev_id);
 	BUG_ON(!gpsd);
 
-	write_lock_irqsave(&gpsd->tv_lock, flags);
-	do_gettimeofday(&gpsd->props.tv);
-	write_unlock_irqrestore(&gpsd->tv_lock, flags);
+	gps_device_event(gpsd, &ev);
 
 	return IRQ_HANDLED;
 }
@@ -22,6 +22,7 @@
 #include <linux/err.h>
 #include <linux/ktime.h>
 #include <linux/pps_kernel.h>
+#include <plat/gps.h>
 
 #define DRIVER_DESC_LONG	"TomTom - PPS driver, (C) 2010 TomTom BV "
 #define PFX 			"tomtom-pps: "
@@ -29,29 +30,31 @@
 
 //#define DEBUG_PPS
 
-/* PPS driver data, containing source id and irq */
+/* PPS driver data, containing source id, irq and the pulses seen */
 struct pps_driver_data {
 	int source;
 	int irq;
+	struct gps_event_ring events;
 };
 
 static irqreturn_t pps_irq_handler(int irq, void *dev_id)
 {
 	struct platform_device *pdev = (struct platform_device *) dev_id;
 	struct pps_driver_data *pps_priv = platform_get_drvdata(pdev);
-	struct timespec ts;
+	struct gps_event ev;
 	struct pps_ktime pps_ts;
 
 	/* acquire timestamp */
-	ktime_get_ts(&ts);
+	gps_event_record(&pps_priv->events, &ev);
 
 #ifdef DEBUG_PPS
-	dev_info(&pdev->dev, "[ source = %d ] PPS event at %llu\n", pps_priv->source, get_jiffies_64());
+	dev_info(&pdev->dev, "[ source = %d ] PPS event %u at %lld\n", pps_priv->source, ev.sequence, ev.monotonic_ns);
 #endif
 
-	/* and translate it to PPS time data struct */
-	pps_ts.sec = ts.tv_sec;
-	pps_ts.nsec = ts.tv_nsec;
+	/* and translate it to PPS time data struct, the PPS API (and NTP)
+	   works on the time of day */
+	pps_ts.sec = ev.real.tv_sec;
+	pps_ts.nsec = ev.real.tv_nsec;
 
 	pps_event(pps_priv->source, &pps_ts, PPS_CAPTUREASSERT, NULL);
 
@@ -69,6 +72,46 @@ static struct pps_source_info pps_info = {
 	.owner		= THIS_MODULE,
 };
 
+static ssize_t pps_show_events(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct pps_driver_data *pps_priv = dev_get_drvdata(dev);
+
+	return gps_event_ring_show(&pps_priv->events, buf);
+}
+
+static ssize_t pps_show_jitter(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct pps_driver_data *pps_priv = dev_get_drvdata(dev);
+
+	return gps_event_stats_show(&pps_priv->events, buf);
+}
+
+/* any write resets the statistics */
+static ssize_t pps_store_jitter(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct pps_driver_data *pps_priv = dev_get_drvdata(dev);
+
+	gps_event_stats_reset(&pps_priv->events);
+	return count;
+}
+
+static DEVICE_ATTR(events, 0444, pps_show_events, NULL);
+static DEVICE_ATTR(jitter, 0644, pps_show_jitter, pps_store_jitter);
+
+static struct attribute *pps_attributes[] = {
+	&dev_attr_events.attr,
+	&dev_attr_jitter.attr,
+	NULL
+};
+
+static const struct attribute_group pps_attr_group = {
+	.attrs = pps_attributes,
+};
+
 static int pps_probe(struct platform_device *pdev)
 {
 	int res;
@@ -83,6 +126,7 @@ static int pps_probe(struct platform_device *pdev)
 		goto err_allocate_mem;
 	}
 	memset(pps_priv, 0, sizeof(*pps_priv));
+	gps_event_ring_init(&pps_priv->events, NSEC_PER_SEC);
 
 	if ((res = pps_register_source(&pps_info, PPS_CAPTUREASSERT | PPS_OFFSETASSERT)) < 0) {
 		dev_err(&pdev->dev, "cannot register pps source\n");
@@ -109,10 +153,17 @@ static int pps_probe(struct platform_device *pdev)
 		goto err_request_irq;
 	}
 
+	if ((res = sysfs_create_group(&pdev->dev.kobj, &pps_attr_group))) {
+		dev_err(&pdev->dev, "unable to create sysfs attributes\n");
+		goto err_sysfs;
+	}
+
 	dev_info(&pdev->dev, "successfully registered pps source at %d.\n", pps_priv->source);
 
 	return  0;
 
+err_sysfs:
+	free_irq(pps_priv->irq, pdev);
 err_request_irq:
 	platform_set_drvdata(pdev, NULL);
 err_get_resource:
@@ -129,6 +180,7 @@ static int pps_remove(struct platform_device *pdev)
 
 	dev_info(&pdev->dev, "unregistering pps source %d.\n", pps_priv->source);
 
+	sysfs_remove_group(&pdev->dev.kobj, &pps_attr_group);
 	free_irq(pps_priv->irq, pdev);
 	platform_set_drvdata(pdev, NULL);
 	pps_unregister_source(pps_priv->source);
@@ -24,6 +24,7 @@
 #include <linux/ewts98.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/sensor_stream.h>
 #include <linux/types.h>
 #include <linux/wait.h>
 
@@ -85,6 +86,7 @@ struct ewts98
 		wait_queue_head_t wq;
 		struct hrtimer timer;
 		int wake_up;
+		ktime_t stamp;	/* when sampling was triggered */
 	} worker;
 
 	/* (micro-)radians/s per ADC count */
@@ -99,6 +101,7 @@ struct ewts98
 	struct input_dev *input;
 	char phys[32];
 	struct regulator *regulator;
+	struct sensor_stream_source stream;
 
 #ifdef CONFIG_EARLYSUSPEND
 	struct early_suspend early_suspend;
@@ -126,6 +129,9 @@ static int __ewts98_enable(struct ewts98 *ewts98)
 		goto err_reg_enable;
 	}
 
+	sensor_stream_start(&ewts98->stream,
+		(s64)ewts98->pdata->sample_rate * NSEC_PER_MSEC);
+
 	/* start the timer that triggers sampling */
 	hrtimer_start(&ewts98->worker.timer,
 		ns_to_ktime(ewts98->pdata->sample_rate * 1000 * 1000),
@@ -202,26 +208,46 @@ static inline int ewts98_calc_average(struct ewts98 *ewts98, ewts98_axis_t axis)
 	return sum / ewts98->pdata->averaging.num_samples;
 }
 
-static void ewts98_report_value(struct ewts98 *ewts98, ewts98_axis_t axis, int adc_value)
+static int ewts98_adc_to_mrad_s(struct ewts98 *ewts98, ewts98_axis_t axis, int adc_value)
 {
-	int ev_code;
 	int zero_point_offset;
 	int urad_s_per_count;
-	int mrad_per_sec;
 
 	if (axis == EWTS98_AXIS_X) {
-		ev_code = ABS_X;
 		zero_point_offset = ewts98->pdata->adc_x.zero_point_offset;
 		urad_s_per_count = ewts98->adc_x_urad_s_per_count;
 	} else {
-		ev_code = ABS_Y;
 		zero_point_offset = ewts98->pdata->adc_y.zero_point_offset;
 		urad_s_per_count = ewts98->adc_y_urad_s_per_count;
 	}
 
-	mrad_per_sec = ((adc_value - zero_point_offset) * urad_s_per_count) / 1000;
+	return ((adc_value - zero_point_offset) * urad_s_per_count) / 1000;
+}
+
+static void ewts98_report_value(struct ewts98 *ewts98, ewts98_axis_t axis, int adc_value)
+{
+	const int ev_code = ((axis == EWTS98_AXIS_X) ? ABS_X : ABS_Y);
 
-	input_event(ewts98->input, EV_ABS, ev_code, mrad_per_sec);
+	input_event(ewts98->input, EV_ABS, ev_code,
+		ewts98_adc_to_mrad_s(ewts98, axis, adc_value));
+}
+
+/* every sample goes to the stream, there is no FIFO to batch them: the
+   stream's watermark limits the wakeups of the reader */
+static void ewts98_stream_sample(struct ewts98 *ewts98, struct ewts98_adc_values *adc_values,
+				ktime_t stamp)
+{
+	s32 sample[1][3];
+
+	if ((adc_values->x == EWTS98_INVALID_VALUE) ||
+		(adc_values->y == EWTS98_INVALID_VALUE))
+		return;
+
+	sample[0][0] = ewts98_adc_to_mrad_s(ewts98, EWTS98_AXIS_X, adc_values->x);
+	sample[0][1] = ewts98_adc_to_mrad_s(ewts98, EWTS98_AXIS_Y, adc_values->y);
+	sample[0][2] = 0; /* two axis sensor */
+
+	sensor_stream_push(&ewts98->stream, sample, 1, 0, stamp);
 }
 
 static void ewts98_log_adc_error(struct ewts98 *ewts98, int adc_error)
@@ -268,6 +294,8 @@ static int ewts98_worker(void *data)
 			if (adc_status)
 				ewts98_log_adc_error(ewts98, adc_status);
 
+			ewts98_stream_sample(ewts98, &adc_values, ewts98->worker.stamp);
+
 			/* we continue in case of errors, but take care that only values
 			   read from the ADCs are reported */
 
@@ -316,6 +344,7 @@ static enum hrtimer_restart ewts98_trigger_sampling(struct hrtimer *hrtimer)
 
 	hrtimer_forward_now(hrtimer, ns_to_ktime(ewts98->pdata->sample_rate * 1000 * 1000));
 
+	ewts98->worker.stamp = ktime_get();
 	ewts98->worker.wake_up = 1;
 	wake_up(&ewts98->worker.wq);
 
@@ -521,6 +550,7 @@ static int ewts98_probe(struct platform_device *pdev)
 
 #ifdef CONFIG_EARLYSUSPEND
 	ewts98->early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB;
+	ewts98->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	ewts98->early_suspend.suspend = ewts98_early_suspend;
 	ewts98->early_suspend.resume = ewts98_early_resume;
 
@@ -534,6 +564,10 @@ static int ewts98_probe(struct platform_device *pdev)
 		goto err_sysfs_disabled;
 	}
 
+	ewts98->stream.name = DRIVER_NAME;
+	ewts98->stream.type = SENSOR_STREAM_GYRO;
+	sensor_stream_register(&ewts98->stream);
+
 	/* create input device */
 	rc = etws98_create_input_dev(ewts98);
 	if (rc)
@@ -542,6 +576,7 @@ static int ewts98_probe(struct platform_device *pdev)
 	return 0;
 
 err_create_input_dev:
+	sensor_stream_unregister(&ewts98->stream);
 	device_remove_file(ewts98->dev, &dev_attr_disabled);
 
 #ifdef CONFIG_EARLYSUSPEND
@@ -577,6 +612,8 @@ static int ewts98_remove(struct platform_device *pdev)
 	/* wait for the worker thread to exit */
 	kthread_stop(ewts98->worker.thread);
 
+	sensor_stream_unregister(&ewts98->stream);
+
 	input_unregister_device(ewts98->input);
 	input_free_device(ewts98->input);
 
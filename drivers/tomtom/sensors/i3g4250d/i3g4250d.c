@@ -45,6 +45,8 @@
 #include <linux/spinlock.h>
 #include <linux/poll.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/sensor_stream.h>
 
 
 #include <linux/input/i3g4250d.h>
@@ -117,6 +119,8 @@
 
 #define I2C_AUTO_INCREMENT	(0x80)
 
+#define I3G4250D_FIFO_DEPTH	32
+
 /* RESUME STATE INDICES */
 #define RES_CTRL_REG1		0
 #define RES_CTRL_REG2		1
@@ -154,14 +158,15 @@ struct i3g4250d_triple {
 struct output_rate {
 	int poll_rate_ms;
 	u8 mask;
+	int hz;
 };
 
 static const struct output_rate odr_table[] = {
 
-	{	2,	ODR840|BW10},
-	{	3,	ODR420|BW01},
-	{	6,	ODR208|BW00},
-	{	11,	ODR105|BW00},
+	{	2,	ODR840|BW10,	840},
+	{	3,	ODR420|BW01,	420},
+	{	6,	ODR208|BW00,	208},
+	{	11,	ODR105|BW00,	105},
 };
 
 static struct i3g4250d_platform_data default_i3g4250d_pdata = {
@@ -216,6 +221,10 @@ struct i3g4250d_status {
 
 	struct i3g4250d_triple data_sum;
 	u8 sample_count;
+
+	struct sensor_stream_source stream;
+	int odr_hz;
+	ktime_t irq2_stamp;
 #ifdef CONFIG_EARLYSUSPEND
 	struct early_suspend early_suspend;
 #endif
@@ -545,6 +554,7 @@ static int i3g4250d_manage_int2settings(struct i3g4250d_status *stat,
 
 	switch (fifomode) {
 	case FIFO_MODE_FIFO:
+	case FIFO_MODE_STREAM:
 		recognized_mode = true;
 
 		if (stat->polling_enabled) {
@@ -691,6 +701,9 @@ static int i3g4250d_update_odr(struct i3g4250d_status *stat,
 			return err;
 		stat->resume_state[RES_CTRL_REG1] = config[1];
 		stat->ktime = ktime_set(0, MS_TO_NS(poll_interval_ms));
+		stat->odr_hz = odr_table[i].hz;
+		sensor_stream_start(&stat->stream,
+				NSEC_PER_SEC / stat->odr_hz);
 	}
 
 	return err;
@@ -735,23 +748,14 @@ static int i3g4250d_get_data(struct i3g4250d_status *stat,
 	return err;
 }
 
-static int i3g4250d_get_data_fifo(struct i3g4250d_status *stat,
-			     struct i3g4250d_triple *data)
+/* one FIFO sample as read from OUT_Y_L on, i.e. Y, Z and then X */
+static void i3g4250d_convert_fifo(struct i3g4250d_status *stat,
+			const unsigned char *gyro_out,
+			struct i3g4250d_triple *data)
 {
-	int err;
-	unsigned char gyro_out[6];
 	/* y,p,r hardware data */
 	s32 hw_d[3] = { 0 };
 
-	// Dummy read (see: A3G4250D datasheet, section 3.2.4)
-	err = i3g4250d_register_read(stat, gyro_out, AXISDATA_REG);
-
-	gyro_out[0] = (OUT_Y_L);
-	err = i3g4250d_i2c_read(stat, gyro_out, 6);
-
-	if (err < 0)
-		return err;
-
 	hw_d[0] = (s32) ((s16)((gyro_out[5]) << 8) | gyro_out[4]);
 	hw_d[1] = (s32) ((s16)((gyro_out[1]) << 8) | gyro_out[0]);
 	hw_d[2] = (s32) ((s16)((gyro_out[3]) << 8) | gyro_out[2]);
@@ -766,10 +770,92 @@ static int i3g4250d_get_data_fifo(struct i3g4250d_status *stat,
 		   : (hw_d[stat->pdata->axis_map_y]));
 	data->z = ((stat->pdata->negate_z) ? (-hw_d[stat->pdata->axis_map_z])
 		   : (hw_d[stat->pdata->axis_map_z]));
+}
+
+static int i3g4250d_get_data_fifo(struct i3g4250d_status *stat,
+			     struct i3g4250d_triple *data)
+{
+	int err;
+	unsigned char gyro_out[6];
+
+	// Dummy read (see: A3G4250D datasheet, section 3.2.4)
+	err = i3g4250d_register_read(stat, gyro_out, AXISDATA_REG);
+
+	gyro_out[0] = (OUT_Y_L);
+	err = i3g4250d_i2c_read(stat, gyro_out, 6);
+
+	if (err < 0)
+		return err;
+
+	i3g4250d_convert_fifo(stat, gyro_out, data);
 
 	return err;
 }
 
+/*
+ * Drain the FIFO into data[] and the sensor stream, call with stat->lock
+ * held. The address rolls over from OUT_Z_H to OUT_X_L and pops the next
+ * sample, so after the dummy read all stored samples come in one burst
+ * (the SMBus block read is limited to 32 bytes, there it's one per sample).
+ * 'stamp' is the time of the newest sample, or of the one that crossed the
+ * watermark if at_watermark is set. Returns the number of samples read.
+ */
+static int i3g4250d_read_fifo(struct i3g4250d_status *stat,
+			struct i3g4250d_triple *data, ktime_t stamp,
+			bool at_watermark)
+{
+	unsigned char raw[I3G4250D_FIFO_DEPTH * 6];
+	s32 samples[I3G4250D_FIFO_DEPTH][3];
+	u8 buf[2];
+	int anchor;
+	int err;
+	int n;
+	int i;
+
+	err = i3g4250d_register_read(stat, buf, FIFO_SRC_REG);
+	if (err < 0) {
+		dev_err(&stat->client->dev, "error reading fifo source reg\n");
+		return err;
+	}
+
+	n = buf[0] & FIFO_STORED_DATA_MASK;
+	if ((n == 31) && (buf[0] & FIFO_OVRN_MASK))
+		n = I3G4250D_FIFO_DEPTH;
+	if (n == 0)
+		return 0;
+
+	if (stat->use_smbus) {
+		for (i = 0; i < n; i++) {
+			err = i3g4250d_get_data_fifo(stat, &data[i]);
+			if (err < 0)
+				return err;
+		}
+	} else {
+		// Dummy read (see: A3G4250D datasheet, section 3.2.4)
+		err = i3g4250d_register_read(stat, buf, AXISDATA_REG);
+		if (err < 0)
+			return err;
+
+		err = sensor_stream_i2c_burst(stat->client,
+				I2C_AUTO_INCREMENT | OUT_Y_L, raw, n * 6);
+		if (err < 0)
+			return err;
+
+		for (i = 0; i < n; i++)
+			i3g4250d_convert_fifo(stat, &raw[i * 6], &data[i]);
+	}
+
+	for (i = 0; i < n; i++) {
+		samples[i][0] = data[i].x;
+		samples[i][1] = data[i].y;
+		samples[i][2] = data[i].z;
+	}
+	anchor = at_watermark ? min(n, stat->watermark + 1) - 1 : n - 1;
+	sensor_stream_push(&stat->stream, samples, n, anchor, stamp);
+
+	return n;
+}
+
 static void i3g4250d_report_values(struct i3g4250d_status *stat,
 					struct i3g4250d_triple *data, bool updateTimestamp)
 {
@@ -920,8 +1006,11 @@ static int i3g4250d_enable(struct i3g4250d_status *stat)
 			stat->sample_count = 0;
 			// Give hardware some time to settle...
 			msleep(200);
+			// Stream mode: no samples are lost between two polls
+			i3g4250d_update_fifomode(stat, FIFO_MODE_STREAM);
+			sensor_stream_start(&stat->stream,
+					NSEC_PER_SEC / stat->odr_hz);
 			hrtimer_start(&(stat->hr_timer), stat->ktime, HRTIMER_MODE_REL);
-			i3g4250d_update_fifomode(stat, FIFO_MODE_FIFO);
 		}
 	}
 
@@ -1310,12 +1399,10 @@ static void i3g4250d_report_triple(struct i3g4250d_status *stat)
 
 static void i3g4250d_irq2_fifo(struct i3g4250d_status *stat)
 {
-	int err;
-	u8 buf[2];
-	u8 int_source;
-	u8 samples;
+	struct i3g4250d_triple data[I3G4250D_FIFO_DEPTH];
+	int samples;
+	int i;
 	u8 workingmode;
-	u8 stored_samples;
 
 	mutex_lock(&stat->lock);
 
@@ -1335,33 +1422,21 @@ static void i3g4250d_irq2_fifo(struct i3g4250d_status *stat)
 		break;
 	}
 	case FIFO_MODE_FIFO:
-		samples = (stat->watermark)+1;
-		dev_dbg(&stat->client->dev,
-			"%s : FIFO_SRC_REG init samples:%d\n",
-							__func__, samples);
-		err = i3g4250d_register_read(stat, buf, FIFO_SRC_REG);
-		if (err < 0)
+	case FIFO_MODE_STREAM:
+		samples = i3g4250d_read_fifo(stat, data, stat->irq2_stamp,
+								true);
+		if (samples < 0)
 			dev_err(&stat->client->dev,
-					"error reading fifo source reg\n");
-
-		int_source = buf[0];
-		dev_dbg(&stat->client->dev, "%s :FIFO_SRC_REG content:0x%02x\n",
-							__func__, int_source);
-
-		stored_samples = int_source & FIFO_STORED_DATA_MASK;
-		dev_dbg(&stat->client->dev, "%s : fifomode:0x%02x\n", __func__,
-						stat->fifomode);
+					"error reading fifo: %d\n", samples);
 
-		dev_dbg(&stat->client->dev, "%s : samples:%d stored:%d\n",
-				__func__, samples, stored_samples);
+		dev_dbg(&stat->client->dev, "%s : fifomode:0x%02x samples:%d\n",
+					__func__, stat->fifomode, samples);
 
-		for (; samples > 0; samples--) {
-			dev_dbg(&stat->client->dev, "%s : current sample:%d\n",
-							__func__, samples);
+		for (i = 0; i < samples; i++)
+			i3g4250d_report_values(stat, &data[i], true);
 
-			i3g4250d_report_triple(stat);
-		}
-		i3g4250d_fifo_reset(stat);
+		if (workingmode == FIFO_MODE_FIFO)
+			i3g4250d_fifo_reset(stat);
 		break;
 	}
 
@@ -1372,6 +1447,7 @@ static irqreturn_t i3g4250d_isr2(int irq, void *dev)
 {
 	struct i3g4250d_status *stat = dev;
 
+	stat->irq2_stamp = ktime_get();
 	disable_irq_nosync(irq);
 	queue_work(stat->irq2_work_queue, &stat->irq2_work);
 	pr_debug("%s %s: isr2 queued\n", I3G4250D_DEV_NAME, __func__);
@@ -1488,10 +1564,11 @@ static int i3g4250d_validate_pdata(struct i3g4250d_status *stat)
 static void poll_function_work(struct work_struct *polling_task)
 {
 	struct i3g4250d_status *stat;
+	struct i3g4250d_triple data[I3G4250D_FIFO_DEPTH];
 	struct i3g4250d_triple data_out;
 	struct i3g4250d_triple data_sum;
-	u8 buf[2];
-	u8 nr_of_samples;
+	s32 sample[1][3];
+	int nr_of_samples;
 	int err, i;
 
 	stat = container_of((struct work_struct *)polling_task,
@@ -1499,18 +1576,16 @@ static void poll_function_work(struct work_struct *polling_task)
 
 	mutex_lock(&stat->lock);
 
-	if (stat->fifomode == FIFO_MODE_FIFO)
+	if (stat->fifomode != FIFO_MODE_BYPASS)
 	{
 		// Read FIFO asynchronously according Technical Note TN1189 from ST
-		err = i3g4250d_register_read(stat, buf, FIFO_SRC_REG);
-		if (err < 0)
-			dev_err(&stat->client->dev, "error reading fifo source reg\n");
-
-		nr_of_samples = buf[0] & FIFO_STORED_DATA_MASK;
-		dev_dbg(&stat->client->dev, "%s :FIFO_SRC_REG = 0x%02x -> nrOfSamples=%d\n",
-							__func__, buf[0], nr_of_samples);
-
-		if (nr_of_samples == 0)
+		nr_of_samples = i3g4250d_read_fifo(stat, data, ktime_get(),
+								false);
+		if (nr_of_samples < 0)
+		{
+			dev_err(&stat->client->dev, "get_gyroscope_data failed\n");
+		}
+		else if (nr_of_samples == 0)
 		{
 			dev_warn(&stat->client->dev, "fifo empty...\n");
 		}
@@ -1518,22 +1593,11 @@ static void poll_function_work(struct work_struct *polling_task)
 		{
 			data_sum.x = data_sum.y = data_sum.z = 0;
 
-			if ((nr_of_samples == 31) && (buf[0] & FIFO_OVRN_MASK))
+			for (i = 0; i < nr_of_samples; i++)
 			{
-				nr_of_samples = 32;
-			}
-			// Empty the FIFO
-			for (i=nr_of_samples; i > 0; i--)
-			{
-				err = i3g4250d_get_data_fifo(stat, &data_out);
-				if (err < 0)
-					dev_err(&stat->client->dev, "get_gyroscope_data failed\n");
-				else
-				{
-					data_sum.x += data_out.x;
-					data_sum.y += data_out.y;
-					data_sum.z += data_out.z;
-				}
+				data_sum.x += data[i].x;
+				data_sum.y += data[i].y;
+				data_sum.z += data[i].z;
 			}
 			// Calculate average values
 			data_out.x = data_sum.x / nr_of_samples;
@@ -1542,7 +1606,9 @@ static void poll_function_work(struct work_struct *polling_task)
 			data_out.ts = (u64)((stat->ts.tv_sec*1000) + (stat->ts.tv_nsec/1000000));
 			i3g4250d_report_values(stat, &data_out, false);
 
-			i3g4250d_fifo_reset(stat);
+			// Stream mode keeps sampling, FIFO mode stopped when full
+			if (stat->fifomode == FIFO_MODE_FIFO)
+				i3g4250d_fifo_reset(stat);
 		}
 	}
 	else // FIFO_BYPASS
@@ -1552,6 +1618,12 @@ static void poll_function_work(struct work_struct *polling_task)
 			dev_err(&stat->client->dev, "get_rotation_data failed.\n");
 		}
 		else {
+			sample[0][0] = data_out.x;
+			sample[0][1] = data_out.y;
+			sample[0][2] = data_out.z;
+			sensor_stream_push(&stat->stream, sample, 1, 0,
+						timespec_to_ktime(stat->ts));
+
 			stat->data_sum.x += data_out.x;
 			stat->data_sum.y += data_out.y;
 			stat->data_sum.z += data_out.z;
@@ -1690,6 +1762,10 @@ static int i3g4250d_probe(struct i2c_client *client,
 	stat->pdata->poll_interval = 200;
 	dev_info(&client->dev, "FIFO polling mode enabled, interval is 200 ms\n");
 
+	stat->stream.name = I3G4250D_DEV_NAME;
+	stat->stream.type = SENSOR_STREAM_GYRO;
+	sensor_stream_register(&stat->stream);
+
 	err = i3g4250d_device_power_on(stat);
 	if (err < 0) {
 		dev_err(&client->dev, "power on failed: %d\n", err);
@@ -1759,6 +1835,7 @@ static int i3g4250d_probe(struct i2c_client *client,
 	}
 #ifdef CONFIG_EARLYSUSPEND
 	stat->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN;
+	stat->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	stat->early_suspend.suspend = i3g4250d_early_suspend;
 	stat->early_suspend.resume = i3g4250d_early_resume;
 	register_early_suspend(&stat->early_suspend);
@@ -1785,6 +1862,7 @@ err4:
 err3:
 	i3g4250d_device_power_off(stat);
 err2:
+	sensor_stream_unregister(&stat->stream);
 	if (stat->pdata->exit)
 		stat->pdata->exit();
 err1_1:
@@ -1829,6 +1907,7 @@ static int i3g4250d_remove(struct i2c_client *client)
 	}
 
 	i3g4250d_disable(stat);
+	sensor_stream_unregister(&stat->stream);
 
 	misc_deregister(&i3g4250d_device);
 
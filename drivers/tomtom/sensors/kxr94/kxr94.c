@@ -24,6 +24,7 @@
 #include <linux/kxr94.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/sensor_stream.h>
 #include <linux/spi/spi.h>
 #include <linux/types.h>
 #include <linux/wait.h>
@@ -129,6 +130,7 @@ struct kxr94
 		wait_queue_head_t wq;
 		struct hrtimer timer;
 		int wake_up;
+		ktime_t stamp;	/* when sampling was triggered */
 	} worker;
 
 	struct {
@@ -144,6 +146,7 @@ struct kxr94
 	struct input_dev *input;
 	char phys[32];
 	struct regulator_bulk_data supplies[KXR94_NUM_SUPPLIES];
+	struct sensor_stream_source stream;
 
 #ifdef CONFIG_EARLYSUSPEND
 	struct early_suspend early_suspend;
@@ -183,6 +186,8 @@ static int __kxr94_enable(struct kxr94 *kxr94)
 
 	kxr94_set_mode(kxr94, KXR94_MODE_ON);
 
+	sensor_stream_start(&kxr94->stream, (s64)kxr94->pdata->sample_rate * NSEC_PER_MSEC);
+
 	/* start the timer that triggers sampling */
 	hrtimer_start(&kxr94->worker.timer, ns_to_ktime(kxr94->pdata->sample_rate * 1000 * 1000),
 		HRTIMER_MODE_REL);
@@ -337,6 +342,25 @@ static inline uint16_t kxr94_calc_average(struct kxr94 *kxr94, int channel)
 	return avg;
 }
 
+/* every sample goes to the stream, there is no FIFO to batch them: the
+   stream's watermark limits the wakeups of the reader */
+static void kxr94_stream_sample(struct kxr94 *kxr94, ktime_t stamp)
+{
+	s32 sample[1][3];
+	int i;
+
+	for (i = 0; i < KXR94_NUM_AXIS; i++) {
+		const uint16_t adc_value = kxr94->async_spi.context[i].adc_value;
+
+		if (adc_value == KXR94_INVALID_VALUE)
+			return;
+
+		sample[0][i] = kxr94_adc_to_si(kxr94, adc_value);
+	}
+
+	sensor_stream_push(&kxr94->stream, sample, 1, 0, stamp);
+}
+
 static int kxr94_worker(void *data)
 {
 	struct kxr94 *kxr94 = (struct kxr94 *)data;
@@ -349,12 +373,14 @@ static int kxr94_worker(void *data)
 			/* normal work */
 
 			int i;
+			ktime_t stamp;
 
 			/* race condition alert: the timer could have expired
 			   again and set wake_up to 1. in this unlikely case we
 			   would loose one sample, we are aware of this and can
 			   live with it */
 			kxr94->worker.wake_up = 0;
+			stamp = kxr94->worker.stamp;
 
 			mutex_lock(&kxr94->lock);
 
@@ -383,6 +409,8 @@ static int kxr94_worker(void *data)
 			if (atomic_read(&kxr94->async_spi.transfers_completed) == KXR94_NUM_CHANNELS) {
 				mutex_lock(&kxr94->lock);
 
+				kxr94_stream_sample(kxr94, stamp);
+
 				for (i = 0; i < KXR94_NUM_CHANNELS; i++) {
 					const uint16_t adc_value = kxr94->async_spi.context[i].adc_value;
 
@@ -433,6 +461,7 @@ static enum hrtimer_restart kxr94_trigger_sampling(struct hrtimer *hrtimer)
 
 	hrtimer_forward_now(hrtimer, ns_to_ktime(kxr94->pdata->sample_rate * 1000 * 1000));
 
+	kxr94->worker.stamp = ktime_get();
 	kxr94->worker.wake_up = 1;
 	wake_up(&kxr94->worker.wq);
 
@@ -664,6 +693,7 @@ static int kxr94_probe(struct spi_device *spi)
 
 #ifdef CONFIG_EARLYSUSPEND
 	kxr94->early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB;
+	kxr94->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	kxr94->early_suspend.suspend = kxr94_early_suspend;
 	kxr94->early_suspend.resume = kxr94_early_resume;
 
@@ -677,6 +707,10 @@ static int kxr94_probe(struct spi_device *spi)
 		goto err_sysfs_disabled;
 	}
 
+	kxr94->stream.name = DRIVER_NAME;
+	kxr94->stream.type = SENSOR_STREAM_ACCEL;
+	sensor_stream_register(&kxr94->stream);
+
 	/* create input device */
 	rc = kxr94_create_input_dev(kxr94);
 	if (rc)
@@ -685,6 +719,7 @@ static int kxr94_probe(struct spi_device *spi)
 	return 0;
 
 err_create_input_dev:
+	sensor_stream_unregister(&kxr94->stream);
 	device_remove_file(kxr94->dev, &dev_attr_disabled);
 
 #ifdef CONFIG_EARLYSUSPEND
@@ -714,6 +749,8 @@ static int kxr94_remove(struct spi_device *spi)
 	/* wait for the worker thread to exit */
 	kthread_stop(kxr94->worker.thread);
 
+	sensor_stream_unregister(&kxr94->stream);
+
 	input_unregister_device(kxr94->input);
 	input_free_device(kxr94->input);
 
@@ -1684,6 +1684,7 @@ static int l3gd20_gyr_probe(struct i2c_client *client,
 	}
 #ifdef CONFIG_EARLYSUSPEND
 	stat->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN;
+	stat->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	stat->early_suspend.suspend = l3gd20_gyr_early_suspend;
 	stat->early_suspend.resume = l3gd20_gyr_early_resume;
 	register_early_suspend(&stat->early_suspend);
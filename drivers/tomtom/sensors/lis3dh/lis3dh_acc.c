@@ -69,6 +69,8 @@
 #include	<linux/module.h>
 #include	<linux/regulator/consumer.h>
 #include	<linux/earlysuspend.h>
+#include	<linux/ktime.h>
+#include	<linux/sensor_stream.h>
 
 #undef	DEBUG
 #define	USE_HRTIMER
@@ -106,6 +108,7 @@
 #define	CTRL_REG6		0x25	/*	control reg 6		*/
 
 #define	FIFO_CTRL_REG		0x2E	/*	FiFo control reg	*/
+#define	FIFO_SRC_REG		0x2F	/*	FiFo source reg		*/
 
 #define	INT_CFG1		0x30	/*	interrupt 1 config	*/
 #define	INT_SRC1		0x31	/*	interrupt 1 source	*/
@@ -152,6 +155,8 @@
 /* */
 /* CTRL REG BITS*/
 #define	CTRL_REG3_I1_AOI1	0x40
+#define	CTRL_REG3_I1_WTM	0x04
+#define	CTRL_REG5_FIFO_EN	0x40
 #define	CTRL_REG6_I2_TAPEN	0x80
 #define	CTRL_REG6_HLACTIVE	0x02
 /* */
@@ -165,6 +170,17 @@
 #define	TAP_TW_MASK		NO_MASK
 
 
+/* FIFO_CTRL_REG / FIFO_SRC_REG BITS */
+#define	FIFO_MODE_BYPASS	0x00
+#define	FIFO_MODE_STREAM	0x80
+#define	FIFO_WTM_MASK		0x1F
+#define	FIFO_SRC_WTM		0x80
+#define	FIFO_SRC_OVRN		0x40
+#define	FIFO_SRC_FSS_MASK	0x1F
+
+#define	LIS3DH_FIFO_DEPTH	32
+#define	LIS3DH_FIFO_WATERMARK	24	/* leaves 8 samples of I2C latency */
+
 /* TAP_SOURCE_REG BIT */
 #define	DTAP			0x20
 #define	STAP			0x10
@@ -209,17 +225,24 @@
 struct {
 	unsigned int cutoff_ms;
 	unsigned int mask;
+	unsigned int hz;
 } lis3dh_acc_odr_table[] = {
-		{    1, ODR1250 },
-		{    3, ODR400  },
-		{    5, ODR200  },
-		{   10, ODR100  },
-		{   20, ODR50   },
-		{   40, ODR25   },
-		{  100, ODR10   },
-		{ 1000, ODR1    },
+		{    1, ODR1250, 1250 },
+		{    3, ODR400,   400 },
+		{    5, ODR200,   200 },
+		{   10, ODR100,   100 },
+		{   20, ODR50,     50 },
+		{   40, ODR25,     25 },
+		{  100, ODR10,     10 },
+		{ 1000, ODR1,       1 },
 };
 
+/* drain the FIFO from the INT1 watermark interrupt, or from the poll if
+   INT1 is not wired */
+static int use_fifo = 1;
+module_param(use_fifo, int, S_IRUGO);
+MODULE_PARM_DESC(use_fifo, "Buffer samples in the FIFO, drained on the INT1 watermark when wired (default: 1)");
+
 struct lis3dh_acc_data {
 	struct i2c_client *client;
 	struct lis3dh_acc_platform_data *pdata;
@@ -259,6 +282,13 @@ struct lis3dh_acc_data {
 
 	int xyz_sum[3];
 	u8 sample_count;
+
+	struct sensor_stream_source stream;
+	int fifo;
+	int fifo_irq;
+	u8 fifo_watermark;
+	unsigned int odr_hz;
+	ktime_t irq1_stamp;
 #ifdef DEBUG
 	u8 reg_addr;
 #endif
@@ -510,17 +540,17 @@ static void lis3dh_acc_device_power_off(struct lis3dh_acc_data *acc)
 	if (err < 0)
 		dev_err(&acc->client->dev, "soft power off failed: %d\n", err);
 
-	if (acc->pdata->gpio_int1)
+	if (acc->pdata->gpio_int1 >= 0)
 		disable_irq_nosync(acc->irq1);
-	if (acc->pdata->gpio_int2)
+	if (acc->pdata->gpio_int2 >= 0)
 		disable_irq_nosync(acc->irq2);
 
 	lis3dh_acc_config_regulator(acc, false);
 
 	if (acc->hw_initialized) {
-		if (acc->pdata->gpio_int1)
+		if (acc->pdata->gpio_int1 >= 0)
 			disable_irq_nosync(acc->irq1);
-		if (acc->pdata->gpio_int2)
+		if (acc->pdata->gpio_int2 >= 0)
 			disable_irq_nosync(acc->irq2);
 		acc->hw_initialized = 0;
 	}
@@ -561,10 +591,15 @@ static int lis3dh_acc_device_power_on(struct lis3dh_acc_data *acc)
 	return 0;
 }
 
+static void lis3dh_acc_drain_fifo(struct lis3dh_acc_data *acc, ktime_t stamp,
+				  int irq);
+
 static irqreturn_t lis3dh_acc_isr1(int irq, void *dev)
 {
 	struct lis3dh_acc_data *acc = dev;
 
+	/* as close to the watermark sample as we get */
+	acc->irq1_stamp = ktime_get();
 	disable_irq_nosync(irq);
 	queue_work(acc->irq1_work_queue, &acc->irq1_work);
 #ifdef DEBUG
@@ -590,6 +625,13 @@ static void lis3dh_acc_irq1_work_func(struct work_struct *work)
 
 	struct lis3dh_acc_data *acc =
 	container_of(work, struct lis3dh_acc_data, irq1_work);
+
+	if (acc->fifo_irq) {
+		mutex_lock(&acc->lock);
+		lis3dh_acc_drain_fifo(acc, acc->irq1_stamp, 1);
+		mutex_unlock(&acc->lock);
+		goto exit;
+	}
 	/* TODO  add interrupt service procedure.
 		 ie:lis3dh_acc_get_int1_source(acc); */
 	;
@@ -692,7 +734,10 @@ int lis3dh_acc_update_odr(struct lis3dh_acc_data *acc, int poll_interval_ms)
 		if (lis3dh_acc_odr_table[i].cutoff_ms <= poll_interval_ms)
 			break;
 	}
+	if (i < 0)
+		i = 0;
 	config[1] = lis3dh_acc_odr_table[i].mask;
+	acc->odr_hz = lis3dh_acc_odr_table[i].hz;
 
 	config[1] |= LIS3DH_ACC_ENABLE_ALL_AXES;
 
@@ -704,6 +749,9 @@ int lis3dh_acc_update_odr(struct lis3dh_acc_data *acc, int poll_interval_ms)
 		if (err < 0)
 			goto error;
 		acc->resume_state[RES_CTRL_REG1] = config[1];
+		if (acc->fifo)
+			sensor_stream_start(&acc->stream,
+					NSEC_PER_SEC / acc->odr_hz);
 	}
 
 	return err;
@@ -732,20 +780,12 @@ static int lis3dh_acc_register_write(struct lis3dh_acc_data *acc, u8 *buf,
 	return err;
 }
 
-static int lis3dh_acc_get_acceleration_data(struct lis3dh_acc_data *acc,
-		int *xyz)
+static void lis3dh_acc_convert(struct lis3dh_acc_data *acc,
+		const u8 *acc_data, int *xyz)
 {
-	int err = -1;
-	/* Data bytes from hardware xL, xH, yL, yH, zL, zH */
-	u8 acc_data[6];
 	/* x,y,z hardware data */
 	s16 hw_d[3] = { 0 };
 
-	acc_data[0] = (I2C_AUTO_INCREMENT | AXISDATA_REG);
-	err = lis3dh_acc_i2c_read(acc, acc_data, 6);
-	if (err < 0)
-		return err;
-
 	hw_d[0] = (((s16) ((acc_data[1] << 8) | acc_data[0])) >> 4);
 	hw_d[1] = (((s16) ((acc_data[3] << 8) | acc_data[2])) >> 4);
 	hw_d[2] = (((s16) ((acc_data[5] << 8) | acc_data[4])) >> 4);
@@ -761,6 +801,21 @@ static int lis3dh_acc_get_acceleration_data(struct lis3dh_acc_data *acc,
 		   : (hw_d[acc->pdata->axis_map_y]));
 	xyz[2] = ((acc->pdata->negate_z) ? (-hw_d[acc->pdata->axis_map_z])
 		   : (hw_d[acc->pdata->axis_map_z]));
+}
+
+static int lis3dh_acc_get_acceleration_data(struct lis3dh_acc_data *acc,
+		int *xyz)
+{
+	int err = -1;
+	/* Data bytes from hardware xL, xH, yL, yH, zL, zH */
+	u8 acc_data[6];
+
+	acc_data[0] = (I2C_AUTO_INCREMENT | AXISDATA_REG);
+	err = lis3dh_acc_i2c_read(acc, acc_data, 6);
+	if (err < 0)
+		return err;
+
+	lis3dh_acc_convert(acc, acc_data, xyz);
 
 	return err;
 }
@@ -780,16 +835,152 @@ static void lis3dh_acc_report_values(struct lis3dh_acc_data *acc,
 #endif
 }
 
+/* average avg_samples samples into one input event, call with acc->lock held */
+static void lis3dh_acc_accumulate(struct lis3dh_acc_data *acc, int *xyz)
+{
+	acc->xyz_sum[0] += xyz[0];
+	acc->xyz_sum[1] += xyz[1];
+	acc->xyz_sum[2] += xyz[2];
+	acc->sample_count += 1;
+
+	if (acc->sample_count == acc->pdata->avg_samples) {
+		xyz[0] = acc->xyz_sum[0] / acc->sample_count;
+		xyz[1] = acc->xyz_sum[1] / acc->sample_count;
+		xyz[2] = acc->xyz_sum[2] / acc->sample_count;
+		lis3dh_acc_report_values(acc, xyz);
+
+		acc->xyz_sum[0] = 0;
+		acc->xyz_sum[1] = 0;
+		acc->xyz_sum[2] = 0;
+		acc->sample_count = 0;
+	}
+}
+
+/* polled sample, timestamped now, call with acc->lock held */
+static void lis3dh_acc_poll_sample(struct lis3dh_acc_data *acc)
+{
+	s32 sample[1][3];
+	int xyz[3] = { 0 };
+	ktime_t stamp = ktime_get();
+	int err;
+
+	/* without INT1 the poll picks up whatever the FIFO collected */
+	if (acc->fifo) {
+		lis3dh_acc_drain_fifo(acc, stamp, 0);
+		return;
+	}
+
+	err = lis3dh_acc_get_acceleration_data(acc, xyz);
+	if (err < 0) {
+		dev_err(&acc->client->dev, "get_acceleration_data failed\n");
+		return;
+	}
+
+	sample[0][0] = xyz[0];
+	sample[0][1] = xyz[1];
+	sample[0][2] = xyz[2];
+	sensor_stream_push(&acc->stream, sample, 1, 0, stamp);
+
+	lis3dh_acc_accumulate(acc, xyz);
+}
+
+/*
+ * In FIFO mode the LIS3DH rolls the register address back from OUT_Z_H to
+ * OUT_X_L, so the whole FIFO is read in a single auto-increment burst.
+ * INT1 is edge triggered and only rises again once the FIFO went below the
+ * watermark, so keep draining while it's still above. A poll reads what is
+ * there once, the newest sample being about as old as the poll.
+ * Call with acc->lock held.
+ */
+static void lis3dh_acc_drain_fifo(struct lis3dh_acc_data *acc, ktime_t stamp,
+				  int irq)
+{
+	u8 raw[LIS3DH_FIFO_DEPTH * 6];
+	s32 samples[LIS3DH_FIFO_DEPTH][3];
+	int xyz[3];
+	int first = 1;
+	int anchor;
+	int err;
+	int n;
+	int i;
+	u8 src;
+
+	for (;;) {
+		src = FIFO_SRC_REG;
+		err = lis3dh_acc_i2c_read(acc, &src, 1);
+		if (err < 0)
+			break;
+
+		if (!first && !(src & FIFO_SRC_WTM))
+			break;
+
+		n = src & FIFO_SRC_FSS_MASK;
+		if (src & FIFO_SRC_OVRN)
+			n = LIS3DH_FIFO_DEPTH;
+		if (n == 0)
+			break;
+
+		err = sensor_stream_i2c_burst(acc->client,
+				I2C_AUTO_INCREMENT | AXISDATA_REG, raw, n * 6);
+		if (err < 0) {
+			dev_err(&acc->client->dev, "fifo read failed: %d\n",
+					err);
+			break;
+		}
+
+		for (i = 0; i < n; i++) {
+			lis3dh_acc_convert(acc, &raw[i * 6], xyz);
+			samples[i][0] = xyz[0];
+			samples[i][1] = xyz[1];
+			samples[i][2] = xyz[2];
+			lis3dh_acc_accumulate(acc, xyz);
+		}
+
+		/* the sample going over the watermark raised the interrupt,
+		   on later rounds the newest one is about as old as the
+		   FIFO_SRC read */
+		anchor = (first && irq) ?
+				min(n, acc->fifo_watermark + 1) - 1 : n - 1;
+		sensor_stream_push(&acc->stream, samples, n, anchor, stamp);
+
+		if (!irq)
+			break;
+
+		first = 0;
+		stamp = ktime_get();
+	}
+}
+
+static void lis3dh_acc_set_fifo_state(struct lis3dh_acc_data *acc, int on)
+{
+	if (on) {
+		if (acc->fifo_irq)
+			acc->resume_state[RES_CTRL_REG3] |= CTRL_REG3_I1_WTM;
+		acc->resume_state[RES_CTRL_REG5] |= CTRL_REG5_FIFO_EN;
+		acc->resume_state[RES_FIFO_CTRL_REG] = FIFO_MODE_STREAM |
+				(acc->fifo_watermark & FIFO_WTM_MASK);
+	} else {
+		acc->resume_state[RES_CTRL_REG3] &= ~CTRL_REG3_I1_WTM;
+		acc->resume_state[RES_CTRL_REG5] &= ~CTRL_REG5_FIFO_EN;
+		acc->resume_state[RES_FIFO_CTRL_REG] = FIFO_MODE_BYPASS;
+	}
+}
+
 static int lis3dh_acc_enable(struct lis3dh_acc_data *acc)
 {
 	int err;
 
 	if (!atomic_cmpxchg(&acc->enabled, 0, 1)) {
+		/* hw_init programs the FIFO from the resume state */
+		lis3dh_acc_set_fifo_state(acc, acc->fifo);
 		err = lis3dh_acc_device_power_on(acc);
 		if (err < 0) {
 			atomic_set(&acc->enabled, 0);
 			return err;
 		}
+		sensor_stream_start(&acc->stream, NSEC_PER_SEC / acc->odr_hz);
+		if (acc->fifo_irq)
+			return 0;
 #ifdef USE_HRTIMER
 		hrtimer_start(&acc->worker.timer,
 			ktime_set(0, acc->pdata->poll_interval * 1000000),
@@ -806,12 +997,14 @@ static int lis3dh_acc_enable(struct lis3dh_acc_data *acc)
 static int lis3dh_acc_disable(struct lis3dh_acc_data *acc)
 {
 	if (atomic_cmpxchg(&acc->enabled, 1, 0)) {
+		if (!acc->fifo_irq) {
 #ifdef USE_HRTIMER
-		hrtimer_cancel(&acc->worker.timer);
-		acc->worker.wake_up = 0;
+			hrtimer_cancel(&acc->worker.timer);
+			acc->worker.wake_up = 0;
 #else
-		cancel_delayed_work_sync(&acc->input_work);
+			cancel_delayed_work_sync(&acc->input_work);
 #endif
+		}
 		lis3dh_acc_device_power_off(acc);
 	}
 
@@ -912,6 +1105,46 @@ static ssize_t attr_set_polling_rate(struct device *dev,
 	return size;
 }
 
+static ssize_t attr_get_fifo_watermark(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	int val;
+	struct lis3dh_acc_data *acc = dev_get_drvdata(dev);
+	mutex_lock(&acc->lock);
+	val = acc->fifo_watermark;
+	mutex_unlock(&acc->lock);
+	return snprintf(buf, 8, "%d\n", val);
+}
+
+static ssize_t attr_set_fifo_watermark(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t size)
+{
+	struct lis3dh_acc_data *acc = dev_get_drvdata(dev);
+	unsigned long wtm;
+	u8 config[2];
+	int err = 0;
+
+	if (strict_strtoul(buf, 10, &wtm))
+		return -EINVAL;
+	if (wtm < 1 || wtm >= LIS3DH_FIFO_DEPTH)
+		return -EINVAL;
+
+	mutex_lock(&acc->lock);
+	acc->fifo_watermark = wtm;
+	if (acc->fifo && atomic_read(&acc->enabled)) {
+		config[0] = FIFO_CTRL_REG;
+		config[1] = FIFO_MODE_STREAM | (wtm & FIFO_WTM_MASK);
+		err = lis3dh_acc_i2c_write(acc, config, 1);
+		if (err >= 0)
+			acc->resume_state[RES_FIFO_CTRL_REG] = config[1];
+	}
+	mutex_unlock(&acc->lock);
+
+	return (err < 0) ? err : size;
+}
+
 static ssize_t attr_get_range(struct device *dev,
 			       struct device_attribute *attr, char *buf)
 {
@@ -1149,6 +1382,8 @@ static struct device_attribute attributes[] = {
 			attr_set_avg_samples),
 	__ATTR(pollrate_ms, 0666, attr_get_polling_rate,
 			attr_set_polling_rate),
+	__ATTR(fifo_watermark, 0666, attr_get_fifo_watermark,
+			attr_set_fifo_watermark),
 	__ATTR(range, 0666, attr_get_range, attr_set_range),
 	__ATTR(enable, 0666, attr_get_enable, attr_set_enable),
 	__ATTR(int1_config, 0666, attr_get_intconfig1, attr_set_intconfig1),
@@ -1200,8 +1435,6 @@ static int remove_sysfs_interfaces(struct device *dev)
 static int lis3dh_worker(void *data)
 {
 	struct lis3dh_acc_data *acc = (struct lis3dh_acc_data *)data;
-	int xyz[3] = { 0 };
-	int err;
 
 	do {
 		wait_event_interruptible(acc->worker.wq,
@@ -1210,28 +1443,7 @@ static int lis3dh_worker(void *data)
 		if (acc->worker.wake_up) {
 			acc->worker.wake_up = 0;
 			mutex_lock(&acc->lock);
-
-			err = lis3dh_acc_get_acceleration_data(acc, xyz);
-			if (err < 0) {
-				dev_err(&acc->client->dev, "get_acceleration_data failed\n");
-			} else {
-				acc->xyz_sum[0] += xyz[0];
-				acc->xyz_sum[1] += xyz[1];
-				acc->xyz_sum[2] += xyz[2];
-				acc->sample_count += 1;
-
-				if (acc->sample_count == acc->pdata->avg_samples) {
-					xyz[0] = acc->xyz_sum[0] / acc->sample_count;
-					xyz[1] = acc->xyz_sum[1] / acc->sample_count;
-					xyz[2] = acc->xyz_sum[2] / acc->sample_count;
-					lis3dh_acc_report_values(acc, xyz);
-
-					acc->xyz_sum[0] = 0;
-					acc->xyz_sum[1] = 0;
-					acc->xyz_sum[2] = 0;
-					acc->sample_count = 0;
-				}
-			}
+			lis3dh_acc_poll_sample(acc);
 			mutex_unlock(&acc->lock);
 		}
 	} while (!kthread_should_stop());
@@ -1261,32 +1473,11 @@ static void lis3dh_acc_input_work_func(struct work_struct *work)
 {
 	struct lis3dh_acc_data *acc;
 
-	int xyz[3] = { 0 };
-	int err;
-
 	acc = container_of((struct delayed_work *)work,
 			struct lis3dh_acc_data,	input_work);
 
 	mutex_lock(&acc->lock);
-	err = lis3dh_acc_get_acceleration_data(acc, xyz);
-	if (err < 0) {
-		dev_err(&acc->client->dev, "get_acceleration_data failed\n");
-	} else {
-		acc->xyz_sum[0] += xyz[0];
-		acc->xyz_sum[1] += xyz[1];
-		acc->xyz_sum[2] += xyz[2];
-		acc->sample_count += 1;
-		if (acc->sample_count == acc->pdata->avg_samples) {
-			xyz[0] = acc->xyz_sum[0] / acc->sample_count;
-			xyz[1] = acc->xyz_sum[1] / acc->sample_count;
-			xyz[2] = acc->xyz_sum[2] / acc->sample_count;
-			lis3dh_acc_report_values(acc, xyz);
-			acc->xyz_sum[0] = 0;
-			acc->xyz_sum[1] = 0;
-			acc->xyz_sum[2] = 0;
-			acc->sample_count = 0;
-		}
-	}
+	lis3dh_acc_poll_sample(acc);
 
 	schedule_delayed_work(&acc->input_work, msecs_to_jiffies(
 			acc->pdata->poll_interval));
@@ -1575,10 +1766,18 @@ static int lis3dh_acc_probe(struct i2c_client *client,
 	acc->resume_state[RES_TT_TLAT] = 0x00;
 	acc->resume_state[RES_TT_TW] = 0x00;
 
+	acc->fifo = use_fifo;
+	acc->fifo_irq = acc->fifo && acc->pdata->gpio_int1 >= 0;
+	acc->fifo_watermark = LIS3DH_FIFO_WATERMARK;
+
+	acc->stream.name = LIS3DH_ACC_DEV_NAME;
+	acc->stream.type = SENSOR_STREAM_ACCEL;
+	sensor_stream_register(&acc->stream);
+
 	err = lis3dh_acc_device_power_on(acc);
 	if (err < 0) {
 		dev_err(&client->dev, "power on failed: %d\n", err);
-		goto err_pdata_init;
+		goto err_stream_unregister;
 	}
 
 	atomic_set(&acc->enabled, 1);
@@ -1653,6 +1852,7 @@ static int lis3dh_acc_probe(struct i2c_client *client,
 	}
 #ifdef CONFIG_EARLYSUSPEND
 	acc->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN;
+	acc->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	acc->early_suspend.suspend = lis3dh_acc_early_suspend;
 	acc->early_suspend.resume = lis3dh_acc_early_resume;
 	register_early_suspend(&acc->early_suspend);
@@ -1677,6 +1877,8 @@ err_input_cleanup:
 	lis3dh_acc_input_cleanup(acc);
 err_power_off:
 	lis3dh_acc_device_power_off(acc);
+err_stream_unregister:
+	sensor_stream_unregister(&acc->stream);
 err_pdata_init:
 	if (acc->pdata->exit)
 		acc->pdata->exit();
@@ -1711,6 +1913,7 @@ static int __devexit lis3dh_acc_remove(struct i2c_client *client)
 
 	lis3dh_acc_input_cleanup(acc);
 	lis3dh_acc_device_power_off(acc);
+	sensor_stream_unregister(&acc->stream);
 	remove_sysfs_interfaces(&client->dev);
 
 	if (acc->pdata->exit)
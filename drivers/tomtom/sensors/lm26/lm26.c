@@ -244,6 +244,7 @@ static int lm26_probe(struct platform_device *pdev)
 
 #ifdef CONFIG_EARLYSUSPEND
 	lm26->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN;
+	lm26->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	lm26->early_suspend.suspend = lm26_early_suspend;
 	lm26->early_suspend.resume = lm26_early_resume;
 	register_early_suspend(&lm26->early_suspend);
@@ -656,6 +656,7 @@ static int ms5607_probe(struct spi_device *spi)
 
 #ifdef CONFIG_EARLYSUSPEND
 	ms5607->early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB;
+	ms5607->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	ms5607->early_suspend.suspend = ms5607_early_suspend;
 	ms5607->early_suspend.resume = ms5607_early_resume;
 
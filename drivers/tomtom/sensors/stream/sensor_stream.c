@@ -0,0 +1,385 @@
+/*
+ * drivers/tomtom/sensors/stream/sensor_stream.c
+ *
+ * Shared sample stream for the motion sensors
+ *
+ * The accelerometer and gyroscope drivers push their samples, with
+ * timestamps, into a single ring which is read through /dev/sensor_stream.
+ * Sensors with a hardware FIFO drain it in bursts from their watermark
+ * interrupt; the core spreads the samples of a burst over time using the
+ * sample period it measures between bursts, so a reader gets one time-ordered
+ * stream of all motion data at a few wakeups per second.
+ *
+ * Copyright (C) 2012 TomTom International BV
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <linux/fs.h>
+#include <linux/i2c.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/sensor_stream.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+
+#define DRIVER_DESC	"Motion sensor sample stream"
+
+static unsigned int ring_samples = 4096;
+module_param(ring_samples, uint, S_IRUGO);
+MODULE_PARM_DESC(ring_samples, "Samples buffered for all sources together, rounded up to a power of two (default: 4096)");
+
+static struct {
+	struct sensor_stream_sample *ring;
+	unsigned long size;
+
+	/* head is advanced by the producers under lock, tail only by the
+	   (single) reader, which never takes the lock */
+	unsigned long head;
+	unsigned long tail;
+	spinlock_t lock;
+
+	unsigned long watermark;
+	unsigned long dropped;
+	wait_queue_head_t wait;
+	atomic_t opened;
+
+	struct mutex sources_lock;
+	struct list_head sources;
+	u16 next_id;
+} stream;
+
+static inline unsigned long sensor_stream_count(void)
+{
+	return ACCESS_ONCE(stream.head) - stream.tail;
+}
+
+int sensor_stream_register(struct sensor_stream_source *src)
+{
+	mutex_lock(&stream.sources_lock);
+	src->id = stream.next_id++;
+	src->last = ktime_set(0, 0);
+	src->period_ns = 0;
+	src->dropped = 0;
+	list_add_tail(&src->list, &stream.sources);
+	mutex_unlock(&stream.sources_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(sensor_stream_register);
+
+void sensor_stream_unregister(struct sensor_stream_source *src)
+{
+	mutex_lock(&stream.sources_lock);
+	list_del(&src->list);
+	mutex_unlock(&stream.sources_lock);
+}
+EXPORT_SYMBOL(sensor_stream_unregister);
+
+/*
+  (re)start timestamping of a source, e.g. after it was enabled or its output
+  data rate changed. period_ns is the nominal sample period, it is refined
+  from the actual bursts later on
+*/
+void sensor_stream_start(struct sensor_stream_source *src, s64 period_ns)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&stream.lock, flags);
+	src->last = ktime_set(0, 0);
+	src->period_ns = period_ns;
+	spin_unlock_irqrestore(&stream.lock, flags);
+}
+EXPORT_SYMBOL(sensor_stream_start);
+
+/*
+  refine the period estimate from the time between the newest sample of the
+  previous burst and the anchor of this one. the sensor's oscillator is
+  typically a few percent off, which adds up over a FIFO of 32 samples.
+  measurements that are far off (suspend, FIFO overrun) are ignored
+*/
+static void sensor_stream_update_period(struct sensor_stream_source *src,
+					int anchor, ktime_t stamp)
+{
+	s64 measured;
+
+	if (!src->last.tv64 || !src->period_ns)
+		return;
+
+	measured = div_s64(ktime_to_ns(ktime_sub(stamp, src->last)), anchor + 1);
+	if (measured < src->period_ns / 2 || measured > src->period_ns * 2)
+		return;
+
+	src->period_ns += div_s64(measured - src->period_ns, 8);
+}
+
+void sensor_stream_push(struct sensor_stream_source *src,
+			const s32 (*xyz)[3], int n, int anchor, ktime_t stamp)
+{
+	struct sensor_stream_sample *sample;
+	unsigned long flags;
+	unsigned long head;
+	ktime_t ts;
+	int i;
+
+	if (n <= 0 || stream.ring == NULL)
+		return;
+
+	spin_lock_irqsave(&stream.lock, flags);
+
+	sensor_stream_update_period(src, anchor, stamp);
+
+	head = stream.head;
+	for (i = 0; i < n; i++) {
+		ts = ktime_add_ns(stamp, (i - anchor) * src->period_ns);
+
+		/* keep the timestamps of a source strictly increasing, even
+		   if the period estimate is still settling */
+		if (src->last.tv64 && ts.tv64 <= src->last.tv64)
+			ts = ktime_add_ns(src->last, 1);
+		src->last = ts;
+
+		if (head - ACCESS_ONCE(stream.tail) >= stream.size) {
+			/* full: drop the newest, the reader owns the rest */
+			src->dropped++;
+			stream.dropped++;
+			continue;
+		}
+
+		sample = &stream.ring[head & (stream.size - 1)];
+		sample->timestamp = ktime_to_ns(ts);
+		sample->source = src->id;
+		sample->type = src->type;
+		sample->x = xyz[i][0];
+		sample->y = xyz[i][1];
+		sample->z = xyz[i][2];
+		head++;
+	}
+
+	/* samples must be visible before the reader sees the new head */
+	smp_wmb();
+	stream.head = head;
+
+	spin_unlock_irqrestore(&stream.lock, flags);
+
+	if (sensor_stream_count() >= stream.watermark)
+		wake_up_interruptible(&stream.wait);
+}
+EXPORT_SYMBOL(sensor_stream_push);
+
+int sensor_stream_i2c_burst(struct i2c_client *client, u8 reg, u8 *buf,
+			    int len)
+{
+	int rc;
+	struct i2c_msg msgs[] = {
+		{
+			.addr	= client->addr,
+			.flags	= client->flags & I2C_M_TEN,
+			.len	= 1,
+			.buf	= &reg,
+		},
+		{
+			.addr	= client->addr,
+			.flags	= (client->flags & I2C_M_TEN) | I2C_M_RD,
+			.len	= len,
+			.buf	= buf,
+		},
+	};
+
+	rc = i2c_transfer(client->adapter, msgs, ARRAY_SIZE(msgs));
+	if (rc == ARRAY_SIZE(msgs))
+		return 0;
+
+	return (rc < 0) ? rc : -EIO;
+}
+EXPORT_SYMBOL(sensor_stream_i2c_burst);
+
+static int sensor_stream_open(struct inode *inode, struct file *file)
+{
+	/* lock-free reading needs a single reader */
+	if (atomic_cmpxchg(&stream.opened, 0, 1))
+		return -EBUSY;
+
+	return nonseekable_open(inode, file);
+}
+
+static int sensor_stream_release(struct inode *inode, struct file *file)
+{
+	atomic_set(&stream.opened, 0);
+
+	return 0;
+}
+
+static ssize_t sensor_stream_read(struct file *file, char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	const size_t sample_size = sizeof(struct sensor_stream_sample);
+	unsigned long head, tail, first, n;
+	int rc;
+
+	if (count < sample_size)
+		return -EINVAL;
+
+	if (file->f_flags & O_NONBLOCK) {
+		if (sensor_stream_count() == 0)
+			return -EAGAIN;
+	} else {
+		rc = wait_event_interruptible(stream.wait,
+				sensor_stream_count() >= stream.watermark);
+		if (rc)
+			return rc;
+	}
+
+	head = ACCESS_ONCE(stream.head);
+	tail = stream.tail;
+
+	/* read the samples only after seeing the head that covers them */
+	smp_rmb();
+
+	n = min_t(unsigned long, head - tail, count / sample_size);
+	first = min_t(unsigned long, n, stream.size - (tail & (stream.size - 1)));
+
+	/* at most two copies, one on either side of the wrap */
+	if (copy_to_user(buf, &stream.ring[tail & (stream.size - 1)],
+			 first * sample_size))
+		return -EFAULT;
+	if (n > first && copy_to_user(buf + first * sample_size,
+				      &stream.ring[0], (n - first) * sample_size))
+		return -EFAULT;
+
+	/* done with the slots before handing them back to the producers */
+	smp_mb();
+	stream.tail = tail + n;
+
+	return n * sample_size;
+}
+
+static unsigned int sensor_stream_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &stream.wait, wait);
+
+	if (sensor_stream_count() >= stream.watermark)
+		return POLLIN | POLLRDNORM;
+
+	return 0;
+}
+
+static long sensor_stream_ioctl(struct file *file, unsigned int cmd,
+				unsigned long arg)
+{
+	struct sensor_stream_source_info info;
+	struct sensor_stream_source *src;
+	u32 val;
+	int i;
+
+	switch (cmd) {
+	case SENSOR_STREAM_SET_WATERMARK:
+		if (get_user(val, (u32 __user *)arg))
+			return -EFAULT;
+		if (val == 0 || val > stream.size)
+			return -EINVAL;
+		stream.watermark = val;
+		return 0;
+
+	case SENSOR_STREAM_GET_DROPPED:
+		return put_user((u32)stream.dropped, (u32 __user *)arg);
+
+	case SENSOR_STREAM_GET_SOURCE:
+		if (copy_from_user(&info, (void __user *)arg, sizeof(info)))
+			return -EFAULT;
+
+		i = 0;
+		mutex_lock(&stream.sources_lock);
+		list_for_each_entry(src, &stream.sources, list) {
+			if (i++ != info.source)
+				continue;
+
+			info.source = src->id;
+			info.type = src->type;
+			info.period_ns = (u32)src->period_ns;
+			info.dropped = (u32)src->dropped;
+			strlcpy(info.name, src->name, sizeof(info.name));
+			mutex_unlock(&stream.sources_lock);
+
+			return copy_to_user((void __user *)arg, &info,
+					    sizeof(info)) ? -EFAULT : 0;
+		}
+		mutex_unlock(&stream.sources_lock);
+		return -ENOENT;
+	}
+
+	return -ENOTTY;
+}
+
+static const struct file_operations sensor_stream_fops = {
+	.owner		= THIS_MODULE,
+	.open		= sensor_stream_open,
+	.release	= sensor_stream_release,
+	.read		= sensor_stream_read,
+	.poll		= sensor_stream_poll,
+	.unlocked_ioctl	= sensor_stream_ioctl,
+};
+
+static struct miscdevice sensor_stream_device = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= SENSOR_STREAM_DEV_NAME,
+	.fops	= &sensor_stream_fops,
+};
+
+static int __init sensor_stream_init(void)
+{
+	int rc;
+
+	pr_info(DRIVER_DESC "\n");
+
+	if (ring_samples == 0)
+		return -EINVAL;
+
+	stream.size = roundup_pow_of_two(ring_samples);
+	stream.ring = vmalloc(stream.size * sizeof(*stream.ring));
+	if (stream.ring == NULL)
+		return -ENOMEM;
+
+	spin_lock_init(&stream.lock);
+	init_waitqueue_head(&stream.wait);
+	mutex_init(&stream.sources_lock);
+	INIT_LIST_HEAD(&stream.sources);
+	atomic_set(&stream.opened, 0);
+	stream.watermark = 1;
+
+	rc = misc_register(&sensor_stream_device);
+	if (rc) {
+		pr_err(SENSOR_STREAM_DEV_NAME ": failed to register device: %d\n", rc);
+		vfree(stream.ring);
+		stream.ring = NULL;
+	}
+
+	return rc;
+}
+
+static void __exit sensor_stream_exit(void)
+{
+	misc_deregister(&sensor_stream_device);
+	vfree(stream.ring);
+}
+
+/* after the misc class, before the sensor drivers that register with us */
+fs_initcall(sensor_stream_init);
+module_exit(sensor_stream_exit);
+
+MODULE_DESCRIPTION(DRIVER_DESC);
+MODULE_LICENSE("GPL");
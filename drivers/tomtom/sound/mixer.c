@@ -0,0 +1,671 @@
+/* drivers/tomtom/sound/mixer.c
+ *
+ * Kernel mixer for navigation prompts. Adds a playback PCM ("TomTom mixer")
+ * whose substreams are not sent to the hardware themselves: they are
+ * resampled to the rate of the main playback stream (the carrier) and added
+ * to each of its periods from the DMA period interrupt, just before the DMA
+ * reaches that period. A prompt therefore starts within two periods of the
+ * carrier instead of a full buffer, and no userspace mixing process is
+ * involved. The carrier is ducked while a prompt plays.
+ *
+ * Mixing happens in place in the carrier's ring, so it only works while the
+ * carrier runs; starting a mixer stream without a running carrier fails with
+ * -EBUSY and a running one gets an XRUN when the carrier stops.
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#include <sound/core.h>
+#include <sound/pcm.h>
+#include <sound/pcm_params.h>
+#include <sound/soc.h>
+
+#include <plat/tt_mixer.h>
+
+#define TT_MIXER_STREAMS	2	/* 0: prompts, ducks the carrier; 1: effects */
+#define TT_MIXER_UNITY		0x10000	/* gains and resampler phase are Q16 */
+#define TT_MIXER_MAX_FRAMES	4096	/* largest carrier period we mix into */
+#define TT_MIXER_BUFFER_BYTES	(64 * 1024)
+
+/* polyphase resampler: 8 taps, 32 phases */
+#define TT_MIXER_TAPS		8
+#define TT_MIXER_PHASE_BITS	5
+
+static int pcm_device = 7;
+module_param(pcm_device, int, S_IRUGO);
+MODULE_PARM_DESC(pcm_device, "PCM device number of the mixer on the sound card (default: 7)");
+
+static unsigned int duck_ramp_ms = 20;
+module_param(duck_ramp_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(duck_ramp_ms, "Time for the carrier to fade to and from the duck level (default: 20ms)");
+
+/*
+ * Kaiser windowed sinc (beta 5, cutoff 0.45 of the input rate), one row per
+ * phase, Q15, every row sums to 32768. Tap k weighs the k-th oldest frame of
+ * the history; phase 0 is centred on tap 3. The cutoff is relative to the
+ * input rate, which suits the usual case of a prompt at a lower rate than the
+ * carrier; a stream at a higher rate than the carrier is not band limited.
+ */
+static const s16 tt_mixer_filter[1 << TT_MIXER_PHASE_BITS][TT_MIXER_TAPS] = {
+	{    646,  -1688,   2786,  29371,   2786,  -1688,    646,    -91 },
+	{    574,  -1425,   1940,  29339,   3680,  -1955,    718,   -103 },
+	{    503,  -1168,   1142,  29224,   4617,  -2223,    789,   -116 },
+	{    433,   -918,    394,  29025,   5593,  -2489,    858,   -128 },
+	{    366,   -677,   -303,  28741,   6607,  -2751,    925,   -140 },
+	{    301,   -446,   -947,  28379,   7653,  -3007,    987,   -152 },
+	{    238,   -227,  -1537,  27936,   8727,  -3252,   1045,   -162 },
+	{    180,    -22,  -2072,  27418,   9824,  -3485,   1097,   -172 },
+	{    125,    169,  -2552,  26824,  10941,  -3701,   1142,   -180 },
+	{     75,    345,  -2976,  26160,  12071,  -3899,   1179,   -187 },
+	{     28,    506,  -3346,  25429,  13209,  -4074,   1207,   -191 },
+	{    -13,    650,  -3662,  24635,  14349,  -4223,   1225,   -193 },
+	{    -51,    778,  -3925,  23784,  15487,  -4344,   1231,   -192 },
+	{    -83,    889,  -4136,  22877,  16616,  -4433,   1225,   -187 },
+	{   -111,    984,  -4297,  21923,  17730,  -4487,   1206,   -180 },
+	{   -135,   1063,  -4411,  20927,  18823,  -4503,   1173,   -169 },
+	{   -154,   1126,  -4479,  19891,  19891,  -4479,   1126,   -154 },
+	{   -169,   1173,  -4503,  18823,  20927,  -4411,   1063,   -135 },
+	{   -180,   1206,  -4487,  17730,  21923,  -4297,    984,   -111 },
+	{   -187,   1225,  -4433,  16616,  22877,  -4136,    889,    -83 },
+	{   -192,   1231,  -4344,  15487,  23784,  -3925,    778,    -51 },
+	{   -193,   1225,  -4223,  14349,  24635,  -3662,    650,    -13 },
+	{   -191,   1207,  -4074,  13209,  25429,  -3346,    506,     28 },
+	{   -187,   1179,  -3899,  12071,  26160,  -2976,    345,     75 },
+	{   -180,   1142,  -3701,  10941,  26824,  -2552,    169,    125 },
+	{   -172,   1097,  -3485,   9824,  27418,  -2072,    -22,    180 },
+	{   -162,   1045,  -3252,   8727,  27936,  -1537,   -227,    238 },
+	{   -152,    987,  -3007,   7653,  28379,   -947,   -446,    301 },
+	{   -140,    925,  -2751,   6607,  28741,   -303,   -677,    366 },
+	{   -128,    858,  -2489,   5593,  29025,    394,   -918,    433 },
+	{   -116,    789,  -2223,   4617,  29224,   1142,  -1168,    503 },
+	{   -103,    718,  -1955,   3680,  29339,   1940,  -1425,    574 },
+};
+
+struct tt_mixer_stream {
+	struct snd_pcm_substream *substream;
+	int running;
+	int duck;			/* duck the carrier while running */
+
+	snd_pcm_uframes_t hw;		/* frames consumed, modulo boundary */
+	snd_pcm_uframes_t pos;		/* the same, within the buffer */
+	snd_pcm_uframes_t period_pos;	/* frames consumed in this period */
+
+	/* resampler state, recomputed when the carrier rate changes */
+	unsigned int out_rate;
+	u32 step;			/* input frames per output frame */
+	u32 phase;
+	s16 hist[TT_MIXER_TAPS][2];
+	unsigned int hist_head;		/* oldest frame, next to be replaced */
+};
+
+static struct {
+	spinlock_t lock;
+	struct snd_pcm *pcm;
+	struct snd_pcm *carrier_pcm;
+	struct snd_pcm_substream *carrier;	/* while running */
+	struct tt_mixer_stream streams[TT_MIXER_STREAMS];
+
+	u32 carrier_gain;		/* current, ramps towards the target */
+	u32 volume;			/* of the mixer streams */
+	u32 duck_level;			/* carrier gain while ducked */
+	int volume_pct;
+	int duck_pct;
+
+	struct work_struct stop_work;
+} tt_mixer = {
+	.lock		= __SPIN_LOCK_UNLOCKED(tt_mixer.lock),
+	.carrier_gain	= TT_MIXER_UNITY,
+	.volume		= TT_MIXER_UNITY,
+	.duck_level	= TT_MIXER_UNITY * 30 / 100,
+	.volume_pct	= 100,
+	.duck_pct	= 30,
+};
+
+/* sum of the mixer streams for one carrier period, packed stereo frames */
+static u32 tt_mixer_acc[TT_MIXER_MAX_FRAMES];
+
+/*
+ * Stereo S16 frames are handled as one 32 bit word, left channel in the low
+ * half. ARMv6 can saturate-add and scale both halves without unpacking.
+ */
+static inline u32 tt_mixer_pack(s32 l, s32 r)
+{
+	return (u16)clamp_t(s32, l, -32768, 32767) |
+	       ((u32)(u16)clamp_t(s32, r, -32768, 32767) << 16);
+}
+
+static inline u32 tt_mixer_qadd16(u32 a, u32 b)
+{
+#if __LINUX_ARM_ARCH__ >= 6
+	u32 r;
+
+	asm("qadd16	%0, %1, %2" : "=r" (r) : "r" (a), "r" (b));
+	return r;
+#else
+	return tt_mixer_pack((s16)a + (s16)b, (s16)(a >> 16) + (s16)(b >> 16));
+#endif
+}
+
+/* gain is Q16 and at most TT_MIXER_UNITY, so the result cannot overflow */
+static inline u32 tt_mixer_scale(u32 x, u32 gain)
+{
+#if __LINUX_ARM_ARCH__ >= 6
+	u32 l, r;
+
+	asm("smulwb	%0, %1, %2" : "=r" (l) : "r" (gain), "r" (x));
+	asm("smulwt	%0, %1, %2" : "=r" (r) : "r" (gain), "r" (x));
+	asm("pkhbt	%0, %1, %2, lsl #16" : "=r" (x) : "r" (l), "r" (r));
+	return x;
+#else
+	return tt_mixer_pack(((s32)(s16)x * (s32)gain) >> 16,
+			     ((s32)(s16)(x >> 16) * (s32)gain) >> 16);
+#endif
+}
+
+static void tt_mixer_push(struct tt_mixer_stream *s,
+			  struct snd_pcm_runtime *runtime)
+{
+	const s16 *frame = (const s16 *)runtime->dma_area +
+			   s->pos * runtime->channels;
+
+	/* mono goes out on both channels */
+	s->hist[s->hist_head][0] = frame[0];
+	s->hist[s->hist_head][1] = frame[runtime->channels - 1];
+	s->hist_head = (s->hist_head + 1) & (TT_MIXER_TAPS - 1);
+
+	if (++s->pos == runtime->buffer_size)
+		s->pos = 0;
+	if (++s->hw == runtime->boundary)
+		s->hw = 0;
+}
+
+static u32 tt_mixer_interpolate(struct tt_mixer_stream *s)
+{
+	const s16 *h = tt_mixer_filter[s->phase >> (16 - TT_MIXER_PHASE_BITS)];
+	unsigned int j = s->hist_head;
+	s32 l = 0, r = 0;
+	int k;
+
+	for (k = 0; k < TT_MIXER_TAPS; k++) {
+		l += h[k] * s->hist[j][0];
+		r += h[k] * s->hist[j][1];
+		j = (j + 1) & (TT_MIXER_TAPS - 1);
+	}
+
+	return tt_mixer_pack((l + (1 << 14)) >> 15, (r + (1 << 14)) >> 15);
+}
+
+/*
+ * Render 'frames' frames of stream s at out_rate into tt_mixer_acc, adding
+ * to what is there if 'add' is set. Returns non-zero if the stream crossed a
+ * period boundary or ran dry, i.e. ALSA should look at its pointer.
+ */
+static int tt_mixer_render(struct tt_mixer_stream *s, unsigned int frames,
+			   unsigned int out_rate, int add)
+{
+	struct snd_pcm_runtime *runtime = s->substream->runtime;
+	snd_pcm_sframes_t avail;
+	unsigned int i, j;
+	int elapsed = 0;
+	u32 v;
+
+	if (s->out_rate != out_rate) {
+		s->out_rate = out_rate;
+		s->step = div_u64((u64)runtime->rate << 16, out_rate);
+	}
+
+	avail = runtime->control->appl_ptr - s->hw;
+	if (avail < 0)
+		avail += runtime->boundary;
+
+	for (i = 0; i < frames; i++) {
+		while (s->phase >= TT_MIXER_UNITY) {
+			if (avail == 0)
+				goto dry;
+
+			tt_mixer_push(s, runtime);
+			avail--;
+			s->phase -= TT_MIXER_UNITY;
+			if (++s->period_pos == runtime->period_size) {
+				s->period_pos = 0;
+				elapsed = 1;
+			}
+		}
+
+		if (s->step == TT_MIXER_UNITY) {
+			j = (s->hist_head - 1) & (TT_MIXER_TAPS - 1);
+			v = tt_mixer_pack(s->hist[j][0], s->hist[j][1]);
+		} else {
+			v = tt_mixer_interpolate(s);
+		}
+		s->phase += s->step;
+
+		v = tt_mixer_scale(v, tt_mixer.volume);
+		tt_mixer_acc[i] = add ? tt_mixer_qadd16(tt_mixer_acc[i], v) : v;
+	}
+
+	return elapsed;
+
+dry:
+	/* the application is late or draining: pad with silence and let
+	   ALSA decide between an underrun and the end of the drain */
+	if (!add)
+		memset(&tt_mixer_acc[i], 0, (frames - i) * sizeof(u32));
+
+	return 1;
+}
+
+/* has the application already written the whole carrier period at offset? */
+static int tt_mixer_carrier_ready(struct snd_pcm_runtime *runtime,
+				  snd_pcm_uframes_t offset)
+{
+	snd_pcm_sframes_t avail, end;
+
+	avail = runtime->control->appl_ptr - runtime->status->hw_ptr;
+	if (avail < 0)
+		avail += runtime->boundary;
+
+	end = offset + runtime->period_size -
+	      runtime->status->hw_ptr % runtime->buffer_size;
+	if (end <= 0)
+		end += runtime->buffer_size;
+
+	return avail >= end;
+}
+
+void tt_mixer_refill(struct snd_pcm_substream *substream,
+		     snd_pcm_uframes_t offset)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_substream *elapsed[TT_MIXER_STREAMS];
+	struct tt_mixer_stream *s;
+	unsigned long flags;
+	unsigned int frames = runtime->period_size;
+	u32 *out, target, ramp, g, v;
+	int i, n = 0, duck = 0;
+
+	if (runtime->format != SNDRV_PCM_FORMAT_S16_LE ||
+	    runtime->channels != 2 || frames > TT_MIXER_MAX_FRAMES)
+		return;
+
+	memset(elapsed, 0, sizeof(elapsed));
+
+	spin_lock_irqsave(&tt_mixer.lock, flags);
+
+	if (substream != tt_mixer.carrier)
+		goto out;
+
+	/* mixing into a period the application has yet to write would only
+	   have the mix overwritten; the mixer streams wait a period instead */
+	if (!tt_mixer_carrier_ready(runtime, offset))
+		goto out;
+
+	for (i = 0; i < TT_MIXER_STREAMS; i++) {
+		s = &tt_mixer.streams[i];
+		if (!s->running)
+			continue;
+
+		duck |= s->duck;
+		if (tt_mixer_render(s, frames, runtime->rate, n++))
+			elapsed[i] = s->substream;
+	}
+
+	target = duck ? tt_mixer.duck_level : TT_MIXER_UNITY;
+	g = tt_mixer.carrier_gain;
+	if (n == 0 && g == TT_MIXER_UNITY && target == TT_MIXER_UNITY)
+		goto out;
+
+	ramp = TT_MIXER_UNITY / max(1U, runtime->rate * duck_ramp_ms / 1000);
+	if (ramp == 0)
+		ramp = 1;
+
+	out = (u32 *)(runtime->dma_area + frames_to_bytes(runtime, offset));
+	for (i = 0; i < frames; i++) {
+		if (g > target)
+			g = (g - target > ramp) ? g - ramp : target;
+		else if (g < target)
+			g = (target - g > ramp) ? g + ramp : target;
+
+		v = out[i];
+		if (g != TT_MIXER_UNITY)
+			v = tt_mixer_scale(v, g);
+		if (n)
+			v = tt_mixer_qadd16(v, tt_mixer_acc[i]);
+		out[i] = v;
+	}
+	tt_mixer.carrier_gain = g;
+
+out:
+	spin_unlock_irqrestore(&tt_mixer.lock, flags);
+
+	for (i = 0; i < TT_MIXER_STREAMS; i++)
+		if (elapsed[i])
+			snd_pcm_period_elapsed(elapsed[i]);
+}
+EXPORT_SYMBOL(tt_mixer_refill);
+
+void tt_mixer_carrier_start(struct snd_pcm_substream *substream)
+{
+	unsigned long flags;
+
+	if (substream->pcm != tt_mixer.carrier_pcm ||
+	    substream->stream != SNDRV_PCM_STREAM_PLAYBACK)
+		return;
+
+	spin_lock_irqsave(&tt_mixer.lock, flags);
+	tt_mixer.carrier = substream;
+	tt_mixer.carrier_gain = TT_MIXER_UNITY;
+	spin_unlock_irqrestore(&tt_mixer.lock, flags);
+}
+EXPORT_SYMBOL(tt_mixer_carrier_start);
+
+void tt_mixer_carrier_stop(struct snd_pcm_substream *substream)
+{
+	unsigned long flags;
+	int i, running = 0;
+
+	spin_lock_irqsave(&tt_mixer.lock, flags);
+	if (tt_mixer.carrier == substream) {
+		tt_mixer.carrier = NULL;
+		for (i = 0; i < TT_MIXER_STREAMS; i++)
+			running |= tt_mixer.streams[i].running;
+	}
+	spin_unlock_irqrestore(&tt_mixer.lock, flags);
+
+	/* we are inside the carrier's trigger, under its stream lock */
+	if (running)
+		schedule_work(&tt_mixer.stop_work);
+}
+EXPORT_SYMBOL(tt_mixer_carrier_stop);
+
+static void tt_mixer_stop_work(struct work_struct *work)
+{
+	struct snd_pcm_substream *substream;
+	struct tt_mixer_stream *s;
+	int i, orphan;
+
+	for (i = 0; i < TT_MIXER_STREAMS; i++) {
+		s = &tt_mixer.streams[i];
+		substream = s->substream;
+		if (substream == NULL)
+			continue;
+
+		/* a running stream is still open: stopping it takes the
+		   stream lock, which also keeps the close path out */
+		snd_pcm_stream_lock_irq(substream);
+		spin_lock(&tt_mixer.lock);
+		orphan = s->substream == substream && s->running &&
+			 tt_mixer.carrier == NULL;
+		spin_unlock(&tt_mixer.lock);
+		if (orphan)
+			snd_pcm_stop(substream, SNDRV_PCM_STATE_XRUN);
+		snd_pcm_stream_unlock_irq(substream);
+	}
+}
+
+static const struct snd_pcm_hardware tt_mixer_hardware = {
+	.info			= SNDRV_PCM_INFO_INTERLEAVED |
+				    SNDRV_PCM_INFO_BLOCK_TRANSFER |
+				    SNDRV_PCM_INFO_MMAP |
+				    SNDRV_PCM_INFO_MMAP_VALID |
+				    SNDRV_PCM_INFO_PAUSE |
+				    SNDRV_PCM_INFO_RESUME,
+	.formats		= SNDRV_PCM_FMTBIT_S16_LE,
+	.rates			= SNDRV_PCM_RATE_CONTINUOUS |
+				    SNDRV_PCM_RATE_8000_48000,
+	.rate_min		= 8000,
+	.rate_max		= 48000,
+	.channels_min		= 1,
+	.channels_max		= 2,
+	.buffer_bytes_max	= TT_MIXER_BUFFER_BYTES,
+	.period_bytes_min	= 256,
+	.period_bytes_max	= TT_MIXER_BUFFER_BYTES / 2,
+	.periods_min		= 2,
+	.periods_max		= 64,
+};
+
+static int tt_mixer_open(struct snd_pcm_substream *substream)
+{
+	struct tt_mixer_stream *s = &tt_mixer.streams[substream->number];
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	runtime->hw = tt_mixer_hardware;
+	snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
+
+	spin_lock_irq(&tt_mixer.lock);
+	s->substream = substream;
+	s->running = 0;
+	s->duck = (substream->number == 0);
+	spin_unlock_irq(&tt_mixer.lock);
+
+	runtime->private_data = s;
+	return 0;
+}
+
+static int tt_mixer_close(struct snd_pcm_substream *substream)
+{
+	struct tt_mixer_stream *s = substream->runtime->private_data;
+
+	spin_lock_irq(&tt_mixer.lock);
+	s->substream = NULL;
+	s->running = 0;
+	spin_unlock_irq(&tt_mixer.lock);
+
+	return 0;
+}
+
+static int tt_mixer_hw_params(struct snd_pcm_substream *substream,
+			      struct snd_pcm_hw_params *params)
+{
+	return snd_pcm_lib_malloc_pages(substream, params_buffer_bytes(params));
+}
+
+static int tt_mixer_hw_free(struct snd_pcm_substream *substream)
+{
+	return snd_pcm_lib_free_pages(substream);
+}
+
+static int tt_mixer_prepare(struct snd_pcm_substream *substream)
+{
+	struct tt_mixer_stream *s = substream->runtime->private_data;
+
+	spin_lock_irq(&tt_mixer.lock);
+	s->running = 0;
+	s->hw = 0;
+	s->pos = 0;
+	s->period_pos = 0;
+	s->out_rate = 0;
+	s->phase = TT_MIXER_UNITY;
+	s->hist_head = 0;
+	memset(s->hist, 0, sizeof(s->hist));
+	spin_unlock_irq(&tt_mixer.lock);
+
+	return 0;
+}
+
+static int tt_mixer_trigger(struct snd_pcm_substream *substream, int cmd)
+{
+	struct tt_mixer_stream *s = substream->runtime->private_data;
+	int ret = 0;
+
+	spin_lock(&tt_mixer.lock);
+
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_RESUME:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		if (tt_mixer.carrier == NULL)
+			ret = -EBUSY;
+		else
+			s->running = 1;
+		break;
+
+	case SNDRV_PCM_TRIGGER_STOP:
+	case SNDRV_PCM_TRIGGER_SUSPEND:
+	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		s->running = 0;
+		break;
+
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	spin_unlock(&tt_mixer.lock);
+
+	return ret;
+}
+
+static snd_pcm_uframes_t tt_mixer_pointer(struct snd_pcm_substream *substream)
+{
+	struct tt_mixer_stream *s = substream->runtime->private_data;
+	snd_pcm_uframes_t pos;
+
+	spin_lock(&tt_mixer.lock);
+	pos = s->pos;
+	spin_unlock(&tt_mixer.lock);
+
+	return pos;
+}
+
+static struct snd_pcm_ops tt_mixer_ops = {
+	.open		= tt_mixer_open,
+	.close		= tt_mixer_close,
+	.ioctl		= snd_pcm_lib_ioctl,
+	.hw_params	= tt_mixer_hw_params,
+	.hw_free	= tt_mixer_hw_free,
+	.prepare	= tt_mixer_prepare,
+	.trigger	= tt_mixer_trigger,
+	.pointer	= tt_mixer_pointer,
+};
+
+static int tt_mixer_get_volume(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] = tt_mixer.volume_pct;
+	return 0;
+}
+
+static int tt_mixer_set_volume(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_value *ucontrol)
+{
+	int pct = ucontrol->value.integer.value[0];
+
+	if (pct < 0 || pct > 100)
+		return -EINVAL;
+
+	spin_lock_irq(&tt_mixer.lock);
+	tt_mixer.volume_pct = pct;
+	tt_mixer.volume = TT_MIXER_UNITY * pct / 100;
+	spin_unlock_irq(&tt_mixer.lock);
+
+	return 1;
+}
+
+static int tt_mixer_get_duck(struct snd_kcontrol *kcontrol,
+			     struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] = tt_mixer.duck_pct;
+	return 0;
+}
+
+static int tt_mixer_set_duck(struct snd_kcontrol *kcontrol,
+			     struct snd_ctl_elem_value *ucontrol)
+{
+	int pct = ucontrol->value.integer.value[0];
+
+	if (pct < 0 || pct > 100)
+		return -EINVAL;
+
+	spin_lock_irq(&tt_mixer.lock);
+	tt_mixer.duck_pct = pct;
+	tt_mixer.duck_level = TT_MIXER_UNITY * pct / 100;
+	spin_unlock_irq(&tt_mixer.lock);
+
+	return 1;
+}
+
+static const struct snd_kcontrol_new tt_mixer_controls[] = {
+	SOC_SINGLE_EXT("TT Prompt Volume %", 0, 0, 100, 0,
+		       tt_mixer_get_volume, tt_mixer_set_volume),
+	SOC_SINGLE_EXT("TT Prompt Duck Level %", 0, 0, 100, 0,
+		       tt_mixer_get_duck, tt_mixer_set_duck),
+};
+
+static void tt_mixer_pcm_free(struct snd_pcm *pcm)
+{
+	cancel_work_sync(&tt_mixer.stop_work);
+
+	spin_lock_irq(&tt_mixer.lock);
+	tt_mixer.pcm = NULL;
+	tt_mixer.carrier_pcm = NULL;
+	tt_mixer.carrier = NULL;
+	spin_unlock_irq(&tt_mixer.lock);
+}
+
+int tt_mixer_new(struct snd_card *card, struct snd_pcm *carrier)
+{
+	static const char *names[TT_MIXER_STREAMS] = { "Prompt", "Effects" };
+	struct snd_pcm_substream *substream;
+	struct snd_pcm *pcm;
+	int i, ret;
+
+	/* one mixer, on the first playback device of the card */
+	if (tt_mixer.pcm)
+		return 0;
+
+	ret = snd_pcm_new(card, "TomTom mixer", pcm_device, TT_MIXER_STREAMS,
+			  0, &pcm);
+	if (ret) {
+		printk(KERN_ERR "tt_mixer: cannot create pcm %d: %d\n",
+		       pcm_device, ret);
+		return ret;
+	}
+
+	INIT_WORK(&tt_mixer.stop_work, tt_mixer_stop_work);
+
+	strcpy(pcm->name, "TomTom mixer");
+	pcm->private_free = tt_mixer_pcm_free;
+	snd_pcm_set_ops(pcm, SNDRV_PCM_STREAM_PLAYBACK, &tt_mixer_ops);
+
+	substream = pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream;
+	for (i = 0; substream; substream = substream->next, i++)
+		strlcpy(substream->name, names[i], sizeof(substream->name));
+
+	ret = snd_pcm_lib_preallocate_pages_for_all(pcm,
+			SNDRV_DMA_TYPE_CONTINUOUS,
+			snd_dma_continuous_data(GFP_KERNEL),
+			TT_MIXER_BUFFER_BYTES, TT_MIXER_BUFFER_BYTES);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARRAY_SIZE(tt_mixer_controls); i++) {
+		ret = snd_ctl_add(card, snd_ctl_new1(&tt_mixer_controls[i],
+						     NULL));
+		if (ret)
+			return ret;
+	}
+
+	spin_lock_irq(&tt_mixer.lock);
+	tt_mixer.pcm = pcm;
+	tt_mixer.carrier_pcm = carrier;
+	spin_unlock_irq(&tt_mixer.lock);
+
+	printk(KERN_INFO "tt_mixer: prompts on pcm %d, mixed into pcm %d\n",
+	       pcm_device, carrier->device);
+
+	return 0;
+}
+EXPORT_SYMBOL(tt_mixer_new);
@@ -91,11 +91,134 @@ int fb_is_primary_device(struct fb_info *fb)
 }
 #endif
 
+/* show the oldest pending flip of a window, vsync_lock must be held */
+static void s3cfb_retire_flip(struct s3cfb_window *win)
+{
+	unsigned int frames = fbdev->wq_count - win->last_flip;
+
+	s3cfb_set_buffer_yoffset(fbdev, win->id,
+				 win->flip_queue[win->flip_head]);
+
+	win->flip_head = (win->flip_head + 1) % S3CFB_FLIP_QUEUE_LEN;
+	win->flip_count--;
+	fbdev->flips_pending--;
+
+	/* the previous buffer was scanned out more than once */
+	if (win->last_flip && frames > 1 && frames <= S3CFB_MISSED_WINDOW)
+		fbdev->missed_frames += frames - 1;
+
+	win->last_flip = fbdev->wq_count;
+}
+
+/* write a pending atomic update of a window, vsync_lock must be held */
+static void s3cfb_apply_update(struct s3cfb_window *win)
+{
+	struct s3cfb_user_update *update = &win->update;
+
+	if (update->flags & S3CFB_UPDATE_POSITION) {
+		win->x = update->window.x;
+		win->y = update->window.y;
+		s3cfb_set_window_position(fbdev, win->id);
+	}
+
+	if (update->flags & S3CFB_UPDATE_ALPHA) {
+		win->alpha.mode = PLANE_BLENDING;
+		win->alpha.channel = update->alpha.channel;
+		win->alpha.value = S3CFB_AVALUE(update->alpha.red, \
+					update->alpha.green, \
+					update->alpha.blue);
+		s3cfb_set_alpha_blending(fbdev, win->id);
+	}
+
+	if (update->flags & S3CFB_UPDATE_CHROMA) {
+		win->chroma.enabled = update->chroma.enabled;
+		win->chroma.key = S3CFB_CHROMA(update->chroma.red, \
+					update->chroma.green, \
+					update->chroma.blue);
+		s3cfb_set_chroma_key(fbdev, win->id);
+	}
+
+	/* an in-kernel producer owns the buffer address */
+	if ((update->flags & S3CFB_UPDATE_BUFFER) && !win->overlay_latched)
+		s3cfb_set_buffer_yoffset(fbdev, win->id, update->yoffset);
+
+	if (update->flags & S3CFB_UPDATE_ENABLE) {
+		if (update->enabled && !s3cfb_window_on(fbdev, win->id))
+			win->enabled = 1;
+		else if (!update->enabled && !s3cfb_window_off(fbdev, win->id))
+			win->enabled = 0;
+	}
+
+	update->flags = 0;
+	fbdev->updates_pending--;
+}
+
+/* forget the pending flips of a window, vsync_lock must be held */
+static void s3cfb_drop_flips(struct s3cfb_window *win)
+{
+	fbdev->flips_pending -= win->flip_count;
+	win->flip_count = 0;
+	win->flip_head = 0;
+}
+
+/* forget everything a window still waits to show at the next frame */
+static void s3cfb_cancel_pending(struct s3cfb_window *win)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+	s3cfb_drop_flips(win);
+	if (win->update.flags) {
+		win->update.flags = 0;
+		fbdev->updates_pending--;
+	}
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+}
+
+/* show the buffer queued by the producer of a window, vsync_lock held */
+static void s3cfb_latch_overlay(struct s3cfb_window *win, ktime_t vsync)
+{
+	s3cfb_set_buffer_paddr(fbdev, win->id, win->overlay_addr);
+
+	/* the window comes up with the first frame of the producer */
+	if (!win->enabled && !s3cfb_window_on(fbdev, win->id))
+		win->enabled = 1;
+
+	win->overlay_pending = 0;
+	fbdev->overlays_pending--;
+
+	win->overlay_latched(win->overlay_priv, win->overlay_addr, vsync);
+}
+
 static irqreturn_t s3cfb_irq_frame(int irq, void *dev_id)
 {
+	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
+	struct s3cfb_window *win;
+	int i;
+
 	s3cfb_clear_interrupt(fbdev);
 
+	spin_lock(&fbdev->vsync_lock);
+
 	fbdev->wq_count++;
+	fbdev->vsync_time = ktime_get();
+
+	for (i = 0; i < pdata->nr_wins; i++) {
+		if (!fbdev->flips_pending && !fbdev->updates_pending &&
+		    !fbdev->overlays_pending)
+			break;
+
+		win = fbdev->fb[i]->par;
+		if (win->flip_count)
+			s3cfb_retire_flip(win);
+		if (win->update.flags)
+			s3cfb_apply_update(win);
+		if (win->overlay_pending)
+			s3cfb_latch_overlay(win, fbdev->vsync_time);
+	}
+
+	spin_unlock(&fbdev->vsync_lock);
+
 	wake_up_interruptible(&fbdev->wq);
 
 	return IRQ_HANDLED;
@@ -330,6 +453,7 @@ static int s3cfb_set_par(struct fb_info *fb)
 	s3cfb_set_window_control(fbdev, win->id);
 	s3cfb_set_window_position(fbdev, win->id);
 	s3cfb_set_window_size(fbdev, win->id);
+	s3cfb_cancel_pending(win);
 	s3cfb_set_buffer_address(fbdev, win->id);
 	s3cfb_set_buffer_size(fbdev, win->id);
 
@@ -366,6 +490,56 @@ static int s3cfb_blank(int blank_mode, struct fb_info *fb)
 	return 0;
 }
 
+/*
+ * queue a pan request to be shown at the next frame interrupt. With
+ * nr_buffers == 3 two flips may be pending, so the client can render into
+ * the third buffer while the second waits for vsync. When the queue is full
+ * the caller waits for a frame, or replaces the newest flip if it can't
+ * sleep.
+*/
+static int s3cfb_queue_flip(struct fb_info *fb, unsigned int yoffset)
+{
+	struct s3cfb_window *win = fb->par;
+	int depth = min_t(int, fb->fix.ypanstep, S3CFB_FLIP_QUEUE_LEN);
+	unsigned long flags;
+	int ret, tail;
+
+	if (depth < 1)
+		depth = 1;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+
+	while (win->flip_count >= depth) {
+		if (in_atomic() || irqs_disabled()) {
+			win->flip_count--;
+			fbdev->flips_pending--;
+			break;
+		}
+
+		spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+		ret = wait_event_interruptible_timeout(fbdev->wq, \
+				win->flip_count < depth, HZ / 10);
+		if (ret < 0)
+			return ret;
+
+		spin_lock_irqsave(&fbdev->vsync_lock, flags);
+		if (!ret) {
+			/* no frame interrupt, the display is off */
+			s3cfb_drop_flips(win);
+			break;
+		}
+	}
+
+	tail = (win->flip_head + win->flip_count) % S3CFB_FLIP_QUEUE_LEN;
+	win->flip_queue[tail] = yoffset;
+	win->flip_count++;
+	fbdev->flips_pending++;
+
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+
+	return 0;
+}
+
 static int s3cfb_pan_display(struct fb_var_screeninfo *var, 
 				struct fb_info *fb)
 {
@@ -376,14 +550,107 @@ static int s3cfb_pan_display(struct fb_var_screeninfo *var,
 		return -EINVAL;
 	}
 
+	if (win->overlay_latched) {
+		dev_dbg(fbdev->dev, "[fb%d] window is fed by a producer\n", \
+			win->id);
+		return -EBUSY;
+	}
+
 	fb->var.yoffset = var->yoffset;
 
 	dev_dbg(fbdev->dev, "[fb%d] yoffset for pan display: %d\n", win->id, \
 		var->yoffset);
 
-	s3cfb_set_buffer_address(fbdev, win->id);
+	if (!fbdev->vsync_irq || win->path == DATA_PATH_FIFO) {
+		s3cfb_cancel_pending(win);
+		s3cfb_set_buffer_address(fbdev, win->id);
+		return 0;
+	}
 
-	return 0;
+	return s3cfb_queue_flip(fb, var->yoffset);
+}
+
+/*
+ * merge an atomic window update into the one pending for the next frame
+ * interrupt, later fields replace earlier ones. Without the frame interrupt
+ * the update is written immediately.
+*/
+static int s3cfb_queue_update(struct fb_info *fb,
+			      struct s3cfb_user_update *user)
+{
+	struct fb_var_screeninfo *var = &fb->var;
+	struct s3cfb_window *win = fb->par;
+	struct s3cfb_lcd *lcd = fbdev->lcd;
+	struct s3cfb_user_update *update = &win->update;
+	unsigned int flags = user->flags & ~S3CFB_UPDATE_WAIT;
+	unsigned long irqflags;
+	unsigned int count;
+	int ret;
+
+	if ((flags & (S3CFB_UPDATE_ALPHA | S3CFB_UPDATE_CHROMA)) && \
+			win->id == 0)
+		return -EINVAL;
+
+	if ((flags & S3CFB_UPDATE_BUFFER) && \
+			user->yoffset > var->yres_virtual - var->yres)
+		return -EINVAL;
+
+	if ((flags & S3CFB_UPDATE_ENABLE) && user->enabled && \
+			!fb->fix.smem_start)
+		return -EINVAL;
+
+	if (flags & S3CFB_UPDATE_POSITION) {
+		if (user->window.x < 0)
+			user->window.x = 0;
+
+		if (user->window.y < 0)
+			user->window.y = 0;
+
+		if (user->window.x + var->xres > lcd->width)
+			user->window.x = lcd->width - var->xres;
+
+		if (user->window.y + var->yres > lcd->height)
+			user->window.y = lcd->height - var->yres;
+	}
+
+	if (!flags)
+		return 0;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, irqflags);
+
+	if (!update->flags)
+		fbdev->updates_pending++;
+
+	if (flags & S3CFB_UPDATE_POSITION)
+		update->window = user->window;
+	if (flags & S3CFB_UPDATE_ALPHA)
+		update->alpha = user->alpha;
+	if (flags & S3CFB_UPDATE_CHROMA)
+		update->chroma = user->chroma;
+	if (flags & S3CFB_UPDATE_BUFFER) {
+		/* the update supersedes queued pan requests */
+		s3cfb_drop_flips(win);
+		update->yoffset = user->yoffset;
+		var->yoffset = user->yoffset;
+	}
+	if (flags & S3CFB_UPDATE_ENABLE)
+		update->enabled = user->enabled;
+	update->flags |= flags;
+
+	if (!fbdev->vsync_irq || win->path == DATA_PATH_FIFO)
+		s3cfb_apply_update(win);
+
+	count = fbdev->wq_count;
+
+	spin_unlock_irqrestore(&fbdev->vsync_lock, irqflags);
+
+	if (!(user->flags & S3CFB_UPDATE_WAIT))
+		return 0;
+
+	ret = wait_event_interruptible_timeout(fbdev->wq, \
+			fbdev->wq_count != count, HZ / 10);
+
+	return ret < 0 ? ret : 0;
 }
 
 static inline unsigned int __chan_to_field(unsigned int chan,
@@ -447,6 +714,8 @@ static int s3cfb_release_window(struct fb_info *fb)
 	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
 	struct s3cfb_window *win = fb->par;
 
+	s3cfb_cancel_pending(win);
+
 	if (win->id != pdata->default_win) {
 		s3cfb_disable_window(win->id);
 		s3cfb_unmap_video_memory(fb);
@@ -480,15 +749,40 @@ static int s3cfb_cursor(struct fb_info *info, struct fb_cursor *cursor)
 
 static int s3cfb_wait_for_vsync(void)
 {
+	unsigned int count = fbdev->wq_count;
+	int ret;
+
 	dev_dbg(fbdev->dev, "waiting for VSYNC interrupt\n");
 
-	interruptible_sleep_on_timeout(&fbdev->wq, HZ / 10);
+	ret = wait_event_interruptible_timeout(fbdev->wq, \
+			fbdev->wq_count != count, HZ / 10);
+	if (ret < 0)
+		return ret;
 
 	dev_dbg(fbdev->dev, "got a VSYNC interrupt\n");
 
 	return 0;
 }
 
+static int s3cfb_get_vsync_info(struct s3cfb_window *win,
+				struct s3cfb_vsync_info *vsync)
+{
+	unsigned long flags;
+	int ret;
+
+	ret = s3cfb_wait_for_vsync();
+	if (ret)
+		return ret;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+	vsync->count = fbdev->wq_count;
+	vsync->pending = win->flip_count;
+	vsync->timestamp = ktime_to_ns(fbdev->vsync_time);
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+
+	return 0;
+}
+
 static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd,
 			unsigned long arg)
 {
@@ -507,6 +801,8 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd,
 		struct s3cfb_user_window user_window;
 		struct s3cfb_user_plane_alpha user_alpha;
 		struct s3cfb_user_chroma user_chroma;
+		struct s3cfb_vsync_info vsync_info;
+		struct s3cfb_user_update user_update;
 		int vsync;
 	} p;
 
@@ -515,6 +811,22 @@ static int s3cfb_ioctl(struct fb_info *fb, unsigned int cmd,
 		s3cfb_wait_for_vsync();
 		break;
 
+	case S3CFB_WAIT_FOR_VSYNC_INFO:
+		ret = s3cfb_get_vsync_info(win, &p.vsync_info);
+		if (!ret && copy_to_user((struct s3cfb_vsync_info __user *) arg, \
+				&p.vsync_info, sizeof(p.vsync_info)))
+			ret = -EFAULT;
+		break;
+
+	case S3CFB_WIN_UPDATE:
+		if (copy_from_user(&p.user_update, \
+			(struct s3cfb_user_update __user *) arg, \
+			sizeof(p.user_update)))
+			ret = -EFAULT;
+		else
+			ret = s3cfb_queue_update(fb, &p.user_update);
+		break;
+
 	case S3CFB_WIN_POSITION:
 		if (copy_from_user(&p.user_window, \
 			(struct s3cfb_user_window __user *) arg, \
@@ -825,6 +1137,112 @@ int s3cfb_direct_ioctl(int id, unsigned int cmd, unsigned long arg)
 }
 EXPORT_SYMBOL(s3cfb_direct_ioctl);
 
+/*
+ * let an in-kernel producer feed a window with its own buffers. The buffers
+ * must match the window size and format. A queued buffer is shown at the
+ * next frame interrupt, which then calls latched() with the bus address and
+ * the frame time. latched() runs in interrupt context with the vsync lock
+ * held and must not call back into s3cfb.
+*/
+int s3cfb_overlay_attach(int id, void (*latched)(void *priv, dma_addr_t addr,
+			 ktime_t vsync), void *priv)
+{
+	struct s3c_platform_fb *pdata;
+	struct s3cfb_window *win;
+	unsigned long flags;
+	int ret = 0;
+
+	if (!fbdev)
+		return -ENODEV;
+
+	pdata = to_fb_plat(fbdev->dev);
+	if (id < 0 || id >= pdata->nr_wins || !latched)
+		return -EINVAL;
+
+	win = fbdev->fb[id]->par;
+	if (win->path == DATA_PATH_FIFO)
+		return -EINVAL;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+
+	if (win->overlay_latched) {
+		ret = -EBUSY;
+	} else {
+		s3cfb_drop_flips(win);
+		win->overlay_latched = latched;
+		win->overlay_priv = priv;
+	}
+
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+
+	dev_dbg(fbdev->dev, "[fb%d] overlay attach: %d\n", id, ret);
+
+	return ret;
+}
+EXPORT_SYMBOL(s3cfb_overlay_attach);
+
+/*
+ * queue a producer buffer for the next frame interrupt. A buffer still
+ * pending from before is replaced, which is reported by returning 1 so the
+ * producer can reuse it. Without the frame interrupt the buffer is shown
+ * immediately.
+*/
+int s3cfb_overlay_queue(int id, dma_addr_t addr)
+{
+	struct s3cfb_window *win = fbdev->fb[id]->par;
+	unsigned long flags;
+	int dropped = 0;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+
+	if (!win->overlay_latched) {
+		spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+		return -EINVAL;
+	}
+
+	if (win->overlay_pending) {
+		dropped = 1;
+	} else {
+		win->overlay_pending = 1;
+		fbdev->overlays_pending++;
+	}
+
+	win->overlay_addr = addr;
+
+	if (!fbdev->vsync_irq)
+		s3cfb_latch_overlay(win, ktime_get());
+
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+
+	return dropped;
+}
+EXPORT_SYMBOL(s3cfb_overlay_queue);
+
+/* turn the window off and hand it back to its frame buffer memory */
+void s3cfb_overlay_detach(int id)
+{
+	struct s3cfb_window *win = fbdev->fb[id]->par;
+	unsigned long flags;
+
+	spin_lock_irqsave(&fbdev->vsync_lock, flags);
+
+	if (win->overlay_pending) {
+		win->overlay_pending = 0;
+		fbdev->overlays_pending--;
+	}
+
+	win->overlay_latched = NULL;
+	win->overlay_priv = NULL;
+
+	spin_unlock_irqrestore(&fbdev->vsync_lock, flags);
+
+	s3cfb_disable_window(id);
+	s3cfb_set_buffer_address(fbdev, id);
+
+	dev_dbg(fbdev->dev, "[fb%d] overlay detach\n", id);
+}
+EXPORT_SYMBOL(s3cfb_overlay_detach);
+
 static int s3cfb_init_fbinfo(int id)
 {
 	struct s3c_platform_fb *pdata = to_fb_plat(fbdev->dev);
@@ -1029,6 +1447,25 @@ static DEVICE_ATTR(win_power, 0644, \
 			s3cfb_sysfs_show_win_power,
 			s3cfb_sysfs_store_win_power);
 
+static int s3cfb_sysfs_show_missed_frames(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", fbdev->missed_frames);
+}
+
+static int s3cfb_sysfs_store_missed_frames(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	/* any write resets the counter */
+	fbdev->missed_frames = 0;
+
+	return len;
+}
+
+static DEVICE_ATTR(missed_frames, 0644, \
+			s3cfb_sysfs_show_missed_frames,
+			s3cfb_sysfs_store_missed_frames);
+
 static int s3cfb_probe(struct platform_device *pdev)
 {
 	struct s3c_platform_fb *pdata;
@@ -1043,6 +1480,7 @@ static int s3cfb_probe(struct platform_device *pdev)
 	}
 
 	fbdev->dev = &pdev->dev;
+	spin_lock_init(&fbdev->vsync_lock);
 	pdata = to_fb_plat(&pdev->dev);
 
 	if (pdata->lcd)	
@@ -1155,6 +1593,10 @@ static int s3cfb_probe(struct platform_device *pdev)
 	if (ret < 0)
 		err("failed to add sysfs entries\n");
 
+	ret = device_create_file(&(pdev->dev), &dev_attr_missed_frames);
+	if (ret < 0)
+		err("failed to add sysfs entries\n");
+
 	info("registered successfully\n");
 
 	return 0;
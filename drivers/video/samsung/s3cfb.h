@@ -16,6 +16,8 @@
 #ifdef __KERNEL__
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
 #include <linux/fb.h>
 #ifdef CONFIG_HAS_WAKELOCK
 #include <linux/wakelock.h>
@@ -35,6 +37,12 @@
 #define S3CFB_AVALUE(r, g, b)	(((r & 0xf) << 8) | ((g & 0xf) << 4) | ((b & 0xf) << 0))
 #define S3CFB_CHROMA(r, g, b)	(((r & 0xff) << 16) | ((g & 0xff) << 8) | ((b & 0xff) << 0))
 
+/* pan requests that may wait for a frame interrupt, two for triple buffering */
+#define S3CFB_FLIP_QUEUE_LEN	2
+/* a flip landing more frames than this after the previous one is treated
+ * as the client having been idle rather than having missed frames */
+#define S3CFB_MISSED_WINDOW	4
+
 
 /*
  * ENUMERATIONS
@@ -78,6 +86,70 @@ enum s3cfb_mem_owner_t {
 	DMA_MEM_OTHER	= 2,
 };
 
+/*
+ * STRUCTURES FOR CUSTOM IOCTLS
+*/
+struct s3cfb_user_window {
+	int x;
+	int y;
+};
+
+struct s3cfb_user_plane_alpha {
+	int 		channel;
+	unsigned char	red;
+	unsigned char	green;
+	unsigned char	blue;
+};
+
+struct s3cfb_user_chroma {
+	int 		enabled;
+	unsigned char	red;
+	unsigned char	green;
+	unsigned char	blue;
+};
+
+/*
+ * struct s3cfb_vsync_info
+ * @count:		frame interrupt counter
+ * @pending:		flips of this window still waiting for a frame
+ * @timestamp:		CLOCK_MONOTONIC time of the frame interrupt in ns
+*/
+struct s3cfb_vsync_info {
+	unsigned int		count;
+	unsigned int		pending;
+	unsigned long long	timestamp;
+};
+
+#define S3CFB_UPDATE_POSITION	(1 << 0)
+#define S3CFB_UPDATE_ALPHA	(1 << 1)
+#define S3CFB_UPDATE_CHROMA	(1 << 2)
+#define S3CFB_UPDATE_BUFFER	(1 << 3)
+#define S3CFB_UPDATE_ENABLE	(1 << 4)
+/* block until the update has been latched by a frame interrupt */
+#define S3CFB_UPDATE_WAIT	(1 << 31)
+
+/*
+ * struct s3cfb_user_update
+ * @flags:		which of the fields below to apply (S3CFB_UPDATE_*)
+ * @window:		window offset on the lcd
+ * @alpha:		plane alpha (not for window 0)
+ * @chroma:		color key (not for window 0)
+ * @yoffset:		line of the virtual framebuffer to scan out from
+ * @enabled:		window on or off
+ *
+ * All selected fields of one update are written within the same frame
+ * interrupt, so they take effect on the same frame. Updates of several
+ * windows issued within one frame are latched together as well.
+*/
+struct s3cfb_user_update {
+	unsigned int			flags;
+	struct s3cfb_user_window	window;
+	struct s3cfb_user_plane_alpha	alpha;
+	struct s3cfb_user_chroma	chroma;
+	unsigned int			yoffset;
+	int				enabled;
+};
+
 /*
  * FIMD STRUCTURES
 */
@@ -125,6 +197,16 @@ struct s3cfb_chroma {
  * @pseudo_pal:		pseudo palette for fb layer
  * @alpha:		alpha blending structure
  * @chroma:		chroma key structure
+ * @flip_queue:		yoffsets of pending pan requests
+ * @flip_head:		index of the next flip to show
+ * @flip_count:		number of pending flips
+ * @last_flip:		frame count at which the last flip was shown
+ * @update:		window state to apply at the next frame interrupt
+ * @overlay_latched:	in-kernel producer feeding the window, called from the
+ *			frame interrupt once a queued buffer has been latched
+ * @overlay_priv:	producer cookie passed to @overlay_latched
+ * @overlay_pending:	if @overlay_addr waits for the next frame interrupt
+ * @overlay_addr:	bus address of the next producer buffer to show
 */
 struct s3cfb_window {
 	int			id;
@@ -139,6 +221,16 @@ struct s3cfb_window {
 	unsigned int		pseudo_pal[16];
 	struct			s3cfb_alpha alpha;
 	struct			s3cfb_chroma chroma;
+	unsigned int		flip_queue[S3CFB_FLIP_QUEUE_LEN];
+	int			flip_head;
+	int			flip_count;
+	unsigned int		last_flip;
+	struct s3cfb_user_update	update;
+	void			(*overlay_latched)(void *priv, dma_addr_t addr,
+						   ktime_t vsync);
+	void			*overlay_priv;
+	int			overlay_pending;
+	dma_addr_t		overlay_addr;
 	int			(*suspend_fifo)(void);
 	int			(*resume_fifo)(void);
 };
@@ -153,6 +245,13 @@ struct s3cfb_window {
  * @output:		output path (RGB/I80/Etc)
  * @rgb_mode:		RGB mode
  * @lcd:		pointer to lcd structure
+ * @vsync_lock:		protects the frame counter, timestamp and flip queues
+ * @vsync_irq:		if the frame interrupt is enabled
+ * @vsync_time:		monotonic time of the last frame interrupt
+ * @flips_pending:	pending flips over all windows
+ * @updates_pending:	windows with a pending atomic update
+ * @overlays_pending:	windows with a pending producer buffer
+ * @missed_frames:	frames shown again while a client was flipping
 */
 struct s3cfb_global {
 	/* general */
@@ -165,6 +264,15 @@ struct s3cfb_global {
 	unsigned int		wq_count;
 	struct fb_info		**fb;
 
+	/* vsync */
+	spinlock_t		vsync_lock;
+	int			vsync_irq;
+	ktime_t			vsync_time;
+	int			flips_pending;
+	int			updates_pending;
+	int			overlays_pending;
+	unsigned int		missed_frames;
+
 	/* fimd */
 	int			enabled;
 	int			dsi;
@@ -180,28 +288,6 @@ struct s3cfb_global {
 };
 
 
-/*
- * STRUCTURES FOR CUSTOM IOCTLS
-*/
-struct s3cfb_user_window {
-	int x;
-	int y;
-};
-
-struct s3cfb_user_plane_alpha {
-	int 		channel;
-	unsigned char	red;
-	unsigned char	green;
-	unsigned char	blue;
-};
-
-struct s3cfb_user_chroma {
-	int 		enabled;
-	unsigned char	red;
-	unsigned char	green;
-	unsigned char	blue;
-};
-
 #if 1
 // added by jamie (2009.08.18)
 typedef struct {
@@ -226,6 +312,8 @@ typedef struct {
 #define S3CFB_WIN_SET_PLANE_ALPHA	_IOW ('F', 204, struct s3cfb_user_plane_alpha)
 #define S3CFB_WIN_SET_CHROMA		_IOW ('F', 205, struct s3cfb_user_chroma)
 #define S3CFB_SET_VSYNC_INT		_IOW ('F', 206, unsigned int)
+#define S3CFB_WAIT_FOR_VSYNC_INFO	_IOR ('F', 207, struct s3cfb_vsync_info)
+#define S3CFB_WIN_UPDATE		_IOW ('F', 208, struct s3cfb_user_update)
 #define S3CFB_SET_SUSPEND_FIFO		_IOW ('F', 300, unsigned long)
 #define S3CFB_SET_RESUME_FIFO		_IOW ('F', 301, unsigned long)
 #define S3CFB_GET_LCD_WIDTH		_IOR ('F', 302, int)
@@ -262,9 +350,16 @@ extern int s3cfb_set_alpha_blending(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_window_position(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_window_size(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id);
+extern int s3cfb_set_buffer_yoffset(struct s3cfb_global *ctrl, int id, unsigned int yoffset);
+extern int s3cfb_set_buffer_paddr(struct s3cfb_global *ctrl, int id, dma_addr_t start_addr);
 extern int s3cfb_set_buffer_size(struct s3cfb_global *ctrl, int id);
 extern int s3cfb_set_chroma_key(struct s3cfb_global *ctrl, int id);
 
+/* in-kernel producers, e.g. fimc capture, showing their buffers directly */
+extern int s3cfb_overlay_attach(int id, void (*latched)(void *priv, dma_addr_t addr, ktime_t vsync), void *priv);
+extern int s3cfb_overlay_queue(int id, dma_addr_t addr);
+extern void s3cfb_overlay_detach(int id);
+
 #ifdef CONFIG_HAS_WAKELOCK
 #ifdef CONFIG_HAS_EARLYSUSPEND
 extern void s3cfb_early_suspend(struct early_suspend *h);
@@ -250,6 +250,7 @@ int s3cfb_set_vsync_interrupt(struct s3cfb_global *ctrl, int enable)
 	}
 
 	writel(cfg, ctrl->regs + S3C_VIDINTCON0);
+	ctrl->vsync_irq = enable;
 
 	return 0;	
 }
@@ -416,18 +417,33 @@ int s3cfb_set_window_control(struct s3cfb_global *ctrl, int id)
 }
 
 int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
+{
+	return s3cfb_set_buffer_yoffset(ctrl, id, ctrl->fb[id]->var.yoffset);
+}
+
+int s3cfb_set_buffer_yoffset(struct s3cfb_global *ctrl, int id,
+			     unsigned int yoffset)
 {
 	struct fb_fix_screeninfo *fix = &ctrl->fb[id]->fix;
 	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
-	dma_addr_t start_addr = 0, end_addr = 0;
+	dma_addr_t start_addr = 0;
 
-	if (fix->smem_start) {
+	if (fix->smem_start)
 		start_addr = fix->smem_start + (var->xres_virtual * \
-				(var->bits_per_pixel / 8) * var->yoffset);
+				(var->bits_per_pixel / 8) * yoffset);
+
+	return s3cfb_set_buffer_paddr(ctrl, id, start_addr);
+}
 
+int s3cfb_set_buffer_paddr(struct s3cfb_global *ctrl, int id,
+			   dma_addr_t start_addr)
+{
+	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
+	dma_addr_t end_addr = 0;
+
+	if (start_addr)
 		end_addr = start_addr + (var->xres_virtual * \
 				(var->bits_per_pixel / 8) * var->yres);
-	}
 
 	writel(start_addr, ctrl->regs + S3C_VIDADDR_START0(id));
 	writel(end_addr, ctrl->regs + S3C_VIDADDR_END0(id));
@@ -304,6 +304,7 @@ int s3cfb_set_vsync_interrupt(struct s3cfb_global *ctrl, int enable)
 	}
 
 	writel(cfg, ctrl->regs + S3C_VIDINTCON0);
+	ctrl->vsync_irq = enable;
 
 	return 0;
 }
@@ -562,20 +563,36 @@ int s3cfb_set_window_control(struct s3cfb_global *ctrl, int id)
 }
 
 int s3cfb_set_buffer_address(struct s3cfb_global *ctrl, int id)
+{
+	return s3cfb_set_buffer_yoffset(ctrl, id, ctrl->fb[id]->var.yoffset);
+}
+
+int s3cfb_set_buffer_yoffset(struct s3cfb_global *ctrl, int id,
+			     unsigned int yoffset)
 {
 	struct fb_fix_screeninfo *fix = &ctrl->fb[id]->fix;
 	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
-	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
-	dma_addr_t start_addr = 0, end_addr = 0;
-	u32 shw;
+	dma_addr_t start_addr = 0;
 
-	if (fix->smem_start) {
+	if (fix->smem_start)
 		start_addr = fix->smem_start + ((var->xres_virtual *
-				var->yoffset + var->xoffset) *
+				yoffset + var->xoffset) *
 				(var->bits_per_pixel / 8));
-		
+
+	return s3cfb_set_buffer_paddr(ctrl, id, start_addr);
+}
+
+int s3cfb_set_buffer_paddr(struct s3cfb_global *ctrl, int id,
+			   dma_addr_t start_addr)
+{
+	struct fb_fix_screeninfo *fix = &ctrl->fb[id]->fix;
+	struct fb_var_screeninfo *var = &ctrl->fb[id]->var;
+	struct s3c_platform_fb *pdata = to_fb_plat(ctrl->dev);
+	dma_addr_t end_addr = 0;
+	u32 shw;
+
+	if (start_addr)
 		end_addr = start_addr + fix->line_length * var->yres;
-	}
 
 	if (pdata->hw_ver == 0x62) {
 		shw = readl(ctrl->regs + S3C_WINSHMAP);
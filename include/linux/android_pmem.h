@@ -50,6 +50,14 @@ struct android_pmem_platform_data
 	unsigned cached;
 	/* The MSM7k has bits to enable a write buffer in the bus controller*/
 	unsigned buffered;
+	/* set to manage the region with a best-fit extent allocator instead
+	 * of the power-of-two buddy bitmap, allocations are then rounded up
+	 * to PAGE_SIZE only */
+	unsigned best_fit;
+	/* in best-fit mode, set to allow allocations that are neither mapped
+	 * nor referenced through get_pmem_file to be moved when a request
+	 * cannot be satisfied because free space is fragmented */
+	unsigned compact;
 };
 
 struct pmem_region {
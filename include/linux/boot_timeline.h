@@ -0,0 +1,39 @@
+#ifndef _LINUX_BOOT_TIMELINE_H
+#define _LINUX_BOOT_TIMELINE_H
+
+#include <linux/init.h>
+
+struct device;
+struct device_driver;
+
+#ifdef CONFIG_BOOT_TIMELINE
+
+/*
+ * Every recorder returns the slot of its event, to be passed to
+ * boot_timeline_end() once the call has returned. The slot is negative when
+ * the timeline is full, in which case boot_timeline_end() does nothing.
+ */
+extern int boot_timeline_initcall(initcall_t fn);
+extern int boot_timeline_probe(struct device *dev, struct device_driver *drv);
+extern void boot_timeline_end(int slot, int ret);
+extern void boot_timeline_mark(const char *name);
+
+#else
+
+static inline int boot_timeline_initcall(initcall_t fn)
+{
+	return -1;
+}
+
+static inline int boot_timeline_probe(struct device *dev,
+				      struct device_driver *drv)
+{
+	return -1;
+}
+
+static inline void boot_timeline_end(int slot, int ret) {}
+static inline void boot_timeline_mark(const char *name) {}
+
+#endif
+
+#endif
@@ -16,9 +16,11 @@
 #define __INCLUDE_PLAT_CAN_MICRO_H
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 #ifdef __KERNEL__
 # include <linux/spinlock.h>
+# include <linux/wait.h>
 #endif
 
 #ifdef __cplusplus
@@ -41,6 +43,30 @@ extern "C" {
 #define IO_CAN_nRST		_IOR(MICRO_DRIVER_MAGIC, 10, int)	/* LOW: CAN processor has been reset */
 #define IO_CAN_RES		_IOR(MICRO_DRIVER_MAGIC, 11, int)	/* Spare pin */
 
+/* Event queue */
+#define IO_CAN_SET_COALESCE	_IOW(MICRO_DRIVER_MAGIC, 20, int)	/* Coalescing window in us, 0 disables */
+
+/*
+ * One event as read from the device. Interrupts that follow each other
+ * within the coalescing window are merged into a single event, as long as
+ * no reader has picked that event up yet. Timestamps are CLOCK_MONOTONIC
+ * in ns. Every open file has its own position in the queue; a reader that
+ * falls more than MICRO_EVENT_RING_SIZE events behind continues at the
+ * oldest event still queued, which is flagged MICRO_EVENT_LOST.
+ */
+struct micro_event {
+	__s64	timestamp;	/* first interrupt */
+	__s64	last;		/* last interrupt merged into this event */
+	__u32	sequence;
+	__u16	count;		/* number of interrupts merged */
+	__u16	flags;
+};
+
+#define MICRO_EVENT_LOST	(1 << 0)	/* events before this one were dropped */
+#define MICRO_EVENT_RESET	(1 << 1)	/* nRST was low at the first interrupt */
+
+#define MICRO_EVENT_RING_SIZE	64	/* must be a power of two */
+
 
 #ifdef __KERNEL__
 struct can_micro_dev {
@@ -61,6 +87,14 @@ struct can_micro_dev {
 	unsigned count;
 	int irq;
 	struct fasync_struct *fasync_listeners;
+
+	/* Event queue, filled from the interrupt handler */
+	spinlock_t event_lock;
+	struct micro_event events[MICRO_EVENT_RING_SIZE];
+	u32 event_head;		/* sequence of the next event */
+	u32 event_consumed;	/* events before this one were handed to a reader */
+	s64 coalesce_ns;
+	wait_queue_head_t event_wait;
 };
 #endif
 
@@ -127,6 +127,9 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	bool suppress_bind_attrs;	/* disables bind/unbind via sysfs */
+	bool async_probe;		/* probe from an async thread */
+	const char * const *async_probe_after; /* NULL terminated names of
+						  drivers to wait for */
 
 	int (*probe) (struct device *dev);
 	int (*remove) (struct device *dev);
@@ -29,18 +29,29 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ * Handlers flagged EARLY_SUSPEND_ASYNC only depend on the handlers of other
+ * levels, and are run concurrently with the rest of their level. A level is
+ * complete before the next one starts.
+ * The time taken by each call is kept in the structure and shown in debugfs.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
 	EARLY_SUSPEND_LEVEL_STOP_DRAWING = 100,
 	EARLY_SUSPEND_LEVEL_DISABLE_FB = 150,
 };
+#define EARLY_SUSPEND_ASYNC	(1U << 0)
+
 struct early_suspend {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct list_head link;
 	int level;
+	unsigned int flags;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	unsigned int suspend_us;
+	unsigned int suspend_max_us;
+	unsigned int resume_us;
+	unsigned int resume_max_us;
 #endif
 };
 
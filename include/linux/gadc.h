@@ -17,6 +17,7 @@
 #include <linux/spinlock.h>
 #include <linux/poll.h>
 #include <linux/wait.h>
+#include <linux/hrtimer.h>
 #endif
 
 /* Kernel and userspace defines. */
@@ -30,6 +31,9 @@
 #define ADC_GET_BUFFERSTATUS	_IOR(ADC_DRIVER_MAGIC, 3, unsigned long int )
 struct gadc_format;
 #define ADC_GET_FORMAT		_IOR(ADC_DRIVER_MAGIC, 4, struct gadc_format * )
+#define ADC_GET_RINGSIZE	_IOR(ADC_DRIVER_MAGIC, 5, unsigned long int )
+#define ADC_GET_OVERFLOWS	_IOR(ADC_DRIVER_MAGIC, 6, unsigned long int )
+#define ADC_SET_WATERMARK	_IOW(ADC_DRIVER_MAGIC, 7, unsigned long int )
 
 /* Major number used by the GADC driver. */
 #define GADC_DRIVER_NAME	"gadc"
@@ -56,6 +60,19 @@ struct gadc_sample
 	unsigned long int	value;
 };
 
+/* Sample ring. The device can be mmap'ed with the length returned by ADC_GET_RINGSIZE, which */
+/* maps this header followed by the samples. The kernel only ever writes head, the reader only */
+/* ever writes tail. Both are free running; slot (index & (size - 1)) holds the sample. When the */
+/* ring is full new samples are dropped and counted in overflows. */
+struct gadc_ring
+{
+	volatile unsigned long int	head;		/* Written by the kernel after the sample is stored. */
+	volatile unsigned long int	tail;		/* Written by the reader after the sample is consumed. */
+	unsigned long int		size;		/* Number of slots, always a power of two. */
+	unsigned long int		overflows;	/* Samples dropped because the ring was full. */
+	struct gadc_sample		samples[0];
+};
+
 #ifdef __KERNEL__
 /* Kernel ONLY structures and defines. */
 struct gadc_platform_data
@@ -75,6 +92,8 @@ struct gadc_cdev
 	void		*private;
 };
 
+struct gadc_platform_channel;
+
 struct gadc_buffer
 {
 	struct gadc_sample	buffer[ADC_BUFFER_SIZE];
@@ -84,6 +103,21 @@ struct gadc_buffer
 	spinlock_t		lock;
 	wait_queue_head_t	poll_queue;
 	unsigned long int	sample_rate;
+
+	/* Sample ring, see struct gadc_ring. Head, size and overflows are kept here as well, so */
+	/* that a reader scribbling over its mapping can't make the kernel write outside the ring. */
+	struct gadc_ring	*ring;
+	unsigned long int	ring_head;
+	unsigned long int	ring_size;
+	unsigned long int	ring_bytes;
+	unsigned long int	ring_overflows;
+	unsigned long int	watermark;
+
+	/* High resolution sampler, see gadc_start_sampler. */
+	struct hrtimer		timer;
+	ktime_t			period;
+	void (*start_conversion)( struct gadc_platform_channel *channel );
+	struct gadc_platform_channel	*conversion_channel;
 };
 
 struct gadc_platform_channel
@@ -102,6 +136,11 @@ struct gadc_platform_interface
 	void (*start_channel)( struct gadc_platform_channel *channel );
 	void (*stop_channel) ( struct gadc_platform_channel *channel );
 	int  (*is_running)   ( struct gadc_platform_channel *channel );
+
+	/* Starts a single conversion. Called from an hrtimer at the requested samplerate, so in */
+	/* hard interrupt context, and must not sleep. The platform hands the result to */
+	/* gadc_add_sample when the conversion completes. */
+	void (*start_conversion)( struct gadc_platform_channel *channel );
 };
 
 extern void unregister_gadc_cdev( struct gadc_cdev *cdev );
@@ -120,6 +159,15 @@ extern int gadc_wait_buffer_fill( struct gadc_buffer *adc, int *samplecount );
 extern void gadc_poll_wait( struct file *file, struct gadc_buffer *adc, poll_table *wait );
 extern int gadc_get_moving_avg( struct gadc_buffer *adc, struct gadc_sample *target, int nr_samples );
 extern int gadc_wait_buffer_overflow( struct gadc_buffer *adc );
+extern int gadc_alloc_ring( struct gadc_buffer *adc, unsigned long int nr_samples );
+extern void gadc_free_ring( struct gadc_buffer *adc );
+extern int gadc_mmap_ring( struct gadc_buffer *adc, struct vm_area_struct *vma );
+extern unsigned long int gadc_get_ring_count( struct gadc_buffer *adc );
+extern ssize_t gadc_read_ring( struct gadc_buffer *adc, char __user *buf, size_t count );
+extern int gadc_wait_ring_fill( struct gadc_buffer *adc );
+extern int gadc_start_sampler( struct gadc_buffer *adc, struct gadc_platform_channel *channel,
+				void (*start_conversion)( struct gadc_platform_channel *channel ) );
+extern void gadc_stop_sampler( struct gadc_buffer *adc );
 
 #endif /* #ifdef __KERNEL__ */
 
@@ -39,6 +39,7 @@ extern void (*pm_power_off_prepare)(void);
  */
 
 struct device;
+struct pm_profile_dev;
 
 typedef struct pm_message {
 	int event;
@@ -415,6 +416,9 @@ struct dev_pm_info {
 #ifdef CONFIG_PM_SLEEP
 	struct list_head	entry;
 #endif
+#ifdef CONFIG_PM_PROFILE
+	struct pm_profile_dev	*profile;
+#endif
 #ifdef CONFIG_PM_RUNTIME
 	struct timer_list	suspend_timer;
 	unsigned long		timer_expires;
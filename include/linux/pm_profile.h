@@ -0,0 +1,66 @@
+#ifndef _LINUX_PM_PROFILE_H
+#define _LINUX_PM_PROFILE_H
+
+#include <linux/ktime.h>
+
+/*
+ * Phases of a suspend to RAM cycle, in the order they run. The device phases
+ * run by the driver core also account the callbacks of each device.
+ *
+ * sysdev_suspend() and sysdev_resume() are not timed: they suspend and
+ * resume timekeeping, so ktime_get() cannot be used across them, and the
+ * S5P sched_clock() stops along with the clock event device.
+ */
+enum pm_profile_phase {
+	PM_PROFILE_SYNC,		/* sys_sync() before suspending */
+	PM_PROFILE_FREEZE,		/* notifiers and freezing tasks */
+	PM_PROFILE_PREPARE,		/* dpm_prepare() */
+	PM_PROFILE_SUSPEND,		/* dpm_suspend() */
+	PM_PROFILE_SUSPEND_NOIRQ,	/* dpm_suspend_noirq() */
+	PM_PROFILE_RESUME_NOIRQ,	/* dpm_resume_noirq() */
+	PM_PROFILE_RESUME,		/* dpm_resume() */
+	PM_PROFILE_COMPLETE,		/* dpm_complete() */
+	PM_PROFILE_THAW,		/* thawing tasks and notifiers */
+	PM_PROFILE_NR_PHASES
+};
+
+struct device;
+
+#ifdef CONFIG_PM_PROFILE
+
+static inline ktime_t pm_profile_time(void)
+{
+	return ktime_get();
+}
+
+/*
+ * A cycle runs from the outermost pm_profile_begin() to the matching
+ * pm_profile_end(), so the callers of pm_suspend() can account their own
+ * work to the same cycle. Nothing is recorded outside of a cycle.
+ */
+extern void pm_profile_begin(void);
+extern void pm_profile_end(int error);
+extern void pm_profile_phase(enum pm_profile_phase phase, ktime_t start);
+extern void pm_profile_device(struct device *dev, enum pm_profile_phase phase,
+			      ktime_t start);
+extern void pm_profile_remove(struct device *dev);
+
+#else
+
+static inline ktime_t pm_profile_time(void)
+{
+	return ktime_set(0, 0);
+}
+
+static inline void pm_profile_begin(void) {}
+static inline void pm_profile_end(int error) {}
+static inline void pm_profile_phase(enum pm_profile_phase phase,
+				    ktime_t start) {}
+static inline void pm_profile_device(struct device *dev,
+				     enum pm_profile_phase phase,
+				     ktime_t start) {}
+static inline void pm_profile_remove(struct device *dev) {}
+
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * include/linux/sensor_stream.h
+ *
+ * Shared sample stream for the motion sensors (accelerometers, gyroscopes).
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef INCLUDE_LINUX_SENSOR_STREAM_H
+#define INCLUDE_LINUX_SENSOR_STREAM_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define SENSOR_STREAM_DEV_NAME	"sensor_stream"
+
+/* sample types */
+#define SENSOR_STREAM_ACCEL	1	/* x, y, z in mm/s2 or mg, as the driver reports them */
+#define SENSOR_STREAM_GYRO	2	/* x, y, z in the unit of the driver's input device */
+
+/*
+ * One sample as read from /dev/sensor_stream. Samples of all sources are
+ * stored in a single ring, in the order they were drained from the sensors.
+ * Timestamps are CLOCK_MONOTONIC in ns; samples that came out of a hardware
+ * FIFO get timestamps interpolated from the interrupt time and the measured
+ * sample period.
+ */
+struct sensor_stream_sample {
+	__s64	timestamp;
+	__u16	source;		/* id of the source, see SENSOR_STREAM_GET_SOURCE */
+	__u16	type;		/* SENSOR_STREAM_ACCEL or SENSOR_STREAM_GYRO */
+	__s32	x;
+	__s32	y;
+	__s32	z;
+};
+
+struct sensor_stream_source_info {
+	__u16	source;		/* in: index, out: id used in samples */
+	__u16	type;
+	__u32	period_ns;	/* current estimate of the sample period */
+	__u32	dropped;	/* samples lost because the ring was full */
+	char	name[20];
+};
+
+#define SENSOR_STREAM_MAGIC		'S'
+/* number of samples that must be queued before poll/read wake up */
+#define SENSOR_STREAM_SET_WATERMARK	_IOW(SENSOR_STREAM_MAGIC, 1, __u32)
+#define SENSOR_STREAM_GET_SOURCE	_IOWR(SENSOR_STREAM_MAGIC, 2, struct sensor_stream_source_info)
+#define SENSOR_STREAM_GET_DROPPED	_IOR(SENSOR_STREAM_MAGIC, 3, __u32)
+
+#ifdef __KERNEL__
+
+#include <linux/ktime.h>
+#include <linux/list.h>
+
+struct i2c_client;
+
+/*
+ * A sensor feeding the stream. The driver fills in name and type before
+ * registering; everything else is owned by the stream core.
+ */
+struct sensor_stream_source {
+	const char		*name;
+	u16			type;
+
+	/* private */
+	u16			id;
+	struct list_head	list;
+	ktime_t			last;		/* timestamp of the newest sample pushed */
+	s64			period_ns;	/* smoothed sample period */
+	unsigned long		dropped;
+};
+
+extern int sensor_stream_register(struct sensor_stream_source *src);
+extern void sensor_stream_unregister(struct sensor_stream_source *src);
+extern void sensor_stream_start(struct sensor_stream_source *src, s64 period_ns);
+
+/*
+ * Queue n samples, oldest first. Sample 'anchor' was taken at time 'stamp'
+ * (typically the watermark interrupt); the others are placed around it at
+ * the measured sample period.
+ */
+extern void sensor_stream_push(struct sensor_stream_source *src,
+			       const s32 (*xyz)[3], int n, int anchor,
+			       ktime_t stamp);
+
+/* read len bytes starting at reg in a single combined I2C transfer */
+extern int sensor_stream_i2c_burst(struct i2c_client *client, u8 reg,
+				   u8 *buf, int len);
+
+#endif /* __KERNEL__ */
+
+#endif /* INCLUDE_LINUX_SENSOR_STREAM_H */
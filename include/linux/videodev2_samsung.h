@@ -83,6 +83,8 @@ enum v4l2_photometry_mode {
 #define V4L2_CID_FIMC_VERSION		(V4L2_CID_PRIVATE_BASE + 21)
 
 #define V4L2_CID_STREAM_PAUSE			(V4L2_CID_PRIVATE_BASE + 53)
+/* fb window fed directly with captured frames, -1 for none */
+#define V4L2_CID_CAPTURE_TO_FB			(V4L2_CID_PRIVATE_BASE + 54)
 
 
 /*      Pixel format FOURCC depth  Description  */
@@ -65,6 +65,7 @@
 #include <linux/idr.h>
 #include <linux/ftrace.h>
 #include <linux/async.h>
+#include <linux/boot_timeline.h>
 #include <linux/kmemcheck.h>
 #include <linux/kmemtrace.h>
 #include <linux/sfi.h>
@@ -709,6 +710,7 @@ int do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
 	ktime_t calltime, delta, rettime;
+	int slot;
 
 	if (initcall_debug) {
 		call.caller = task_pid_nr(current);
@@ -718,7 +720,9 @@ int do_one_initcall(initcall_t fn)
 		enable_boot_trace();
 	}
 
+	slot = boot_timeline_initcall(fn);
 	ret.result = fn();
+	boot_timeline_end(slot, ret.result);
 
 	if (initcall_debug) {
 		disable_boot_trace();
@@ -819,6 +823,8 @@ static noinline int init_post(void)
 
 	current->signal->flags |= SIGNAL_UNKILLABLE;
 
+	boot_timeline_mark("init");
+
 	if (ramdisk_execute_command) {
 		run_init_process(ramdisk_execute_command);
 		printk(KERN_WARNING "Failed to execute %s\n",
@@ -886,6 +892,8 @@ static int __init kernel_init(void * unused)
 	if (!ramdisk_execute_command)
 		ramdisk_execute_command = "/init";
 
+	wait_for_initramfs();
+
 	if (sys_access((const char __user *) ramdisk_execute_command, 0) != 0) {
 		ramdisk_execute_command = NULL;
 		prepare_namespace();
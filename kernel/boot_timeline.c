@@ -0,0 +1,240 @@
+/*
+ * kernel/boot_timeline.c - Timeline of initcalls and driver probes.
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This file is released under the GPLv2
+ *
+ *
+ * Every initcall and every driver probe is recorded with its start and end
+ * time, the pid it ran in and its return value, so that a chart of the boot
+ * can be drawn including the probes run by async threads. Unlike
+ * initcall_debug this costs no printk per call and needs no boot option.
+ *
+ * Events are stored in a fixed table until it is full and are shown in
+ * debugfs/boot_timeline, one per line:
+ *
+ *	<type> <start_us> <end_us> <pid> <ret> <name> [<device>]
+ *
+ * where type is "initcall", "probe" or "mark", and end_us is "-" for a call
+ * that has not returned yet.
+ */
+
+#include <linux/boot_timeline.h>
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+
+#include <asm/atomic.h>
+
+#define BOOT_TIMELINE_ENTRIES	CONFIG_BOOT_TIMELINE_ENTRIES
+#define BOOT_TIMELINE_NAME_LEN	20
+
+enum boot_timeline_type {
+	BOOT_TIMELINE_INITCALL,
+	BOOT_TIMELINE_PROBE,
+	BOOT_TIMELINE_MARK,
+};
+
+static const char *boot_timeline_types[] = {
+	[BOOT_TIMELINE_INITCALL]	= "initcall",
+	[BOOT_TIMELINE_PROBE]		= "probe",
+	[BOOT_TIMELINE_MARK]		= "mark",
+};
+
+struct boot_timeline_event {
+	ktime_t		start;
+	ktime_t		end;		/* zero while running */
+	pid_t		pid;
+	int		ret;
+	int		type;
+	initcall_t	fn;		/* initcalls */
+	char		name[BOOT_TIMELINE_NAME_LEN];	/* driver or mark */
+	char		dev[BOOT_TIMELINE_NAME_LEN];
+};
+
+static struct boot_timeline_event events[BOOT_TIMELINE_ENTRIES];
+static atomic_t next_event = ATOMIC_INIT(0);
+
+static struct boot_timeline_event *boot_timeline_get(int *slot, int type)
+{
+	struct boot_timeline_event *ev;
+
+	*slot = atomic_inc_return(&next_event) - 1;
+	if (*slot >= BOOT_TIMELINE_ENTRIES) {
+		*slot = -1;
+		return NULL;
+	}
+
+	ev = &events[*slot];
+	ev->type = type;
+	ev->pid = task_pid_nr(current);
+	return ev;
+}
+
+/**
+ * boot_timeline_initcall - Record the start of an initcall.
+ * @fn: Initcall about to run.
+ *
+ * The function is resolved to its name only when the timeline is shown, so
+ * that recording stays cheap.
+ */
+int boot_timeline_initcall(initcall_t fn)
+{
+	struct boot_timeline_event *ev;
+	int slot;
+
+	ev = boot_timeline_get(&slot, BOOT_TIMELINE_INITCALL);
+	if (ev) {
+		ev->fn = fn;
+		ev->start = ktime_get();
+	}
+	return slot;
+}
+
+/**
+ * boot_timeline_probe - Record the start of a driver probe.
+ * @dev: Device being probed.
+ * @drv: Driver probing it.
+ */
+int boot_timeline_probe(struct device *dev, struct device_driver *drv)
+{
+	struct boot_timeline_event *ev;
+	int slot;
+
+	ev = boot_timeline_get(&slot, BOOT_TIMELINE_PROBE);
+	if (ev) {
+		strlcpy(ev->name, drv->name, sizeof(ev->name));
+		strlcpy(ev->dev, dev_name(dev), sizeof(ev->dev));
+		ev->start = ktime_get();
+	}
+	return slot;
+}
+
+/**
+ * boot_timeline_end - Record the end of an initcall or probe.
+ * @slot: Slot returned when the call was recorded.
+ * @ret: Return value of the call.
+ */
+void boot_timeline_end(int slot, int ret)
+{
+	struct boot_timeline_event *ev;
+
+	if (slot < 0)
+		return;
+
+	ev = &events[slot];
+	ev->ret = ret;
+	ev->end = ktime_get();
+}
+
+/**
+ * boot_timeline_mark - Record a point in time, such as starting init.
+ * @name: Name of the mark.
+ */
+void boot_timeline_mark(const char *name)
+{
+	struct boot_timeline_event *ev;
+	int slot;
+
+	ev = boot_timeline_get(&slot, BOOT_TIMELINE_MARK);
+	if (ev) {
+		strlcpy(ev->name, name, sizeof(ev->name));
+		ev->start = ktime_get();
+		ev->end = ev->start;
+	}
+}
+
+static int boot_timeline_count(void)
+{
+	return min(atomic_read(&next_event), BOOT_TIMELINE_ENTRIES);
+}
+
+static void *boot_timeline_start(struct seq_file *s, loff_t *pos)
+{
+	if (*pos == 0)
+		return SEQ_START_TOKEN;
+	if (*pos > boot_timeline_count())
+		return NULL;
+	return &events[*pos - 1];
+}
+
+static void *boot_timeline_next(struct seq_file *s, void *v, loff_t *pos)
+{
+	++*pos;
+	return boot_timeline_start(s, pos);
+}
+
+static void boot_timeline_stop(struct seq_file *s, void *v)
+{
+}
+
+static int boot_timeline_show(struct seq_file *s, void *v)
+{
+	struct boot_timeline_event *ev = v;
+	int dropped;
+
+	if (v == SEQ_START_TOKEN) {
+		dropped = atomic_read(&next_event) - BOOT_TIMELINE_ENTRIES;
+		if (dropped > 0)
+			seq_printf(s, "# %d events dropped\n", dropped);
+		seq_printf(s, "# type start_us end_us pid ret name [device]\n");
+		return 0;
+	}
+
+	seq_printf(s, "%s %llu ", boot_timeline_types[ev->type],
+		   (unsigned long long)ktime_to_us(ev->start));
+	if (ev->end.tv64)
+		seq_printf(s, "%llu", (unsigned long long)ktime_to_us(ev->end));
+	else
+		seq_putc(s, '-');
+	seq_printf(s, " %d %d ", ev->pid, ev->ret);
+
+	switch (ev->type) {
+	case BOOT_TIMELINE_INITCALL:
+		seq_printf(s, "%pf\n", ev->fn);
+		break;
+	case BOOT_TIMELINE_PROBE:
+		seq_printf(s, "%s %s\n", ev->name, ev->dev);
+		break;
+	default:
+		seq_printf(s, "%s\n", ev->name);
+		break;
+	}
+
+	return 0;
+}
+
+static const struct seq_operations boot_timeline_seq_ops = {
+	.start	= boot_timeline_start,
+	.next	= boot_timeline_next,
+	.stop	= boot_timeline_stop,
+	.show	= boot_timeline_show,
+};
+
+static int boot_timeline_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &boot_timeline_seq_ops);
+}
+
+static const struct file_operations boot_timeline_fops = {
+	.owner		= THIS_MODULE,
+	.open		= boot_timeline_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init boot_timeline_init(void)
+{
+	debugfs_create_file("boot_timeline", S_IRUGO, NULL, NULL,
+			    &boot_timeline_fops);
+	return 0;
+}
+
+late_initcall(boot_timeline_init);
@@ -13,10 +13,15 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/seq_file.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
@@ -26,12 +31,16 @@
 enum {
 	DEBUG_USER_STATE = 1U << 0,
 	DEBUG_SUSPEND = 1U << 2,
+	DEBUG_TIMING = 1U << 3,
 };
 static int debug_mask = DEBUG_USER_STATE;
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
+static int async_handlers = 1;
+module_param_named(async, async_handlers, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
+static LIST_HEAD(early_suspend_domain);
 static void early_suspend(struct work_struct *work);
 static void late_resume(struct work_struct *work);
 static DECLARE_WORK(early_suspend_work, early_suspend);
@@ -44,10 +53,74 @@ enum {
 };
 static int state;
 
+static void call_suspend(struct early_suspend *h)
+{
+	ktime_t start = ktime_get();
+
+	h->suspend(h);
+	h->suspend_us = ktime_us_delta(ktime_get(), start);
+	if (h->suspend_us > h->suspend_max_us)
+		h->suspend_max_us = h->suspend_us;
+	if (debug_mask & DEBUG_TIMING)
+		pr_info("early_suspend: %pf took %u us\n", h->suspend,
+			h->suspend_us);
+}
+
+static void call_resume(struct early_suspend *h)
+{
+	ktime_t start = ktime_get();
+
+	h->resume(h);
+	h->resume_us = ktime_us_delta(ktime_get(), start);
+	if (h->resume_us > h->resume_max_us)
+		h->resume_max_us = h->resume_us;
+	if (debug_mask & DEBUG_TIMING)
+		pr_info("late_resume: %pf took %u us\n", h->resume,
+			h->resume_us);
+}
+
+static void call_suspend_async(void *data, async_cookie_t cookie)
+{
+	call_suspend(data);
+}
+
+static void call_resume_async(void *data, async_cookie_t cookie)
+{
+	call_resume(data);
+}
+
+/*
+ * Called with early_suspend_lock held, in level order for suspend and in
+ * reverse for resume. The handlers of a level are all done before the first
+ * one of the next level is called.
+ */
+static void call_handler(struct early_suspend *h, int resume, int *level)
+{
+	if ((resume ? h->resume : h->suspend) == NULL)
+		return;
+
+	if (h->level != *level) {
+		async_synchronize_full_domain(&early_suspend_domain);
+		*level = h->level;
+	}
+
+	if (async_handlers && (h->flags & EARLY_SUSPEND_ASYNC))
+		async_schedule_domain(resume ? call_resume_async :
+				      call_suspend_async, h,
+				      &early_suspend_domain);
+	else if (resume)
+		call_resume(h);
+	else
+		call_suspend(h);
+}
+
 void register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
 
+	handler->suspend_us = handler->suspend_max_us = 0;
+	handler->resume_us = handler->resume_max_us = 0;
+
 	mutex_lock(&early_suspend_lock);
 	list_for_each(pos, &early_suspend_handlers) {
 		struct early_suspend *e;
@@ -57,7 +130,7 @@ void register_early_suspend(struct early_suspend *handler)
 	}
 	list_add_tail(&handler->link, pos);
 	if ((state & SUSPENDED) && handler->suspend)
-		handler->suspend(handler);
+		call_suspend(handler);
 	mutex_unlock(&early_suspend_lock);
 }
 EXPORT_SYMBOL(register_early_suspend);
@@ -75,6 +148,8 @@ static void early_suspend(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MIN;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -93,10 +168,13 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL)
-			pos->suspend(pos);
-	}
+	start = ktime_get();
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		call_handler(pos, 0, &level);
+	async_synchronize_full_domain(&early_suspend_domain);
+	if (debug_mask & DEBUG_TIMING)
+		pr_info("early_suspend: handlers took %lld us\n",
+			ktime_us_delta(ktime_get(), start));
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -115,6 +193,8 @@ static void late_resume(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level = INT_MIN;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -131,9 +211,13 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
+	start = ktime_get();
 	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
-		if (pos->resume != NULL)
-			pos->resume(pos);
+		call_handler(pos, 1, &level);
+	async_synchronize_full_domain(&early_suspend_domain);
+	if (debug_mask & DEBUG_TIMING)
+		pr_info("late_resume: handlers took %lld us\n",
+			ktime_us_delta(ktime_get(), start));
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 abort:
@@ -178,3 +262,64 @@ suspend_state_t get_suspend_state(void)
 }
 
 EXPORT_SYMBOL(get_suspend_state);
+
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_stats_show(struct seq_file *s, void *unused)
+{
+	struct early_suspend *pos;
+
+	seq_printf(s, "level async suspend last/max (us)  resume last/max (us)"
+		   "  handler\n");
+
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		seq_printf(s, "%-5d %-5s %10u/%-10u %10u/%-10u %pf\n",
+			   pos->level,
+			   (pos->flags & EARLY_SUSPEND_ASYNC) ? "yes" : "no",
+			   pos->suspend_us, pos->suspend_max_us,
+			   pos->resume_us, pos->resume_max_us,
+			   pos->suspend ? pos->suspend : pos->resume);
+	mutex_unlock(&early_suspend_lock);
+
+	return 0;
+}
+
+static int early_suspend_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_stats_show, NULL);
+}
+
+static ssize_t early_suspend_stats_write(struct file *file,
+					 const char __user *buf,
+					 size_t count, loff_t *ppos)
+{
+	struct early_suspend *pos;
+
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link) {
+		pos->suspend_max_us = 0;
+		pos->resume_max_us = 0;
+	}
+	mutex_unlock(&early_suspend_lock);
+
+	return count;
+}
+
+static const struct file_operations early_suspend_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= early_suspend_stats_open,
+	.read		= seq_read,
+	.write		= early_suspend_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_debugfs_init(void)
+{
+	debugfs_create_file("early_suspend", S_IRUGO | S_IWUSR, NULL, NULL,
+			    &early_suspend_stats_fops);
+	return 0;
+}
+
+late_initcall(early_suspend_debugfs_init);
+#endif
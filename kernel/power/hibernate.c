@@ -22,6 +22,7 @@
 #include <linux/console.h>
 #include <linux/cpu.h>
 #include <linux/freezer.h>
+#include <linux/ktime.h>
 #include <scsi/scsi_scan.h>
 #include <asm/suspend.h>
 
@@ -29,6 +30,7 @@
 
 
 static int noresume = 0;
+static int nocompress = 0;
 static char resume_file[256] = CONFIG_PM_STD_PARTITION;
 dev_t swsusp_resume_device;
 sector_t swsusp_resume_block;
@@ -590,6 +592,8 @@ int hibernate(void)
 
 		if (hibernation_mode == HIBERNATION_PLATFORM)
 			flags |= SF_PLATFORM_MODE;
+		if (nocompress)
+			flags |= SF_NOCOMPRESS_MODE;
 		pr_debug("PM: writing image.\n");
 		error = swsusp_write(flags);
 		swsusp_free();
@@ -630,6 +634,7 @@ static int software_resume(void)
 {
 	int error;
 	unsigned int flags;
+	ktime_t start, checked, frozen, loaded;
 
 	/*
 	 * If the user said "noresume".. bail out early.
@@ -686,9 +691,11 @@ static int software_resume(void)
 		MAJOR(swsusp_resume_device), MINOR(swsusp_resume_device));
 
 	pr_debug("PM: Checking hibernation image.\n");
+	start = ktime_get();
 	error = swsusp_check();
 	if (error)
 		goto Unlock;
+	checked = ktime_get();
 
 	/* The snapshot device should not be opened while we're running */
 	if (!atomic_add_unless(&snapshot_device_available, -1, 0)) {
@@ -718,11 +725,19 @@ static int software_resume(void)
 	}
 
 	pr_debug("PM: Reading hibernation image.\n");
+	frozen = ktime_get();
 
 	error = swsusp_read(&flags);
 	swsusp_close(FMODE_READ);
-	if (!error)
+	if (!error) {
+		loaded = ktime_get();
+		printk(KERN_INFO "PM: Restore phases: check %ld ms, prepare "
+			"%ld ms, load %ld ms\n",
+			(long)ktime_us_delta(checked, start) / 1000,
+			(long)ktime_us_delta(frozen, checked) / 1000,
+			(long)ktime_us_delta(loaded, frozen) / 1000);
 		hibernation_restore(flags & SF_PLATFORM_MODE);
+	}
 
 	printk(KERN_ERR "PM: Restore failed, recovering.\n");
 	swsusp_free();
@@ -962,6 +977,14 @@ static int __init noresume_setup(char *str)
 	return 1;
 }
 
+static int __init hibernate_setup(char *str)
+{
+	if (!strncmp(str, "nocompress", 10))
+		nocompress = 1;
+	return 1;
+}
+
 __setup("noresume", noresume_setup);
+__setup("hibernate=", hibernate_setup);
 __setup("resume_offset=", resume_offset_setup);
 __setup("resume=", resume_setup);
@@ -14,6 +14,7 @@
 #include <linux/init.h>
 #include <linux/console.h>
 #include <linux/cpu.h>
+#include <linux/pm_profile.h>
 #include <linux/syscalls.h>
 
 #include "power.h"
@@ -256,6 +257,7 @@ static void suspend_finish(void)
  */
 int enter_state(suspend_state_t state)
 {
+	ktime_t start;
 	int error;
 
 	if (!valid_state(state))
@@ -264,12 +266,18 @@ int enter_state(suspend_state_t state)
 	if (!mutex_trylock(&pm_mutex))
 		return -EBUSY;
 
+	pm_profile_begin();
+
 	printk(KERN_INFO "PM: Syncing filesystems ... ");
+	start = pm_profile_time();
 	sys_sync();
+	pm_profile_phase(PM_PROFILE_SYNC, start);
 	printk("done.\n");
 
 	pr_debug("PM: Preparing system for %s sleep\n", pm_states[state]);
+	start = pm_profile_time();
 	error = suspend_prepare();
+	pm_profile_phase(PM_PROFILE_FREEZE, start);
 	if (error)
 		goto Unlock;
 
@@ -281,8 +289,11 @@ int enter_state(suspend_state_t state)
 
  Finish:
 	pr_debug("PM: Finishing wakeup.\n");
+	start = pm_profile_time();
 	suspend_finish();
+	pm_profile_phase(PM_PROFILE_THAW, start);
  Unlock:
+	pm_profile_end(error);
 	mutex_unlock(&pm_mutex);
 	return error;
 }
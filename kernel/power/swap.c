@@ -23,6 +23,14 @@
 #include <linux/swap.h>
 #include <linux/swapops.h>
 #include <linux/pm.h>
+#include <linux/slab.h>
+#include <linux/completion.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/lzo.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+#include <asm/atomic.h>
 
 #include "power.h"
 
@@ -45,27 +53,84 @@ static struct swsusp_header *swsusp_header;
 static unsigned short root_swap = 0xffff;
 static struct block_device *resume_bdev;
 
+/*
+ *	Asynchronous I/O is done in batches: the bios of a batch are
+ *	submitted without waiting for each other and hib_wait_io() waits for
+ *	all of them at once, so the block layer can merge and queue them.
+ *
+ *	The count is biased by one until hib_wait_io(), so the completion is
+ *	only signalled once the waiter is there to consume it.
+ */
+
+struct hib_bio_batch {
+	atomic_t		count;
+	struct completion	done;
+	int			error;
+};
+
+static void hib_init_batch(struct hib_bio_batch *hb)
+{
+	atomic_set(&hb->count, 1);
+	init_completion(&hb->done);
+	hb->error = 0;
+}
+
+static void hib_end_io(struct bio *bio, int error)
+{
+	struct hib_bio_batch *hb = bio->bi_private;
+	struct page *page = bio->bi_io_vec[0].bv_page;
+
+	if (!error && !test_bit(BIO_UPTODATE, &bio->bi_flags))
+		error = -EIO;
+
+	if (error) {
+		printk(KERN_ALERT "PM: I/O error %d\n", error);
+		if (!hb->error)
+			hb->error = error;
+	}
+
+	/* Pages written asynchronously are copies made by write_page() */
+	if (bio_data_dir(bio) == WRITE)
+		put_page(page);
+
+	if (atomic_dec_and_test(&hb->count))
+		complete(&hb->done);
+
+	bio_put(bio);
+}
+
+static int hib_wait_io(struct hib_bio_batch *hb)
+{
+	blk_unplug(bdev_get_queue(resume_bdev));
+	if (!atomic_dec_and_test(&hb->count))
+		wait_for_completion(&hb->done);
+
+	/* Ready for the next batch */
+	INIT_COMPLETION(hb->done);
+	atomic_set(&hb->count, 1);
+	return hb->error;
+}
+
 /**
  *	submit - submit BIO request.
  *	@rw:	READ or WRITE.
  *	@off	physical offset of page.
  *	@page:	page we're reading or writing.
- *	@bio_chain: list of pending biod (for async reading)
+ *	@hb:	batch to add the request to (for async I/O)
  *
  *	Straight from the textbook - allocate and initialize the bio.
  *	If we're reading, make sure the page is marked as dirty.
- *	Then submit it and, if @bio_chain == NULL, wait.
+ *	Then submit it and, if @hb == NULL, wait.
  */
 static int submit(int rw, pgoff_t page_off, struct page *page,
-			struct bio **bio_chain)
+			struct hib_bio_batch *hb)
 {
-	const int bio_rw = rw | (1 << BIO_RW_SYNCIO) | (1 << BIO_RW_UNPLUG);
+	const int bio_rw = rw | (1 << BIO_RW_SYNCIO);
 	struct bio *bio;
 
 	bio = bio_alloc(__GFP_WAIT | __GFP_HIGH, 1);
 	bio->bi_sector = page_off * (PAGE_SIZE >> 9);
 	bio->bi_bdev = resume_bdev;
-	bio->bi_end_io = end_swap_bio_read;
 
 	if (bio_add_page(bio, page, PAGE_SIZE, 0) < PAGE_SIZE) {
 		printk(KERN_ERR "PM: Adding page to bio failed at %ld\n",
@@ -74,61 +139,35 @@ static int submit(int rw, pgoff_t page_off, struct page *page,
 		return -EFAULT;
 	}
 
-	lock_page(page);
-	bio_get(bio);
-
-	if (bio_chain == NULL) {
+	if (hb) {
+		/* The queue is unplugged by hib_wait_io() */
+		bio->bi_end_io = hib_end_io;
+		bio->bi_private = hb;
+		atomic_inc(&hb->count);
 		submit_bio(bio_rw, bio);
+	} else {
+		bio->bi_end_io = end_swap_bio_read;
+		lock_page(page);
+		bio_get(bio);
+		submit_bio(bio_rw | (1 << BIO_RW_UNPLUG), bio);
 		wait_on_page_locked(page);
 		if (rw == READ)
 			bio_set_pages_dirty(bio);
 		bio_put(bio);
-	} else {
-		if (rw == READ)
-			get_page(page);	/* These pages are freed later */
-		bio->bi_private = *bio_chain;
-		*bio_chain = bio;
-		submit_bio(bio_rw, bio);
 	}
 	return 0;
 }
 
-static int bio_read_page(pgoff_t page_off, void *addr, struct bio **bio_chain)
-{
-	return submit(READ, page_off, virt_to_page(addr), bio_chain);
-}
-
-static int bio_write_page(pgoff_t page_off, void *addr, struct bio **bio_chain)
+static int hib_bio_read_page(pgoff_t page_off, void *addr,
+				struct hib_bio_batch *hb)
 {
-	return submit(WRITE, page_off, virt_to_page(addr), bio_chain);
+	return submit(READ, page_off, virt_to_page(addr), hb);
 }
 
-static int wait_on_bio_chain(struct bio **bio_chain)
+static int hib_bio_write_page(pgoff_t page_off, void *addr,
+				struct hib_bio_batch *hb)
 {
-	struct bio *bio;
-	struct bio *next_bio;
-	int ret = 0;
-
-	if (bio_chain == NULL)
-		return 0;
-
-	bio = *bio_chain;
-	if (bio == NULL)
-		return 0;
-	while (bio) {
-		struct page *page;
-
-		next_bio = bio->bi_private;
-		page = bio->bi_io_vec[0].bv_page;
-		wait_on_page_locked(page);
-		if (!PageUptodate(page) || PageError(page))
-			ret = -EIO;
-		put_page(page);
-		bio_put(bio);
-		bio = next_bio;
-	}
-	*bio_chain = NULL;
-	return ret;
+	return submit(WRITE, page_off, virt_to_page(addr), hb);
 }
 
 /*
@@ -139,14 +178,14 @@ static int mark_swapfiles(sector_t start, unsigned int flags)
 {
 	int error;
 
-	bio_read_page(swsusp_resume_block, swsusp_header, NULL);
+	hib_bio_read_page(swsusp_resume_block, swsusp_header, NULL);
 	if (!memcmp("SWAP-SPACE",swsusp_header->sig, 10) ||
 	    !memcmp("SWAPSPACE2",swsusp_header->sig, 10)) {
 		memcpy(swsusp_header->orig_sig,swsusp_header->sig, 10);
 		memcpy(swsusp_header->sig,SWSUSP_SIG, 10);
 		swsusp_header->image = start;
 		swsusp_header->flags = flags;
-		error = bio_write_page(swsusp_resume_block,
+		error = hib_bio_write_page(swsusp_resume_block,
 					swsusp_header, NULL);
 	} else {
 		printk(KERN_ERR "PM: Swap header not found!\n");
@@ -185,29 +224,44 @@ static int swsusp_swap_check(void) /* This is called before saving image */
  *	write_page - Write one page to given swap location.
  *	@buf:		Address we're writing.
  *	@offset:	Offset of the swap page we're writing to.
- *	@bio_chain:	Link the next write BIO here
+ *	@hb:		Batch to add the write to
+ *
+ *	Asynchronous writes are done from a copy of @buf, so the caller may
+ *	reuse it at once. If no page is free for the copy, the pages of the
+ *	batch are waited for first.
  */
 
-static int write_page(void *buf, sector_t offset, struct bio **bio_chain)
+static int write_page(void *buf, sector_t offset, struct hib_bio_batch *hb)
 {
 	void *src;
+	int error;
 
 	if (!offset)
 		return -ENOSPC;
 
-	if (bio_chain) {
-		src = (void *)__get_free_page(__GFP_WAIT | __GFP_HIGH);
+	if (hb) {
+		src = (void *)__get_free_page(__GFP_WAIT | __GFP_NOWARN |
+						__GFP_NORETRY);
+		if (!src) {
+			error = hib_wait_io(hb);
+			if (error)
+				return error;
+			src = (void *)__get_free_page(__GFP_WAIT | __GFP_HIGH);
+		}
 		if (src) {
 			memcpy(src, buf, PAGE_SIZE);
+		} else if (is_vmalloc_addr(buf)) {
+			/* LZO buffers can't be handed to the block layer */
+			return -ENOMEM;
 		} else {
 			WARN_ON_ONCE(1);
-			bio_chain = NULL;	/* Go synchronous */
+			hb = NULL;	/* Go synchronous */
 			src = buf;
 		}
 	} else {
 		src = buf;
 	}
-	return bio_write_page(offset, src, bio_chain);
+	return hib_bio_write_page(offset, src, hb);
 }
 
 /*
@@ -221,8 +275,8 @@ static int write_page(void *buf, sector_t offset, struct bio **bio_chain)
  *	allocated and populated one at a time, so we only need one memory
  *	page to set up the entire structure.
  *
- *	During resume we also only need to use one swap_map_page structure
- *	at a time.
+ *	During resume all of the swap map pages are read in before the image
+ *	data, so the reads of the data never wait for a swap map page.
  */
 
 #define MAP_PAGE_ENTRIES	(PAGE_SIZE / sizeof(sector_t) - 1)
@@ -232,6 +286,11 @@ struct swap_map_page {
 	sector_t next_swap;
 };
 
+struct swap_map_page_list {
+	struct swap_map_page *map;
+	struct swap_map_page_list *next;
+};
+
 /**
  *	The swap_map_handle structure is used for handling swap in
  *	a file-alike way
@@ -239,6 +298,7 @@ struct swap_map_page {
 
 struct swap_map_handle {
 	struct swap_map_page *cur;
+	struct swap_map_page_list *maps;
 	sector_t cur_swap;
 	unsigned int k;
 };
@@ -265,7 +325,7 @@ static int get_swap_writer(struct swap_map_handle *handle)
 }
 
 static int swap_write_page(struct swap_map_handle *handle, void *buf,
-				struct bio **bio_chain)
+				struct hib_bio_batch *hb)
 {
 	int error = 0;
 	sector_t offset;
@@ -273,14 +333,17 @@ static int swap_write_page(struct swap_map_handle *handle, void *buf,
 	if (!handle->cur)
 		return -EINVAL;
 	offset = alloc_swapdev_block(root_swap);
-	error = write_page(buf, offset, bio_chain);
+	error = write_page(buf, offset, hb);
 	if (error)
 		return error;
 	handle->cur->entries[handle->k++] = offset;
 	if (handle->k >= MAP_PAGE_ENTRIES) {
-		error = wait_on_bio_chain(bio_chain);
-		if (error)
-			goto out;
+		/* Don't let the copies of more than one map page pile up */
+		if (hb) {
+			error = hib_wait_io(hb);
+			if (error)
+				goto out;
+		}
 		offset = alloc_swapdev_block(root_swap);
 		if (!offset)
 			return -ENOSPC;
@@ -316,30 +379,216 @@ static int save_image(struct swap_map_handle *handle,
 	int ret;
 	int nr_pages;
 	int err2;
-	struct bio *bio;
+	struct hib_bio_batch hb;
 	struct timeval start;
 	struct timeval stop;
 
+	hib_init_batch(&hb);
+
 	printk(KERN_INFO "PM: Saving image data pages (%u pages) ...     ",
 		nr_to_write);
 	m = nr_to_write / 100;
 	if (!m)
 		m = 1;
 	nr_pages = 0;
-	bio = NULL;
 	do_gettimeofday(&start);
 	while (1) {
 		ret = snapshot_read_next(snapshot, PAGE_SIZE);
 		if (ret <= 0)
 			break;
-		ret = swap_write_page(handle, data_of(*snapshot), &bio);
+		ret = swap_write_page(handle, data_of(*snapshot), &hb);
 		if (ret)
 			break;
 		if (!(nr_pages % m))
 			printk("\b\b\b\b%3d%%", nr_pages / m);
 		nr_pages++;
 	}
-	err2 = wait_on_bio_chain(&bio);
+	err2 = hib_wait_io(&hb);
+	do_gettimeofday(&stop);
+	if (!ret)
+		ret = err2;
+	if (!ret)
+		printk("\b\b\b\bdone\n");
+	else
+		printk("\n");
+	swsusp_show_speed(&start, &stop, nr_to_write, "Wrote");
+	return ret;
+}
+
+/*
+ *	The LZO compressed image is a stream of chunks of up to LZO_UNC_PAGES
+ *	image pages. Each chunk is stored as the length of its compressed
+ *	data followed by the data, padded to a whole number of swap pages.
+ *
+ *	The chunks are compressed and decompressed by worker threads, while
+ *	the caller does the I/O and copies pages to and from the snapshot.
+ *	One CPU is left to the caller, but at least one worker is always
+ *	used, so that even a single CPU overlaps the I/O with the LZO work.
+ */
+
+#define LZO_HEADER	sizeof(size_t)
+#define LZO_UNC_PAGES	32
+#define LZO_UNC_SIZE	(LZO_UNC_PAGES * PAGE_SIZE)
+#define LZO_CMP_PAGES	DIV_ROUND_UP(lzo1x_worst_compress(LZO_UNC_SIZE) + \
+				     LZO_HEADER, PAGE_SIZE)
+#define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
+#define LZO_THREADS	3
+
+static unsigned int lzo_nr_threads(void)
+{
+	unsigned int nr_threads = num_online_cpus() - 1;
+
+	return clamp_val(nr_threads, 1, LZO_THREADS);
+}
+
+struct cmp_data {
+	struct task_struct *thr;	/* worker thread */
+	atomic_t ready;			/* unc[] is filled */
+	atomic_t stop;			/* cmp[] is filled */
+	int ret;			/* lzo1x_1_compress() result */
+	wait_queue_head_t go;
+	wait_queue_head_t done;
+	size_t unc_len;
+	size_t cmp_len;
+	unsigned char unc[LZO_UNC_SIZE];
+	unsigned char cmp[LZO_CMP_SIZE];
+	unsigned char wrk[LZO1X_1_MEM_COMPRESS];
+};
+
+static int lzo_compress_threadfn(void *data)
+{
+	struct cmp_data *d = data;
+
+	while (1) {
+		wait_event(d->go, atomic_read(&d->ready) ||
+				  kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+		atomic_set(&d->ready, 0);
+
+		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
+					  d->cmp + LZO_HEADER, &d->cmp_len,
+					  d->wrk);
+		atomic_set(&d->stop, 1);
+		wake_up(&d->done);
+	}
+	return 0;
+}
+
+/**
+ *	save_image_lzo - save the suspend image data, LZO compressed
+ */
+
+static int save_image_lzo(struct swap_map_handle *handle,
+			  struct snapshot_handle *snapshot,
+			  unsigned int nr_to_write)
+{
+	unsigned int m;
+	int ret = 0;
+	int nr_pages;
+	int err2;
+	struct hib_bio_batch hb;
+	struct timeval start;
+	struct timeval stop;
+	struct cmp_data *data, *d;
+	unsigned int thr, run_threads, nr_threads;
+	size_t off;
+
+	hib_init_batch(&hb);
+
+	nr_threads = lzo_nr_threads();
+	data = vmalloc(sizeof(*data) * nr_threads);
+	if (!data) {
+		printk(KERN_ERR "PM: Failed to allocate LZO buffers\n");
+		return -ENOMEM;
+	}
+	memset(data, 0, sizeof(*data) * nr_threads);
+
+	for (thr = 0; thr < nr_threads; thr++) {
+		d = &data[thr];
+		init_waitqueue_head(&d->go);
+		init_waitqueue_head(&d->done);
+		d->thr = kthread_run(lzo_compress_threadfn, d,
+				     "image_compress/%u", thr);
+		if (IS_ERR(d->thr)) {
+			ret = PTR_ERR(d->thr);
+			d->thr = NULL;
+			printk(KERN_ERR "PM: Cannot start compression threads\n");
+			goto out_clean;
+		}
+	}
+
+	printk(KERN_INFO "PM: Compressing and saving image data "
+		"(%u pages, %u threads) ...     ", nr_to_write, nr_threads);
+	m = nr_to_write / 100;
+	if (!m)
+		m = 1;
+	nr_pages = 0;
+	do_gettimeofday(&start);
+	for (;;) {
+		for (run_threads = 0; run_threads < nr_threads; run_threads++) {
+			d = &data[run_threads];
+			for (off = 0; off < LZO_UNC_SIZE; off += PAGE_SIZE) {
+				ret = snapshot_read_next(snapshot, PAGE_SIZE);
+				if (ret < 0)
+					goto out_finish;
+				if (!ret)
+					break;
+
+				memcpy(d->unc + off, data_of(*snapshot),
+				       PAGE_SIZE);
+
+				if (!(nr_pages % m))
+					printk("\b\b\b\b%3d%%", nr_pages / m);
+				nr_pages++;
+			}
+			if (!off)
+				break;
+
+			d->unc_len = off;
+			atomic_set(&d->ready, 1);
+			wake_up(&d->go);
+		}
+
+		if (!run_threads)
+			break;
+
+		/* Write the chunks in order, the remaining ones compress */
+		for (thr = 0; thr < run_threads; thr++) {
+			d = &data[thr];
+
+			wait_event(d->done, atomic_read(&d->stop));
+			atomic_set(&d->stop, 0);
+
+			ret = d->ret;
+			if (ret < 0) {
+				printk(KERN_ERR "PM: LZO compression failed\n");
+				ret = -EIO;
+				goto out_finish;
+			}
+
+			if (unlikely(!d->cmp_len || d->cmp_len >
+				     lzo1x_worst_compress(d->unc_len))) {
+				printk(KERN_ERR
+				       "PM: Invalid LZO compressed length\n");
+				ret = -EINVAL;
+				goto out_finish;
+			}
+
+			*(size_t *)d->cmp = d->cmp_len;
+
+			for (off = 0; off < LZO_HEADER + d->cmp_len;
+			     off += PAGE_SIZE) {
+				ret = swap_write_page(handle, d->cmp + off,
+						      &hb);
+				if (ret)
+					goto out_finish;
+			}
+		}
+	}
+
+out_finish:
+	err2 = hib_wait_io(&hb);
 	do_gettimeofday(&stop);
 	if (!ret)
 		ret = err2;
@@ -348,6 +597,11 @@ static int save_image(struct swap_map_handle *handle,
 	else
 		printk("\n");
 	swsusp_show_speed(&start, &stop, nr_to_write, "Wrote");
+out_clean:
+	for (thr = 0; thr < nr_threads; thr++)
+		if (data[thr].thr)
+			kthread_stop(data[thr].thr);
+	vfree(data);
 	return ret;
 }
 
@@ -358,12 +612,18 @@ static int save_image(struct swap_map_handle *handle,
  *	space avaiable from the resume partition.
  */
 
-static int enough_swap(unsigned int nr_pages)
+static int enough_swap(unsigned int nr_pages, unsigned int flags)
 {
 	unsigned int free_swap = count_swap_pages(root_swap, 1);
+	unsigned int required;
 
 	pr_debug("PM: Free swap pages: %u\n", free_swap);
-	return free_swap > nr_pages + PAGES_FOR_IO;
+
+	/* An LZO compressed image may not shrink at all */
+	required = (flags & SF_NOCOMPRESS_MODE) ? nr_pages :
+		DIV_ROUND_UP(nr_pages, LZO_UNC_PAGES) * LZO_CMP_PAGES;
+
+	return free_swap > required + PAGES_FOR_IO;
 }
 
 /**
@@ -398,7 +658,7 @@ int swsusp_write(unsigned int flags)
 		goto out;
 	}
 	header = (struct swsusp_info *)data_of(snapshot);
-	if (!enough_swap(header->pages)) {
+	if (!enough_swap(header->pages, flags)) {
 		printk(KERN_ERR "PM: Not enough free swap\n");
 		error = -ENOSPC;
 		goto out;
@@ -408,9 +668,14 @@ int swsusp_write(unsigned int flags)
 		sector_t start = handle.cur_swap;
 
 		error = swap_write_page(&handle, header, NULL);
-		if (!error)
-			error = save_image(&handle, &snapshot,
-					header->pages - 1);
+		if (!error) {
+			if (flags & SF_NOCOMPRESS_MODE)
+				error = save_image(&handle, &snapshot,
+						header->pages - 1);
+			else
+				error = save_image_lzo(&handle, &snapshot,
+						header->pages - 1);
+		}
 
 		if (!error) {
 			flush_swap_writer(&handle);
@@ -435,34 +700,64 @@ int swsusp_write(unsigned int flags)
 
 static void release_swap_reader(struct swap_map_handle *handle)
 {
-	if (handle->cur)
-		free_page((unsigned long)handle->cur);
+	struct swap_map_page_list *tmp;
+
+	while (handle->maps) {
+		if (handle->maps->map)
+			free_page((unsigned long)handle->maps->map);
+		tmp = handle->maps;
+		handle->maps = handle->maps->next;
+		kfree(tmp);
+	}
 	handle->cur = NULL;
 }
 
 static int get_swap_reader(struct swap_map_handle *handle, sector_t start)
 {
+	struct swap_map_page_list *tmp, *last = NULL;
+	sector_t offset = start;
 	int error;
 
+	handle->cur = NULL;
+	handle->maps = NULL;
 	if (!start)
 		return -EINVAL;
 
-	handle->cur = (struct swap_map_page *)get_zeroed_page(__GFP_WAIT | __GFP_HIGH);
-	if (!handle->cur)
-		return -ENOMEM;
+	while (offset) {
+		tmp = kzalloc(sizeof(*tmp), GFP_KERNEL);
+		if (!tmp) {
+			release_swap_reader(handle);
+			return -ENOMEM;
+		}
+		if (last)
+			last->next = tmp;
+		else
+			handle->maps = tmp;
+		last = tmp;
 
-	error = bio_read_page(start, handle->cur, NULL);
-	if (error) {
-		release_swap_reader(handle);
-		return error;
+		tmp->map = (struct swap_map_page *)
+				__get_free_page(__GFP_WAIT | __GFP_HIGH);
+		if (!tmp->map) {
+			release_swap_reader(handle);
+			return -ENOMEM;
+		}
+
+		error = hib_bio_read_page(offset, tmp->map, NULL);
+		if (error) {
+			release_swap_reader(handle);
+			return error;
+		}
+		offset = tmp->map->next_swap;
 	}
 	handle->k = 0;
+	handle->cur = handle->maps->map;
 	return 0;
 }
 
 static int swap_read_page(struct swap_map_handle *handle, void *buf,
-				struct bio **bio_chain)
+				struct hib_bio_batch *hb)
 {
+	struct swap_map_page_list *tmp;
 	sector_t offset;
 	int error;
 
@@ -471,17 +766,19 @@ static int swap_read_page(struct swap_map_handle *handle, void *buf,
 	offset = handle->cur->entries[handle->k];
 	if (!offset)
 		return -EFAULT;
-	error = bio_read_page(offset, buf, bio_chain);
+	error = hib_bio_read_page(offset, buf, hb);
 	if (error)
 		return error;
 	if (++handle->k >= MAP_PAGE_ENTRIES) {
-		error = wait_on_bio_chain(bio_chain);
 		handle->k = 0;
-		offset = handle->cur->next_swap;
-		if (!offset)
+		free_page((unsigned long)handle->maps->map);
+		tmp = handle->maps;
+		handle->maps = handle->maps->next;
+		kfree(tmp);
+		if (!handle->maps)
 			release_swap_reader(handle);
-		else if (!error)
-			error = bio_read_page(offset, handle->cur, NULL);
+		else
+			handle->cur = handle->maps->map;
 	}
 	return error;
 }
@@ -500,34 +797,35 @@ static int load_image(struct swap_map_handle *handle,
 	int error = 0;
 	struct timeval start;
 	struct timeval stop;
-	struct bio *bio;
+	struct hib_bio_batch hb;
 	int err2;
 	unsigned nr_pages;
 
+	hib_init_batch(&hb);
+
 	printk(KERN_INFO "PM: Loading image data pages (%u pages) ...     ",
 		nr_to_read);
 	m = nr_to_read / 100;
 	if (!m)
 		m = 1;
 	nr_pages = 0;
-	bio = NULL;
 	do_gettimeofday(&start);
 	for ( ; ; ) {
 		error = snapshot_write_next(snapshot, PAGE_SIZE);
 		if (error <= 0)
 			break;
-		error = swap_read_page(handle, data_of(*snapshot), &bio);
+		error = swap_read_page(handle, data_of(*snapshot), &hb);
 		if (error)
 			break;
 		if (snapshot->sync_read)
-			error = wait_on_bio_chain(&bio);
+			error = hib_wait_io(&hb);
 		if (error)
 			break;
 		if (!(nr_pages % m))
 			printk("\b\b\b\b%3d%%", nr_pages / m);
 		nr_pages++;
 	}
-	err2 = wait_on_bio_chain(&bio);
+	err2 = hib_wait_io(&hb);
 	do_gettimeofday(&stop);
 	if (!error)
 		error = err2;
@@ -542,6 +840,237 @@ static int load_image(struct swap_map_handle *handle,
 	return error;
 }
 
+struct dec_data {
+	struct task_struct *thr;	/* worker thread */
+	atomic_t ready;			/* the chunk is read */
+	atomic_t stop;			/* unc[] is filled */
+	int ret;			/* lzo1x_decompress_safe() result */
+	wait_queue_head_t go;
+	wait_queue_head_t done;
+	size_t unc_len;
+	size_t cmp_len;
+	size_t expect;			/* unc_len of a valid chunk, 0 if idle */
+	unsigned int cmp_pages;
+	unsigned char *page[LZO_CMP_PAGES];	/* the chunk as read */
+	unsigned char unc[LZO_UNC_SIZE];
+	unsigned char cmp[LZO_CMP_SIZE];
+};
+
+static int lzo_decompress_threadfn(void *data)
+{
+	struct dec_data *d = data;
+	unsigned int i;
+
+	while (1) {
+		wait_event(d->go, atomic_read(&d->ready) ||
+				  kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+		atomic_set(&d->ready, 0);
+
+		for (i = 0; i < d->cmp_pages; i++)
+			memcpy(d->cmp + i * PAGE_SIZE, d->page[i], PAGE_SIZE);
+
+		d->unc_len = LZO_UNC_SIZE;
+		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
+					       d->unc, &d->unc_len);
+		atomic_set(&d->stop, 1);
+		wake_up(&d->done);
+	}
+	return 0;
+}
+
+/*
+ * Read one compressed chunk into the pages of @d. The pages of the chunk are
+ * read as one batch once its length is known from the first one.
+ */
+static int lzo_read_chunk(struct swap_map_handle *handle, struct dec_data *d,
+			  struct hib_bio_batch *hb)
+{
+	unsigned int i;
+	int error;
+
+	error = swap_read_page(handle, d->page[0], hb);
+	if (!error)
+		error = hib_wait_io(hb);
+	if (error)
+		return error;
+
+	d->cmp_len = *(size_t *)d->page[0];
+	if (unlikely(!d->cmp_len ||
+		     d->cmp_len > lzo1x_worst_compress(LZO_UNC_SIZE))) {
+		printk(KERN_ERR "PM: Invalid LZO compressed length\n");
+		return -EINVAL;
+	}
+
+	d->cmp_pages = DIV_ROUND_UP(LZO_HEADER + d->cmp_len, PAGE_SIZE);
+	for (i = 1; i < d->cmp_pages; i++) {
+		error = swap_read_page(handle, d->page[i], hb);
+		if (error)
+			return error;
+	}
+	return hib_wait_io(hb);
+}
+
+/**
+ *	load_image_lzo - load the LZO compressed image using the swap map
+ *	handle @handle and the snapshot handle @snapshot
+ *
+ *	The workers are used as a ring: while the chunk of one of them is
+ *	copied into the image, the others decompress theirs and the next
+ *	chunk is read into the one that was just copied.
+ */
+
+static int load_image_lzo(struct swap_map_handle *handle,
+			  struct snapshot_handle *snapshot,
+			  unsigned int nr_to_read)
+{
+	unsigned int m;
+	int ret = 0;
+	int err2;
+	struct hib_bio_batch hb;
+	struct timeval start;
+	struct timeval stop;
+	ktime_t t;
+	s64 read_us = 0, wait_us = 0, copy_us = 0;
+	struct dec_data *data, *d;
+	unsigned int thr, nr_threads, i;
+	unsigned int nr_pages, nr_queued;
+	size_t off;
+
+	hib_init_batch(&hb);
+
+	nr_threads = lzo_nr_threads();
+	data = vmalloc(sizeof(*data) * nr_threads);
+	if (!data) {
+		printk(KERN_ERR "PM: Failed to allocate LZO buffers\n");
+		return -ENOMEM;
+	}
+	memset(data, 0, sizeof(*data) * nr_threads);
+
+	for (thr = 0; thr < nr_threads; thr++) {
+		d = &data[thr];
+		init_waitqueue_head(&d->go);
+		init_waitqueue_head(&d->done);
+		for (i = 0; i < LZO_CMP_PAGES; i++) {
+			d->page[i] = (void *)__get_free_page(__GFP_WAIT |
+							      __GFP_HIGH);
+			if (!d->page[i]) {
+				printk(KERN_ERR
+				       "PM: Failed to allocate LZO pages\n");
+				ret = -ENOMEM;
+				goto out_clean;
+			}
+		}
+		d->thr = kthread_run(lzo_decompress_threadfn, d,
+				     "image_decompress/%u", thr);
+		if (IS_ERR(d->thr)) {
+			ret = PTR_ERR(d->thr);
+			d->thr = NULL;
+			printk(KERN_ERR
+			       "PM: Cannot start decompression threads\n");
+			goto out_clean;
+		}
+	}
+
+	printk(KERN_INFO "PM: Loading and decompressing image data "
+		"(%u pages, %u threads) ...     ", nr_to_read, nr_threads);
+	m = nr_to_read / 100;
+	if (!m)
+		m = 1;
+	nr_pages = 0;
+	nr_queued = 0;
+	do_gettimeofday(&start);
+
+	ret = snapshot_write_next(snapshot, PAGE_SIZE);
+	if (ret <= 0)
+		goto out_finish;
+
+	for (thr = 0; ; thr = (thr + 1) % nr_threads) {
+		d = &data[thr];
+
+		if (d->expect) {
+			t = ktime_get();
+			wait_event(d->done, atomic_read(&d->stop));
+			atomic_set(&d->stop, 0);
+			wait_us += ktime_us_delta(ktime_get(), t);
+
+			if (d->ret < 0 || d->unc_len != d->expect) {
+				printk(KERN_ERR
+				       "PM: LZO decompression failed\n");
+				ret = -EIO;
+				goto out_finish;
+			}
+			d->expect = 0;
+
+			t = ktime_get();
+			for (off = 0; off < d->unc_len; off += PAGE_SIZE) {
+				memcpy(data_of(*snapshot), d->unc + off,
+				       PAGE_SIZE);
+
+				if (!(nr_pages % m))
+					printk("\b\b\b\b%3d%%", nr_pages / m);
+				nr_pages++;
+
+				ret = snapshot_write_next(snapshot, PAGE_SIZE);
+				if (ret < 0)
+					goto out_finish;
+				if (!ret && nr_pages < nr_to_read) {
+					ret = -ENODATA;
+					goto out_finish;
+				}
+			}
+			copy_us += ktime_us_delta(ktime_get(), t);
+		}
+
+		if (nr_queued < nr_to_read) {
+			t = ktime_get();
+			ret = lzo_read_chunk(handle, d, &hb);
+			read_us += ktime_us_delta(ktime_get(), t);
+			if (ret)
+				goto out_finish;
+
+			d->expect = min_t(unsigned int, LZO_UNC_PAGES,
+					  nr_to_read - nr_queued) * PAGE_SIZE;
+			nr_queued += d->expect >> PAGE_SHIFT;
+			atomic_set(&d->ready, 1);
+			wake_up(&d->go);
+		} else if (nr_pages >= nr_to_read) {
+			break;
+		}
+	}
+	ret = 0;
+
+out_finish:
+	err2 = hib_wait_io(&hb);
+	do_gettimeofday(&stop);
+	if (!ret)
+		ret = err2;
+	if (!ret) {
+		printk("\b\b\b\bdone\n");
+		snapshot_write_finalize(snapshot);
+		if (!snapshot_image_loaded(snapshot))
+			ret = -ENODATA;
+	} else
+		printk("\n");
+	swsusp_show_speed(&start, &stop, nr_to_read, "Read");
+	printk(KERN_INFO "PM: Image load phases: read %ld ms, "
+		"decompress %ld ms, copy %ld ms\n",
+		(long)read_us / 1000, (long)wait_us / 1000,
+		(long)copy_us / 1000);
+out_clean:
+	for (thr = 0; thr < nr_threads; thr++) {
+		d = &data[thr];
+		if (d->thr)
+			kthread_stop(d->thr);
+		for (i = 0; i < LZO_CMP_PAGES; i++)
+			if (d->page[i])
+				free_page((unsigned long)d->page[i]);
+	}
+	vfree(data);
+	return ret;
+}
+
 /**
  *	swsusp_read - read the hibernation image.
  *	@flags_p: flags passed by the "frozen" kernel in the image header should
@@ -554,6 +1083,7 @@ int swsusp_read(unsigned int *flags_p)
 	struct swap_map_handle handle;
 	struct snapshot_handle snapshot;
 	struct swsusp_info *header;
+	ktime_t start;
 
 	*flags_p = swsusp_header->flags;
 	if (IS_ERR(resume_bdev)) {
@@ -566,11 +1096,21 @@ int swsusp_read(unsigned int *flags_p)
 	if (error < PAGE_SIZE)
 		return error < 0 ? error : -EFAULT;
 	header = (struct swsusp_info *)data_of(snapshot);
+	start = ktime_get();
 	error = get_swap_reader(&handle, swsusp_header->image);
 	if (!error)
-		error = swap_read_page(&handle, header, NULL);
+		printk(KERN_INFO "PM: Read swap map in %ld ms\n",
+			(long)ktime_us_delta(ktime_get(), start) / 1000);
 	if (!error)
-		error = load_image(&handle, &snapshot, header->pages - 1);
+		error = swap_read_page(&handle, header, NULL);
+	if (!error) {
+		if (*flags_p & SF_NOCOMPRESS_MODE)
+			error = load_image(&handle, &snapshot,
+					header->pages - 1);
+		else
+			error = load_image_lzo(&handle, &snapshot,
+					header->pages - 1);
+	}
 	release_swap_reader(&handle);
 
 	if (!error)
@@ -592,7 +1132,7 @@ int swsusp_check(void)
 	if (!IS_ERR(resume_bdev)) {
 		set_blocksize(resume_bdev, PAGE_SIZE);
 		memset(swsusp_header, 0, PAGE_SIZE);
-		error = bio_read_page(swsusp_resume_block,
+		error = hib_bio_read_page(swsusp_resume_block,
 					swsusp_header, NULL);
 		if (error)
 			goto put;
@@ -600,7 +1140,7 @@ int swsusp_check(void)
 		if (!memcmp(SWSUSP_SIG, swsusp_header->sig, 10)) {
 			memcpy(swsusp_header->sig, swsusp_header->orig_sig, 10);
 			/* Reset swap signature now */
-			error = bio_write_page(swsusp_resume_block,
+			error = hib_bio_write_page(swsusp_resume_block,
 						swsusp_header, NULL);
 		} else {
 			error = -EINVAL;
@@ -0,0 +1,220 @@
+/*
+ * LZO decompressor for the Linux kernel, reading files written by lzop.
+ *
+ * Copyright (C) 2012 TomTom BV <http://www.tomtom.com/>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * An lzop file is a header followed by blocks of at most 256KiB of data,
+ * each preceded by its uncompressed and compressed sizes and by the
+ * checksums the header flags ask for. A zero uncompressed size ends the
+ * file. The checksums are skipped rather than verified: the LZO1X
+ * decompressor checks for input and output overruns itself, and speed is
+ * the reason to pick LZO over gzip.
+ */
+
+#ifdef STATIC
+#define PREBOOT
+#include "lzo/lzo1x_decompress.c"
+#else
+#include <linux/decompress/unlzo.h>
+#include <linux/lzo.h>
+#include <linux/slab.h>
+#endif /* STATIC */
+
+#include <linux/types.h>
+#include <linux/decompress/mm.h>
+
+#include <asm/unaligned.h>
+
+static const unsigned char lzop_magic[] = {
+	0x89, 0x4c, 0x5a, 0x4f, 0x00, 0x0d, 0x0a, 0x1a, 0x0a
+};
+
+#define LZO_BLOCK_SIZE		(256 * 1024l)
+
+/* lzop header flags */
+#define F_ADLER32_D		0x00000001L
+#define F_ADLER32_C		0x00000002L
+#define F_H_EXTRA_FIELD		0x00000040L
+#define F_CRC32_D		0x00000100L
+#define F_CRC32_C		0x00000200L
+#define F_H_FILTER		0x00000800L
+
+/*
+ * Returns the length of the lzop header at @in, or 0 if there is none.
+ * The flags telling which checksums follow each block are stored in @flags.
+ */
+STATIC int INIT parse_header(u8 *in, int len, u32 *flags)
+{
+	u8 *p = in, *end = in + len;
+	u16 version;
+	u32 extra;
+	int l;
+
+	if (len < sizeof(lzop_magic) + 2)
+		return 0;
+	for (l = 0; l < sizeof(lzop_magic); l++)
+		if (*p++ != lzop_magic[l])
+			return 0;
+
+	version = get_unaligned_be16(p);
+	p += 4;				/* version, library version */
+	if (version >= 0x0940)
+		p += 2;			/* version needed to extract */
+	p += 1;				/* method */
+	if (version >= 0x0940)
+		p += 1;			/* level */
+
+	if (end - p < 4)
+		return 0;
+	*flags = get_unaligned_be32(p);
+	p += 4;
+	if (*flags & F_H_FILTER)
+		p += 4;
+	p += 8;				/* mode, mtime */
+	if (version >= 0x0940)
+		p += 4;			/* mtime high */
+
+	if (end - p < 1)
+		return 0;
+	l = *p++;
+	p += l + 4;			/* file name, header checksum */
+
+	if (*flags & F_H_EXTRA_FIELD) {
+		if (end - p < 4)
+			return 0;
+		extra = get_unaligned_be32(p);
+		if (extra > len)
+			return 0;
+		p += 4 + extra + 4;	/* length, data, checksum */
+	}
+
+	if (p > end)
+		return 0;
+	return p - in;
+}
+
+STATIC inline int INIT unlzo(u8 *input, int in_len,
+			     int (*fill)(void *, unsigned int),
+			     int (*flush)(void *, unsigned int),
+			     u8 *output, int *posp,
+			     void (*error_fn)(char *x))
+{
+	u8 *in = input, *end = input + in_len;
+	u8 *out_buf;
+	u32 flags, dst_len, src_len;
+	int skip, csums_d, csums_c;
+	size_t tmp;
+	int ret = -1;
+
+	set_error_fn(error_fn);
+
+	if (!input || fill) {
+		error("unlzo needs all of its input in memory");
+		return -1;
+	}
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		return -1;
+	} else {
+		out_buf = large_malloc(LZO_BLOCK_SIZE);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			return -1;
+		}
+	}
+
+	skip = parse_header(in, in_len, &flags);
+	if (!skip) {
+		error("invalid header");
+		goto exit;
+	}
+	in += skip;
+
+	csums_d = !!(flags & F_ADLER32_D) + !!(flags & F_CRC32_D);
+	csums_c = !!(flags & F_ADLER32_C) + !!(flags & F_CRC32_C);
+
+	for (;;) {
+		if (end - in < 4)
+			goto truncated;
+		dst_len = get_unaligned_be32(in);
+		in += 4;
+
+		/* a zero length block ends the file */
+		if (!dst_len)
+			break;
+
+		if (dst_len > LZO_BLOCK_SIZE) {
+			error("dest len longer than block size");
+			goto exit;
+		}
+
+		if (end - in < 4)
+			goto truncated;
+		src_len = get_unaligned_be32(in);
+		in += 4;
+
+		if (!src_len || src_len > dst_len) {
+			error("file corrupted");
+			goto exit;
+		}
+
+		/* checksums of compressed data are only there if it shrunk */
+		skip = 4 * csums_d;
+		if (src_len < dst_len)
+			skip += 4 * csums_c;
+		if (end - in < skip || end - in - skip < src_len)
+			goto truncated;
+		in += skip;
+
+		/* blocks which did not shrink are stored as they are */
+		if (src_len == dst_len) {
+			memcpy(out_buf, in, src_len);
+		} else {
+			tmp = dst_len;
+			if (lzo1x_decompress_safe(in, src_len, out_buf,
+						  &tmp) != LZO_E_OK ||
+			    tmp != dst_len) {
+				error("Compressed data violation");
+				goto exit;
+			}
+		}
+		in += src_len;
+
+		if (flush && flush(out_buf, dst_len) != dst_len)
+			goto exit;
+		if (output)
+			out_buf += dst_len;
+	}
+
+	if (posp)
+		*posp = in - input;
+	ret = 0;
+	goto exit;
+
+truncated:
+	error("unexpected end of input");
+exit:
+	if (!output)
+		large_free(out_buf);
+	return ret;
+}
+
+#ifdef PREBOOT
+STATIC int INIT decompress(unsigned char *buf, int in_len,
+			   int (*fill)(void *, unsigned int),
+			   int (*flush)(void *, unsigned int),
+			   unsigned char *output,
+			   int *posp,
+			   void (*error_fn)(char *x))
+{
+	return unlzo(buf, in_len, fill, flush, output, posp, error_fn);
+}
+#endif
@@ -0,0 +1,223 @@
+/*
+ * s3c-dma-latency.c  --  Latency measurement for the audio DMA platform
+ *
+ * Records, per stream direction, the timing the DMA platform actually
+ * achieves: the delay from trigger to the first period interrupt, how far
+ * period interrupts stray from the nominal period time, and how far the
+ * hardware pointer runs ahead of the last period boundary. The results are
+ * shown in debugfs as s3c-pcm-latency; writing to the file clears them.
+ *
+ *  This program is free software; you can redistribute  it and/or modify it
+ *  under  the terms of  the GNU General  Public License as published by the
+ *  Free Software Foundation;  either version 2 of the  License, or (at your
+ *  option) any later version.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+
+#include <sound/pcm.h>
+
+#include "s3c-dma-latency.h"
+
+struct s3c_dma_latency {
+	/* stream configuration, in frames and ns */
+	unsigned int		rate;
+	snd_pcm_uframes_t	period;
+	snd_pcm_uframes_t	buffer;
+	s64			period_ns;
+	int			cyclic;
+
+	ktime_t			trigger;
+	ktime_t			last;
+
+	/* trigger to first period interrupt, less one period */
+	unsigned long		starts;
+	s64			start_last;
+	s64			start_max;
+
+	/* distance of a period interrupt from the nominal period time */
+	unsigned long		periods;
+	s64			jitter_max;
+	u64			jitter_total;
+
+	/* how far the hardware pointer ran ahead of the period boundary */
+	unsigned long		pointers;
+	long			lead_max;
+};
+
+static struct s3c_dma_latency s3c_dma_latency[2];
+static DEFINE_SPINLOCK(s3c_dma_latency_lock);
+
+#define to_latency(substream) (&s3c_dma_latency[(substream)->stream])
+
+void s3c_dma_latency_setup(struct snd_pcm_substream *substream,
+			   unsigned int rate, snd_pcm_uframes_t period,
+			   snd_pcm_uframes_t buffer, int cyclic)
+{
+	struct s3c_dma_latency *lat = to_latency(substream);
+	unsigned long flags;
+
+	spin_lock_irqsave(&s3c_dma_latency_lock, flags);
+	lat->rate = rate;
+	lat->period = period;
+	lat->buffer = buffer;
+	lat->cyclic = cyclic;
+	lat->period_ns = rate ? div_u64((u64)period * NSEC_PER_SEC, rate) : 0;
+	spin_unlock_irqrestore(&s3c_dma_latency_lock, flags);
+}
+EXPORT_SYMBOL_GPL(s3c_dma_latency_setup);
+
+void s3c_dma_latency_start(struct snd_pcm_substream *substream)
+{
+	struct s3c_dma_latency *lat = to_latency(substream);
+	unsigned long flags;
+
+	spin_lock_irqsave(&s3c_dma_latency_lock, flags);
+	lat->trigger = ktime_get();
+	lat->last = ktime_set(0, 0);
+	spin_unlock_irqrestore(&s3c_dma_latency_lock, flags);
+}
+EXPORT_SYMBOL_GPL(s3c_dma_latency_start);
+
+void s3c_dma_latency_period(struct snd_pcm_substream *substream)
+{
+	struct s3c_dma_latency *lat = to_latency(substream);
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	s64 delta;
+
+	spin_lock_irqsave(&s3c_dma_latency_lock, flags);
+
+	if (lat->last.tv64 == 0) {
+		if (lat->trigger.tv64 != 0) {
+			delta = ktime_to_ns(ktime_sub(now, lat->trigger)) -
+				lat->period_ns;
+			lat->start_last = delta;
+			lat->start_max = max(lat->start_max, delta);
+			lat->starts++;
+		}
+	} else {
+		delta = ktime_to_ns(ktime_sub(now, lat->last)) - lat->period_ns;
+		if (delta < 0)
+			delta = -delta;
+		lat->jitter_max = max(lat->jitter_max, delta);
+		lat->jitter_total += delta;
+		lat->periods++;
+	}
+	lat->last = now;
+
+	spin_unlock_irqrestore(&s3c_dma_latency_lock, flags);
+}
+EXPORT_SYMBOL_GPL(s3c_dma_latency_period);
+
+/* lead is in bytes past the last period boundary the software knows of */
+void s3c_dma_latency_pointer(struct snd_pcm_substream *substream, long lead)
+{
+	struct s3c_dma_latency *lat = to_latency(substream);
+	unsigned long flags;
+
+	spin_lock_irqsave(&s3c_dma_latency_lock, flags);
+	lat->pointers++;
+	lat->lead_max = max(lat->lead_max, lead);
+	spin_unlock_irqrestore(&s3c_dma_latency_lock, flags);
+}
+EXPORT_SYMBOL_GPL(s3c_dma_latency_pointer);
+
+static int s3c_dma_latency_show(struct seq_file *s, void *unused)
+{
+	static const char *const names[] = { "playback", "capture" };
+	struct s3c_dma_latency lat;
+	unsigned long flags;
+	u64 avg;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(s3c_dma_latency); i++) {
+		spin_lock_irqsave(&s3c_dma_latency_lock, flags);
+		lat = s3c_dma_latency[i];
+		spin_unlock_irqrestore(&s3c_dma_latency_lock, flags);
+
+		if (lat.rate == 0)
+			continue;
+
+		avg = lat.jitter_total;
+		if (lat.periods)
+			do_div(avg, lat.periods);
+
+		seq_printf(s, "%s: %u Hz, period %lu frames (%lld us), buffer %lu frames, %s\n",
+			   names[i], lat.rate, lat.period,
+			   div_s64(lat.period_ns, NSEC_PER_USEC), lat.buffer,
+			   lat.cyclic ? "cyclic" : "queued");
+		seq_printf(s, "  start:   %lu, last %lld us, max %lld us\n",
+			   lat.starts, div_s64(lat.start_last, NSEC_PER_USEC),
+			   div_s64(lat.start_max, NSEC_PER_USEC));
+		seq_printf(s, "  periods: %lu, jitter avg %llu us, max %lld us\n",
+			   lat.periods, div_u64(avg, NSEC_PER_USEC),
+			   div_s64(lat.jitter_max, NSEC_PER_USEC));
+		seq_printf(s, "  pointer: %lu, lead max %ld bytes\n",
+			   lat.pointers, lat.lead_max);
+	}
+
+	return 0;
+}
+
+static int s3c_dma_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s3c_dma_latency_show, inode->i_private);
+}
+
+static ssize_t s3c_dma_latency_write(struct file *file,
+				     const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct s3c_dma_latency *lat;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&s3c_dma_latency_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(s3c_dma_latency); i++) {
+		lat = &s3c_dma_latency[i];
+		lat->starts = lat->periods = lat->pointers = 0;
+		lat->start_last = lat->start_max = 0;
+		lat->jitter_max = 0;
+		lat->jitter_total = 0;
+		lat->lead_max = 0;
+	}
+	spin_unlock_irqrestore(&s3c_dma_latency_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations s3c_dma_latency_fops = {
+	.open		= s3c_dma_latency_open,
+	.read		= seq_read,
+	.write		= s3c_dma_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *s3c_dma_latency_dentry;
+
+static int __init s3c_dma_latency_init(void)
+{
+	s3c_dma_latency_dentry = debugfs_create_file("s3c-pcm-latency",
+				S_IRUGO | S_IWUSR, NULL, NULL,
+				&s3c_dma_latency_fops);
+	return 0;
+}
+module_init(s3c_dma_latency_init);
+
+static void __exit s3c_dma_latency_exit(void)
+{
+	debugfs_remove(s3c_dma_latency_dentry);
+}
+module_exit(s3c_dma_latency_exit);
+
+MODULE_DESCRIPTION("Samsung audio DMA latency measurement");
+MODULE_LICENSE("GPL");
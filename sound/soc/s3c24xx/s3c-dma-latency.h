@@ -0,0 +1,37 @@
+/*
+ *  s3c-dma-latency.h --
+ *
+ *  This program is free software; you can redistribute  it and/or modify it
+ *  under  the terms of  the GNU General  Public License as published by the
+ *  Free Software Foundation;  either version 2 of the  License, or (at your
+ *  option) any later version.
+ *
+ *  Latency measurement for the Samsung audio DMA platform
+ */
+
+#ifndef _S3C_DMA_LATENCY_H
+#define _S3C_DMA_LATENCY_H
+
+#include <sound/pcm.h>
+
+#ifdef CONFIG_SND_S3C_DMA_LATENCY
+extern void s3c_dma_latency_setup(struct snd_pcm_substream *substream,
+				  unsigned int rate,
+				  snd_pcm_uframes_t period,
+				  snd_pcm_uframes_t buffer, int cyclic);
+extern void s3c_dma_latency_start(struct snd_pcm_substream *substream);
+extern void s3c_dma_latency_period(struct snd_pcm_substream *substream);
+extern void s3c_dma_latency_pointer(struct snd_pcm_substream *substream,
+				    long lead);
+#else
+static inline void s3c_dma_latency_setup(struct snd_pcm_substream *substream,
+					 unsigned int rate,
+					 snd_pcm_uframes_t period,
+					 snd_pcm_uframes_t buffer, int cyclic) { }
+static inline void s3c_dma_latency_start(struct snd_pcm_substream *substream) { }
+static inline void s3c_dma_latency_period(struct snd_pcm_substream *substream) { }
+static inline void s3c_dma_latency_pointer(struct snd_pcm_substream *substream,
+					   long lead) { }
+#endif
+
+#endif
@@ -15,6 +15,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/platform_device.h>
@@ -31,6 +32,15 @@
 #include <mach/dma.h>
 
 #include "s3c-dma.h"
+#include "s3c-dma-latency.h"
+
+#ifdef CONFIG_S5P_DMA_PL330
+static int use_cyclic = 1;
+module_param_named(cyclic, use_cyclic, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(cyclic, "Run the whole buffer as one cyclic DMA program, without reloads between periods (default: on)");
+#else
+#define use_cyclic 0
+#endif
 
 static const struct snd_pcm_hardware s3c_dma_hardware = {
 	.info			= SNDRV_PCM_INFO_INTERLEAVED |
@@ -62,6 +72,7 @@ struct s3c24xx_runtime_data {
 	dma_addr_t dma_start;
 	dma_addr_t dma_pos;
 	dma_addr_t dma_end;
+	int cyclic;
 	struct s3c_dma_params *params;
 };
 
@@ -80,6 +91,15 @@ static void s3c_dma_enqueue(struct snd_pcm_substream *substream)
 
 	pr_debug("Entered %s\n", __FUNCTION__);
 
+#ifdef CONFIG_S5P_DMA_PL330
+	if (prtd->cyclic) {
+		s3c2410_dma_enqueue_cyclic(prtd->params->channel, substream,
+				prtd->dma_start, prtd->dma_period,
+				(prtd->dma_end - prtd->dma_start) / prtd->dma_period);
+		return;
+	}
+#endif
+
 	if ((pos + len) > prtd->dma_end) {
 		len  = prtd->dma_end - pos;
 		pr_debug(KERN_DEBUG "%s: corrected dma len %ld\n",
@@ -107,6 +127,8 @@ static void s3c24xx_audio_buffdone(struct s3c2410_dma_chan *channel,
 
 	prtd = substream->runtime->private_data;
 
+	s3c_dma_latency_period(substream);
+
 	/* By Jung */
 	prtd->dma_pos += prtd->dma_period;
 	if (prtd->dma_pos >= prtd->dma_end)
@@ -116,7 +138,8 @@ static void s3c24xx_audio_buffdone(struct s3c2410_dma_chan *channel,
 		snd_pcm_period_elapsed(substream);
 	
 	spin_lock(&prtd->lock);
-	if (prtd->state & ST_RUNNING && !s3c_dma_has_circular()) {
+	if (prtd->state & ST_RUNNING && !prtd->cyclic &&
+	    !s3c_dma_has_circular()) {
 		s3c_dma_enqueue(substream);
 	}
 
@@ -187,6 +210,10 @@ static int s3c_dma_hw_params(struct snd_pcm_substream *substream,
 	printk("DmaAddr=@%x Total=%lubytes PrdSz=%u #Prds=%u, dmaEnd 0x%x\n",
 				runtime->dma_addr, totbytes, params_period_bytes(params), periods, prtd->dma_end);
 
+	s3c_dma_latency_setup(substream, params_rate(params),
+			      params_period_size(params),
+			      bytes_to_frames(runtime, totbytes), prtd->cyclic);
+
 	return 0;
 }
 
@@ -260,6 +287,7 @@ static int s3c_dma_trigger(struct snd_pcm_substream *substream, int cmd)
 	case SNDRV_PCM_TRIGGER_START:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		prtd->state |= ST_RUNNING;
+		s3c_dma_latency_start(substream);
 		s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_START);
 		break;
 
@@ -288,25 +316,44 @@ s3c_dma_pointer(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct s3c24xx_runtime_data *prtd = runtime->private_data;
 	unsigned long res;
-	dma_addr_t src, dst;
+	dma_addr_t src, dst, pos;
+	long lead;
 
 	pr_debug("Entered %s\n", __func__);
 
 	spin_lock(&prtd->lock);
-#if 0
 	s3c2410_dma_getposition(prtd->params->channel, &src, &dst);
 
 	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE)
-		res = dst - prtd->dma_start;
+		pos = dst;
 	else
-		res = src - prtd->dma_start;
-#else
-	res = prtd->dma_pos - prtd->dma_start;
-#endif
+		pos = src;
+
+	/* the address register is only meaningful while the channel is
+	 * inside our buffer; otherwise report the last period boundary,
+	 * which is where the next period will be queued */
+	if (pos < prtd->dma_start || pos >= prtd->dma_end)
+		pos = prtd->dma_pos;
+
+	lead = pos - prtd->dma_pos;
+	if (lead < 0)
+		lead += prtd->dma_end - prtd->dma_start;
+
+	/* a read racing the period interrupt may still see the end of the
+	 * previous period; never let the pointer step backwards */
+	if (lead > prtd->dma_end - prtd->dma_start - prtd->dma_period) {
+		pos = prtd->dma_pos;
+		lead = 0;
+	}
+
+	res = pos - prtd->dma_start;
+
 	spin_unlock(&prtd->lock);
 
 	pr_debug("Pointer %x %x\n", src, dst);
 
+	s3c_dma_latency_pointer(substream, lead);
+
 	/* we seem to be getting the odd error from the pcm library due
 	 * to out-of-bounds pointers. this is maybe due to the dma engine
 	 * not having loaded the new values for the channel before being
@@ -344,6 +391,13 @@ static int s3c_dma_open(struct snd_pcm_substream *substream)
 
 	spin_lock_init(&prtd->lock);
 
+	/* the cyclic program always starts at the top of the buffer, so it
+	 * cannot pick up a paused stream where it left off */
+	prtd->cyclic = use_cyclic;
+	if (prtd->cyclic)
+		runtime->hw.info &= ~(SNDRV_PCM_INFO_PAUSE |
+				      SNDRV_PCM_INFO_RESUME);
+
 	runtime->private_data = prtd;
 	return 0;
 }
@@ -15,6 +15,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/platform_device.h>
@@ -32,6 +33,31 @@
 #include <plat/audio.h>
 
 #include "s3c24xx-pcm.h"
+#include "s3c-dma-latency.h"
+
+#ifdef CONFIG_TOMTOM_NASHVILLE_MIXER
+#include <plat/tt_mixer.h>
+#else
+static inline int tt_mixer_new(struct snd_card *card, struct snd_pcm *pcm)
+{
+	return 0;
+}
+static inline void tt_mixer_carrier_start(struct snd_pcm_substream *substream) {}
+static inline void tt_mixer_carrier_stop(struct snd_pcm_substream *substream) {}
+static inline void tt_mixer_refill(struct snd_pcm_substream *substream,
+				   snd_pcm_uframes_t offset) {}
+#endif
+
+#ifdef CONFIG_S5P_DMA_PL330
+static int use_cyclic = 1;
+module_param_named(cyclic, use_cyclic, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(cyclic, "Run the whole buffer as one cyclic DMA program, without reloads between periods (default: on)");
+#else
+#define use_cyclic 0
+#endif
+
+/* a cyclic ring costs no reload per period, so it can do with large ones */
+#define CYCLIC_PERIOD_BYTES_MAX	(16*1024)
 
 static const struct snd_pcm_hardware s3c24xx_pcm_hardware = {
 	.info			= SNDRV_PCM_INFO_INTERLEAVED |
@@ -63,6 +89,8 @@ struct s3c24xx_runtime_data {
 	dma_addr_t dma_start;
 	dma_addr_t dma_pos;
 	dma_addr_t dma_end;
+	dma_addr_t dma_done;	/* end of the last completed period */
+	int cyclic;
 	struct s3c24xx_pcm_dma_params *params;
 };
 
@@ -80,6 +108,17 @@ static void s3c24xx_pcm_enqueue(struct snd_pcm_substream *substream)
 
 	pr_debug("Entered %s\n", __func__);
 
+#ifdef CONFIG_S5P_DMA_PL330
+	if (prtd->cyclic) {
+		ret = s3c2410_dma_enqueue_cyclic(prtd->params->channel, substream,
+				prtd->dma_start, prtd->dma_period,
+				(prtd->dma_end - prtd->dma_start) / prtd->dma_period);
+		if (ret == 0)
+			prtd->dma_loaded = 1;
+		return;
+	}
+#endif
+
 	if (s3c_dma_has_circular())
 		limit = (prtd->dma_end - prtd->dma_start) / prtd->dma_period;
 	else
@@ -119,6 +158,7 @@ static void s3c24xx_audio_buffdone(struct s3c2410_dma_chan *channel,
 {
 	struct snd_pcm_substream *substream = dev_id;
 	struct s3c24xx_runtime_data *prtd;
+	dma_addr_t next;
 
 	pr_debug("Entered %s\n", __func__);
 
@@ -127,11 +167,29 @@ static void s3c24xx_audio_buffdone(struct s3c2410_dma_chan *channel,
 
 	prtd = substream->runtime->private_data;
 
+	s3c_dma_latency_period(substream);
+
+	spin_lock(&prtd->lock);
+	prtd->dma_done += prtd->dma_period;
+	if (prtd->dma_done >= prtd->dma_end)
+		prtd->dma_done = prtd->dma_start;
+
+	/* the period after the one the DMA is working on now */
+	next = prtd->dma_done + prtd->dma_period;
+	if (next >= prtd->dma_end)
+		next = prtd->dma_start;
+	spin_unlock(&prtd->lock);
+
 	if (substream)
 		snd_pcm_period_elapsed(substream);
 
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		tt_mixer_refill(substream, bytes_to_frames(substream->runtime,
+						next - prtd->dma_start));
+
 	spin_lock(&prtd->lock);
-	if (prtd->state & ST_RUNNING && !s3c_dma_has_circular()) {
+	if (prtd->state & ST_RUNNING && !prtd->cyclic &&
+	    !s3c_dma_has_circular()) {
 		prtd->dma_loaded--;
 		s3c24xx_pcm_enqueue(substream);
 	}
@@ -192,9 +250,14 @@ static int s3c24xx_pcm_hw_params(struct snd_pcm_substream *substream,
 	prtd->dma_period = params_period_bytes(params);
 	prtd->dma_start = runtime->dma_addr;
 	prtd->dma_pos = prtd->dma_start;
+	prtd->dma_done = prtd->dma_start;
 	prtd->dma_end = prtd->dma_start + totbytes;
 	spin_unlock_irq(&prtd->lock);
 
+	s3c_dma_latency_setup(substream, params_rate(params),
+			      params_period_size(params),
+			      params_buffer_size(params), prtd->cyclic);
+
 	return 0;
 }
 
@@ -208,6 +271,8 @@ static int s3c24xx_pcm_hw_free(struct snd_pcm_substream *substream)
 	snd_pcm_set_runtime_buffer(substream, NULL);
 
 	if (prtd->params) {
+		/* a cyclic buffer never completes, drop it with the channel */
+		s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_FLUSH);
 		s3c2410_dma_free(prtd->params->channel, prtd->params->client);
 		prtd->params = NULL;
 	}
@@ -246,6 +311,7 @@ static int s3c24xx_pcm_prepare(struct snd_pcm_substream *substream)
 	s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_FLUSH);
 	prtd->dma_loaded = 0;
 	prtd->dma_pos = prtd->dma_start;
+	prtd->dma_done = prtd->dma_start;
 
 	/* enqueue dma buffers */
 	s3c24xx_pcm_enqueue(substream);
@@ -267,6 +333,8 @@ static int s3c24xx_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 	case SNDRV_PCM_TRIGGER_RESUME:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		prtd->state |= ST_RUNNING;
+		s3c_dma_latency_start(substream);
+		tt_mixer_carrier_start(substream);
 		s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_START);
 		break;
 
@@ -274,6 +342,7 @@ static int s3c24xx_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
 		prtd->state &= ~ST_RUNNING;
+		tt_mixer_carrier_stop(substream);
 		s3c2410_dma_ctrl(prtd->params->channel, S3C2410_DMAOP_STOP);
 		break;
 
@@ -293,7 +362,8 @@ s3c24xx_pcm_pointer(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct s3c24xx_runtime_data *prtd = runtime->private_data;
 	unsigned long res;
-	dma_addr_t src, dst;
+	dma_addr_t src, dst, pos;
+	long lead;
 
 	pr_debug("Entered %s\n", __func__);
 
@@ -301,14 +371,34 @@ s3c24xx_pcm_pointer(struct snd_pcm_substream *substream)
 	s3c2410_dma_getposition(prtd->params->channel, &src, &dst);
 
 	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE)
-		res = dst - prtd->dma_start;
+		pos = dst;
 	else
-		res = src - prtd->dma_start;
+		pos = src;
+
+	/* the address register is only meaningful while the channel is
+	 * inside our buffer; otherwise report the last period boundary */
+	if (pos < prtd->dma_start || pos >= prtd->dma_end)
+		pos = prtd->dma_done;
+
+	lead = pos - prtd->dma_done;
+	if (lead < 0)
+		lead += prtd->dma_end - prtd->dma_start;
+
+	/* a read racing the period interrupt may still see the end of the
+	 * previous period; never let the pointer step backwards */
+	if (lead > prtd->dma_end - prtd->dma_start - prtd->dma_period) {
+		pos = prtd->dma_done;
+		lead = 0;
+	}
+
+	res = pos - prtd->dma_start;
 
 	spin_unlock(&prtd->lock);
 
 	pr_debug("Pointer %x %x\n", src, dst);
 
+	s3c_dma_latency_pointer(substream, lead);
+
 	/* we seem to be getting the odd error from the pcm library due
 	 * to out-of-bounds pointers. this is maybe due to the dma engine
 	 * not having loaded the new values for the channel before being
@@ -339,6 +429,15 @@ static int s3c24xx_pcm_open(struct snd_pcm_substream *substream)
 
 	spin_lock_init(&prtd->lock);
 
+	/* the cyclic program always starts at the top of the buffer, so it
+	 * cannot pick up a paused stream where it left off */
+	prtd->cyclic = use_cyclic;
+	if (prtd->cyclic) {
+		runtime->hw.info &= ~(SNDRV_PCM_INFO_PAUSE |
+				      SNDRV_PCM_INFO_RESUME);
+		runtime->hw.period_bytes_max = CYCLIC_PERIOD_BYTES_MAX;
+	}
+
 	runtime->private_data = prtd;
 	return 0;
 }
@@ -444,6 +543,9 @@ static int s3c24xx_pcm_new(struct snd_card *card,
 			SNDRV_PCM_STREAM_PLAYBACK);
 		if (ret)
 			goto out;
+
+		/* prompts still play through the main device without it */
+		tt_mixer_new(card, pcm);
 	}
 
 	if (dai->capture.channels_min) {